@@ -33,6 +33,7 @@ from qgis.PyQt.QtGui import QIcon
 from qgis.analysis import QgsZonalStatistics
 from qgis.core import (QgsProcessing,
                        QgsProcessingAlgorithm,
+                       QgsProcessingParameterDefinition,
                        QgsProcessingParameterVectorLayer,
                        QgsProcessingParameterRasterLayer,
                        QgsProcessingParameterString,
@@ -52,6 +53,7 @@ class ZonalStatistics(QgisAlgorithm):
     INPUT_VECTOR = 'INPUT_VECTOR'
     COLUMN_PREFIX = 'COLUMN_PREFIX'
     STATISTICS = 'STATS'
+    METHOD = 'METHOD'
 
     def icon(self):
         return QIcon(os.path.join(pluginPath, 'images', 'zonalstats.png'))
@@ -70,6 +72,7 @@ class ZonalStatistics(QgisAlgorithm):
         self.bandNumber = None
         self.columnPrefix = None
         self.selectedStats = None
+        self.method = None
         self.vectorLayer = None
         self.raster_interface = None
         self.raster_crs = None
@@ -107,6 +110,15 @@ class ZonalStatistics(QgisAlgorithm):
                                                      self.tr('Statistics to calculate'),
                                                      keys,
                                                      allowMultiple=True, defaultValue=[0, 1, 2]))
+
+        self.methods = [(self.tr('Read the raster in a single pass'), QgsZonalStatistics.SinglePass),
+                        (self.tr('Read the raster separately for each zone'), QgsZonalStatistics.PerFeature)]
+        method_param = QgsProcessingParameterEnum(self.METHOD,
+                                                  self.tr('Raster reading method'),
+                                                  [m[0] for m in self.methods],
+                                                  defaultValue=0)
+        method_param.setFlags(method_param.flags() | QgsProcessingParameterDefinition.FlagAdvanced)
+        self.addParameter(method_param)
         self.addOutput(QgsProcessingOutputVectorLayer(self.INPUT_VECTOR,
                                                       self.tr('Zonal statistics'),
                                                       QgsProcessing.TypeVectorPolygon))
@@ -127,6 +139,8 @@ class ZonalStatistics(QgisAlgorithm):
         for i in st:
             self.selectedStats |= self.STATS[keys[i]]
 
+        self.method = self.methods[self.parameterAsEnum(parameters, self.METHOD, context)][1]
+
         self.vectorLayer = self.parameterAsVectorLayer(parameters, self.INPUT_VECTOR, context)
         rasterLayer = self.parameterAsRasterLayer(parameters, self.INPUT_RASTER, context)
         self.raster_interface = rasterLayer.dataProvider().clone()
@@ -144,5 +158,6 @@ class ZonalStatistics(QgisAlgorithm):
                                 self.columnPrefix,
                                 self.bandNumber,
                                 QgsZonalStatistics.Statistics(self.selectedStats))
+        zs.setMethod(self.method)
         zs.calculateStatistics(feedback)
         return {self.INPUT_VECTOR: self.vectorLayer}
@@ -0,0 +1,94 @@
+/***************************************************************************
+  qgscompactgraph.cpp
+  --------------------------------------
+  Date                 : October 2026
+  Copyright            : (C) 2026 by QGIS contributors
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#include <algorithm>
+
+#include "qgscompactgraph.h"
+#include "qgsgraph.h"
+
+QgsCompactGraph::QgsCompactGraph( const QgsGraph &graph )
+  : mVertexCount( graph.vertexCount() )
+{
+  const int edgeCount = graph.edgeCount();
+  for ( int i = 0; i < edgeCount; ++i )
+  {
+    mStrategyCount = std::max( mStrategyCount, graph.edge( i ).strategies().size() );
+  }
+
+  // count outgoing edges per vertex, then turn the counts into row offsets
+  mRowOffsets.assign( static_cast< std::size_t >( mVertexCount ) + 1, 0 );
+  mEdgeFrom.resize( edgeCount );
+  for ( int i = 0; i < edgeCount; ++i )
+  {
+    const int from = graph.edge( i ).fromVertex();
+    mEdgeFrom[ i ] = from;
+    mRowOffsets[ from + 1 ]++;
+  }
+  for ( int v = 0; v < mVertexCount; ++v )
+  {
+    mRowOffsets[ v + 1 ] += mRowOffsets[ v ];
+  }
+
+  mRowTargets.resize( edgeCount );
+  mRowEdges.resize( edgeCount );
+  mEdgeRows.resize( edgeCount );
+  mRowCosts.assign( static_cast< std::size_t >( edgeCount ) * mStrategyCount, 0.0 );
+
+  // fill rows, keeping the outgoing edge order of each vertex identical to the source graph
+  std::vector< int > nextInRow( mRowOffsets.begin(), mRowOffsets.end() - 1 );
+  for ( int i = 0; i < edgeCount; ++i )
+  {
+    const QgsGraphEdge &edge = graph.edge( i );
+    const int row = nextInRow[ edge.fromVertex() ]++;
+    mRowTargets[ row ] = edge.toVertex();
+    mRowEdges[ row ] = i;
+    mEdgeRows[ i ] = row;
+
+    const QVector< QVariant > strategies = edge.strategies();
+    for ( int s = 0; s < strategies.size(); ++s )
+    {
+      mRowCosts[ static_cast< std::size_t >( s ) * edgeCount + row ] = strategies.at( s ).toDouble();
+    }
+  }
+}
+
+int QgsCompactGraph::vertexCount() const
+{
+  return mVertexCount;
+}
+
+int QgsCompactGraph::edgeCount() const
+{
+  return static_cast< int >( mRowEdges.size() );
+}
+
+int QgsCompactGraph::strategyCount() const
+{
+  return mStrategyCount;
+}
+
+int QgsCompactGraph::fromVertex( int edgeIdx ) const
+{
+  return mEdgeFrom[ edgeIdx ];
+}
+
+int QgsCompactGraph::toVertex( int edgeIdx ) const
+{
+  return mRowTargets[ mEdgeRows[ edgeIdx ] ];
+}
+
+double QgsCompactGraph::cost( int edgeIdx, int strategyIndex ) const
+{
+  return mRowCosts[ static_cast< std::size_t >( strategyIndex ) * mRowEdges.size() + mEdgeRows[ edgeIdx ] ];
+}
@@ -0,0 +1,113 @@
+/***************************************************************************
+  qgscompactgraph.h
+  --------------------------------------
+  Date                 : October 2026
+  Copyright            : (C) 2026 by QGIS contributors
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#ifndef QGSCOMPACTGRAPH_H
+#define QGSCOMPACTGRAPH_H
+
+#include <vector>
+
+#include "qgis_sip.h"
+#include "qgis_analysis.h"
+
+class QgsGraph;
+
+/**
+ * \ingroup analysis
+ * \class QgsCompactGraph
+ * \brief A read-only, cache friendly representation of a QgsGraph.
+ *
+ * The outgoing edges of all vertices are stored in compressed sparse row (CSR) form,
+ * and the edge costs for each strategy are converted once to a contiguous array of
+ * doubles. This avoids the QVariant conversions and scattered memory accesses required
+ * when traversing a QgsGraph, and is intended for repeated shortest path searches
+ * over the same graph.
+ *
+ * Vertex and edge indices are identical to the indices used by the source QgsGraph.
+ *
+ * \see QgsGraphAnalyzer::dijkstra()
+ * \since QGIS 3.6
+ */
+class ANALYSIS_EXPORT QgsCompactGraph
+{
+  public:
+
+    /**
+     * Constructor for an empty QgsCompactGraph.
+     */
+    QgsCompactGraph() = default;
+
+    /**
+     * Constructor for QgsCompactGraph, built from the specified source \a graph.
+     *
+     * The compact graph does not keep a reference to \a graph, so it remains valid
+     * after the source graph is destroyed.
+     */
+    explicit QgsCompactGraph( const QgsGraph &graph );
+
+    /**
+     * Returns the number of graph vertices.
+     */
+    int vertexCount() const;
+
+    /**
+     * Returns the number of graph edges.
+     */
+    int edgeCount() const;
+
+    /**
+     * Returns the number of cost strategies stored for each edge.
+     */
+    int strategyCount() const;
+
+    /**
+     * Returns the index of the vertex at the start of the edge with index \a edgeIdx.
+     * \see toVertex()
+     */
+    int fromVertex( int edgeIdx ) const;
+
+    /**
+     * Returns the index of the vertex at the end of the edge with index \a edgeIdx.
+     * \see fromVertex()
+     */
+    int toVertex( int edgeIdx ) const;
+
+    /**
+     * Returns the cost of the edge with index \a edgeIdx, calculated using
+     * the specified \a strategyIndex.
+     */
+    double cost( int edgeIdx, int strategyIndex ) const;
+
+  private:
+
+    int mVertexCount = 0;
+    int mStrategyCount = 0;
+
+    //! Start of the outgoing edges of each vertex within the row arrays, size vertexCount + 1
+    std::vector< int > mRowOffsets;
+    //! Destination vertex of each outgoing edge, in row order
+    std::vector< int > mRowTargets;
+    //! Original edge index of each outgoing edge, in row order
+    std::vector< int > mRowEdges;
+    //! Edge costs in row order, one contiguous block of edgeCount values per strategy
+    std::vector< double > mRowCosts;
+
+    //! Position of each original edge within the row arrays
+    std::vector< int > mEdgeRows;
+    //! Start vertex of each original edge
+    std::vector< int > mEdgeFrom;
+
+    friend class QgsGraphAnalyzer;
+};
+
+#endif // QGSCOMPACTGRAPH_H
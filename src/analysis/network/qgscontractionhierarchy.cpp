@@ -0,0 +1,542 @@
+/***************************************************************************
+  qgscontractionhierarchy.cpp
+  --------------------------------------
+  Date                 : October 2026
+  Copyright            : (C) 2026 by QGIS contributors
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                   *
+*                                                                          *
+***************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+
+#include "qgscontractionhierarchy.h"
+#include "qgscompactgraph.h"
+#include "qgsfeedback.h"
+#include "qgis.h"
+
+///@cond PRIVATE
+
+//! File format identifier ("QGCH") and version
+static const quint32 CH_FILE_MAGIC = 0x51474348;
+static const quint32 CH_FILE_VERSION = 2;
+
+//! Maximum number of vertices settled by a single witness search
+static const int CH_WITNESS_SETTLE_LIMIT = 500;
+
+//! Maximum number of vertices settled by a witness search when only estimating the contraction priority
+static const int CH_SIMULATE_SETTLE_LIMIT = 50;
+
+typedef std::pair< double, int > QgsCostVertexPair;
+typedef std::priority_queue< QgsCostVertexPair, std::vector< QgsCostVertexPair >, std::greater< QgsCostVertexPair > > QgsCostVertexQueue;
+
+/**
+ * Working state for contracting a graph. Arcs to contracted vertices are kept in the
+ * adjacency lists, as they form the final hierarchy.
+ */
+class QgsContractionBuilder
+{
+  public:
+
+    struct Arc
+    {
+      int vertex;
+      double cost;
+    };
+
+    explicit QgsContractionBuilder( int vertexCount )
+      : mOut( vertexCount )
+      , mIn( vertexCount )
+      , mContracted( vertexCount, false )
+      , mDeletedNeighbors( vertexCount, 0 )
+      , mLevels( vertexCount, 0 )
+      , mWitnessCost( vertexCount, std::numeric_limits< double >::infinity() )
+    {}
+
+    /**
+     * Adds an arc from \a from to \a to, or lowers the cost of an existing one.
+     * Returns false if an existing arc is already at least as cheap.
+     */
+    bool addArc( int from, int to, double cost )
+    {
+      for ( Arc &arc : mOut[ from ] )
+      {
+        if ( arc.vertex != to )
+          continue;
+
+        if ( arc.cost <= cost )
+          return false;
+
+        arc.cost = cost;
+        for ( Arc &reverse : mIn[ to ] )
+        {
+          if ( reverse.vertex == from )
+            reverse.cost = std::min( reverse.cost, cost );
+        }
+        return true;
+      }
+      mOut[ from ].push_back( Arc{ to, cost } );
+      mIn[ to ].push_back( Arc{ from, cost } );
+      return true;
+    }
+
+    /**
+     * Contracts \a vertex, or only counts the required shortcuts if \a simulate is true.
+     * Returns the number of shortcuts required.
+     */
+    int contract( int vertex, bool simulate )
+    {
+      int shortcuts = 0;
+
+      double maxOutCost = 0;
+      for ( const Arc &out : mOut[ vertex ] )
+      {
+        if ( !mContracted[ out.vertex ] )
+          maxOutCost = std::max( maxOutCost, out.cost );
+      }
+
+      // copy, as adding shortcuts may reallocate the adjacency lists
+      const std::vector< Arc > incoming = mIn[ vertex ];
+      const std::vector< Arc > outgoing = mOut[ vertex ];
+      for ( const Arc &in : incoming )
+      {
+        if ( mContracted[ in.vertex ] || in.vertex == vertex )
+          continue;
+
+        witnessSearch( in.vertex, vertex, in.cost + maxOutCost, simulate ? CH_SIMULATE_SETTLE_LIMIT : CH_WITNESS_SETTLE_LIMIT );
+        for ( const Arc &out : outgoing )
+        {
+          if ( mContracted[ out.vertex ] || out.vertex == in.vertex || out.vertex == vertex )
+            continue;
+
+          const double viaCost = in.cost + out.cost;
+          if ( mWitnessCost[ out.vertex ] <= viaCost )
+            continue;
+
+          if ( simulate )
+            shortcuts++;
+          else if ( addArc( in.vertex, out.vertex, viaCost ) )
+            shortcuts++;
+        }
+        clearWitnessSearch();
+      }
+
+      if ( !simulate )
+      {
+        mContracted[ vertex ] = true;
+        for ( const Arc &in : mIn[ vertex ] )
+        {
+          mDeletedNeighbors[ in.vertex ]++;
+          mLevels[ in.vertex ] = std::max( mLevels[ in.vertex ], mLevels[ vertex ] + 1 );
+        }
+        for ( const Arc &out : mOut[ vertex ] )
+        {
+          mDeletedNeighbors[ out.vertex ]++;
+          mLevels[ out.vertex ] = std::max( mLevels[ out.vertex ], mLevels[ vertex ] + 1 );
+        }
+      }
+      return shortcuts;
+    }
+
+    //! Returns the contraction priority of \a vertex, lower values are contracted first
+    int priority( int vertex )
+    {
+      int removedArcs = 0;
+      for ( const Arc &in : mIn[ vertex ] )
+      {
+        if ( !mContracted[ in.vertex ] )
+          removedArcs++;
+      }
+      for ( const Arc &out : mOut[ vertex ] )
+      {
+        if ( !mContracted[ out.vertex ] )
+          removedArcs++;
+      }
+      return 2 * ( contract( vertex, true ) - removedArcs ) + mDeletedNeighbors[ vertex ] + mLevels[ vertex ];
+    }
+
+    std::vector< std::vector< Arc > > mOut;
+    std::vector< std::vector< Arc > > mIn;
+    std::vector< bool > mContracted;
+
+  private:
+
+    //! Dijkstra search from \a source over uncontracted vertices, ignoring \a excluded and stopping after \a maxCost
+    void witnessSearch( int source, int excluded, double maxCost, int settleLimit )
+    {
+      QgsCostVertexQueue queue;
+      mWitnessCost[ source ] = 0;
+      mTouched.push_back( source );
+      queue.push( QgsCostVertexPair( 0, source ) );
+
+      int settled = 0;
+      while ( !queue.empty() && settled < settleLimit )
+      {
+        const QgsCostVertexPair top = queue.top();
+        queue.pop();
+        if ( top.first > mWitnessCost[ top.second ] )
+          continue;
+        if ( top.first > maxCost )
+          break;
+
+        settled++;
+        for ( const Arc &arc : mOut[ top.second ] )
+        {
+          if ( arc.vertex == excluded || mContracted[ arc.vertex ] )
+            continue;
+
+          const double cost = top.first + arc.cost;
+          if ( cost < mWitnessCost[ arc.vertex ] )
+          {
+            if ( std::isinf( mWitnessCost[ arc.vertex ] ) )
+              mTouched.push_back( arc.vertex );
+            mWitnessCost[ arc.vertex ] = cost;
+            queue.push( QgsCostVertexPair( cost, arc.vertex ) );
+          }
+        }
+      }
+    }
+
+    void clearWitnessSearch()
+    {
+      for ( int vertex : mTouched )
+        mWitnessCost[ vertex ] = std::numeric_limits< double >::infinity();
+      mTouched.clear();
+    }
+
+    std::vector< int > mDeletedNeighbors;
+    std::vector< int > mLevels;
+    std::vector< double > mWitnessCost;
+    std::vector< int > mTouched;
+};
+
+///@endcond
+
+QgsContractionHierarchy::QgsContractionHierarchy( const QgsCompactGraph &graph, int criterionNum, QgsFeedback *feedback )
+  : mVertexCount( graph.vertexCount() )
+{
+  if ( criterionNum < 0 || ( graph.edgeCount() > 0 && criterionNum >= graph.strategyCount() ) )
+    return;
+
+  mGraphHash = hashGraph( graph, criterionNum );
+
+  QgsContractionBuilder builder( mVertexCount );
+  for ( int i = 0; i < graph.edgeCount(); ++i )
+  {
+    const int from = graph.fromVertex( i );
+    const int to = graph.toVertex( i );
+    if ( from != to )
+      builder.addArc( from, to, graph.cost( i, criterionNum ) );
+  }
+
+  // contract vertices in order of increasing priority, updating priorities of neighbors after each
+  // contraction and lazily re-checking the priority of each vertex as it is popped
+  std::vector< int > priorities( mVertexCount );
+  std::priority_queue< std::pair< int, int >, std::vector< std::pair< int, int > >, std::greater< std::pair< int, int > > > queue;
+  for ( int v = 0; v < mVertexCount; ++v )
+  {
+    priorities[ v ] = builder.priority( v );
+    queue.push( std::make_pair( priorities[ v ], v ) );
+  }
+
+  std::vector< int > rank( mVertexCount, 0 );
+  int contracted = 0;
+  while ( !queue.empty() )
+  {
+    const std::pair< int, int > top = queue.top();
+    queue.pop();
+    const int vertex = top.second;
+    if ( builder.mContracted[ vertex ] || top.first != priorities[ vertex ] )
+      continue;
+
+    const int priority = builder.priority( vertex );
+    if ( !queue.empty() && priority > queue.top().first )
+    {
+      priorities[ vertex ] = priority;
+      queue.push( std::make_pair( priority, vertex ) );
+      continue;
+    }
+
+    mShortcutCount += builder.contract( vertex, false );
+    rank[ vertex ] = contracted++;
+
+    // contracting a vertex mostly affects the priority of its direct neighbors
+    for ( const std::vector< QgsContractionBuilder::Arc > *arcs : { &builder.mIn[ vertex ], &builder.mOut[ vertex ] } )
+    {
+      for ( const QgsContractionBuilder::Arc &arc : *arcs )
+      {
+        if ( builder.mContracted[ arc.vertex ] )
+          continue;
+
+        const int neighborPriority = builder.priority( arc.vertex );
+        if ( neighborPriority != priorities[ arc.vertex ] )
+        {
+          priorities[ arc.vertex ] = neighborPriority;
+          queue.push( std::make_pair( neighborPriority, arc.vertex ) );
+        }
+      }
+    }
+
+    if ( feedback && contracted % 1000 == 0 )
+    {
+      if ( feedback->isCanceled() )
+        return;
+      feedback->setProgress( 100.0 * contracted / mVertexCount );
+    }
+  }
+
+  // split arcs into upward arcs for the forward search and reversed downward arcs for the backward search
+  mUpOffsets.fill( 0, mVertexCount + 1 );
+  mDownOffsets.fill( 0, mVertexCount + 1 );
+  for ( int v = 0; v < mVertexCount; ++v )
+  {
+    for ( const QgsContractionBuilder::Arc &arc : builder.mOut[ v ] )
+    {
+      if ( rank[ arc.vertex ] > rank[ v ] )
+        mUpOffsets[ v + 1 ]++;
+    }
+    for ( const QgsContractionBuilder::Arc &arc : builder.mIn[ v ] )
+    {
+      if ( rank[ arc.vertex ] > rank[ v ] )
+        mDownOffsets[ v + 1 ]++;
+    }
+  }
+  for ( int v = 0; v < mVertexCount; ++v )
+  {
+    mUpOffsets[ v + 1 ] += mUpOffsets[ v ];
+    mDownOffsets[ v + 1 ] += mDownOffsets[ v ];
+  }
+
+  mUpTargets.resize( mUpOffsets.last() );
+  mUpCosts.resize( mUpOffsets.last() );
+  mDownTargets.resize( mDownOffsets.last() );
+  mDownCosts.resize( mDownOffsets.last() );
+  for ( int v = 0; v < mVertexCount; ++v )
+  {
+    int upRow = mUpOffsets.at( v );
+    for ( const QgsContractionBuilder::Arc &arc : builder.mOut[ v ] )
+    {
+      if ( rank[ arc.vertex ] > rank[ v ] )
+      {
+        mUpTargets[ upRow ] = arc.vertex;
+        mUpCosts[ upRow ] = arc.cost;
+        upRow++;
+      }
+    }
+    int downRow = mDownOffsets.at( v );
+    for ( const QgsContractionBuilder::Arc &arc : builder.mIn[ v ] )
+    {
+      if ( rank[ arc.vertex ] > rank[ v ] )
+      {
+        mDownTargets[ downRow ] = arc.vertex;
+        mDownCosts[ downRow ] = arc.cost;
+        downRow++;
+      }
+    }
+  }
+
+  mValid = true;
+}
+
+bool QgsContractionHierarchy::isValid() const
+{
+  return mValid;
+}
+
+int QgsContractionHierarchy::vertexCount() const
+{
+  return mVertexCount;
+}
+
+int QgsContractionHierarchy::shortcutCount() const
+{
+  return mShortcutCount;
+}
+
+QByteArray QgsContractionHierarchy::hashGraph( const QgsCompactGraph &graph, int criterionNum )
+{
+  QCryptographicHash hash( QCryptographicHash::Sha1 );
+  const qint32 header[3] = { graph.vertexCount(), graph.edgeCount(), criterionNum };
+  hash.addData( reinterpret_cast< const char * >( header ), sizeof( header ) );
+  for ( int i = 0; i < graph.edgeCount(); ++i )
+  {
+    const qint32 vertices[2] = { graph.fromVertex( i ), graph.toVertex( i ) };
+    const double cost = criterionNum < graph.strategyCount() ? graph.cost( i, criterionNum ) : 0;
+    hash.addData( reinterpret_cast< const char * >( vertices ), sizeof( vertices ) );
+    hash.addData( reinterpret_cast< const char * >( &cost ), sizeof( cost ) );
+  }
+  return hash.result();
+}
+
+QByteArray QgsContractionHierarchy::graphHash() const
+{
+  return mGraphHash;
+}
+
+double QgsContractionHierarchy::shortestPathCost( int fromVertexIdx, int toVertexIdx ) const
+{
+  const double infinity = std::numeric_limits< double >::infinity();
+  if ( !mValid || fromVertexIdx < 0 || fromVertexIdx >= mVertexCount || toVertexIdx < 0 || toVertexIdx >= mVertexCount )
+    return infinity;
+
+  if ( fromVertexIdx == toVertexIdx )
+    return 0.0;
+
+  // search spaces in a hierarchy are tiny, so per query hash maps are cheaper than
+  // vertex sized arrays and keep queries free of shared state
+  std::unordered_map< int, double > forwardCost;
+  std::unordered_map< int, double > backwardCost;
+  QgsCostVertexQueue forwardQueue;
+  QgsCostVertexQueue backwardQueue;
+
+  forwardCost[ fromVertexIdx ] = 0.0;
+  backwardCost[ toVertexIdx ] = 0.0;
+  forwardQueue.push( QgsCostVertexPair( 0.0, fromVertexIdx ) );
+  backwardQueue.push( QgsCostVertexPair( 0.0, toVertexIdx ) );
+
+  double best = infinity;
+
+  auto step = [&best]( QgsCostVertexQueue & queue, std::unordered_map< int, double > &cost, const std::unordered_map< int, double > &otherCost,
+                       const QVector< int > &offsets, const QVector< int > &targets, const QVector< double > &costs )
+  {
+    const QgsCostVertexPair top = queue.top();
+    queue.pop();
+    if ( top.first > cost[ top.second ] )
+      return;
+
+    const auto other = otherCost.find( top.second );
+    if ( other != otherCost.end() )
+      best = std::min( best, top.first + other->second );
+
+    const int rowEnd = offsets.at( top.second + 1 );
+    for ( int row = offsets.at( top.second ); row < rowEnd; ++row )
+    {
+      const double newCost = top.first + costs.at( row );
+      const auto it = cost.find( targets.at( row ) );
+      if ( it == cost.end() )
+      {
+        cost.emplace( targets.at( row ), newCost );
+        queue.push( QgsCostVertexPair( newCost, targets.at( row ) ) );
+      }
+      else if ( newCost < it->second )
+      {
+        it->second = newCost;
+        queue.push( QgsCostVertexPair( newCost, targets.at( row ) ) );
+      }
+    }
+  };
+
+  while ( true )
+  {
+    const bool forwardDone = forwardQueue.empty() || forwardQueue.top().first >= best;
+    const bool backwardDone = backwardQueue.empty() || backwardQueue.top().first >= best;
+    if ( forwardDone && backwardDone )
+      break;
+
+    if ( !forwardDone )
+      step( forwardQueue, forwardCost, backwardCost, mUpOffsets, mUpTargets, mUpCosts );
+    if ( !backwardDone )
+      step( backwardQueue, backwardCost, forwardCost, mDownOffsets, mDownTargets, mDownCosts );
+  }
+
+  return best;
+}
+
+bool QgsContractionHierarchy::writeToFile( const QString &path ) const
+{
+  if ( !mValid )
+    return false;
+
+  QFile file( path );
+  if ( !file.open( QIODevice::WriteOnly ) )
+    return false;
+
+  QDataStream stream( &file );
+  stream.setVersion( QDataStream::Qt_5_0 );
+  stream << CH_FILE_MAGIC << CH_FILE_VERSION;
+  stream << static_cast< qint32 >( mVertexCount ) << static_cast< qint32 >( mShortcutCount );
+  stream << mGraphHash;
+  stream << mUpOffsets << mUpTargets << mUpCosts;
+  stream << mDownOffsets << mDownTargets << mDownCosts;
+  return stream.status() == QDataStream::Ok;
+}
+
+bool QgsContractionHierarchy::readFromFile( const QString &path )
+{
+  QFile file( path );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return false;
+
+  QDataStream stream( &file );
+  stream.setVersion( QDataStream::Qt_5_0 );
+  quint32 magic = 0;
+  quint32 version = 0;
+  stream >> magic >> version;
+  if ( magic != CH_FILE_MAGIC || version != CH_FILE_VERSION )
+    return false;
+
+  qint32 vertexCount = 0;
+  qint32 shortcutCount = 0;
+  QByteArray graphHash;
+  QVector< int > upOffsets;
+  QVector< int > upTargets;
+  QVector< double > upCosts;
+  QVector< int > downOffsets;
+  QVector< int > downTargets;
+  QVector< double > downCosts;
+  stream >> vertexCount >> shortcutCount;
+  stream >> graphHash;
+  stream >> upOffsets >> upTargets >> upCosts;
+  stream >> downOffsets >> downTargets >> downCosts;
+  if ( stream.status() != QDataStream::Ok || vertexCount < 0 || shortcutCount < 0 )
+    return false;
+
+  // guard against corrupt files, queries index directly into these arrays
+  auto isValidAdjacency = [vertexCount]( const QVector< int > &offsets, const QVector< int > &targets, const QVector< double > &costs )
+  {
+    if ( offsets.size() != vertexCount + 1 || offsets.at( 0 ) != 0
+         || offsets.last() != targets.size() || costs.size() != targets.size() )
+      return false;
+
+    // offsets must be monotonic, which keeps all of them within the target array
+    for ( int v = 0; v < vertexCount; ++v )
+    {
+      if ( offsets.at( v ) > offsets.at( v + 1 ) )
+        return false;
+    }
+    for ( int target : targets )
+    {
+      if ( target < 0 || target >= vertexCount )
+        return false;
+    }
+    return true;
+  };
+  if ( !isValidAdjacency( upOffsets, upTargets, upCosts ) || !isValidAdjacency( downOffsets, downTargets, downCosts ) )
+    return false;
+
+  mVertexCount = vertexCount;
+  mShortcutCount = shortcutCount;
+  mGraphHash = graphHash;
+  mUpOffsets = upOffsets;
+  mUpTargets = upTargets;
+  mUpCosts = upCosts;
+  mDownOffsets = downOffsets;
+  mDownTargets = downTargets;
+  mDownCosts = downCosts;
+  mValid = true;
+  return true;
+}
@@ -0,0 +1,135 @@
+/***************************************************************************
+  qgscontractionhierarchy.h
+  --------------------------------------
+  Date                 : October 2026
+  Copyright            : (C) 2026 by QGIS contributors
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                   *
+*                                                                          *
+***************************************************************************/
+
+#ifndef QGSCONTRACTIONHIERARCHY_H
+#define QGSCONTRACTIONHIERARCHY_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QString>
+
+#include "qgis_sip.h"
+#include "qgis_analysis.h"
+
+class QgsCompactGraph;
+class QgsFeedback;
+
+/**
+ * \ingroup analysis
+ * \class QgsContractionHierarchy
+ * \brief A preprocessed routing index for fast repeated point to point queries.
+ *
+ * A contraction hierarchy is built once from a graph and a cost strategy. Vertices are
+ * contracted one by one in order of importance, adding shortcut edges which preserve the
+ * shortest path costs between the remaining vertices. Queries then run a bidirectional
+ * search which only ever moves towards more important vertices, touching a tiny fraction
+ * of the graph compared to a full Dijkstra search.
+ *
+ * The hierarchy can be saved to disk with writeToFile() and loaded again with readFromFile(),
+ * avoiding the preprocessing cost for subsequent jobs over the same graph. Comparing graphHash()
+ * with hashGraph() checks whether a loaded hierarchy matches a graph.
+ *
+ * Queries do not modify the hierarchy, so shortestPathCost() may be called concurrently
+ * from multiple threads.
+ *
+ * \since QGIS 3.6
+ */
+class ANALYSIS_EXPORT QgsContractionHierarchy
+{
+  public:
+
+    /**
+     * Constructor for an invalid, empty QgsContractionHierarchy.
+     */
+    QgsContractionHierarchy() = default;
+
+    /**
+     * Constructor for QgsContractionHierarchy. Builds the hierarchy for the specified \a graph,
+     * using the edge costs from the strategy with index \a criterionNum.
+     *
+     * An optional \a feedback object can be used to report progress and cancel the build. If the
+     * build is canceled the resulting hierarchy will be invalid.
+     */
+    QgsContractionHierarchy( const QgsCompactGraph &graph, int criterionNum, QgsFeedback *feedback = nullptr );
+
+    /**
+     * Returns true if the hierarchy was successfully built or loaded.
+     */
+    bool isValid() const;
+
+    /**
+     * Returns the number of vertices in the hierarchy, which matches the vertex
+     * count of the graph it was built from.
+     */
+    int vertexCount() const;
+
+    /**
+     * Returns the number of shortcut edges which were added during preprocessing.
+     */
+    int shortcutCount() const;
+
+    /**
+     * Returns the cost of the shortest path going from the vertex with index \a fromVertexIdx
+     * to the vertex with index \a toVertexIdx.
+     *
+     * Returns infinity if the target vertex cannot be reached or either index is invalid.
+     */
+    double shortestPathCost( int fromVertexIdx, int toVertexIdx ) const;
+
+    /**
+     * Writes the hierarchy to the file at \a path.
+     * \returns true if the file was successfully written
+     * \see readFromFile()
+     */
+    bool writeToFile( const QString &path ) const;
+
+    /**
+     * Reads a hierarchy previously saved with writeToFile() from the file at \a path.
+     * \returns true if the file was successfully read
+     * \see writeToFile()
+     */
+    bool readFromFile( const QString &path );
+
+    /**
+     * Returns a hash of the vertices, the edges and the edge costs from the strategy with index
+     * \a criterionNum of a \a graph. Hierarchies built from graphs with the same hash are identical.
+     * \see graphHash()
+     */
+    static QByteArray hashGraph( const QgsCompactGraph &graph, int criterionNum );
+
+    /**
+     * Returns the hash of the graph the hierarchy was built from, as returned by hashGraph().
+     * The hash is saved by writeToFile() and restored by readFromFile().
+     */
+    QByteArray graphHash() const;
+
+  private:
+
+    bool mValid = false;
+    int mVertexCount = 0;
+    int mShortcutCount = 0;
+    QByteArray mGraphHash;
+
+    //! Edges leading to more important vertices, in compressed sparse row form
+    QVector< int > mUpOffsets;
+    QVector< int > mUpTargets;
+    QVector< double > mUpCosts;
+
+    //! Reversed edges arriving from more important vertices, in compressed sparse row form
+    QVector< int > mDownOffsets;
+    QVector< int > mDownTargets;
+    QVector< double > mDownCosts;
+};
+
+#endif // QGSCONTRACTIONHIERARCHY_H
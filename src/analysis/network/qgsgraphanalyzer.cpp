@@ -20,8 +20,108 @@
 #include <QPair>
 
 #include "qgsgraph.h"
+#include "qgscompactgraph.h"
 #include "qgsgraphanalyzer.h"
 
+///@cond PRIVATE
+
+/**
+ * Binary min-heap of vertex indices keyed by path cost, supporting
+ * decrease-key through a vertex to heap position index.
+ */
+class QgsVertexCostHeap
+{
+  public:
+
+    explicit QgsVertexCostHeap( int vertexCount )
+      : mPositions( vertexCount, -1 )
+    {}
+
+    bool isEmpty() const { return mEntries.empty(); }
+
+    //! Inserts \a vertex with \a cost, or lowers the cost of \a vertex if it is already queued
+    void push( int vertex, double cost )
+    {
+      int pos = mPositions[ vertex ];
+      if ( pos < 0 )
+      {
+        pos = static_cast< int >( mEntries.size() );
+        mEntries.push_back( Entry{ cost, vertex } );
+      }
+      else
+      {
+        mEntries[ pos ].cost = cost;
+      }
+      siftUp( pos );
+    }
+
+    //! Removes the vertex with the lowest cost and returns it
+    int pop()
+    {
+      const int vertex = mEntries.front().vertex;
+      mPositions[ vertex ] = -1;
+      const Entry last = mEntries.back();
+      mEntries.pop_back();
+      if ( !mEntries.empty() )
+      {
+        mEntries[ 0 ] = last;
+        mPositions[ last.vertex ] = 0;
+        siftDown( 0 );
+      }
+      return vertex;
+    }
+
+  private:
+
+    struct Entry
+    {
+      double cost;
+      int vertex;
+    };
+
+    void siftUp( int pos )
+    {
+      const Entry entry = mEntries[ pos ];
+      while ( pos > 0 )
+      {
+        const int parent = ( pos - 1 ) / 2;
+        if ( mEntries[ parent ].cost <= entry.cost )
+          break;
+        mEntries[ pos ] = mEntries[ parent ];
+        mPositions[ mEntries[ pos ].vertex ] = pos;
+        pos = parent;
+      }
+      mEntries[ pos ] = entry;
+      mPositions[ entry.vertex ] = pos;
+    }
+
+    void siftDown( int pos )
+    {
+      const int size = static_cast< int >( mEntries.size() );
+      const Entry entry = mEntries[ pos ];
+      while ( true )
+      {
+        int child = 2 * pos + 1;
+        if ( child >= size )
+          break;
+        if ( child + 1 < size && mEntries[ child + 1 ].cost < mEntries[ child ].cost )
+          child++;
+        if ( entry.cost <= mEntries[ child ].cost )
+          break;
+        mEntries[ pos ] = mEntries[ child ];
+        mPositions[ mEntries[ pos ].vertex ] = pos;
+        pos = child;
+      }
+      mEntries[ pos ] = entry;
+      mPositions[ entry.vertex ] = pos;
+    }
+
+    std::vector< Entry > mEntries;
+    std::vector< int > mPositions;
+};
+
+///@endcond
+
 void QgsGraphAnalyzer::dijkstra( const QgsGraph *source, int startPointIdx, int criterionNum, QVector<int> *resultTree, QVector<double> *resultCost )
 {
   if ( startPointIdx < 0 || startPointIdx >= source->vertexCount() )
@@ -88,6 +188,61 @@ void QgsGraphAnalyzer::dijkstra( const QgsGraph *source, int startPointIdx, int
   }
 }
 
+void QgsGraphAnalyzer::dijkstra( const QgsCompactGraph *source, int startVertexIdx, int criterionNum, QVector<int> *resultTree, QVector<double> *resultCost, int targetVertexIdx, double costLimit )
+{
+  if ( startVertexIdx < 0 || startVertexIdx >= source->vertexCount() )
+  {
+    // invalid start point
+    return;
+  }
+
+  QVector< double > localCost;
+  QVector< double > &cost = resultCost ? *resultCost : localCost;
+  cost.fill( std::numeric_limits<double>::infinity(), source->vertexCount() );
+  cost[ startVertexIdx ] = 0.0;
+
+  if ( resultTree )
+  {
+    resultTree->fill( -1, source->vertexCount() );
+  }
+
+  if ( criterionNum < 0 || criterionNum >= source->mStrategyCount )
+    return;
+
+  // work on raw pointers in the inner loop, QVector::operator[] would check for detaching on every access
+  double *costs = cost.data();
+  int *tree = resultTree ? resultTree->data() : nullptr;
+  const int *rowOffsets = source->mRowOffsets.data();
+  const int *rowTargets = source->mRowTargets.data();
+  const int *rowEdges = source->mRowEdges.data();
+  const double *rowCosts = source->mRowCosts.data() + static_cast< std::size_t >( criterionNum ) * source->mRowEdges.size();
+
+  QgsVertexCostHeap heap( source->vertexCount() );
+  heap.push( startVertexIdx, 0.0 );
+
+  while ( !heap.isEmpty() )
+  {
+    const int curVertex = heap.pop();
+    if ( curVertex == targetVertexIdx )
+      break;
+
+    const double curCost = costs[ curVertex ];
+    const int rowEnd = rowOffsets[ curVertex + 1 ];
+    for ( int row = rowOffsets[ curVertex ]; row < rowEnd; ++row )
+    {
+      const double newCost = curCost + rowCosts[ row ];
+      const int toVertex = rowTargets[ row ];
+      if ( newCost < costs[ toVertex ] && newCost <= costLimit )
+      {
+        costs[ toVertex ] = newCost;
+        if ( tree )
+          tree[ toVertex ] = rowEdges[ row ];
+        heap.push( toVertex, newCost );
+      }
+    }
+  }
+}
+
 QgsGraph *QgsGraphAnalyzer::shortestTree( const QgsGraph *source, int startVertexIdx, int criterionNum )
 {
   QgsGraph *treeResult = new QgsGraph();
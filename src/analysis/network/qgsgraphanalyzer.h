@@ -17,11 +17,13 @@
 #define QGSGRAPHANALYZER_H
 
 #include <QVector>
+#include <limits>
 
 #include "qgis_sip.h"
 #include "qgis_analysis.h"
 
 class QgsGraph;
+class QgsCompactGraph;
 
 /**
  * \ingroup analysis
@@ -75,6 +77,28 @@ class ANALYSIS_EXPORT QgsGraphAnalyzer
     % End
 #endif
 
+    /**
+     * Solve shortest path problem on a compact graph using Dijkstra algorithm with an indexed binary heap.
+     *
+     * This is considerably faster than the QgsGraph based variant, and is intended for running
+     * many searches over the same graph.
+     *
+     * \param source source graph
+     * \param startVertexIdx index of the start vertex
+     * \param criterionNum index of the optimization strategy
+     * \param resultTree array that represents shortest path tree. resultTree[ vertexIndex ] == inboundingArcIndex if vertex reachable, otherwise resultTree[ vertexIndex ] == -1.
+     * Arc indices refer to the QgsGraph the compact graph was built from.
+     * \param resultCost array of the paths costs
+     * \param targetVertexIdx optional target vertex index. If set, the search stops as soon as the path to this vertex is known,
+     * and only the results for the target vertex (and the vertices on its path) are final.
+     * \param costLimit optional maximum path cost. Vertices which cannot be reached within this cost are reported as unreachable.
+     *
+     * \note Not available in Python bindings
+     * \since QGIS 3.6
+     */
+    static void dijkstra( const QgsCompactGraph *source, int startVertexIdx, int criterionNum, QVector<int> *resultTree = nullptr, QVector<double> *resultCost = nullptr,
+                          int targetVertexIdx = -1, double costLimit = std::numeric_limits< double >::infinity() ) SIP_SKIP;
+
     /**
      * Returns shortest path tree with root-node in startVertexIdx
      * \param source source graph
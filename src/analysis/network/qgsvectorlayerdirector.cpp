@@ -31,10 +31,14 @@
 
 #include <QString>
 #include <QtAlgorithms>
+#include <QtConcurrentMap>
 
-#include <spatialindex/SpatialIndex.h>
+#include <cmath>
+#include <functional>
+#include <numeric>
 
-using namespace SpatialIndex;
+//! Number of features read and processed together when building a graph
+static const int GRAPH_BUILD_CHUNK_SIZE = 5000;
 
 struct TiePointInfo
 {
@@ -112,60 +116,136 @@ QgsVectorLayerDirector::Direction QgsVectorLayerDirector::directionForFeature( c
   }
 }
 
+void QgsVectorLayerDirector::setMultiThreaded( bool enabled )
+{
+  mMultiThreaded = enabled;
+}
+
+bool QgsVectorLayerDirector::isMultiThreaded() const
+{
+  return mMultiThreaded;
+}
+
 ///@cond PRIVATE
-class QgsNetworkVisitor : public SpatialIndex::IVisitor
+
+/**
+ * Spatial hash of graph vertices, using grid cells at least as large as the topology tolerance
+ * so that a lookup never has to inspect more than 3x3 cells. Lookups are read-only and can
+ * be made from multiple threads once all vertices have been added.
+ */
+class QgsNetworkVertexGrid
 {
   public:
-    explicit QgsNetworkVisitor( QVector< int > &pointIndexes )
-      : mPoints( pointIndexes ) {}
-
-    void visitNode( const INode &n ) override
-    { Q_UNUSED( n ); }
 
-    void visitData( const IData &d ) override
+    QgsNetworkVertexGrid( const QVector< QgsPointXY > &vertices, double tolerance )
+      : mVertices( vertices )
+      , mTolerance( tolerance )
+      , mCellSize( std::max( tolerance, 1e-6 ) )
+    {}
+
+    /**
+     * Returns the lowest index of a vertex within tolerance of \a point, or -1 if there is none.
+     * When several vertices are within tolerance, the R-tree which was used before returned the
+     * first one met while traversing its nodes. The lowest index does not depend on the tree layout.
+     */
+    int find( const QgsPointXY &point ) const
     {
-      mPoints.append( d.getIdentifier() );
+      int result = -1;
+      const qint64 minCellX = cell( point.x() - mTolerance );
+      const qint64 maxCellX = cell( point.x() + mTolerance );
+      const qint64 minCellY = cell( point.y() - mTolerance );
+      const qint64 maxCellY = cell( point.y() + mTolerance );
+      for ( qint64 cellX = minCellX; cellX <= maxCellX; ++cellX )
+      {
+        for ( qint64 cellY = minCellY; cellY <= maxCellY; ++cellY )
+        {
+          const QPair< qint64, qint64 > key( cellX, cellY );
+          for ( auto it = mCells.constFind( key ); it != mCells.constEnd() && it.key() == key; ++it )
+          {
+            const int index = it.value();
+            if ( result != -1 && index > result )
+              continue;
+
+            const QgsPointXY &vertex = mVertices.at( index );
+            if ( std::fabs( vertex.x() - point.x() ) <= mTolerance && std::fabs( vertex.y() - point.y() ) <= mTolerance )
+              result = index;
+          }
+        }
+      }
+      return result;
     }
 
-    void visitData( std::vector<const IData *> &v ) override
-    { Q_UNUSED( v ); }
+    //! Adds the vertex with the specified \a index to the grid
+    void insert( int index )
+    {
+      const QgsPointXY &vertex = mVertices.at( index );
+      mCells.insert( QPair< qint64, qint64 >( cell( vertex.x() ), cell( vertex.y() ) ), index );
+    }
 
   private:
-    QVector< int > &mPoints;
-};
 
-///@endcond
+    qint64 cell( double value ) const
+    {
+      return static_cast< qint64 >( std::floor( value / mCellSize ) );
+    }
 
-std::unique_ptr< SpatialIndex::ISpatialIndex > createVertexSpatialIndex( SpatialIndex::IStorageManager &storageManager )
+    const QVector< QgsPointXY > &mVertices;
+    double mTolerance = 0;
+    double mCellSize = 0;
+    QMultiHash< QPair< qint64, qint64 >, int > mCells;
+};
+
+//! A network line segment, as candidate for tying additional points to the network
+struct QgsNetworkSegment
 {
-  // R-Tree parameters
-  double fillFactor = 0.7;
-  unsigned long indexCapacity = 10;
-  unsigned long leafCapacity = 10;
-  unsigned long dimension = 2;
-  RTree::RTreeVariant variant = RTree::RV_RSTAR;
-
-  // create R-tree
-  SpatialIndex::id_type indexId;
-  std::unique_ptr< SpatialIndex::ISpatialIndex > iRTree( RTree::createNewRTree( storageManager, fillFactor, indexCapacity,
-      leafCapacity, dimension, variant, indexId ) );
-  return iRTree;
-}
+  QgsFeatureId featureId;
+  QgsPointXY start;
+  QgsPointXY end;
+};
 
-int findClosestVertex( const QgsPointXY &point, SpatialIndex::ISpatialIndex *index, double tolerance )
+//! An edge to add to the graph builder
+struct QgsNetworkEdge
 {
-  QVector< int > matching;
-  QgsNetworkVisitor visitor( matching );
+  int fromIdx;
+  QgsPointXY from;
+  int toIdx;
+  QgsPointXY to;
+  QVector< QVariant > strategies;
+};
 
-  double pt1[2] = { point.x() - tolerance, point.y() - tolerance },
-                  pt2[2] = { point.x() + tolerance, point.y() + tolerance };
-  SpatialIndex::Region searchRegion( pt1, pt2, 2 );
+//! Returns the lines of a network \a feature, transformed using \a ct
+static QgsMultiPolylineXY networkLines( const QgsFeature &feature, const QgsCoordinateTransform &ct )
+{
+  QgsMultiPolylineXY mpl;
+  if ( QgsWkbTypes::flatType( feature.geometry().wkbType() ) == QgsWkbTypes::MultiLineString )
+    mpl = feature.geometry().asMultiPolyline();
+  else if ( QgsWkbTypes::flatType( feature.geometry().wkbType() ) == QgsWkbTypes::LineString )
+    mpl.push_back( feature.geometry().asPolyline() );
 
-  index->intersectsWithQuery( searchRegion, visitor );
+  for ( QgsPolylineXY &line : mpl )
+  {
+    for ( QgsPointXY &point : line )
+    {
+      point = ct.transform( point );
+    }
+  }
+  return mpl;
+}
 
-  return matching.empty() ? -1 : matching.at( 0 );
+//! Reads the next chunk of features from \a iterator into \a features, returns false if there are no more features
+static bool readFeatureChunk( QgsFeatureIterator &iterator, QVector< QgsFeature > &features )
+{
+  features.clear();
+  QgsFeature feature;
+  while ( features.size() < GRAPH_BUILD_CHUNK_SIZE && iterator.nextFeature( feature ) )
+  {
+    features.push_back( feature );
+  }
+  return !features.isEmpty();
 }
 
+///@endcond
+
 void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const QVector< QgsPointXY > &additionalPoints,
                                         QVector< QgsPointXY > &snappedPoints, QgsFeedback *feedback ) const
 {
@@ -179,6 +259,23 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
     ct.setDestinationCrs( builder->destinationCrs() );
   }
 
+  // runs function for every index in [0, count), on the global thread pool if multi threading is enabled.
+  // Results are always merged in feature order afterwards, so the graph does not depend on the threading mode.
+  auto forEachIndex = [this]( int count, const std::function< void( int ) > &function )
+  {
+    if ( mMultiThreaded && count > 1 )
+    {
+      QVector< int > indices( count );
+      std::iota( indices.begin(), indices.end(), 0 );
+      QtConcurrent::blockingMap( indices, function );
+    }
+    else
+    {
+      for ( int i = 0; i < count; ++i )
+        function( i );
+    }
+  };
+
   // clear existing snapped points list, and resize to length of provided additional points
   snappedPoints = QVector< QgsPointXY >( additionalPoints.size(), QgsPointXY( 0.0, 0.0 ) );
   // tie points = snapped location of specified additional points to network lines
@@ -188,94 +285,103 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
   QVector< QgsPointXY > graphVertices;
 
   // spatial index for graph vertices
-  std::unique_ptr< SpatialIndex::IStorageManager > iStorage( StorageManager::createNewMemoryStorageManager() );
-  std::unique_ptr< SpatialIndex::ISpatialIndex > iRTree = createVertexSpatialIndex( *iStorage );
-
-  double tolerance = std::max( builder->topologyTolerance(), 1e-10 );
-  auto findPointWithinTolerance = [&iRTree, tolerance]( const QgsPointXY & point )->int
-  {
-    return findClosestVertex( point, iRTree.get(), tolerance );
-  };
-  auto addPointToIndex = [&iRTree]( const QgsPointXY & point, int index )
+  const double tolerance = std::max( builder->topologyTolerance(), 1e-10 );
+  QgsNetworkVertexGrid vertexGrid( graphVertices, tolerance );
+  auto findPointWithinTolerance = [&vertexGrid]( const QgsPointXY & point )->int
   {
-    double coords[] = {point.x(), point.y()};
-    iRTree->insertData( 0, nullptr, SpatialIndex::Point( coords, 2 ), index );
+    return vertexGrid.find( point );
   };
 
   // first iteration - get all nodes from network, and snap additional points to network
   QgsFeatureIterator fit = mSource->getFeatures( QgsFeatureRequest().setNoAttributes() );
-  QgsFeature feature;
-  while ( fit.nextFeature( feature ) )
+  QVector< QgsFeature > features;
+  std::vector< QgsMultiPolylineXY > featureLines;
+  std::vector< QgsNetworkSegment > segments;
+  while ( readFeatureChunk( fit, features ) )
   {
     if ( feedback && feedback->isCanceled() )
       return;
 
-    QgsMultiPolylineXY mpl;
-    if ( QgsWkbTypes::flatType( feature.geometry().wkbType() ) == QgsWkbTypes::MultiLineString )
-      mpl = feature.geometry().asMultiPolyline();
-    else if ( QgsWkbTypes::flatType( feature.geometry().wkbType() ) == QgsWkbTypes::LineString )
-      mpl.push_back( feature.geometry().asPolyline() );
+    featureLines.assign( features.size(), QgsMultiPolylineXY() );
+    forEachIndex( features.size(), [&]( int i )
+    {
+      featureLines[ i ] = networkLines( features.at( i ), ct );
+    } );
 
-    for ( const QgsPolylineXY &line : qgis::as_const( mpl ) )
+    // collapse vertices within tolerance - vertex indices depend on feature order, so this is done serially
+    segments.clear();
+    for ( int i = 0; i < features.size(); ++i )
     {
-      QgsPointXY pt1, pt2;
-      bool isFirstPoint = true;
-      for ( const QgsPointXY &point : line )
+      for ( QgsPolylineXY &line : featureLines[ i ] )
       {
-        pt2 = ct.transform( point );
+        QgsPointXY pt1;
+        bool isFirstPoint = true;
+        for ( QgsPointXY &point : line )
+        {
+          int ptIdx = findPointWithinTolerance( point );
+          if ( ptIdx == -1 )
+          {
+            // no vertex already exists within tolerance - add to points, and index
+            graphVertices.push_back( point );
+            vertexGrid.insert( graphVertices.count() - 1 );
+          }
+          else
+          {
+            // vertex already exists within tolerance - use that
+            point = graphVertices.at( ptIdx );
+          }
 
-        int pt2Idx = findPointWithinTolerance( pt2 ) ;
-        if ( pt2Idx == -1 )
+          if ( !isFirstPoint )
+            segments.push_back( QgsNetworkSegment{ features.at( i ).id(), pt1, point } );
+          pt1 = point;
+          isFirstPoint = false;
+        }
+      }
+    }
+
+    // check which line segments are candidates for being closest to each additional point. Each additional point
+    // scans the segments in feature order, so the first closest segment wins exactly as in a serial scan
+    forEachIndex( additionalPoints.size(), [&]( int i )
+    {
+      const QgsPointXY &additionalPoint = additionalPoints.at( i );
+      TiePointInfo &tiePoint = additionalTiePoints[ i ];
+      for ( const QgsNetworkSegment &segment : segments )
+      {
+        QgsPointXY snappedPoint;
+        double thisSegmentClosestDist = std::numeric_limits<double>::max();
+        if ( segment.start == segment.end )
         {
-          // no vertex already exists within tolerance - add to points, and index
-          addPointToIndex( pt2, graphVertices.count() );
-          graphVertices.push_back( pt2 );
+          thisSegmentClosestDist = additionalPoint.sqrDist( segment.start );
+          snappedPoint = segment.start;
         }
         else
         {
-          // vertex already exists within tolerance - use that
-          pt2 = graphVertices.at( pt2Idx );
+          thisSegmentClosestDist = additionalPoint.sqrDistToSegment( segment.start.x(), segment.start.y(),
+                                   segment.end.x(), segment.end.y(), snappedPoint, 0 );
         }
 
-        if ( !isFirstPoint )
+        if ( thisSegmentClosestDist < tiePoint.mLength )
         {
-          // check if this line segment is a candidate for being closest to each additional point
-          int i = 0;
-          for ( const QgsPointXY &additionalPoint : additionalPoints )
-          {
-
-            QgsPointXY snappedPoint;
-            double thisSegmentClosestDist = std::numeric_limits<double>::max();
-            if ( pt1 == pt2 )
-            {
-              thisSegmentClosestDist = additionalPoint.sqrDist( pt1 );
-              snappedPoint = pt1;
-            }
-            else
-            {
-              thisSegmentClosestDist = additionalPoint.sqrDistToSegment( pt1.x(), pt1.y(),
-                                       pt2.x(), pt2.y(), snappedPoint, 0 );
-            }
-
-            if ( thisSegmentClosestDist < additionalTiePoints[ i ].mLength )
-            {
-              // found a closer segment for this additional point
-              TiePointInfo info( i, feature.id(), pt1, pt2 );
-              info.mLength = thisSegmentClosestDist;
-              info.mTiedPoint = snappedPoint;
-
-              additionalTiePoints[ i ] = info;
-              snappedPoints[ i ] = info.mTiedPoint;
-            }
-            i++;
-          }
+          // found a closer segment for this additional point
+          TiePointInfo info( i, segment.featureId, segment.start, segment.end );
+          info.mLength = thisSegmentClosestDist;
+          info.mTiedPoint = snappedPoint;
+          tiePoint = info;
         }
-        pt1 = pt2;
-        isFirstPoint = false;
       }
-    }
+    } );
+
+    step += features.size();
     if ( feedback )
-      feedback->setProgress( 100.0 * static_cast< double >( ++step ) / featureCount );
+      feedback->setProgress( 100.0 * static_cast< double >( step ) / featureCount );
+  }
+  featureLines.clear();
+  segments.clear();
+
+  for ( int i = 0; i < additionalTiePoints.size(); ++i )
+  {
+    if ( additionalTiePoints.at( i ).additionalPointId != -1 )
+      snappedPoints[ i ] = additionalTiePoints.at( i ).mTiedPoint;
   }
 
   // build a hash of feature ids to tie points which depend on this feature
@@ -296,8 +402,8 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
     if ( ptIdx == -1 )
     {
       // no vertex already within tolerance, add to index and network vertices
-      addPointToIndex( point, graphVertices.count() );
       graphVertices.push_back( point );
+      vertexGrid.insert( graphVertices.count() - 1 );
     }
     else
     {
@@ -324,96 +430,110 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
     }
   }
 
+  const QgsDistanceArea *distanceArea = builder->distanceArea();
+  std::vector< std::vector< QgsNetworkEdge > > featureEdges;
   fit = mSource->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( requiredAttributes() ) );
-  while ( fit.nextFeature( feature ) )
+  while ( readFeatureChunk( fit, features ) )
   {
     if ( feedback && feedback->isCanceled() )
       return;
 
-    Direction direction = directionForFeature( feature );
-
-    // begin features segments and add arc to the Graph;
-    QgsMultiPolylineXY mpl;
-    if ( QgsWkbTypes::flatType( feature.geometry().wkbType() ) == QgsWkbTypes::MultiLineString )
-      mpl = feature.geometry().asMultiPolyline();
-    else if ( QgsWkbTypes::flatType( feature.geometry().wkbType() ) == QgsWkbTypes::LineString )
-      mpl.push_back( feature.geometry().asPolyline() );
-
-    for ( const QgsPolylineXY &line : qgis::as_const( mpl ) )
+    // the vertex index is only read from here on, so edges of each feature can be calculated independently
+    featureEdges.assign( features.size(), std::vector< QgsNetworkEdge >() );
+    forEachIndex( features.size(), [&]( int featureIdx )
     {
-      QgsPointXY pt1, pt2;
+      const QgsFeature &feature = features.at( featureIdx );
+      std::vector< QgsNetworkEdge > &edges = featureEdges[ featureIdx ];
+
+      Direction direction = directionForFeature( feature );
 
-      bool isFirstPoint = true;
-      for ( const QgsPointXY &point : line )
+      // begin features segments and add arc to the Graph;
+      const QgsMultiPolylineXY mpl = networkLines( feature, ct );
+      for ( const QgsPolylineXY &line : mpl )
       {
-        pt2 = ct.transform( point );
-        int pPt2idx = findPointWithinTolerance( pt2 );
-        Q_ASSERT_X( pPt2idx >= 0, "QgsVectorLayerDirectory::makeGraph", "encountered a vertex which was not present in graph" );
-        pt2 = graphVertices.at( pPt2idx );
+        QgsPointXY pt1, pt2;
 
-        if ( !isFirstPoint )
+        bool isFirstPoint = true;
+        for ( const QgsPointXY &point : line )
         {
-          QMap< double, QgsPointXY > pointsOnArc;
-          pointsOnArc[ 0.0 ] = pt1;
-          pointsOnArc[ pt1.sqrDist( pt2 )] = pt2;
+          int pPt2idx = findPointWithinTolerance( point );
+          Q_ASSERT_X( pPt2idx >= 0, "QgsVectorLayerDirectory::makeGraph", "encountered a vertex which was not present in graph" );
+          pt2 = graphVertices.at( pPt2idx );
 
-          const QList< int > tiePointsForCurrentFeature = tiePointNetworkFeatures.value( feature.id() );
-          for ( int tiePointIdx : tiePointsForCurrentFeature )
+          if ( !isFirstPoint )
           {
-            const TiePointInfo &t = additionalTiePoints.at( tiePointIdx );
-            if ( t.mFirstPoint == pt1 && t.mLastPoint == pt2 )
-            {
-              pointsOnArc[ pt1.sqrDist( t.mTiedPoint )] = t.mTiedPoint;
-            }
-          }
-
-          QgsPointXY arcPt1;
-          QgsPointXY arcPt2;
-          int pt1idx = -1;
-          int pt2idx = -1;
-          bool isFirstPoint = true;
-          for ( auto arcPointIt = pointsOnArc.constBegin(); arcPointIt != pointsOnArc.constEnd(); ++arcPointIt )
-          {
-            arcPt2 = arcPointIt.value();
-
-            pt2idx = findPointWithinTolerance( arcPt2 );
-            Q_ASSERT_X( pt2idx >= 0, "QgsVectorLayerDirectory::makeGraph", "encountered a vertex which was not present in graph" );
-            arcPt2 = graphVertices.at( pt2idx );
+            QMap< double, QgsPointXY > pointsOnArc;
+            pointsOnArc[ 0.0 ] = pt1;
+            pointsOnArc[ pt1.sqrDist( pt2 )] = pt2;
 
-            if ( !isFirstPoint && arcPt1 != arcPt2 )
+            const QList< int > tiePointsForCurrentFeature = tiePointNetworkFeatures.value( feature.id() );
+            for ( int tiePointIdx : tiePointsForCurrentFeature )
             {
-              double distance = builder->distanceArea()->measureLine( arcPt1, arcPt2 );
-              QVector< QVariant > prop;
-              prop.reserve( mStrategies.size() );
-              for ( QgsNetworkStrategy *strategy : mStrategies )
+              const TiePointInfo &t = additionalTiePoints.at( tiePointIdx );
+              if ( t.mFirstPoint == pt1 && t.mLastPoint == pt2 )
               {
-                prop.push_back( strategy->cost( distance, feature ) );
+                pointsOnArc[ pt1.sqrDist( t.mTiedPoint )] = t.mTiedPoint;
               }
+            }
 
-              if ( direction == Direction::DirectionForward ||
-                   direction == Direction::DirectionBoth )
-              {
-                builder->addEdge( pt1idx, arcPt1, pt2idx, arcPt2, prop );
-              }
-              if ( direction == Direction::DirectionBackward ||
-                   direction == Direction::DirectionBoth )
+            QgsPointXY arcPt1;
+            QgsPointXY arcPt2;
+            int pt1idx = -1;
+            int pt2idx = -1;
+            bool isFirstPoint = true;
+            for ( auto arcPointIt = pointsOnArc.constBegin(); arcPointIt != pointsOnArc.constEnd(); ++arcPointIt )
+            {
+              arcPt2 = arcPointIt.value();
+
+              pt2idx = findPointWithinTolerance( arcPt2 );
+              Q_ASSERT_X( pt2idx >= 0, "QgsVectorLayerDirectory::makeGraph", "encountered a vertex which was not present in graph" );
+              arcPt2 = graphVertices.at( pt2idx );
+
+              if ( !isFirstPoint && arcPt1 != arcPt2 )
               {
-                builder->addEdge( pt2idx, arcPt2, pt1idx, arcPt1, prop );
+                double distance = distanceArea->measureLine( arcPt1, arcPt2 );
+                QVector< QVariant > prop;
+                prop.reserve( mStrategies.size() );
+                for ( QgsNetworkStrategy *strategy : mStrategies )
+                {
+                  prop.push_back( strategy->cost( distance, feature ) );
+                }
+
+                if ( direction == Direction::DirectionForward ||
+                     direction == Direction::DirectionBoth )
+                {
+                  edges.push_back( QgsNetworkEdge{ pt1idx, arcPt1, pt2idx, arcPt2, prop } );
+                }
+                if ( direction == Direction::DirectionBackward ||
+                     direction == Direction::DirectionBoth )
+                {
+                  edges.push_back( QgsNetworkEdge{ pt2idx, arcPt2, pt1idx, arcPt1, prop } );
+                }
               }
+              pt1idx = pt2idx;
+              arcPt1 = arcPt2;
+              isFirstPoint = false;
             }
-            pt1idx = pt2idx;
-            arcPt1 = arcPt2;
-            isFirstPoint = false;
           }
+          pt1 = pt2;
+          isFirstPoint = false;
         }
-        pt1 = pt2;
-        isFirstPoint = false;
+      }
+    } );
+
+    // builders are not thread safe, so edges are added serially in feature order
+    for ( const std::vector< QgsNetworkEdge > &edges : featureEdges )
+    {
+      for ( const QgsNetworkEdge &edge : edges )
+      {
+        builder->addEdge( edge.fromIdx, edge.from, edge.toIdx, edge.to, edge.strategies );
       }
     }
+
+    step += features.size();
     if ( feedback )
     {
-      feedback->setProgress( 100.0 * static_cast< double >( ++step ) / featureCount );
+      feedback->setProgress( 100.0 * static_cast< double >( step ) / featureCount );
     }
-
   }
 }
@@ -78,6 +78,27 @@ class ANALYSIS_EXPORT QgsVectorLayerDirector : public QgsGraphDirector
 
     QString name() const override;
 
+    /**
+     * Sets whether graph construction should use multiple threads.
+     *
+     * When enabled, reading geometries, snapping additional points and calculating edge
+     * costs are distributed over the global thread pool. The resulting graph is identical
+     * to the one built on a single thread. All strategies added to the director must be
+     * safe to call from multiple threads, so this is disabled by default.
+     *
+     * \see isMultiThreaded()
+     * \since QGIS 3.6
+     */
+    void setMultiThreaded( bool enabled );
+
+    /**
+     * Returns true if graph construction uses multiple threads.
+     *
+     * \see setMultiThreaded()
+     * \since QGIS 3.6
+     */
+    bool isMultiThreaded() const;
+
   private:
     QgsFeatureSource *mSource = nullptr;
     int mDirectionFieldId = -1;
@@ -85,6 +106,7 @@ class ANALYSIS_EXPORT QgsVectorLayerDirector : public QgsGraphDirector
     QString mReverseDirectionValue;
     QString mBothDirectionValue;
     Direction mDefaultDirection = DirectionBoth;
+    bool mMultiThreaded = false;
 
     QgsAttributeList requiredAttributes() const;
     Direction directionForFeature( const QgsFeature &feature ) const;
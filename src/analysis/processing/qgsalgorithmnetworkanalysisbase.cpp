@@ -112,6 +112,8 @@ void QgsNetworkAnalysisAlgorithmBase::loadCommonParams( const QVariantMap &param
   }
 
   mDirector = new QgsVectorLayerDirector( mNetwork.get(), directionField, forwardValue, backwardValue, bothValue, defaultDirection );
+  // the native distance and speed strategies are thread safe
+  mDirector->setMultiThreaded( true );
 
   QgsUnitTypes::DistanceUnit distanceUnits = context.project()->crs().mapUnits();
   mMultiplier = QgsUnitTypes::fromUnitToUnitFactor( distanceUnits, QgsUnitTypes::DistanceMeters );
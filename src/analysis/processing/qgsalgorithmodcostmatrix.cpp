@@ -0,0 +1,254 @@
+/***************************************************************************
+                         qgsalgorithmodcostmatrix.cpp
+                         ---------------------
+    begin                : October 2026
+    copyright            : (C) 2026 by QGIS contributors
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsalgorithmodcostmatrix.h"
+
+#include "qgscompactgraph.h"
+#include "qgscontractionhierarchy.h"
+
+#include <QDir>
+#include <QtConcurrentMap>
+#include <algorithm>
+#include <cmath>
+
+///@cond PRIVATE
+
+QString QgsOdCostMatrixAlgorithm::name() const
+{
+  return QStringLiteral( "odcostmatrix" );
+}
+
+QString QgsOdCostMatrixAlgorithm::displayName() const
+{
+  return QObject::tr( "OD cost matrix (layer to layer)" );
+}
+
+QStringList QgsOdCostMatrixAlgorithm::tags() const
+{
+  return QObject::tr( "network,path,shortest,fastest,origin,destination,od,matrix,cost" ).split( ',' );
+}
+
+QString QgsOdCostMatrixAlgorithm::shortHelpString() const
+{
+  return QObject::tr( "This algorithm computes the optimal (shortest or fastest) route cost between every point "
+                      "of the start points layer and every point of the end points layer.\n\n"
+                      "The network is preprocessed once into a routing index, after which the individual "
+                      "origin-destination pairs are solved in parallel. The output is a table with one row per pair, "
+                      "referencing the ids of the start and end features. Pairs without a route have a NULL cost.\n\n"
+                      "The routing index can be saved to a file, and loaded again by later runs over the same network "
+                      "and points to skip the preprocessing. An index file which does not match the network is ignored." );
+}
+
+QgsOdCostMatrixAlgorithm *QgsOdCostMatrixAlgorithm::createInstance() const
+{
+  return new QgsOdCostMatrixAlgorithm();
+}
+
+void QgsOdCostMatrixAlgorithm::initAlgorithm( const QVariantMap & )
+{
+  addCommonParams();
+  addParameter( new QgsProcessingParameterFeatureSource( QStringLiteral( "START_POINTS" ), QObject::tr( "Vector layer with start points" ), QList< int >() << QgsProcessing::TypeVectorPoint ) );
+  addParameter( new QgsProcessingParameterFeatureSource( QStringLiteral( "END_POINTS" ), QObject::tr( "Vector layer with end points" ), QList< int >() << QgsProcessing::TypeVectorPoint ) );
+
+  std::unique_ptr< QgsProcessingParameterFile > inputIndex = qgis::make_unique< QgsProcessingParameterFile >( QStringLiteral( "INPUT_INDEX" ),
+      QObject::tr( "Routing index" ), QgsProcessingParameterFile::File, QStringLiteral( "qch" ), QVariant(), true );
+  inputIndex->setFlags( inputIndex->flags() | QgsProcessingParameterDefinition::FlagAdvanced );
+  addParameter( inputIndex.release() );
+
+  addParameter( new QgsProcessingParameterFeatureSink( QStringLiteral( "OUTPUT" ), QObject::tr( "OD cost matrix" ), QgsProcessing::TypeVector ) );
+  addParameter( new QgsProcessingParameterFileDestination( QStringLiteral( "OUTPUT_INDEX" ), QObject::tr( "Saved routing index" ),
+                QObject::tr( "Routing index files (*.qch)" ), QVariant(), true, false ) );
+}
+
+QVariantMap QgsOdCostMatrixAlgorithm::processAlgorithm( const QVariantMap &parameters, QgsProcessingContext &context, QgsProcessingFeedback *feedback )
+{
+  loadCommonParams( parameters, context, feedback );
+
+  std::unique_ptr< QgsFeatureSource > startPoints( parameterAsSource( parameters, QStringLiteral( "START_POINTS" ), context ) );
+  if ( !startPoints )
+    throw QgsProcessingException( invalidSourceError( parameters, QStringLiteral( "START_POINTS" ) ) );
+
+  std::unique_ptr< QgsFeatureSource > endPoints( parameterAsSource( parameters, QStringLiteral( "END_POINTS" ), context ) );
+  if ( !endPoints )
+    throw QgsProcessingException( invalidSourceError( parameters, QStringLiteral( "END_POINTS" ) ) );
+
+  QgsFields fields;
+  fields.append( QgsField( QStringLiteral( "start_id" ), QVariant::LongLong ) );
+  fields.append( QgsField( QStringLiteral( "end_id" ), QVariant::LongLong ) );
+  fields.append( QgsField( QStringLiteral( "start" ), QVariant::String ) );
+  fields.append( QgsField( QStringLiteral( "end" ), QVariant::String ) );
+  fields.append( QgsField( QStringLiteral( "cost" ), QVariant::Double ) );
+
+  QString dest;
+  std::unique_ptr< QgsFeatureSink > sink( parameterAsSink( parameters, QStringLiteral( "OUTPUT" ), context, dest, fields, QgsWkbTypes::NoGeometry, mNetwork->sourceCrs() ) );
+  if ( !sink )
+    throw QgsProcessingException( invalidSinkError( parameters, QStringLiteral( "OUTPUT" ) ) );
+
+  QVector< QgsPointXY > points;
+  QVector< QgsFeatureId > startIds;
+  QVector< QgsFeatureId > endIds;
+  loadPointsWithIds( startPoints.get(), points, startIds, context, feedback );
+  const int startCount = points.size();
+  loadPointsWithIds( endPoints.get(), points, endIds, context, feedback );
+  const int endCount = points.size() - startCount;
+
+  feedback->pushInfo( QObject::tr( "Building graph…" ) );
+  QVector< QgsPointXY > snappedPoints;
+  mDirector->makeGraph( mBuilder.get(), points, snappedPoints, feedback );
+  if ( feedback->isCanceled() )
+    return QVariantMap();
+
+  mGraph.reset( mBuilder->graph() );
+
+  // QgsGraph::findVertex is a linear scan, so index vertex locations once instead
+  QHash< QgsPointXY, int > vertexIndex;
+  vertexIndex.reserve( mGraph->vertexCount() );
+  for ( int i = mGraph->vertexCount() - 1; i >= 0; --i )
+  {
+    vertexIndex.insert( mGraph->vertex( i ).point(), i );
+  }
+  QVector< int > pointVertices( points.size() );
+  for ( int i = 0; i < points.size(); ++i )
+  {
+    pointVertices[ i ] = vertexIndex.value( snappedPoints.at( i ), -1 );
+  }
+
+  QgsProcessingMultiStepFeedback indexFeedback( 2, feedback );
+  const QgsCompactGraph compactGraph( *mGraph );
+  const QByteArray graphHash = QgsContractionHierarchy::hashGraph( compactGraph, 0 );
+
+  // the graph includes the start and end points, so an index only matches runs over the same network and points
+  const QString inputIndex = parameterAsFile( parameters, QStringLiteral( "INPUT_INDEX" ), context );
+  QgsContractionHierarchy hierarchy;
+  bool indexLoaded = false;
+  if ( !inputIndex.isEmpty() )
+  {
+    indexLoaded = hierarchy.readFromFile( inputIndex ) && hierarchy.graphHash() == graphHash;
+    if ( indexLoaded )
+      feedback->pushInfo( QObject::tr( "Loaded routing index from %1" ).arg( QDir::toNativeSeparators( inputIndex ) ) );
+    else
+      feedback->pushInfo( QObject::tr( "Routing index %1 does not match the network, rebuilding it" ).arg( QDir::toNativeSeparators( inputIndex ) ) );
+  }
+
+  if ( !indexLoaded )
+  {
+    feedback->pushInfo( QObject::tr( "Building routing index…" ) );
+    hierarchy = QgsContractionHierarchy( compactGraph, 0, &indexFeedback );
+    if ( feedback->isCanceled() )
+      return QVariantMap();
+    if ( !hierarchy.isValid() )
+      throw QgsProcessingException( QObject::tr( "Could not build routing index for network." ) );
+  }
+
+  QVariantMap outputs;
+  const QString outputIndex = parameterAsFileOutput( parameters, QStringLiteral( "OUTPUT_INDEX" ), context );
+  if ( !outputIndex.isEmpty() )
+  {
+    // a loaded index is only written again to another file
+    if ( ( !indexLoaded || outputIndex != inputIndex ) && !hierarchy.writeToFile( outputIndex ) )
+      throw QgsProcessingException( QObject::tr( "Could not write routing index to %1" ).arg( QDir::toNativeSeparators( outputIndex ) ) );
+    outputs.insert( QStringLiteral( "OUTPUT_INDEX" ), outputIndex );
+  }
+
+  feedback->pushInfo( QObject::tr( "Calculating OD cost matrix…" ) );
+  indexFeedback.setCurrentStep( 1 );
+
+  // rows are solved in parallel chunks, results are written from this thread between chunks
+  const int chunkSize = 64;
+  QVector< QVector< double > > chunkCosts( chunkSize );
+  QVector< int > chunkRows;
+  QgsAttributes attributes( fields.count() );
+  QgsFeature feat;
+  feat.setFields( fields );
+
+  for ( int chunkStart = 0; chunkStart < startCount; chunkStart += chunkSize )
+  {
+    if ( feedback->isCanceled() )
+      break;
+
+    const int chunkEnd = std::min( chunkStart + chunkSize, startCount );
+    chunkRows.clear();
+    for ( int row = chunkStart; row < chunkEnd; ++row )
+    {
+      chunkRows << row;
+      chunkCosts[ row - chunkStart ].resize( endCount );
+    }
+
+    QtConcurrent::blockingMap( chunkRows, [&]( int row )
+    {
+      double *rowCosts = chunkCosts[ row - chunkStart ].data();
+      const int fromVertex = pointVertices.at( row );
+      for ( int j = 0; j < endCount; ++j )
+      {
+        rowCosts[ j ] = hierarchy.shortestPathCost( fromVertex, pointVertices.at( startCount + j ) );
+      }
+    } );
+
+    for ( int row = chunkStart; row < chunkEnd; ++row )
+    {
+      const QVector< double > &rowCosts = chunkCosts.at( row - chunkStart );
+      for ( int j = 0; j < endCount; ++j )
+      {
+        attributes[ 0 ] = startIds.at( row );
+        attributes[ 1 ] = endIds.at( j );
+        attributes[ 2 ] = points.at( row ).toString();
+        attributes[ 3 ] = points.at( startCount + j ).toString();
+        attributes[ 4 ] = std::isinf( rowCosts.at( j ) ) ? QVariant() : QVariant( rowCosts.at( j ) / mMultiplier );
+        feat.setAttributes( attributes );
+        sink->addFeature( feat, QgsFeatureSink::FastInsert );
+      }
+    }
+
+    indexFeedback.setProgress( 100.0 * chunkEnd / startCount );
+  }
+
+  outputs.insert( QStringLiteral( "OUTPUT" ), dest );
+  return outputs;
+}
+
+void QgsOdCostMatrixAlgorithm::loadPointsWithIds( QgsFeatureSource *source, QVector< QgsPointXY > &points, QVector< QgsFeatureId > &featureIds, QgsProcessingContext &context, QgsProcessingFeedback *feedback )
+{
+  feedback->pushInfo( QObject::tr( "Loading points…" ) );
+
+  QgsFeature feat;
+  int i = 0;
+  double step = source->featureCount() > 0 ? 100.0 / source->featureCount() : 0;
+  QgsFeatureIterator features = source->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() ).setDestinationCrs( mNetwork->sourceCrs(), context.transformContext() ) );
+
+  while ( features.nextFeature( feat ) )
+  {
+    i++;
+    if ( feedback->isCanceled() )
+    {
+      break;
+    }
+
+    feedback->setProgress( i * step );
+    if ( !feat.hasGeometry() )
+      continue;
+
+    QgsGeometry geom = feat.geometry();
+    QgsAbstractGeometry::vertex_iterator it = geom.vertices_begin();
+    while ( it != geom.vertices_end() )
+    {
+      points.push_back( QgsPointXY( *it ) );
+      featureIds.push_back( feat.id() );
+      it++;
+    }
+  }
+}
+
+///@endcond
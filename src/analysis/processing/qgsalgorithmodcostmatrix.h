@@ -0,0 +1,60 @@
+/***************************************************************************
+                         qgsalgorithmodcostmatrix.h
+                         ---------------------
+    begin                : October 2026
+    copyright            : (C) 2026 by QGIS contributors
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSALGORITHMODCOSTMATRIX_H
+#define QGSALGORITHMODCOSTMATRIX_H
+
+#define SIP_NO_FILE
+
+#include "qgis_sip.h"
+#include "qgsalgorithmnetworkanalysisbase.h"
+
+///@cond PRIVATE
+
+/**
+ * Native origin-destination cost matrix algorithm.
+ */
+class QgsOdCostMatrixAlgorithm : public QgsNetworkAnalysisAlgorithmBase
+{
+
+  public:
+
+    QgsOdCostMatrixAlgorithm() = default;
+    void initAlgorithm( const QVariantMap &configuration = QVariantMap() ) override;
+    QString name() const override;
+    QString displayName() const override;
+    QStringList tags() const override;
+    QString shortHelpString() const override;
+    QgsOdCostMatrixAlgorithm *createInstance() const override SIP_FACTORY;
+
+  protected:
+
+    QVariantMap processAlgorithm( const QVariantMap &parameters,
+                                  QgsProcessingContext &context, QgsProcessingFeedback *feedback ) override;
+
+  private:
+
+    /**
+     * Loads all vertices from the feature \a source, storing the id of the feature
+     * each point was taken from in \a featureIds.
+     */
+    void loadPointsWithIds( QgsFeatureSource *source, QVector< QgsPointXY > &points, QVector< QgsFeatureId > &featureIds, QgsProcessingContext &context, QgsProcessingFeedback *feedback );
+
+};
+
+///@endcond PRIVATE
+
+#endif // QGSALGORITHMODCOSTMATRIX_H
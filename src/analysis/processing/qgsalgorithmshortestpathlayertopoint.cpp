@@ -18,6 +18,7 @@
 #include "qgsalgorithmshortestpathlayertopoint.h"
 
 #include "qgsgraphanalyzer.h"
+#include "qgscompactgraph.h"
 
 #include "qgsmessagelog.h"
 
@@ -87,7 +88,9 @@ QVariantMap QgsShortestPathLayerToPointAlgorithm::processAlgorithm( const QVaria
   mDirector->makeGraph( mBuilder.get(), points, snappedPoints, feedback );
 
   feedback->pushInfo( QObject::tr( "Calculating shortest paths…" ) );
-  QgsGraph *graph = mBuilder->graph();
+  mGraph.reset( mBuilder->graph() );
+  QgsGraph *graph = mGraph.get();
+  QgsCompactGraph compactGraph( *graph );
   int idxEnd = graph->findVertex( snappedPoints[0] );
   int idxStart;
   int currentIdx;
@@ -111,7 +114,7 @@ QVariantMap QgsShortestPathLayerToPointAlgorithm::processAlgorithm( const QVaria
     }
 
     idxStart = graph->findVertex( snappedPoints[i] );
-    QgsGraphAnalyzer::dijkstra( graph, idxStart, 0, &tree, &costs );
+    QgsGraphAnalyzer::dijkstra( &compactGraph, idxStart, 0, &tree, &costs, idxEnd );
 
     if ( tree.at( idxEnd ) == -1 )
     {
@@ -18,6 +18,7 @@
 #include "qgsalgorithmshortestpathpointtolayer.h"
 
 #include "qgsgraphanalyzer.h"
+#include "qgscompactgraph.h"
 
 #include "qgsmessagelog.h"
 
@@ -87,13 +88,15 @@ QVariantMap QgsShortestPathPointToLayerAlgorithm::processAlgorithm( const QVaria
   mDirector->makeGraph( mBuilder.get(), points, snappedPoints, feedback );
 
   feedback->pushInfo( QObject::tr( "Calculating shortest paths…" ) );
-  QgsGraph *graph = mBuilder->graph();
+  mGraph.reset( mBuilder->graph() );
+  QgsGraph *graph = mGraph.get();
   int idxStart = graph->findVertex( snappedPoints[0] );
   int idxEnd;
 
+  QgsCompactGraph compactGraph( *graph );
   QVector< int > tree;
   QVector< double > costs;
-  QgsGraphAnalyzer::dijkstra( graph, idxStart, 0, &tree, &costs );
+  QgsGraphAnalyzer::dijkstra( &compactGraph, idxStart, 0, &tree, &costs );
 
   QVector<QgsPointXY> route;
   double cost;
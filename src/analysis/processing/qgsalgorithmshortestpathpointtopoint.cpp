@@ -18,6 +18,7 @@
 #include "qgsalgorithmshortestpathpointtopoint.h"
 
 #include "qgsgraphanalyzer.h"
+#include "qgscompactgraph.h"
 
 ///@cond PRIVATE
 
@@ -80,13 +81,15 @@ QVariantMap QgsShortestPathPointToPointAlgorithm::processAlgorithm( const QVaria
   mDirector->makeGraph( mBuilder.get(), points, snappedPoints, feedback );
 
   feedback->pushInfo( QObject::tr( "Calculating shortest path…" ) );
-  QgsGraph *graph = mBuilder->graph();
+  mGraph.reset( mBuilder->graph() );
+  QgsGraph *graph = mGraph.get();
   int idxStart = graph->findVertex( snappedPoints[0] );
   int idxEnd = graph->findVertex( snappedPoints[1] );
 
+  QgsCompactGraph compactGraph( *graph );
   QVector< int > tree;
   QVector< double > costs;
-  QgsGraphAnalyzer::dijkstra( graph, idxStart, 0, &tree, &costs );
+  QgsGraphAnalyzer::dijkstra( &compactGraph, idxStart, 0, &tree, &costs, idxEnd );
 
   if ( tree.at( idxEnd ) == -1 )
   {
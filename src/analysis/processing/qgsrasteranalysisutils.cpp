@@ -18,9 +18,14 @@
 #include "qgsfeedback.h"
 #include "qgsrasterblock.h"
 #include "qgsrasteriterator.h"
-#include "qgsgeos.h"
+#include "qgsgeometry.h"
+#include "qgsgeometrycollection.h"
+#include "qgscurvepolygon.h"
+#include "qgslinestring.h"
 #include "qgsprocessingparameters.h"
 #include <map>
+#include <algorithm>
+#include <cmath>
 ///@cond PRIVATE
 
 void QgsRasterAnalysisUtils::cellInfoForBBox( const QgsRectangle &rasterBBox, const QgsRectangle &featureBBox, double cellSizeX, double cellSizeY,
@@ -58,12 +63,11 @@ void QgsRasterAnalysisUtils::cellInfoForBBox( const QgsRectangle &rasterBBox, co
 
 void QgsRasterAnalysisUtils::statisticsFromMiddlePointTest( QgsRasterInterface *rasterInterface, int rasterBand, const QgsGeometry &poly, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox,  const std::function<void( double )> &addValue, bool skipNodata )
 {
-  std::unique_ptr< QgsGeometryEngine > polyEngine( QgsGeometry::createGeometryEngine( poly.constGet( ) ) );
-  if ( !polyEngine )
+  const QgsPolygonRasterizer rasterizer( poly, rasterBBox, cellSizeX, cellSizeY );
+  if ( rasterizer.isEmpty() )
   {
     return;
   }
-  polyEngine->prepareGeometry();
 
   QgsRasterIterator iter( rasterInterface );
   iter.startRasterRead( rasterBand, nCellsX, nCellsY, rasterBBox );
@@ -75,46 +79,37 @@ void QgsRasterAnalysisUtils::statisticsFromMiddlePointTest( QgsRasterInterface *
   int iterRows = 0;
   QgsRectangle blockExtent;
   bool isNoData = false;
+  std::vector< unsigned char > mask;
   while ( iter.readNextRasterPart( rasterBand, iterCols, iterRows, block, iterLeft, iterTop, &blockExtent ) )
   {
-    double cellCenterY = blockExtent.yMaximum() - 0.5 * cellSizeY;
+    mask.resize( static_cast< std::size_t >( iterCols ) * iterRows );
+    rasterizer.rasterizeCenters( iterLeft, iterTop, iterCols, iterRows, mask.data() );
 
+    const unsigned char *inside = mask.data();
     for ( int row = 0; row < iterRows; ++row )
     {
-      double cellCenterX = blockExtent.xMinimum() + 0.5 * cellSizeX;
-      for ( int col = 0; col < iterCols; ++col )
+      for ( int col = 0; col < iterCols; ++col, ++inside )
       {
+        if ( !*inside )
+          continue;
+
         const double pixelValue = block->valueAndNoData( row, col, isNoData );
         if ( validPixel( pixelValue ) && ( !skipNodata || !isNoData ) )
         {
-          QgsPoint cellCenter( cellCenterX, cellCenterY );
-          if ( polyEngine->contains( &cellCenter ) )
-          {
-            addValue( pixelValue );
-          }
+          addValue( pixelValue );
         }
-        cellCenterX += cellSizeX;
       }
-      cellCenterY -= cellSizeY;
     }
   }
 }
 
 void QgsRasterAnalysisUtils::statisticsFromPreciseIntersection( QgsRasterInterface *rasterInterface, int rasterBand, const QgsGeometry &poly, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox,  const std::function<void( double, double )> &addValue, bool skipNodata )
 {
-  QgsGeometry pixelRectGeometry;
-
-  double hCellSizeX = cellSizeX / 2.0;
-  double hCellSizeY = cellSizeY / 2.0;
-  double pixelArea = cellSizeX * cellSizeY;
-  double weight = 0;
-
-  std::unique_ptr< QgsGeometryEngine > polyEngine( QgsGeometry::createGeometryEngine( poly.constGet( ) ) );
-  if ( !polyEngine )
+  const QgsPolygonRasterizer rasterizer( poly, rasterBBox, cellSizeX, cellSizeY );
+  if ( rasterizer.isEmpty() )
   {
     return;
   }
-  polyEngine->prepareGeometry();
 
   QgsRasterIterator iter( rasterInterface );
   iter.startRasterRead( rasterBand, nCellsX, nCellsY, rasterBBox );
@@ -126,38 +121,26 @@ void QgsRasterAnalysisUtils::statisticsFromPreciseIntersection( QgsRasterInterfa
   int iterRows = 0;
   QgsRectangle blockExtent;
   bool isNoData = false;
+  std::vector< double > coverage;
   while ( iter.readNextRasterPart( rasterBand, iterCols, iterRows, block, iterLeft, iterTop, &blockExtent ) )
   {
-    double currentY = blockExtent.yMaximum() - 0.5 * cellSizeY;
+    coverage.resize( static_cast< std::size_t >( iterCols ) * iterRows );
+    rasterizer.rasterizeCoverage( iterLeft, iterTop, iterCols, iterRows, coverage.data() );
+
+    const double *weight = coverage.data();
     for ( int row = 0; row < iterRows; ++row )
     {
-      double currentX = blockExtent.xMinimum() + 0.5 * cellSizeX;
-      for ( int col = 0; col < iterCols; ++col )
+      for ( int col = 0; col < iterCols; ++col, ++weight )
       {
+        if ( *weight <= 0.0 )
+          continue;
+
         const double pixelValue = block->valueAndNoData( row, col, isNoData );
         if ( validPixel( pixelValue ) && ( !skipNodata || !isNoData ) )
         {
-          pixelRectGeometry = QgsGeometry::fromRect( QgsRectangle( currentX - hCellSizeX, currentY - hCellSizeY, currentX + hCellSizeX, currentY + hCellSizeY ) );
-          // GEOS intersects tests on prepared geometry is MAGNITUDES faster than calculating the intersection itself,
-          // so we first test to see if there IS an intersection before doing the actual calculation
-          if ( !pixelRectGeometry.isNull() && polyEngine->intersects( pixelRectGeometry.constGet() ) )
-          {
-            //intersection
-            QgsGeometry intersectGeometry = pixelRectGeometry.intersection( poly );
-            if ( !intersectGeometry.isEmpty() )
-            {
-              double intersectionArea = intersectGeometry.area();
-              if ( intersectionArea > 0.0 )
-              {
-                weight = intersectionArea / pixelArea;
-                addValue( pixelValue, weight );
-              }
-            }
-          }
+          addValue( pixelValue, *weight );
         }
-        currentX += cellSizeX;
       }
-      currentY -= cellSizeY;
     }
   }
 }
@@ -213,5 +196,260 @@ Qgis::DataType QgsRasterAnalysisUtils::rasterTypeChoiceToDataType( int choice )
   return sDataTypes.value( choice ).second;
 }
 
+//
+// QgsPolygonRasterizer
+//
+
+QgsPolygonRasterizer::QgsPolygonRasterizer( const QgsGeometry &geometry, const QgsRectangle &gridExtent, double cellSizeX, double cellSizeY )
+  : mOriginX( gridExtent.xMinimum() )
+  , mOriginY( gridExtent.yMaximum() )
+  , mCellSizeX( cellSizeX )
+  , mCellSizeY( cellSizeY )
+{
+  if ( geometry.isNull() || cellSizeX <= 0 || cellSizeY <= 0 )
+    return;
+
+  if ( QgsWkbTypes::isCurvedType( geometry.wkbType() ) )
+  {
+    std::unique_ptr< QgsAbstractGeometry > segmentized( geometry.constGet()->segmentize() );
+    addGeometry( segmentized.get() );
+  }
+  else
+  {
+    addGeometry( geometry.constGet() );
+  }
+
+  std::sort( mEdges.begin(), mEdges.end(), []( const Edge & a, const Edge & b ) { return a.y0 < b.y0; } );
+}
+
+void QgsPolygonRasterizer::addGeometry( const QgsAbstractGeometry *geometry )
+{
+  if ( const QgsGeometryCollection *collection = qgsgeometry_cast< const QgsGeometryCollection * >( geometry ) )
+  {
+    for ( int i = 0; i < collection->numGeometries(); ++i )
+      addGeometry( collection->geometryN( i ) );
+  }
+  else if ( const QgsCurvePolygon *polygon = qgsgeometry_cast< const QgsCurvePolygon * >( geometry ) )
+  {
+    if ( !polygon->exteriorRing() )
+      return;
+
+    addRing( polygon->exteriorRing(), true );
+    for ( int i = 0; i < polygon->numInteriorRings(); ++i )
+      addRing( polygon->interiorRing( i ), false );
+  }
+}
+
+void QgsPolygonRasterizer::addRing( const QgsCurve *ring, bool exterior )
+{
+  std::unique_ptr< QgsLineString > segmentized;
+  const QgsLineString *line = qgsgeometry_cast< const QgsLineString * >( ring );
+  if ( !line )
+  {
+    segmentized.reset( ring->curveToLine() );
+    line = segmentized.get();
+  }
+
+  const int count = line->numPoints();
+  if ( count < 3 )
+    return;
+
+  const double *x = line->xData();
+  const double *y = line->yData();
+  QVector< double > px( count );
+  QVector< double > py( count );
+  double area = 0;
+  for ( int i = 0; i < count; ++i )
+  {
+    px[ i ] = ( x[ i ] - mOriginX ) / mCellSizeX;
+    py[ i ] = ( mOriginY - y[ i ] ) / mCellSizeY;
+    if ( i > 0 )
+      area += px[ i - 1 ] * py[ i ] - px[ i ] * py[ i - 1 ];
+  }
+  area += px[ count - 1 ] * py[ 0 ] - px[ 0 ] * py[ count - 1 ];
+
+  // exterior rings and holes must wind in opposite directions for the coverage sums to cancel out in holes,
+  // whatever the orientation of the input rings
+  const double ringDirection = ( ( area > 0 ) == exterior ) ? 1.0 : -1.0;
+
+  mEdges.reserve( mEdges.size() + count );
+  for ( int i = 0; i < count; ++i )
+  {
+    // the ring is closed explicitly, but be tolerant of unclosed rings
+    const int j = i + 1 < count ? i + 1 : 0;
+    if ( py[ i ] == py[ j ] )
+      continue; // horizontal edges never cross a row boundary and cover no area
+
+    if ( py[ i ] < py[ j ] )
+      mEdges.append( { px[ i ], py[ i ], px[ j ], py[ j ], ringDirection } );
+    else
+      mEdges.append( { px[ j ], py[ j ], px[ i ], py[ i ], -ringDirection } );
+  }
+}
+
+QVector< const QgsPolygonRasterizer::Edge * > QgsPolygonRasterizer::edgesForRows( int top, int height ) const
+{
+  QVector< const Edge * > edges;
+  const double bottom = top + height;
+  for ( const Edge &edge : mEdges )
+  {
+    if ( edge.y0 >= bottom )
+      break;
+    if ( edge.y1 > top )
+      edges.append( &edge );
+  }
+  return edges;
+}
+
+void QgsPolygonRasterizer::rasterizeCenters( int left, int top, int width, int height, unsigned char *mask ) const
+{
+  std::fill( mask, mask + static_cast< std::size_t >( width ) * height, 0 );
+
+  const QVector< const Edge * > edges = edgesForRows( top, height );
+  QVector< const Edge * > activeEdges;
+  QVector< double > crossings;
+  int nextEdge = 0;
+  for ( int row = 0; row < height; ++row )
+  {
+    // an edge crosses the scanline through the pixel centers if y0 <= y < y1, so that vertices are counted once
+    const double y = top + row + 0.5;
+    while ( nextEdge < edges.size() && edges.at( nextEdge )->y0 <= y )
+      activeEdges.append( edges.at( nextEdge++ ) );
+
+    crossings.clear();
+    int kept = 0;
+    for ( const Edge *edge : qgis::as_const( activeEdges ) )
+    {
+      if ( edge->y1 <= y )
+        continue;
+
+      activeEdges[ kept++ ] = edge;
+      crossings.append( edge->x0 + ( y - edge->y0 ) * ( edge->x1 - edge->x0 ) / ( edge->y1 - edge->y0 ) - left );
+    }
+    activeEdges.resize( kept );
+    std::sort( crossings.begin(), crossings.end() );
+
+    // even-odd rule: pixel centers between pairs of crossings are inside
+    unsigned char *rowMask = mask + static_cast< std::size_t >( row ) * width;
+    for ( int i = 0; i + 1 < crossings.size(); i += 2 )
+    {
+      // clamp before converting to int, crossings may be far outside the block
+      const double first = std::min( std::max( crossings.at( i ) - 0.5, -1.0 ), static_cast< double >( width ) );
+      const double last = std::min( std::max( crossings.at( i + 1 ) - 0.5, -1.0 ), static_cast< double >( width ) );
+      const int startCol = static_cast< int >( std::floor( first ) ) + 1;
+      const int endCol = static_cast< int >( std::ceil( last ) );
+      if ( startCol < endCol )
+        std::fill( rowMask + startCol, rowMask + endCol, 1 );
+    }
+  }
+}
+
+/**
+ * Accumulates the area covered by an edge piece within a single row into \a acc, so that the running sum
+ * of acc over a row gives the signed coverage of each pixel. Coordinates are relative to the row and the
+ * first column of the block, \a acc must hold width + 2 values.
+ */
+static void accumulateEdgeCoverage( double *acc, int width, double x0, double y0, double x1, double y1, double direction )
+{
+  // split the piece at the left and right block borders. Parts outside the block are moved
+  // onto the border, which keeps their contribution to the pixels right of them unchanged
+  for ( const double border : { 0.0, static_cast< double >( width ) } )
+  {
+    if ( ( x0 < border && x1 > border ) || ( x0 > border && x1 < border ) )
+    {
+      const double yBorder = y0 + ( border - x0 ) * ( y1 - y0 ) / ( x1 - x0 );
+      accumulateEdgeCoverage( acc, width, x0, y0, border, yBorder, direction );
+      accumulateEdgeCoverage( acc, width, border, yBorder, x1, y1, direction );
+      return;
+    }
+  }
+  x0 = std::min( std::max( x0, 0.0 ), static_cast< double >( width ) );
+  x1 = std::min( std::max( x1, 0.0 ), static_cast< double >( width ) );
+
+  const double d = ( y1 - y0 ) * direction;
+  if ( d == 0.0 )
+    return;
+
+  const double xLeft = std::min( x0, x1 );
+  const double xRight = std::max( x0, x1 );
+  const int leftCol = static_cast< int >( std::floor( xLeft ) );
+  const int rightCol = static_cast< int >( std::ceil( xRight ) );
+  if ( rightCol <= leftCol + 1 )
+  {
+    // piece within a single pixel: the part of the pixel right of it is covered
+    const double xMid = 0.5 * ( x0 + x1 ) - leftCol;
+    acc[ leftCol ] += d - d * xMid;
+    acc[ leftCol + 1 ] += d * xMid;
+  }
+  else
+  {
+    // piece over several pixels, the covered height grows linearly from left to right
+    const double slope = 1.0 / ( xRight - xLeft );
+    const double leftFraction = xLeft - leftCol;
+    const double leftArea = 0.5 * slope * ( 1.0 - leftFraction ) * ( 1.0 - leftFraction );
+    const double rightFraction = xRight - rightCol + 1.0;
+    const double rightArea = 0.5 * slope * rightFraction * rightFraction;
+    acc[ leftCol ] += d * leftArea;
+    if ( rightCol == leftCol + 2 )
+    {
+      acc[ leftCol + 1 ] += d * ( 1.0 - leftArea - rightArea );
+    }
+    else
+    {
+      const double secondArea = slope * ( 1.5 - leftFraction );
+      acc[ leftCol + 1 ] += d * ( secondArea - leftArea );
+      for ( int col = leftCol + 2; col < rightCol - 1; ++col )
+        acc[ col ] += d * slope;
+      const double beforeLastArea = secondArea + ( rightCol - leftCol - 3 ) * slope;
+      acc[ rightCol - 1 ] += d * ( 1.0 - beforeLastArea - rightArea );
+    }
+    acc[ rightCol ] += d * rightArea;
+  }
+}
+
+void QgsPolygonRasterizer::rasterizeCoverage( int left, int top, int width, int height, double *coverage ) const
+{
+  // fractions this close to 0 or 1 are rounding noise from the running sums
+  const double epsilon = 1e-10;
+
+  const QVector< const Edge * > edges = edgesForRows( top, height );
+  QVector< const Edge * > activeEdges;
+  std::vector< double > acc( static_cast< std::size_t >( width ) + 2 );
+  int nextEdge = 0;
+  for ( int row = 0; row < height; ++row )
+  {
+    const double rowTop = top + row;
+    const double rowBottom = rowTop + 1;
+    while ( nextEdge < edges.size() && edges.at( nextEdge )->y0 < rowBottom )
+      activeEdges.append( edges.at( nextEdge++ ) );
+
+    std::fill( acc.begin(), acc.end(), 0.0 );
+    int kept = 0;
+    for ( const Edge *edge : qgis::as_const( activeEdges ) )
+    {
+      if ( edge->y1 <= rowTop )
+        continue;
+
+      activeEdges[ kept++ ] = edge;
+      const double y0 = std::max( edge->y0, rowTop );
+      const double y1 = std::min( edge->y1, rowBottom );
+      const double slope = ( edge->x1 - edge->x0 ) / ( edge->y1 - edge->y0 );
+      const double x0 = edge->x0 + ( y0 - edge->y0 ) * slope - left;
+      const double x1 = edge->x0 + ( y1 - edge->y0 ) * slope - left;
+      accumulateEdgeCoverage( acc.data(), width, x0, y0 - rowTop, x1, y1 - rowTop, edge->direction );
+    }
+    activeEdges.resize( kept );
+
+    double *rowCoverage = coverage + static_cast< std::size_t >( row ) * width;
+    double sum = 0;
+    for ( int col = 0; col < width; ++col )
+    {
+      sum += acc[ col ];
+      const double fraction = std::fabs( sum );
+      rowCoverage[ col ] = fraction < epsilon ? 0.0 : ( fraction > 1.0 - epsilon ? 1.0 : fraction );
+    }
+  }
+}
+
 ///@endcond PRIVATE
 
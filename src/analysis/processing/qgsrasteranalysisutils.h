@@ -19,6 +19,8 @@
 #include "qgis_analysis.h"
 #include "qgis.h"
 
+#include <QVector>
+
 #include <functional>
 #include <memory>
 
@@ -28,6 +30,8 @@
 
 class QgsRasterInterface;
 class QgsGeometry;
+class QgsAbstractGeometry;
+class QgsCurve;
 class QgsRectangle;
 class QgsProcessingParameterDefinition;
 
@@ -45,7 +49,7 @@ namespace QgsRasterAnalysisUtils
   void statisticsFromMiddlePointTest( QgsRasterInterface *rasterInterface, int rasterBand, const QgsGeometry &poly, int nCellsX, int nCellsY,
                                       double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, const std::function<void( double )> &addValue, bool skipNodata = true );
 
-  //! Returns statistics with precise pixel - polygon intersection test (slow)
+  //! Returns statistics weighted by the fraction of each pixel covered by the polygon
   void statisticsFromPreciseIntersection( QgsRasterInterface *rasterInterface, int rasterBand, const QgsGeometry &poly, int nCellsX, int nCellsY,
                                           double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, const std::function<void( double, double )> &addValue, bool skipNodata = true );
 
@@ -67,6 +71,70 @@ namespace QgsRasterAnalysisUtils
   Qgis::DataType rasterTypeChoiceToDataType( int choice );
 }
 
+/**
+ * Rasterizes a polygon or multipolygon onto a grid of pixels using a scanline algorithm.
+ *
+ * The edges of the polygon are converted to pixel coordinates once. Each row of pixels is then
+ * processed in a single walk over the edges crossing it, either to find the spans of pixels whose
+ * center is inside the polygon, or to compute the exact fraction of each pixel covered by the polygon.
+ * No geometry engine is involved, so the cost is proportional to the number of pixels plus the
+ * number of edge crossings, instead of one GEOS operation per pixel.
+ */
+class ANALYSIS_EXPORT QgsPolygonRasterizer
+{
+  public:
+
+    /**
+     * Constructor for QgsPolygonRasterizer, for a polygon \a geometry and a grid of pixels of size
+     * \a cellSizeX by \a cellSizeY whose top left corner is the top left corner of \a gridExtent.
+     * Curved geometries are segmentized, non polygon parts are ignored.
+     */
+    QgsPolygonRasterizer( const QgsGeometry &geometry, const QgsRectangle &gridExtent, double cellSizeX, double cellSizeY );
+
+    //! Returns true if the geometry does not contain any polygon edge
+    bool isEmpty() const { return mEdges.isEmpty(); }
+
+    /**
+     * Tests which pixels of the block of \a width by \a height pixels starting at column \a left
+     * and row \a top of the grid have their center within the polygon. Values in \a mask, which must
+     * hold width * height values in row major order, are set to 1 for those pixels and 0 otherwise.
+     */
+    void rasterizeCenters( int left, int top, int width, int height, unsigned char *mask ) const;
+
+    /**
+     * Computes the fraction of the area of each pixel of the block of \a width by \a height pixels
+     * starting at column \a left and row \a top of the grid which is covered by the polygon.
+     * Fractions from 0 to 1 are stored in \a coverage, which must hold width * height values in
+     * row major order.
+     */
+    void rasterizeCoverage( int left, int top, int width, int height, double *coverage ) const;
+
+  private:
+
+    //! Polygon edge in pixel coordinates, with y0 <= y1
+    struct Edge
+    {
+      double x0;
+      double y0;
+      double x1;
+      double y1;
+      //! Winding contribution of the edge, after normalizing the orientation of rings
+      double direction;
+    };
+
+    void addGeometry( const QgsAbstractGeometry *geometry );
+    void addRing( const QgsCurve *ring, bool exterior );
+    QVector< const Edge * > edgesForRows( int top, int height ) const;
+
+    double mOriginX = 0;
+    double mOriginY = 0;
+    double mCellSizeX = 1;
+    double mCellSizeY = 1;
+
+    //! Edges sorted by y0
+    QVector< Edge > mEdges;
+};
+
 
 ///@endcond PRIVATE
 
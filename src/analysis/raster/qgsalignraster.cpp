@@ -15,13 +15,22 @@
 
 #include "qgsalignraster.h"
 
+#include "qgis.h"
+
 #include <gdalwarper.h>
 #include <ogr_srs_api.h>
 #include <cpl_conv.h>
+#include <algorithm>
 #include <limits>
 
+#include <QFuture>
+#include <QMutex>
 #include <QPair>
 #include <QString>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <QtConcurrentRun>
 
 #include "qgscoordinatereferencesystem.h"
 #include "qgsrectangle.h"
@@ -60,15 +69,53 @@ static QgsRectangle transform_to_extent( const double *geotransform, double xSiz
 }
 
 
+///@cond PRIVATE
+
+//! Progress of rasters warped in parallel, reported to the progress handler by the thread running the alignment
+struct SharedWarpProgress
+{
+  QMutex mutex;
+  QWaitCondition changed;
+  QVector<double> progress;
+  bool canceled = false;
+};
+
+//! Progress argument of a single warp
+struct QgsAlignRasterWarpProgress
+{
+  //! Handler called directly by the warping thread, if shared is not set
+  QgsAlignRaster::ProgressHandler *handler = nullptr;
+  SharedWarpProgress *shared = nullptr;
+  int index = 0;
+  //! Progress range of the current GDAL operation within the raster
+  double base = 0;
+  double scale = 1;
+  //! Set when the progress function asked GDAL to stop
+  bool canceled = false;
+};
+
+///@endcond
+
 static int CPL_STDCALL _progress( double dfComplete, const char *pszMessage, void *pProgressArg )
 {
   Q_UNUSED( pszMessage );
 
-  QgsAlignRaster::ProgressHandler *handler = ( ( QgsAlignRaster * ) pProgressArg )->progressHandler();
-  if ( handler )
-    return handler->progress( dfComplete );
-  else
-    return true;
+  QgsAlignRasterWarpProgress *warpProgress = static_cast< QgsAlignRasterWarpProgress * >( pProgressArg );
+  const double complete = warpProgress->base + warpProgress->scale * dfComplete;
+  bool proceed = true;
+  if ( warpProgress->shared )
+  {
+    QMutexLocker locker( &warpProgress->shared->mutex );
+    warpProgress->shared->progress[ warpProgress->index ] = complete;
+    warpProgress->shared->changed.wakeAll();
+    proceed = !warpProgress->shared->canceled;
+  }
+  else if ( warpProgress->handler )
+    proceed = warpProgress->handler->progress( complete );
+
+  if ( !proceed )
+    warpProgress->canceled = true;
+  return proceed;
 }
 
 
@@ -363,10 +410,80 @@ bool QgsAlignRaster::run()
 
   //dump();
 
-  Q_FOREACH ( const Item &r, mRasters )
+  const int rasterCount = mRasters.count();
+  if ( rasterCount == 0 )
+    return true;
+
+  // rasters are warped in parallel, with remaining cores used by GDAL for each raster
+  const int cores = std::max( 1, QThread::idealThreadCount() );
+  const int parallelWarps = std::max( 1, std::min( rasterCount, mMaxParallelWarps > 0 ? mMaxParallelWarps : cores ) );
+  const int threads = std::max( 1, cores / parallelWarps );
+  const double memoryLimit = mWarpMemoryLimit > 0 ? mWarpMemoryLimit * 1024.0 * 1024.0 / parallelWarps : 0;
+
+  SharedWarpProgress shared;
+  shared.progress.fill( 0, rasterCount );
+  QVector<QgsAlignRasterWarpProgress> warpProgress( rasterCount );
+  QVector<QString> errors( rasterCount );
+
+  QThreadPool pool;
+  pool.setMaxThreadCount( parallelWarps );
+  QList< QFuture<bool> > futures;
+  for ( int i = 0; i < rasterCount; ++i )
   {
-    if ( !createAndWarp( r ) )
+    warpProgress[i].shared = &shared;
+    warpProgress[i].index = i;
+    const Item &raster = mRasters.at( i );
+    QgsAlignRasterWarpProgress *progress = &warpProgress[i];
+    QString *error = &errors[i];
+    futures << QtConcurrent::run( &pool, [this, &raster, threads, memoryLimit, progress, error]
+    {
+      return warpRaster( raster, threads, memoryLimit, progress, *error );
+    } );
+  }
+
+  // report progress from this thread until all warps are finished, progress handlers may not be thread safe
+  QVector<double> reported( rasterCount, -1 );
+  shared.mutex.lock();
+  while ( true )
+  {
+    bool finished = true;
+    for ( const QFuture<bool> &future : qgis::as_const( futures ) )
+      finished &= future.isFinished();
+
+    const QVector<double> progress = shared.progress;
+    shared.mutex.unlock();
+
+    bool cancel = false;
+    if ( mProgressHandler && progress != reported )
+    {
+      double total = 0;
+      for ( int i = 0; i < rasterCount; ++i )
+      {
+        if ( progress.at( i ) != reported.at( i ) && !mProgressHandler->rasterProgress( i, progress.at( i ) ) )
+          cancel = true;
+        total += progress.at( i );
+      }
+      if ( !mProgressHandler->progress( total / rasterCount ) )
+        cancel = true;
+      reported = progress;
+    }
+
+    shared.mutex.lock();
+    if ( cancel )
+      shared.canceled = true;
+    if ( finished )
+      break;
+    shared.changed.wait( &shared.mutex, 100 );
+  }
+  shared.mutex.unlock();
+
+  for ( int i = 0; i < rasterCount; ++i )
+  {
+    if ( !futures.at( i ).result() )
+    {
+      mErrorMessage = errors.at( i );
       return false;
+    }
   }
   return true;
 }
@@ -417,11 +534,19 @@ int QgsAlignRaster::suggestedReferenceLayer() const
 
 
 bool QgsAlignRaster::createAndWarp( const Item &raster )
+{
+  QgsAlignRasterWarpProgress progress;
+  progress.handler = mProgressHandler;
+  return warpRaster( raster, 1, 0, &progress, mErrorMessage );
+}
+
+
+bool QgsAlignRaster::warpRaster( const Item &raster, int threads, double memoryLimit, QgsAlignRasterWarpProgress *progress, QString &errorMessage ) const
 {
   GDALDriverH hDriver = GDALGetDriverByName( "GTiff" );
   if ( !hDriver )
   {
-    mErrorMessage = QStringLiteral( "GDALGetDriverByName(GTiff) failed." );
+    errorMessage = QStringLiteral( "GDALGetDriverByName(GTiff) failed." );
     return false;
   }
 
@@ -429,7 +554,7 @@ bool QgsAlignRaster::createAndWarp( const Item &raster )
   gdal::dataset_unique_ptr hSrcDS( GDALOpen( raster.inputFilename.toLocal8Bit().constData(), GA_ReadOnly ) );
   if ( !hSrcDS )
   {
-    mErrorMessage = QObject::tr( "Unable to open input file: %1" ).arg( raster.inputFilename );
+    errorMessage = QObject::tr( "Unable to open input file: %1" ).arg( raster.inputFilename );
     return false;
   }
 
@@ -438,18 +563,28 @@ bool QgsAlignRaster::createAndWarp( const Item &raster )
   int bandCount = GDALGetRasterCount( hSrcDS.get() );
   GDALDataType eDT = GDALGetRasterDataType( GDALGetRasterBand( hSrcDS.get(), 1 ) );
 
+  char **papszCreateOptions = nullptr;
+  if ( mCreateTiledOutputs )
+  {
+    papszCreateOptions = CSLSetNameValue( papszCreateOptions, "TILED", "YES" );
+    papszCreateOptions = CSLSetNameValue( papszCreateOptions, "BIGTIFF", "IF_SAFER" );
+  }
+
   // Create the output file.
   gdal::dataset_unique_ptr hDstDS( GDALCreate( hDriver, raster.outputFilename.toLocal8Bit().constData(), mXSize, mYSize,
-                                   bandCount, eDT, nullptr ) );
+                                   bandCount, eDT, papszCreateOptions ) );
+  CSLDestroy( papszCreateOptions );
   if ( !hDstDS )
   {
-    mErrorMessage = QObject::tr( "Unable to create output file: %1" ).arg( raster.outputFilename );
+    errorMessage = QObject::tr( "Unable to create output file: %1" ).arg( raster.outputFilename );
     return false;
   }
 
   // Write out the projection definition.
   GDALSetProjection( hDstDS.get(), mCrsWkt.toLatin1().constData() );
-  GDALSetGeoTransform( hDstDS.get(), mGeoTransform );
+  double geoTransform[6];
+  std::copy( mGeoTransform, mGeoTransform + 6, geoTransform );
+  GDALSetGeoTransform( hDstDS.get(), geoTransform );
 
   // Copy the color table, if required.
   GDALColorTableH hCT = GDALGetRasterColorTable( GDALGetRasterBand( hSrcDS.get(), 1 ) );
@@ -474,9 +609,16 @@ bool QgsAlignRaster::createAndWarp( const Item &raster )
 
   psWarpOptions->eResampleAlg = static_cast< GDALResampleAlg >( raster.resampleMethod );
 
-  // our progress function
+  if ( memoryLimit > 0 )
+    psWarpOptions->dfWarpMemoryLimit = memoryLimit;
+  if ( threads > 1 )
+    psWarpOptions->papszWarpOptions = CSLSetNameValue( psWarpOptions->papszWarpOptions, "NUM_THREADS", QByteArray::number( threads ).constData() );
+
+  // our progress function, warping is followed by building of overviews if requested
+  progress->base = 0;
+  progress->scale = mBuildOverviews ? 0.8 : 1.0;
   psWarpOptions->pfnProgress = _progress;
-  psWarpOptions->pProgressArg = this;
+  psWarpOptions->pProgressArg = progress;
 
   // Establish reprojection transformer.
   psWarpOptions->pTransformerArg =
@@ -501,9 +643,43 @@ bool QgsAlignRaster::createAndWarp( const Item &raster )
   // Initialize and execute the warp operation.
   GDALWarpOperation oOperation;
   oOperation.Initialize( psWarpOptions.get() );
-  oOperation.ChunkAndWarpImage( 0, 0, mXSize, mYSize );
+  // with several threads, reading and writing of chunks overlaps with warping
+  CPLErr warpResult = threads > 1 ? oOperation.ChunkAndWarpMulti( 0, 0, mXSize, mYSize )
+                      : oOperation.ChunkAndWarpImage( 0, 0, mXSize, mYSize );
 
   GDALDestroyGenImgProjTransformer( psWarpOptions->pTransformerArg );
+
+  if ( warpResult != CE_None )
+  {
+    if ( progress->canceled )
+      errorMessage = QObject::tr( "Canceled while warping input file: %1" ).arg( raster.inputFilename );
+    else
+      errorMessage = QObject::tr( "Unable to warp input file: %1" ).arg( raster.inputFilename );
+    return false;
+  }
+
+  if ( mBuildOverviews )
+  {
+    QVector<int> levels;
+    for ( int factor = 2; std::max( mXSize, mYSize ) / factor >= 256; factor *= 2 )
+      levels << factor;
+
+    if ( !levels.isEmpty() )
+    {
+      const char *resampling = raster.resampleMethod == RA_NearestNeighbour ? "NEAREST"
+                               : raster.resampleMethod == RA_Mode ? "MODE" : "AVERAGE";
+      progress->base = 0.8;
+      progress->scale = 0.2;
+      if ( GDALBuildOverviews( hDstDS.get(), resampling, levels.count(), levels.data(), 0, nullptr, _progress, progress ) != CE_None )
+      {
+        if ( progress->canceled )
+          errorMessage = QObject::tr( "Canceled while building overviews of output file: %1" ).arg( raster.outputFilename );
+        else
+          errorMessage = QObject::tr( "Unable to build overviews of output file: %1" ).arg( raster.outputFilename );
+        return false;
+      }
+    }
+  }
   return true;
 }
 
@@ -26,6 +26,7 @@
 #include "qgsogrutils.h"
 
 class QgsRectangle;
+struct QgsAlignRasterWarpProgress;
 
 typedef void *GDALDatasetH SIP_SKIP;
 
@@ -164,6 +165,16 @@ class ANALYSIS_EXPORT QgsAlignRaster
        */
       virtual bool progress( double complete ) = 0;
 
+      /**
+       * Method to be overridden for progress reporting of individual rasters.
+       * It is called from the thread running the alignment, together with progress().
+       * \param index Index of the raster in rasters()
+       * \param complete Progress of the alignment of the raster
+       * \returns false if the execution should be canceled, true otherwise
+       * \since QGIS 3.6
+       */
+      virtual bool rasterProgress( int index, double complete ) { Q_UNUSED( index ); Q_UNUSED( complete ); return true; }
+
       virtual ~ProgressHandler() = default;
     };
 
@@ -187,6 +198,65 @@ class ANALYSIS_EXPORT QgsAlignRaster
     //! Gets output cell size
     QSizeF cellSize() const { return QSizeF( mCellSizeX, mCellSizeY ); }
 
+    /**
+     * Sets the maximum number of rasters which are warped at the same time. With 0 (the default),
+     * up to one raster per CPU core is warped. Remaining cores are used by GDAL to warp each raster
+     * with several threads.
+     * \see maximumParallelWarps()
+     * \since QGIS 3.6
+     */
+    void setMaximumParallelWarps( int count ) { mMaxParallelWarps = count; }
+
+    /**
+     * Returns the maximum number of rasters which are warped at the same time, 0 if automatic.
+     * \see setMaximumParallelWarps()
+     * \since QGIS 3.6
+     */
+    int maximumParallelWarps() const { return mMaxParallelWarps; }
+
+    /**
+     * Sets the memory budget for warping, in megabytes. The budget is shared by all rasters warped
+     * at the same time. With 0 (the default), GDAL's default memory limit is used for each raster.
+     * \see warpMemoryLimit()
+     * \since QGIS 3.6
+     */
+    void setWarpMemoryLimit( int megabytes ) { mWarpMemoryLimit = megabytes; }
+
+    /**
+     * Returns the memory budget for warping, in megabytes. 0 if GDAL's default is used for each raster.
+     * \see setWarpMemoryLimit()
+     * \since QGIS 3.6
+     */
+    int warpMemoryLimit() const { return mWarpMemoryLimit; }
+
+    /**
+     * Sets whether aligned rasters are written as tiled GeoTIFF files.
+     * \see createTiledOutputs()
+     * \since QGIS 3.6
+     */
+    void setCreateTiledOutputs( bool tiled ) { mCreateTiledOutputs = tiled; }
+
+    /**
+     * Returns whether aligned rasters are written as tiled GeoTIFF files.
+     * \see setCreateTiledOutputs()
+     * \since QGIS 3.6
+     */
+    bool createTiledOutputs() const { return mCreateTiledOutputs; }
+
+    /**
+     * Sets whether internal overviews are built for aligned rasters, right after each raster is warped.
+     * \see buildOverviews()
+     * \since QGIS 3.6
+     */
+    void setBuildOverviews( bool build ) { mBuildOverviews = build; }
+
+    /**
+     * Returns whether internal overviews are built for aligned rasters.
+     * \see setBuildOverviews()
+     * \since QGIS 3.6
+     */
+    bool buildOverviews() const { return mBuildOverviews; }
+
     //! Sets the output CRS in WKT format
     void setDestinationCrs( const QString &crsWkt ) { mCrsWkt = crsWkt; }
     //! Gets the output CRS in WKT format
@@ -248,7 +318,8 @@ class ANALYSIS_EXPORT QgsAlignRaster
     QgsRectangle alignedRasterExtent() const;
 
     /**
-     * Run the alignment process
+     * Run the alignment process. Rasters are warped in parallel, see setMaximumParallelWarps().
+     * The progress handler is always called from the thread calling run().
      * \returns true on success, sets error on error (see errorMessage())
      */
     bool run();
@@ -309,6 +380,16 @@ class ANALYSIS_EXPORT QgsAlignRaster
     //! Computed raster grid height
     int mYSize;
 
+  private:
+
+    //! Creates the output of a raster and warps it, using \a threads GDAL threads and \a memoryLimit bytes
+    bool warpRaster( const Item &raster, int threads, double memoryLimit, QgsAlignRasterWarpProgress *progress, QString &errorMessage ) const;
+
+    int mMaxParallelWarps = 0;
+    int mWarpMemoryLimit = 0;
+    bool mCreateTiledOutputs = false;
+    bool mBuildOverviews = false;
+
 };
 
 
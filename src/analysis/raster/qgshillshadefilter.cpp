@@ -57,6 +57,17 @@ float QgsHillshadeFilter::processNineCellWindow( float *x11, float *x21, float *
                                       std::cos( mAzimuthRad - aspect_rad ) ) ) );
 }
 
+void QgsHillshadeFilter::processNineCellRow( float *scanLine1, float *scanLine2, float *scanLine3, float *resultLine, int count )
+{
+  // non-virtual calls, which the compiler can inline into the row loop
+  for ( int xIndex = 0; xIndex < count; ++xIndex )
+  {
+    resultLine[ xIndex ] = QgsHillshadeFilter::processNineCellWindow( &scanLine1[ xIndex ], &scanLine1[ xIndex + 1 ], &scanLine1[ xIndex + 2 ],
+                           &scanLine2[ xIndex ], &scanLine2[ xIndex + 1 ], &scanLine2[ xIndex + 2 ],
+                           &scanLine3[ xIndex ], &scanLine3[ xIndex + 1 ], &scanLine3[ xIndex + 2 ] );
+  }
+}
+
 void QgsHillshadeFilter::setLightAzimuth( float azimuth )
 {
   mLightAzimuth = azimuth;
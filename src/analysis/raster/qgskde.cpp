@@ -18,8 +18,20 @@
 #include "qgsfeatureiterator.h"
 #include "qgsgeometry.h"
 
+#include <QThreadPool>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #define NO_DATA -9999
 
+//! Size in pixels of the tiles of the in-memory surface
+static const int TILE_SIZE = 256;
+//! Number of points collected before their kernels are added to the surface in parallel
+static const int PENDING_POINTS_BATCH_SIZE = 65536;
+
 QgsKernelDensityEstimation::QgsKernelDensityEstimation( const QgsKernelDensityEstimation::Parameters &parameters, const QString &outputFile, const QString &outputFormat )
   : mSource( parameters.source )
   , mOutputFile( outputFile )
@@ -101,6 +113,14 @@ QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::prepare()
   if ( mRadiusField < 0 )
     mBufferSize = radiusSizeInPixels( mRadius );
 
+  mRows = rows;
+  mColumns = cols;
+  mTileRows = ( rows + TILE_SIZE - 1 ) / TILE_SIZE;
+  mTileColumns = ( cols + TILE_SIZE - 1 ) / TILE_SIZE;
+  mTiles.clear();
+  mTiles.resize( static_cast< std::size_t >( mTileRows ) * mTileColumns );
+  mPendingPoints.clear();
+
   return Success;
 }
 
@@ -157,59 +177,177 @@ QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::addFeature( const
     }
 
     // calculate the pixel position
-    unsigned int xPosition = ( ( ( *pointIt ).x() - mBounds.xMinimum() ) / mPixelSize ) - buffer;
-    unsigned int yPosition = ( ( ( *pointIt ).y() - mBounds.yMinimum() ) / mPixelSize ) - buffer;
-    unsigned int yPositionIO = ( ( mBounds.yMaximum() - ( *pointIt ).y() ) / mPixelSize ) - buffer;
+    const double xPosition = ( ( ( *pointIt ).x() - mBounds.xMinimum() ) / mPixelSize ) - buffer;
+    const double yPosition = ( ( ( *pointIt ).y() - mBounds.yMinimum() ) / mPixelSize ) - buffer;
+    const double yPositionIO = ( ( mBounds.yMaximum() - ( *pointIt ).y() ) / mPixelSize ) - buffer;
+
+    // kernels which do not fit in the raster are not added
+    if ( blockSize <= 0 || xPosition <= -1 || yPositionIO <= -1
+         || static_cast< qint64 >( xPosition ) + blockSize > mColumns
+         || static_cast< qint64 >( yPositionIO ) + blockSize > mRows )
+    {
+      result = RasterIoError;
+      continue;
+    }
+    if ( yPosition <= -1 )
+    {
+      // no pixel of the kernel is within the radius of the point
+      continue;
+    }
+
+    PendingPoint point;
+    point.x = ( *pointIt ).x();
+    point.y = ( *pointIt ).y();
+    point.radius = radius;
+    point.weight = weight;
+    point.buffer = buffer;
+    point.xPosition = static_cast< unsigned int >( xPosition );
+    point.yPosition = static_cast< unsigned int >( yPosition );
+    point.yPositionIO = static_cast< unsigned int >( yPositionIO );
+    mPendingPoints.append( point );
+  }
+
+  if ( mPendingPoints.size() >= PENDING_POINTS_BATCH_SIZE )
+    addPendingPoints();
+
+  return result;
+}
 
+QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::finalise()
+{
+  addPendingPoints();
 
-    // get the data
-    float *dataBuffer = ( float * ) CPLMalloc( sizeof( float ) * blockSize * blockSize );
-    if ( GDALRasterIO( mRasterBandH, GF_Read, xPosition, yPositionIO, blockSize, blockSize,
-                       dataBuffer, blockSize, blockSize, GDT_Float32, 0, 0 ) != CE_None )
+  Result result = Success;
+  if ( mRasterBandH )
+  {
+    // write the surface one row of tiles at a time
+    std::vector< float > rowsBuffer( static_cast< std::size_t >( mColumns ) * TILE_SIZE );
+    for ( int tileRow = 0; tileRow < mTileRows; ++tileRow )
     {
-      result = RasterIoError;
+      const int firstRow = tileRow * TILE_SIZE;
+      const int rowCount = std::min( TILE_SIZE, mRows - firstRow );
+      for ( int tileColumn = 0; tileColumn < mTileColumns; ++tileColumn )
+      {
+        const float *tile = mTiles[ static_cast< std::size_t >( tileRow ) * mTileColumns + tileColumn ].get();
+        const int firstColumn = tileColumn * TILE_SIZE;
+        const int columnCount = std::min( TILE_SIZE, mColumns - firstColumn );
+        for ( int row = 0; row < rowCount; ++row )
+        {
+          float *dest = rowsBuffer.data() + static_cast< std::size_t >( row ) * mColumns + firstColumn;
+          if ( !tile )
+          {
+            std::fill( dest, dest + columnCount, static_cast< float >( NO_DATA ) );
+            continue;
+          }
+
+          const float *source = tile + row * TILE_SIZE;
+          for ( int column = 0; column < columnCount; ++column )
+          {
+            dest[ column ] = std::isnan( source[ column ] ) ? NO_DATA : source[ column ];
+          }
+        }
+      }
+
+      if ( GDALRasterIO( mRasterBandH, GF_Write, 0, firstRow, mColumns, rowCount,
+                         rowsBuffer.data(), mColumns, rowCount, GDT_Float32, 0, 0 ) != CE_None )
+      {
+        result = RasterIoError;
+      }
     }
+  }
+
+  mTiles.clear();
+  mDatasetH.reset();
+  mRasterBandH = nullptr;
+  return result;
+}
+
+void QgsKernelDensityEstimation::addPendingPoints()
+{
+  if ( mPendingPoints.isEmpty() )
+    return;
+
+  // each worker owns a distinct set of tile rows, so workers never write the same pixel, and the
+  // kernels of all points are added to each pixel in the same order as the features were added
+  const int workerCount = std::max( 1, std::min( QThreadPool::globalInstance()->maxThreadCount(), mTileRows ) );
+  if ( workerCount == 1 )
+  {
+    addPendingPointsToTileRows( 0, 1 );
+  }
+  else
+  {
+    QVector< int > workers;
+    for ( int worker = 0; worker < workerCount; ++worker )
+      workers << worker;
+
+    QtConcurrent::blockingMap( workers, [this, workerCount]( int worker )
+    {
+      addPendingPointsToTileRows( worker, workerCount );
+    } );
+  }
+  mPendingPoints.clear();
+}
+
+void QgsKernelDensityEstimation::addPendingPointsToTileRows( int worker, int workerCount )
+{
+  std::vector< double > squaredDistancesX;
+  for ( const PendingPoint &point : qgis::as_const( mPendingPoints ) )
+  {
+    const int blockSize = 2 * point.buffer + 1;
+    const int firstTileRow = static_cast< int >( point.yPositionIO / TILE_SIZE );
+    const int lastTileRow = static_cast< int >( ( point.yPositionIO + blockSize - 1 ) / TILE_SIZE );
+    bool ownsRows = false;
+    for ( int tileRow = firstTileRow; tileRow <= lastTileRow && !ownsRows; ++tileRow )
+      ownsRows = tileRow % workerCount == worker;
+    if ( !ownsRows )
+      continue;
 
+    // the squared distance along x is the same for all rows of the kernel
+    squaredDistancesX.resize( blockSize );
     for ( int xp = 0; xp < blockSize; xp++ )
     {
-      for ( int yp = 0; yp < blockSize; yp++ )
-      {
-        double pixelCentroidX = ( xPosition + xp + 0.5 ) * mPixelSize + mBounds.xMinimum();
-        double pixelCentroidY = ( yPosition + yp + 0.5 ) * mPixelSize + mBounds.yMinimum();
+      double pixelCentroidX = ( point.xPosition + xp + 0.5 ) * mPixelSize + mBounds.xMinimum();
+      squaredDistancesX[ xp ] = std::pow( pixelCentroidX - point.x, 2.0 );
+    }
+
+    for ( int yp = 0; yp < blockSize; yp++ )
+    {
+      const int row = static_cast< int >( point.yPositionIO ) + yp;
+      const int tileRow = row / TILE_SIZE;
+      if ( tileRow % workerCount != worker )
+        continue;
 
-        double distance = std::sqrt( std::pow( pixelCentroidX - ( *pointIt ).x(), 2.0 ) + std::pow( pixelCentroidY - ( *pointIt ).y(), 2.0 ) );
+      double pixelCentroidY = ( point.yPosition + yp + 0.5 ) * mPixelSize + mBounds.yMinimum();
+      const double squaredDistanceY = std::pow( pixelCentroidY - point.y, 2.0 );
+
+      for ( int xp = 0; xp < blockSize; xp++ )
+      {
+        double distance = std::sqrt( squaredDistancesX[ xp ] + squaredDistanceY );
 
         // is pixel outside search bandwidth of feature?
-        if ( distance > radius )
+        if ( distance > point.radius )
         {
           continue;
         }
 
-        double pixelValue = weight * calculateKernelValue( distance, radius, mShape, mOutputValues );
-        int pos = xp + blockSize * yp;
-        if ( dataBuffer[ pos ] == NO_DATA )
+        double pixelValue = point.weight * calculateKernelValue( distance, point.radius, mShape, mOutputValues );
+
+        const int column = static_cast< int >( point.xPosition ) + xp;
+        std::unique_ptr< float[] > &tile = mTiles[ static_cast< std::size_t >( tileRow ) * mTileColumns + column / TILE_SIZE ];
+        if ( !tile )
+        {
+          tile.reset( new float[ TILE_SIZE * TILE_SIZE ] );
+          std::fill( tile.get(), tile.get() + TILE_SIZE * TILE_SIZE, std::numeric_limits< float >::quiet_NaN() );
+        }
+        float &value = tile[ ( row % TILE_SIZE ) * TILE_SIZE + column % TILE_SIZE ];
+        if ( std::isnan( value ) )
         {
-          dataBuffer[ pos ] = 0;
+          value = 0;
         }
-        dataBuffer[ pos ] += pixelValue;
+        value += pixelValue;
       }
     }
-    if ( GDALRasterIO( mRasterBandH, GF_Write, xPosition, yPositionIO, blockSize, blockSize,
-                       dataBuffer, blockSize, blockSize, GDT_Float32, 0, 0 ) != CE_None )
-    {
-      result = RasterIoError;
-    }
-    CPLFree( dataBuffer );
   }
-
-  return result;
-}
-
-QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::finalise()
-{
-  mDatasetH.reset();
-  mRasterBandH = nullptr;
-  return Success;
 }
 
 int QgsKernelDensityEstimation::radiusSizeInPixels( double radius ) const
@@ -243,21 +381,7 @@ bool QgsKernelDensityEstimation::createEmptyLayer( GDALDriverH driver, const Qgs
   if ( GDALSetRasterNoDataValue( poBand, NO_DATA ) != CE_None )
     return false;
 
-  float *line = static_cast< float * >( CPLMalloc( sizeof( float ) * columns ) );
-  for ( int i = 0; i < columns; i++ )
-  {
-    line[i] = NO_DATA;
-  }
-  // Write the empty raster
-  for ( int i = 0; i < rows ; i++ )
-  {
-    if ( GDALRasterIO( poBand, GF_Write, 0, i, columns, 1, line, columns, 1, GDT_Float32, 0, 0 ) != CE_None )
-    {
-      return false;
-    }
-  }
-
-  CPLFree( line );
+  // all pixels are written by finalise()
   return true;
 }
 
@@ -19,6 +19,10 @@
 #include "qgsrectangle.h"
 #include "qgsogrutils.h"
 #include <QString>
+#include <QVector>
+
+#include <memory>
+#include <vector>
 
 // GDAL includes
 #include <gdal.h>
@@ -122,6 +126,8 @@ class ANALYSIS_EXPORT QgsKernelDensityEstimation
 
     /**
      * Adds a single feature to the KDE surface. prepare() must be called before adding features.
+     *
+     * The surface is accumulated in memory, and only written to the output file by finalise().
      * \see prepare()
      * \see finalise()
      */
@@ -129,6 +135,7 @@ class ANALYSIS_EXPORT QgsKernelDensityEstimation
 
     /**
      * Finalises the output file. Must be called after adding all features via addFeature().
+     * The density surface is written to the output file block by block.
      * \see prepare()
      * \see addFeature()
      */
@@ -171,6 +178,33 @@ class ANALYSIS_EXPORT QgsKernelDensityEstimation
     gdal::dataset_unique_ptr mDatasetH;
     GDALRasterBandH mRasterBandH;
 
+    //! Point waiting to be added to the surface, with the position of its kernel in pixels
+    struct PendingPoint
+    {
+      double x;
+      double y;
+      double radius;
+      double weight;
+      int buffer;
+      unsigned int xPosition;
+      unsigned int yPosition;
+      unsigned int yPositionIO;
+    };
+
+    //! Adds the pending points to the surface
+    void addPendingPoints();
+    //! Adds the kernels of pending points to the tile rows handled by \a worker
+    void addPendingPointsToTileRows( int worker, int workerCount );
+
+    int mRows = 0;
+    int mColumns = 0;
+    int mTileRows = 0;
+    int mTileColumns = 0;
+
+    //! In-memory surface, as tiles allocated on first use. Pixels without value are NaN
+    std::vector< std::unique_ptr< float[] > > mTiles;
+    QVector< PendingPoint > mPendingPoints;
+
     //! Creates a new raster layer and initializes it to the no data value
     bool createEmptyLayer( GDALDriverH driver, const QgsRectangle &bounds, int rows, int columns ) const;
     int radiusSizeInPixels( double radius ) const;
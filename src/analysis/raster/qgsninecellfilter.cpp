@@ -17,6 +17,11 @@
 
 #include "qgsgdalutils.h"
 #include "qgsninecellfilter.h"
+#include "qgsaspectfilter.h"
+#include "qgshillshadefilter.h"
+#include "qgsruggednessfilter.h"
+#include "qgsslopefilter.h"
+#include "qgstotalcurvaturefilter.h"
 #include "qgslogger.h"
 #include "cpl_string.h"
 #include "qgsfeedback.h"
@@ -30,7 +35,11 @@
 #include <QFile>
 #include <QDebug>
 #include <QFileInfo>
+#include <QThread>
+#include <QtConcurrentMap>
 #include <iterator>
+#include <typeinfo>
+#include <vector>
 
 
 
@@ -82,6 +91,17 @@ int QgsNineCellFilter::processRaster( QgsFeedback *feedback )
 #endif
 }
 
+void QgsNineCellFilter::processNineCellRow( float *scanLine1, float *scanLine2, float *scanLine3, float *resultLine, int count )
+{
+  for ( int xIndex = 0; xIndex < count; ++xIndex )
+  {
+    // cells(x, y) x11, x21, x31, x12, x22, x32, x13, x23, x33
+    resultLine[ xIndex ] = processNineCellWindow( &scanLine1[ xIndex ], &scanLine1[ xIndex + 1 ], &scanLine1[ xIndex + 2 ],
+                           &scanLine2[ xIndex ], &scanLine2[ xIndex + 1 ], &scanLine2[ xIndex + 2 ],
+                           &scanLine3[ xIndex ], &scanLine3[ xIndex + 1 ], &scanLine3[ xIndex + 2 ] );
+  }
+}
+
 gdal::dataset_unique_ptr QgsNineCellFilter::openInputFile( int &nCellsX, int &nCellsY )
 {
   gdal::dataset_unique_ptr inputDataset( GDALOpen( mInputFile.toUtf8().constData(), GA_ReadOnly ) );
@@ -399,16 +419,30 @@ int QgsNineCellFilter::processRasterCPU( QgsFeedback *feedback )
     return 6;
   }
 
-  //keep only three scanlines in memory at a time, make room for initial and final nodata
-  std::size_t bufferSize( sizeof( float ) * ( xSize + 2 ) );
-  float *scanLine1 = ( float * ) CPLMalloc( bufferSize );
-  float *scanLine2 = ( float * ) CPLMalloc( bufferSize );
-  float *scanLine3 = ( float * ) CPLMalloc( bufferSize );
-
-  float *resultLine = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-
-  //values outside the layer extent (if the 3x3 window is on the border) are sent to the processing method as (input) nodata values
-  for ( int yIndex = 0; yIndex < ySize; ++yIndex )
+  //the raster is processed in bands of rows. Bands are read sequentially with one extra row above and below,
+  //processed in parallel, and written back in order
+  const int bandRows = std::max( 1, std::min( 256, ( 1 << 22 ) / ( xSize + 2 ) ) );
+  const int bandCount = ( ySize + bandRows - 1 ) / bandRows;
+  // Only filter bands from several threads with the built-in filters. Subclasses, including
+  // filters implemented in Python, may not be thread safe.
+  const std::type_info &filterType = typeid( *this );
+  const bool threadSafeFilter = filterType == typeid( QgsSlopeFilter ) || filterType == typeid( QgsAspectFilter ) ||
+                                filterType == typeid( QgsHillshadeFilter ) || filterType == typeid( QgsRuggednessFilter ) ||
+                                filterType == typeid( QgsTotalCurvatureFilter );
+  const int batchSize = threadSafeFilter ? std::max( 1, QThread::idealThreadCount() ) : 1;
+  const std::size_t stride = static_cast< std::size_t >( xSize ) + 2;
+
+  struct Band
+  {
+    int firstRow = 0;
+    int rows = 0;
+    //! rows + 2 scanlines with an extra column at both ends, values outside the layer extent are (input) nodata
+    std::vector< float > input;
+    std::vector< float > result;
+  };
+  std::vector< Band > bands( std::min( batchSize, bandCount ) );
+
+  for ( int firstBand = 0; firstBand < bandCount; firstBand += batchSize )
   {
     if ( feedback && feedback->isCanceled() )
     {
@@ -417,74 +451,56 @@ int QgsNineCellFilter::processRasterCPU( QgsFeedback *feedback )
 
     if ( feedback )
     {
-      feedback->setProgress( 100.0 * static_cast< double >( yIndex ) / ySize );
+      feedback->setProgress( 100.0 * static_cast< double >( firstBand ) / bandCount );
     }
 
-    if ( yIndex == 0 )
+    const int batchBands = std::min( batchSize, bandCount - firstBand );
+    for ( int i = 0; i < batchBands; ++i )
     {
-      //fill scanline 1 with (input) nodata for the values above the first row and feed scanline2 with the first row
-      for ( int a = 0; a < xSize + 2 ; ++a )
-      {
-        scanLine1[a] = mInputNodataValue;
-      }
-      // Read scanline2
-      if ( GDALRasterIO( rasterBand, GF_Read, 0, 0, xSize, 1, &scanLine2[1], xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
+      Band &band = bands[ i ];
+      band.firstRow = ( firstBand + i ) * bandRows;
+      band.rows = std::min( bandRows, ySize - band.firstRow );
+      band.input.assign( stride * ( band.rows + 2 ), mInputNodataValue );
+      band.result.resize( static_cast< std::size_t >( xSize ) * band.rows );
+
+      //read the rows of the band and the rows around it which are within the layer extent
+      const int readFirstRow = std::max( 0, band.firstRow - 1 );
+      const int readLastRow = std::min( ySize - 1, band.firstRow + band.rows );
+      float *readStart = band.input.data() + stride * ( readFirstRow - band.firstRow + 1 ) + 1;
+      if ( GDALRasterIO( rasterBand, GF_Read, 0, readFirstRow, xSize, readLastRow - readFirstRow + 1, readStart, xSize, readLastRow - readFirstRow + 1,
+                         GDT_Float32, 0, static_cast< int >( stride * sizeof( float ) ) ) != CE_None )
       {
         QgsDebugMsg( QStringLiteral( "Raster IO Error" ) );
       }
     }
-    else
-    {
-      //normally fetch only scanLine3 and release scanline 1 if we move forward one row
-      CPLFree( scanLine1 );
-      scanLine1 = scanLine2;
-      scanLine2 = scanLine3;
-      scanLine3 = ( float * ) CPLMalloc( bufferSize );
-    }
 
-    // Read scanline 3
-    if ( yIndex == ySize - 1 ) //fill the row below the bottom with nodata values
+    auto processBand = [this, xSize, stride]( Band & band )
     {
-      for ( int a = 0; a < xSize + 2; ++a )
+      for ( int row = 0; row < band.rows; ++row )
       {
-        scanLine3[a] = mInputNodataValue;
+        float *scanLine1 = band.input.data() + stride * row;
+        processNineCellRow( scanLine1, scanLine1 + stride, scanLine1 + 2 * stride, band.result.data() + static_cast< std::size_t >( xSize ) * row, xSize );
       }
-    }
-    else
+    };
+    if ( batchBands == 1 )
     {
-      if ( GDALRasterIO( rasterBand, GF_Read, 0, yIndex + 1, xSize, 1, &scanLine3[1], xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
-      {
-        QgsDebugMsg( QStringLiteral( "Raster IO Error" ) );
-      }
+      processBand( bands[ 0 ] );
     }
-    // Set first and last extra columns to nodata
-    scanLine1[0] = scanLine1[xSize + 1] = mInputNodataValue;
-    scanLine2[0] = scanLine2[xSize + 1] = mInputNodataValue;
-    scanLine3[0] = scanLine3[xSize + 1] = mInputNodataValue;
-
-
-
-    // j is the x axis index, skip 0 and last cell that have been filled with nodata
-    for ( int xIndex = 0; xIndex < xSize ; ++xIndex )
+    else
     {
-      // cells(x, y) x11, x21, x31, x12, x22, x32, x13, x23, x33
-      resultLine[ xIndex ] = processNineCellWindow( &scanLine1[ xIndex ], &scanLine1[ xIndex + 1 ], &scanLine1[ xIndex + 2 ],
-                             &scanLine2[ xIndex ], &scanLine2[ xIndex + 1 ], &scanLine2[ xIndex + 2 ],
-                             &scanLine3[ xIndex ], &scanLine3[ xIndex + 1 ], &scanLine3[ xIndex + 2 ] );
-
+      QtConcurrent::blockingMap( bands.begin(), bands.begin() + batchBands, processBand );
     }
 
-    if ( GDALRasterIO( outputRasterBand, GF_Write, 0, yIndex, xSize, 1, resultLine, xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
+    for ( int i = 0; i < batchBands; ++i )
     {
-      QgsDebugMsg( QStringLiteral( "Raster IO Error" ) );
+      const Band &band = bands.at( i );
+      if ( GDALRasterIO( outputRasterBand, GF_Write, 0, band.firstRow, xSize, band.rows, const_cast< float * >( band.result.data() ), xSize, band.rows, GDT_Float32, 0, 0 ) != CE_None )
+      {
+        QgsDebugMsg( QStringLiteral( "Raster IO Error" ) );
+      }
     }
   }
 
-  CPLFree( resultLine );
-  CPLFree( scanLine1 );
-  CPLFree( scanLine2 );
-  CPLFree( scanLine3 );
-
   if ( feedback && feedback->isCanceled() )
   {
     //delete the dataset without closing (because it is faster)
@@ -21,6 +21,7 @@
 #include <QString>
 #include "gdal.h"
 #include "qgis_analysis.h"
+#include "qgis_sip.h"
 #include "qgsogrutils.h"
 
 class QgsFeedback;
@@ -80,6 +81,23 @@ class ANALYSIS_EXPORT QgsNineCellFilter
                                          float *x12, float *x22, float *x32,
                                          float *x13, float *x23, float *x33 ) = 0;
 
+    /**
+     * Calculates the output values for a row of \a count cells, and stores them in \a resultLine.
+     *
+     * \a scanLine1, \a scanLine2 and \a scanLine3 contain the input values of the rows above, at and below
+     * the processed row, with one extra value at both ends (count + 2 values). Values outside of the
+     * raster extent are set to the input nodata value.
+     *
+     * The default implementation calls processNineCellWindow() for each cell. Subclasses can reimplement
+     * it to avoid a virtual call per cell. With the built-in filters, rows are processed from several
+     * threads at once, so their implementations must not modify the state of the filter. Rows of other
+     * subclasses are processed from the calling thread.
+     *
+     * \note not available in Python bindings
+     * \since QGIS 3.6
+     */
+    virtual void processNineCellRow( float *scanLine1, float *scanLine2, float *scanLine3, float *resultLine, int count ) SIP_SKIP;
+
   private:
     //default constructor forbidden. We need input file, output file and format obligatory
     QgsNineCellFilter() = delete;
@@ -0,0 +1,348 @@
+/***************************************************************************
+                          qgsrastercalcprogram.cpp
+                          ------------------------
+    begin                : October 2026
+    copyright            : (C) 2026 by QGIS contributors
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsrastercalcprogram.h"
+#include "qgsrastermatrix.h"
+
+#include <algorithm>
+#include <cmath>
+
+///@cond PRIVATE
+
+// Operators are applied to the whole span, and nodata is selected afterwards instead of skipping
+// the calculation. Invalid arguments (division by zero, negative logarithms...) are replaced by
+// nodata the same way, mirroring QgsRasterMatrix.
+
+template <typename F>
+static void binaryOperation( const double *left, const double *right, double *result, int count, double nodata, F f )
+{
+  for ( int i = 0; i < count; ++i )
+  {
+    const double x = left[ i ];
+    const double y = right[ i ];
+    const double value = f( x, y );
+    result[ i ] = ( x == nodata || y == nodata ) ? nodata : value;
+  }
+}
+
+template <typename F>
+static void unaryOperation( const double *left, double *result, int count, double nodata, F f )
+{
+  for ( int i = 0; i < count; ++i )
+  {
+    const double x = left[ i ];
+    const double value = f( x );
+    result[ i ] = x == nodata ? nodata : value;
+  }
+}
+
+static bool isUnaryOperator( QgsRasterCalcNode::Operator op )
+{
+  switch ( op )
+  {
+    case QgsRasterCalcNode::opSQRT:
+    case QgsRasterCalcNode::opSIN:
+    case QgsRasterCalcNode::opCOS:
+    case QgsRasterCalcNode::opTAN:
+    case QgsRasterCalcNode::opASIN:
+    case QgsRasterCalcNode::opACOS:
+    case QgsRasterCalcNode::opATAN:
+    case QgsRasterCalcNode::opSIGN:
+    case QgsRasterCalcNode::opLOG:
+    case QgsRasterCalcNode::opLOG10:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+static bool applyOperator( QgsRasterCalcNode::Operator op, const double *left, const double *right, double *result, int count, double nodata )
+{
+  switch ( op )
+  {
+    case QgsRasterCalcNode::opPLUS:
+      binaryOperation( left, right, result, count, nodata, []( double x, double y ) { return x + y; } );
+      return true;
+    case QgsRasterCalcNode::opMINUS:
+      binaryOperation( left, right, result, count, nodata, []( double x, double y ) { return x - y; } );
+      return true;
+    case QgsRasterCalcNode::opMUL:
+      binaryOperation( left, right, result, count, nodata, []( double x, double y ) { return x * y; } );
+      return true;
+    case QgsRasterCalcNode::opDIV:
+      binaryOperation( left, right, result, count, nodata, [nodata]( double x, double y ) { return y == 0 ? nodata : x / y; } );
+      return true;
+    case QgsRasterCalcNode::opPOW:
+      binaryOperation( left, right, result, count, nodata, [nodata]( double x, double y )
+      {
+        const bool valid = !( ( x == 0 && y < 0 ) || ( x < 0 && ( y - std::floor( y ) ) > 0 ) );
+        return valid ? std::pow( x, y ) : nodata;
+      } );
+      return true;
+    case QgsRasterCalcNode::opEQ:
+      binaryOperation( left, right, result, count, nodata, []( double x, double y ) { return x == y ? 1.0 : 0.0; } );
+      return true;
+    case QgsRasterCalcNode::opNE:
+      binaryOperation( left, right, result, count, nodata, []( double x, double y ) { return x == y ? 0.0 : 1.0; } );
+      return true;
+    case QgsRasterCalcNode::opGT:
+      binaryOperation( left, right, result, count, nodata, []( double x, double y ) { return x > y ? 1.0 : 0.0; } );
+      return true;
+    case QgsRasterCalcNode::opLT:
+      binaryOperation( left, right, result, count, nodata, []( double x, double y ) { return x < y ? 1.0 : 0.0; } );
+      return true;
+    case QgsRasterCalcNode::opGE:
+      binaryOperation( left, right, result, count, nodata, []( double x, double y ) { return x >= y ? 1.0 : 0.0; } );
+      return true;
+    case QgsRasterCalcNode::opLE:
+      binaryOperation( left, right, result, count, nodata, []( double x, double y ) { return x <= y ? 1.0 : 0.0; } );
+      return true;
+    case QgsRasterCalcNode::opAND:
+      binaryOperation( left, right, result, count, nodata, []( double x, double y ) { return x != 0 && y != 0 ? 1.0 : 0.0; } );
+      return true;
+    case QgsRasterCalcNode::opOR:
+      binaryOperation( left, right, result, count, nodata, []( double x, double y ) { return x != 0 || y != 0 ? 1.0 : 0.0; } );
+      return true;
+
+    case QgsRasterCalcNode::opSQRT:
+      unaryOperation( left, result, count, nodata, [nodata]( double x ) { return x < 0 ? nodata : std::sqrt( x ); } );
+      return true;
+    case QgsRasterCalcNode::opSIN:
+      unaryOperation( left, result, count, nodata, []( double x ) { return std::sin( x ); } );
+      return true;
+    case QgsRasterCalcNode::opCOS:
+      unaryOperation( left, result, count, nodata, []( double x ) { return std::cos( x ); } );
+      return true;
+    case QgsRasterCalcNode::opTAN:
+      unaryOperation( left, result, count, nodata, []( double x ) { return std::tan( x ); } );
+      return true;
+    case QgsRasterCalcNode::opASIN:
+      unaryOperation( left, result, count, nodata, []( double x ) { return std::asin( x ); } );
+      return true;
+    case QgsRasterCalcNode::opACOS:
+      unaryOperation( left, result, count, nodata, []( double x ) { return std::acos( x ); } );
+      return true;
+    case QgsRasterCalcNode::opATAN:
+      unaryOperation( left, result, count, nodata, []( double x ) { return std::atan( x ); } );
+      return true;
+    case QgsRasterCalcNode::opSIGN:
+      unaryOperation( left, result, count, nodata, []( double x ) { return -x; } );
+      return true;
+    case QgsRasterCalcNode::opLOG:
+      unaryOperation( left, result, count, nodata, [nodata]( double x ) { return x <= 0 ? nodata : std::log( x ); } );
+      return true;
+    case QgsRasterCalcNode::opLOG10:
+      unaryOperation( left, result, count, nodata, [nodata]( double x ) { return x <= 0 ? nodata : std::log10( x ); } );
+      return true;
+
+    case QgsRasterCalcNode::opNONE:
+      break;
+  }
+  return false;
+}
+
+std::unique_ptr< QgsRasterCalcProgram > QgsRasterCalcProgram::compile( const QgsRasterCalcNode *node, double nodataValue )
+{
+  if ( !node )
+    return nullptr;
+
+  std::unique_ptr< QgsRasterCalcProgram > program( new QgsRasterCalcProgram() );
+  program->mNodataValue = nodataValue;
+  if ( !program->compileNode( node, program->mResult ) )
+    return nullptr;
+
+  program->mFreeBuffers.clear();
+  return program;
+}
+
+bool QgsRasterCalcProgram::compileNode( const QgsRasterCalcNode *node, Operand &operand )
+{
+  switch ( node->mType )
+  {
+    case QgsRasterCalcNode::tNumber:
+      operand.type = Constant;
+      operand.index = mConstants.size();
+      mConstants << node->mNumber;
+      return true;
+
+    case QgsRasterCalcNode::tRasterRef:
+    {
+      int index = mInputs.indexOf( node->mRasterName );
+      if ( index < 0 )
+      {
+        index = mInputs.size();
+        mInputs << node->mRasterName;
+      }
+      operand.type = Input;
+      operand.index = index;
+      return true;
+    }
+
+    case QgsRasterCalcNode::tMatrix:
+    {
+      const QgsRasterMatrix *matrix = node->mMatrix;
+      if ( !matrix )
+        return false;
+
+      if ( matrix->isNumber() )
+      {
+        const double value = matrix->number();
+        operand.type = Constant;
+        operand.index = mConstants.size();
+        mConstants << ( value == matrix->nodataValue() ? mNodataValue : value );
+        return true;
+      }
+
+      MatrixData matrixData;
+      matrixData.data = node->mMatrix->data();
+      matrixData.columns = matrix->nColumns();
+      matrixData.rows = matrix->nRows();
+      matrixData.nodataValue = matrix->nodataValue();
+      operand.type = Matrix;
+      operand.index = mMatrices.size();
+      mMatrices << matrixData;
+      return true;
+    }
+
+    case QgsRasterCalcNode::tOperator:
+      break;
+  }
+
+  const QgsRasterCalcNode::Operator op = node->mOperator;
+  if ( op == QgsRasterCalcNode::opNONE )
+    return false;
+
+  const bool unary = isUnaryOperator( op );
+
+  Operand left;
+  Operand right;
+  if ( !node->mLeft || !compileNode( node->mLeft, left ) )
+    return false;
+  if ( unary )
+    right = left;
+  else if ( !node->mRight || !compileNode( node->mRight, right ) )
+    return false;
+
+  if ( left.type == Constant && right.type == Constant )
+  {
+    // fold. Constant operands are always the last constants added.
+    double value = 0;
+    if ( !applyOperator( op, &mConstants.at( left.index ), &mConstants.at( right.index ), &value, 1, mNodataValue ) )
+      return false;
+
+    mConstants.resize( left.index );
+    operand.type = Constant;
+    operand.index = mConstants.size();
+    mConstants << value;
+    return true;
+  }
+
+  // release operand buffers first, so that the result can overwrite them
+  release( left );
+  if ( !unary )
+    release( right );
+
+  Instruction instruction;
+  instruction.op = op;
+  instruction.left = left;
+  instruction.right = right;
+  instruction.result = acquireBuffer();
+
+  mInstructions << instruction;
+  operand.type = Buffer;
+  operand.index = instruction.result;
+  return true;
+}
+
+int QgsRasterCalcProgram::acquireBuffer()
+{
+  if ( !mFreeBuffers.isEmpty() )
+    return mFreeBuffers.takeLast();
+
+  return mBufferCount++;
+}
+
+void QgsRasterCalcProgram::release( const Operand &operand )
+{
+  if ( operand.type == Buffer )
+    mFreeBuffers << operand.index;
+}
+
+std::vector< double > QgsRasterCalcProgram::createWorkspace() const
+{
+  std::vector< double > workspace( static_cast< size_t >( mConstants.size() + mMatrices.size() + mBufferCount ) * SPAN_SIZE );
+  for ( int i = 0; i < mConstants.size(); ++i )
+  {
+    std::fill_n( workspace.begin() + static_cast< size_t >( i ) * SPAN_SIZE, SPAN_SIZE, mConstants.at( i ) );
+  }
+  return workspace;
+}
+
+const double *QgsRasterCalcProgram::operandData( const Operand &operand, const double *const *inputs, const double *workspace ) const
+{
+  switch ( operand.type )
+  {
+    case Input:
+      return inputs[ operand.index ];
+    case Constant:
+      return workspace + static_cast< size_t >( operand.index ) * SPAN_SIZE;
+    case Matrix:
+      return workspace + static_cast< size_t >( mConstants.size() + operand.index ) * SPAN_SIZE;
+    case Buffer:
+      break;
+  }
+  return workspace + static_cast< size_t >( mConstants.size() + mMatrices.size() + operand.index ) * SPAN_SIZE;
+}
+
+void QgsRasterCalcProgram::evaluate( const double *const *inputs, std::vector< double > &workspace, float *result, int row, int column, int count ) const
+{
+  Q_ASSERT( count <= SPAN_SIZE );
+
+  // copy the span of each matrix, converting its nodata
+  double *matrixValues = workspace.data() + static_cast< size_t >( mConstants.size() ) * SPAN_SIZE;
+  for ( const MatrixData &matrix : mMatrices )
+  {
+    const bool rowInside = row >= 0 && row < matrix.rows;
+    const double *matrixRow = matrix.data + static_cast< size_t >( rowInside ? row : 0 ) * matrix.columns;
+    for ( int i = 0; i < count; ++i )
+    {
+      const int matrixColumn = column + i;
+      const bool inside = rowInside && matrixColumn < matrix.columns;
+      matrixValues[ i ] = inside && matrixRow[ matrixColumn ] != matrix.nodataValue ? matrixRow[ matrixColumn ] : mNodataValue;
+    }
+    matrixValues += SPAN_SIZE;
+  }
+
+  double *buffers = matrixValues;
+
+  for ( const Instruction &instruction : mInstructions )
+  {
+    applyOperator( instruction.op,
+                   operandData( instruction.left, inputs, workspace.data() ),
+                   operandData( instruction.right, inputs, workspace.data() ),
+                   buffers + static_cast< size_t >( instruction.result ) * SPAN_SIZE,
+                   count, mNodataValue );
+  }
+
+  const double *values = operandData( mResult, inputs, workspace.data() );
+  for ( int i = 0; i < count; ++i )
+  {
+    result[ i ] = static_cast< float >( values[ i ] );
+  }
+}
+
+///@endcond
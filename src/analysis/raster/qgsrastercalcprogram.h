@@ -0,0 +1,138 @@
+/***************************************************************************
+                          qgsrastercalcprogram.h
+                          ----------------------
+    begin                : October 2026
+    copyright            : (C) 2026 by QGIS contributors
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSRASTERCALCPROGRAM_H
+#define QGSRASTERCALCPROGRAM_H
+
+#define SIP_NO_FILE
+
+#include "qgis_analysis.h"
+#include "qgsrastercalcnode.h"
+
+#include <QStringList>
+#include <QVector>
+#include <memory>
+#include <vector>
+
+///@cond PRIVATE
+
+/**
+ * A raster calculator expression compiled to a flat list of array operations.
+ *
+ * Each instruction applies one operator to whole spans of up to SPAN_SIZE values of a row, reading
+ * from the input arrays, constants, matrices or intermediate buffers and writing to an intermediate
+ * buffer. Buffers are reused as soon as their value has been consumed, so the number of
+ * buffers is the maximum depth of the expression tree. Subexpressions which do not depend
+ * on any raster are folded into constants.
+ *
+ * Matrix nodes are aligned with the evaluated raster, with values outside of the matrix
+ * treated as nodata. 1x1 matrices are handled as numbers. The program references the
+ * matrices of the tree it was compiled from, and must be discarded together with them.
+ *
+ * Nodata is represented by the nodata value itself, as in QgsRasterMatrix, and operators
+ * select it without branching. Results match QgsRasterCalcNode::calculate().
+ *
+ * The program is immutable once compiled and can be evaluated from several threads, each
+ * using its own workspace.
+ */
+class ANALYSIS_EXPORT QgsRasterCalcProgram
+{
+  public:
+
+    //! Maximum number of values processed by a single evaluate() call
+    static constexpr int SPAN_SIZE = 1024;
+
+    /**
+     * Compiles the expression starting at \a node, using \a nodataValue for input and
+     * result nodata. Returns nullptr if the expression contains unknown operators.
+     */
+    static std::unique_ptr< QgsRasterCalcProgram > compile( const QgsRasterCalcNode *node, double nodataValue );
+
+    /**
+     * Returns the names of the rasters referenced by the expression. The arrays passed to
+     * evaluate() must follow the same order.
+     */
+    QStringList inputs() const { return mInputs; }
+
+    //! Returns the number of instructions of the program
+    int instructionCount() const { return mInstructions.size(); }
+
+    /**
+     * Creates a workspace for evaluate(). Each thread evaluating the program needs its own workspace.
+     */
+    std::vector< double > createWorkspace() const;
+
+    /**
+     * Evaluates the program for \a count values of \a row, starting at \a column. \a count must
+     * not exceed SPAN_SIZE. \a inputs contains one array per input, with nodata values already
+     * replaced by the nodata value of the program. Results are stored in \a result.
+     */
+    void evaluate( const double *const *inputs, std::vector< double > &workspace, float *result, int row, int column, int count ) const;
+
+  private:
+
+    enum OperandType
+    {
+      Input, //!< Array passed to evaluate()
+      Constant, //!< Constant, broadcast to a whole span in the workspace
+      Matrix, //!< Matrix values, copied to the workspace for each span
+      Buffer, //!< Intermediate buffer in the workspace
+    };
+
+    struct Operand
+    {
+      OperandType type = Constant;
+      int index = 0;
+    };
+
+    struct MatrixData
+    {
+      const double *data = nullptr;
+      int columns = 0;
+      int rows = 0;
+      double nodataValue = 0;
+    };
+
+    struct Instruction
+    {
+      QgsRasterCalcNode::Operator op;
+      int result; //!< Destination buffer
+      Operand left;
+      Operand right;
+    };
+
+    QgsRasterCalcProgram() = default;
+
+    bool compileNode( const QgsRasterCalcNode *node, Operand &operand );
+    int acquireBuffer();
+    void release( const Operand &operand );
+
+    const double *operandData( const Operand &operand, const double *const *inputs, const double *workspace ) const;
+
+    double mNodataValue = 0;
+    QStringList mInputs;
+    QVector< double > mConstants;
+    QVector< MatrixData > mMatrices;
+    QVector< Instruction > mInstructions;
+    Operand mResult;
+
+    int mBufferCount = 0;
+    QVector< int > mFreeBuffers;
+};
+
+///@endcond
+
+#endif // QGSRASTERCALCPROGRAM_H
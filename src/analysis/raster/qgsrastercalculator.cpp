@@ -17,16 +17,21 @@
 
 #include "qgsgdalutils.h"
 #include "qgsrastercalculator.h"
+#include "qgsrastercalcprogram.h"
 #include "qgsrasterdataprovider.h"
 #include "qgsrasterinterface.h"
 #include "qgsrasterlayer.h"
-#include "qgsrastermatrix.h"
 #include "qgsrasterprojector.h"
 #include "qgsfeedback.h"
 #include "qgsogrutils.h"
 #include "qgsproject.h"
 
 #include <QFile>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <vector>
 
 #include <cpl_string.h>
 #include <gdalwarper.h>
@@ -118,188 +123,144 @@ QgsRasterCalculator::Result QgsRasterCalculator::processCalculation( QgsFeedback
   float outputNodataValue = -FLT_MAX;
   GDALSetRasterNoDataValue( outputRasterBand, outputNodataValue );
 
-  // Check if we need to read the raster as a whole (which is memory inefficient
-  // and not interruptable by the user) by checking if any raster matrix nodes are
-  // in the expression
-  bool requiresMatrix = ! calcNode->findNodes( QgsRasterCalcNode::Type::tMatrix ).isEmpty();
+  // The expression is compiled and processed in bands of rows, so that memory use does not
+  // depend on the raster size. Matrix nodes are aligned with the output raster.
+  std::unique_ptr< QgsRasterCalcProgram > program = QgsRasterCalcProgram::compile( calcNode.get(), outputNodataValue );
+  if ( !program )
+  {
+    mLastError = QObject::tr( "Could not compile expression %1" ).arg( mFormulaString );
+    gdal::fast_delete_and_close( outputDataset, outputDriver, mOutputFile );
+    return ParserError;
+  }
 
-  // Take the fast route (process one line at a time) if we can
-  if ( ! requiresMatrix )
+  // One source per program input, reprojected if required
+  struct InputRaster
   {
-    // Map of raster names -> blocks
-    std::map<QString, std::unique_ptr<QgsRasterBlock>> inputBlocks;
-    std::map<QString, QgsRasterCalculatorEntry> uniqueRasterEntries;
-    for ( const auto &r : calcNode->findNodes( QgsRasterCalcNode::Type::tRasterRef ) )
+    QgsRasterCalculatorEntry entry;
+    std::unique_ptr< QgsRasterProjector > projector;
+    std::unique_ptr< QgsRasterBlock > block;
+  };
+  std::vector< InputRaster > inputs;
+  for ( const QString &inputRef : program->inputs() )
+  {
+    InputRaster input;
+    bool found = false;
+    for ( const auto &ref : qgis::as_const( mRasterEntries ) )
     {
-      QString layerRef( r->toString().remove( 0, 1 ) );
-      layerRef.chop( 1 );
-      if ( ! inputBlocks.count( layerRef ) )
+      if ( ref.ref == inputRef )
       {
-        for ( const auto &ref : mRasterEntries )
-        {
-          if ( ref.ref == layerRef )
-          {
-            uniqueRasterEntries[layerRef] = ref;
-            inputBlocks[layerRef ] = qgis::make_unique<QgsRasterBlock>();
-          }
-        }
+        input.entry = ref;
+        found = true;
+        break;
       }
     }
-
-    //read / write line by line
-    QMap<QString, QgsRasterBlock * > _rasterData;
-    // Cast to float
-    std::vector<float> castedResult;
-    castedResult.reserve( static_cast<size_t>( mNumOutputColumns ) );
-    auto rowHeight = mOutputRectangle.height() / mNumOutputRows;
-    for ( size_t row = 0; row < static_cast<size_t>( mNumOutputRows ); ++row )
+    if ( !found )
     {
-      if ( feedback )
-      {
-        feedback->setProgress( 100.0 * static_cast< double >( row ) / mNumOutputRows );
-      }
-
-      if ( feedback && feedback->isCanceled() )
-      {
-        break;
-      }
-
-      // Calculates the rect for a single row read
-      QgsRectangle rect( mOutputRectangle );
-      rect.setYMaximum( rect.yMaximum() - rowHeight * row );
-      rect.setYMinimum( rect.yMaximum() - rowHeight );
-
-      // Read rows into input blocks
-      for ( auto &layerRef : inputBlocks )
-      {
-        QgsRasterCalculatorEntry ref = uniqueRasterEntries[layerRef.first];
-        if ( uniqueRasterEntries[layerRef.first].raster->crs() != mOutputCrs )
-        {
-          QgsRasterProjector proj;
-          proj.setCrs( ref.raster->crs(), mOutputCrs );
-          proj.setInput( ref.raster->dataProvider() );
-          proj.setPrecision( QgsRasterProjector::Exact );
-          layerRef.second.reset( proj.block( ref.bandNumber, rect, mNumOutputColumns, 1 ) );
-        }
-        else
-        {
-          inputBlocks[layerRef.first].reset( ref.raster->dataProvider()->block( ref.bandNumber, rect, mNumOutputColumns, 1 ) );
-        }
-      }
-
-      QgsRasterMatrix resultMatrix;
-      resultMatrix.setNodataValue( outputNodataValue );
-
-      _rasterData.clear();
-      for ( const auto &layerRef : inputBlocks )
-      {
-        _rasterData.insert( layerRef.first, inputBlocks[layerRef.first].get() );
-      }
-
-      if ( calcNode->calculate( _rasterData, resultMatrix, 0 ) )
-      {
-        // write scanline to the dataset
-        for ( size_t i = 0; i < static_cast<size_t>( mNumOutputColumns ); i++ )
-        {
-          castedResult[i] = static_cast<float>( resultMatrix.data()[i] );
-        }
-        if ( GDALRasterIO( outputRasterBand, GF_Write, 0, row, mNumOutputColumns, 1, castedResult.data(), mNumOutputColumns, 1, GDT_Float32, 0, 0 ) != CE_None )
-        {
-          QgsDebugMsg( QStringLiteral( "RasterIO error!" ) );
-        }
-      }
+      mLastError = QObject::tr( "No raster layer for entry %1" ).arg( inputRef );
+      gdal::fast_delete_and_close( outputDataset, outputDriver, mOutputFile );
+      return InputLayerError;
     }
 
-    if ( feedback )
+    if ( input.entry.raster->crs() != mOutputCrs )
     {
-      feedback->setProgress( 100.0 );
+      input.projector = qgis::make_unique< QgsRasterProjector >();
+      input.projector->setCrs( input.entry.raster->crs(), mOutputCrs );
+      input.projector->setInput( input.entry.raster->dataProvider() );
+      input.projector->setPrecision( QgsRasterProjector::Exact );
     }
+    inputs.push_back( std::move( input ) );
   }
-  else  // Original code (memory inefficient route)
+
+  // Bands of about a million pixels are read at once, with at least one row per thread.
+  // The rows of a band are evaluated in parallel, in spans of QgsRasterCalcProgram::SPAN_SIZE
+  // values which keep the intermediate buffers in cache.
+  const int threadCount = std::max( 1, QThread::idealThreadCount() );
+  const int bandRows = std::max( 1, std::min( mNumOutputRows, std::max( threadCount, ( 1 << 20 ) / std::max( 1, mNumOutputColumns ) ) ) );
+  const int columns = mNumOutputColumns;
+  std::vector< float > bandResult( static_cast< size_t >( columns ) * bandRows );
+  const double rowHeight = mOutputRectangle.height() / mNumOutputRows;
+
+  for ( int bandTop = 0; bandTop < mNumOutputRows; bandTop += bandRows )
   {
-    QMap< QString, QgsRasterBlock * > inputBlocks;
-    QVector<QgsRasterCalculatorEntry>::const_iterator it = mRasterEntries.constBegin();
-    for ( ; it != mRasterEntries.constEnd(); ++it )
+    if ( feedback )
     {
+      feedback->setProgress( 100.0 * static_cast< double >( bandTop ) / mNumOutputRows );
+    }
 
-      std::unique_ptr< QgsRasterBlock > block;
-      // if crs transform needed
-      if ( it->raster->crs() != mOutputCrs )
-      {
-        QgsRasterProjector proj;
-        proj.setCrs( it->raster->crs(), mOutputCrs );
-        proj.setInput( it->raster->dataProvider() );
-        proj.setPrecision( QgsRasterProjector::Exact );
-
-        QgsRasterBlockFeedback *rasterBlockFeedback = new QgsRasterBlockFeedback();
-        QObject::connect( feedback, &QgsFeedback::canceled, rasterBlockFeedback, &QgsRasterBlockFeedback::cancel );
-        block.reset( proj.block( it->bandNumber, mOutputRectangle, mNumOutputColumns, mNumOutputRows, rasterBlockFeedback ) );
-        if ( rasterBlockFeedback->isCanceled() )
-        {
-          qDeleteAll( inputBlocks );
-          return Canceled;
-        }
-      }
-      else
-      {
-        block.reset( it->raster->dataProvider()->block( it->bandNumber, mOutputRectangle, mNumOutputColumns, mNumOutputRows ) );
-      }
-      if ( block->isEmpty() )
-      {
-        mLastError = QObject::tr( "Could not allocate required memory for %1" ).arg( it->ref );
-        qDeleteAll( inputBlocks );
-        return MemoryError;
-      }
-      inputBlocks.insert( it->ref, block.release() );
+    if ( feedback && feedback->isCanceled() )
+    {
+      break;
     }
 
-    QgsRasterMatrix resultMatrix;
-    resultMatrix.setNodataValue( outputNodataValue );
+    const int rowCount = std::min( bandRows, mNumOutputRows - bandTop );
 
-    //read / write line by line
-    for ( int i = 0; i < mNumOutputRows; ++i )
+    // Calculates the rect for the band read
+    QgsRectangle rect( mOutputRectangle );
+    rect.setYMaximum( rect.yMaximum() - rowHeight * bandTop );
+    rect.setYMinimum( rect.yMaximum() - rowHeight * rowCount );
+
+    // Read band into input blocks
+    for ( InputRaster &input : inputs )
     {
-      if ( feedback )
+      QgsRasterInterface *source = input.projector ? static_cast< QgsRasterInterface * >( input.projector.get() ) : input.entry.raster->dataProvider();
+      input.block.reset( source->block( input.entry.bandNumber, rect, columns, rowCount ) );
+      if ( !input.block || input.block->isEmpty() )
       {
-        feedback->setProgress( 100.0 * static_cast< double >( i ) / mNumOutputRows );
+        mLastError = QObject::tr( "Could not allocate required memory for %1" ).arg( input.entry.ref );
+        gdal::fast_delete_and_close( outputDataset, outputDriver, mOutputFile );
+        return MemoryError;
       }
+    }
 
-      if ( feedback && feedback->isCanceled() )
-      {
-        break;
-      }
+    const int rowsPerTask = ( rowCount + threadCount - 1 ) / threadCount;
+    std::vector< int > taskRows;
+    for ( int row = 0; row < rowCount; row += rowsPerTask )
+      taskRows.push_back( row );
 
-      if ( calcNode->calculate( inputBlocks, resultMatrix, i ) )
+    auto evaluateRows = [&]( int firstRow )
+    {
+      const int lastRow = std::min( firstRow + rowsPerTask, rowCount );
+      std::vector< double > workspace = program->createWorkspace();
+      std::vector< double > inputValues( inputs.size() * QgsRasterCalcProgram::SPAN_SIZE );
+      std::vector< const double * > inputData( inputs.size() );
+      for ( size_t i = 0; i < inputs.size(); ++i )
+        inputData[ i ] = inputValues.data() + i * QgsRasterCalcProgram::SPAN_SIZE;
+
+      for ( int row = firstRow; row < lastRow; ++row )
       {
-        bool resultIsNumber = resultMatrix.isNumber();
-        float *calcData = new float[mNumOutputColumns];
-
-        for ( int j = 0; j < mNumOutputColumns; ++j )
+        for ( int column = 0; column < columns; column += QgsRasterCalcProgram::SPAN_SIZE )
         {
-          calcData[j] = ( float )( resultIsNumber ? resultMatrix.number() : resultMatrix.data()[j] );
-        }
+          const int count = std::min( QgsRasterCalcProgram::SPAN_SIZE, columns - column );
 
-        //write scanline to the dataset
-        if ( GDALRasterIO( outputRasterBand, GF_Write, 0, i, mNumOutputColumns, 1, calcData, mNumOutputColumns, 1, GDT_Float32, 0, 0 ) != CE_None )
-        {
-          QgsDebugMsg( QStringLiteral( "RasterIO error!" ) );
-        }
+          //convert input raster values to double, also convert input no data to result no data
+          for ( size_t i = 0; i < inputs.size(); ++i )
+          {
+            const QgsRasterBlock *block = inputs[ i ].block.get();
+            double *values = inputValues.data() + i * QgsRasterCalcProgram::SPAN_SIZE;
+            bool isNoData = false;
+            for ( int j = 0; j < count; ++j )
+            {
+              const double value = block->valueAndNoData( row, column + j, isNoData );
+              values[ j ] = isNoData ? outputNodataValue : value;
+            }
+          }
 
-        delete[] calcData;
+          program->evaluate( inputData.data(), workspace, bandResult.data() + static_cast< size_t >( row ) * columns + column, bandTop + row, column, count );
+        }
       }
+    };
+    QtConcurrent::blockingMap( taskRows, evaluateRows );
 
-    }
-
-    if ( feedback )
+    // write band to the dataset
+    if ( GDALRasterIO( outputRasterBand, GF_Write, 0, bandTop, columns, rowCount, bandResult.data(), columns, rowCount, GDT_Float32, 0, 0 ) != CE_None )
     {
-      feedback->setProgress( 100.0 );
+      QgsDebugMsg( QStringLiteral( "RasterIO error!" ) );
     }
+  }
 
-    //close datasets and release memory
-    calcNode.reset();
-    qDeleteAll( inputBlocks );
-    inputBlocks.clear();
-
+  if ( feedback )
+  {
+    feedback->setProgress( 100.0 );
   }
 
   if ( feedback && feedback->isCanceled() )
@@ -27,8 +27,12 @@
 #include "qgsrasterlayer.h"
 #include "qgslogger.h"
 #include "qgsproject.h"
+#include "qgsrasteriterator.h"
+#include "qgsrasterblock.h"
 
 #include <QFile>
+#include <QThread>
+#include <QtConcurrentMap>
 
 QgsZonalStatistics::QgsZonalStatistics( QgsVectorLayer *polygonLayer, QgsRasterLayer *rasterLayer, const QString &attributePrefix, int rasterBand, QgsZonalStatistics::Statistics stats )
   : QgsZonalStatistics( polygonLayer,
@@ -78,10 +82,6 @@ int QgsZonalStatistics::calculateStatistics( QgsFeedback *feedback )
     return 4;
   }
 
-  //get geometry info about raster layer
-  int nCellsXProvider = mRasterInterface->xSize();
-  int nCellsYProvider = mRasterInterface->ySize();
-
   QgsRectangle rasterBBox = mRasterInterface->extent();
 
   //add the new fields to the provider
@@ -204,69 +204,15 @@ int QgsZonalStatistics::calculateStatistics( QgsFeedback *feedback )
     return 8;
   }
 
-  //progress dialog
-  long featureCount = vectorProvider->featureCount();
-
-  //iterate over each polygon
-  QgsFeatureRequest request;
-  request.setNoAttributes();
-  request.setDestinationCrs( mRasterCrs, QgsProject::instance()->transformContext() );
-  QgsFeatureIterator fi = vectorProvider->getFeatures( request );
-  QgsFeature f;
-
   bool statsStoreValues = ( mStatistics & QgsZonalStatistics::Median ) ||
                           ( mStatistics & QgsZonalStatistics::StDev ) ||
                           ( mStatistics & QgsZonalStatistics::Variance );
   bool statsStoreValueCount = ( mStatistics & QgsZonalStatistics::Minority ) ||
                               ( mStatistics & QgsZonalStatistics::Majority );
 
-  FeatureStats featureStats( statsStoreValues, statsStoreValueCount );
-  int featureCounter = 0;
-
-  QgsChangedAttributesMap changeMap;
-  while ( fi.nextFeature( f ) )
+  //converts the statistics of a feature to the attribute values written to the vector data provider
+  auto statisticsAttributes = [ & ]( FeatureStats & featureStats )
   {
-    if ( feedback && feedback->isCanceled() )
-    {
-      break;
-    }
-
-    if ( feedback )
-    {
-      feedback->setProgress( 100.0 * static_cast< double >( featureCounter ) / featureCount );
-    }
-
-    if ( !f.hasGeometry() )
-    {
-      ++featureCounter;
-      continue;
-    }
-    QgsGeometry featureGeometry = f.geometry();
-
-    QgsRectangle featureRect = featureGeometry.boundingBox().intersect( rasterBBox );
-    if ( featureRect.isEmpty() )
-    {
-      ++featureCounter;
-      continue;
-    }
-
-    int nCellsX, nCellsY;
-    QgsRectangle rasterBlockExtent;
-    QgsRasterAnalysisUtils::cellInfoForBBox( rasterBBox, featureRect, mCellSizeX, mCellSizeY, nCellsX, nCellsY, nCellsXProvider, nCellsYProvider, rasterBlockExtent );
-
-    featureStats.reset();
-    QgsRasterAnalysisUtils::statisticsFromMiddlePointTest( mRasterInterface, mRasterBand, featureGeometry, nCellsX, nCellsY, mCellSizeX, mCellSizeY,
-    rasterBlockExtent, [ &featureStats ]( double value ) { featureStats.addValue( value ); } );
-
-    if ( featureStats.count <= 1 )
-    {
-      //the cell resolution is probably larger than the polygon area. We switch to precise pixel - polygon intersection in this case
-      featureStats.reset();
-      QgsRasterAnalysisUtils::statisticsFromPreciseIntersection( mRasterInterface, mRasterBand, featureGeometry, nCellsX, nCellsY, mCellSizeX, mCellSizeY,
-      rasterBlockExtent, [ &featureStats ]( double value, double weight ) { featureStats.addValue( value, weight ); } );
-    }
-
-    //write the statistics value to the vector data provider
     QgsAttributeMap changeAttributeMap;
     if ( mStatistics & QgsZonalStatistics::Count )
       changeAttributeMap.insert( countIndex, QVariant( featureStats.count ) );
@@ -334,9 +280,93 @@ int QgsZonalStatistics::calculateStatistics( QgsFeedback *feedback )
       if ( mStatistics & QgsZonalStatistics::Variety )
         changeAttributeMap.insert( varietyIndex, QVariant( featureStats.valueCount.count() ) );
     }
+    return changeAttributeMap;
+  };
+
+  //progress dialog
+  long featureCount = vectorProvider->featureCount();
+
+  //iterate over each polygon
+  QgsFeatureRequest request;
+  request.setNoAttributes();
+  request.setDestinationCrs( mRasterCrs, QgsProject::instance()->transformContext() );
+  QgsFeatureIterator fi = vectorProvider->getFeatures( request );
+  QgsFeature f;
+
+  FeatureStats featureStats( statsStoreValues, statsStoreValueCount );
+  int featureCounter = 0;
+
+  QgsChangedAttributesMap changeMap;
+  if ( mMethod == SinglePass )
+  {
+    QVector< QgsFeatureId > ids;
+    QVector< QgsGeometry > geometries;
+    while ( fi.nextFeature( f ) )
+    {
+      if ( feedback && feedback->isCanceled() )
+      {
+        break;
+      }
+
+      if ( !f.hasGeometry() || f.geometry().boundingBox().intersect( rasterBBox ).isEmpty() )
+      {
+        continue;
+      }
+      ids << f.id();
+      geometries << f.geometry();
+    }
+
+    QVector< FeatureStats > stats( geometries.size(), featureStats );
+    calculateSinglePass( geometries, stats, feedback );
+
+    for ( int i = 0; i < ids.size(); ++i )
+    {
+      if ( feedback && feedback->isCanceled() )
+      {
+        break;
+      }
+
+      if ( stats.at( i ).count <= 1 )
+      {
+        //the cell resolution is probably larger than the polygon area. The feature is small, so read its own window
+        //to switch to precise pixel - polygon intersection like the per feature method
+        calculateFeatureStatistics( geometries.at( i ), stats[ i ] );
+      }
+      changeMap.insert( ids.at( i ), statisticsAttributes( stats[ i ] ) );
+    }
+  }
+  else
+  {
+    while ( fi.nextFeature( f ) )
+    {
+      if ( feedback && feedback->isCanceled() )
+      {
+        break;
+      }
+
+      if ( feedback )
+      {
+        feedback->setProgress( 100.0 * static_cast< double >( featureCounter ) / featureCount );
+      }
+
+      if ( !f.hasGeometry() )
+      {
+        ++featureCounter;
+        continue;
+      }
+      QgsGeometry featureGeometry = f.geometry();
 
-    changeMap.insert( f.id(), changeAttributeMap );
-    ++featureCounter;
+      QgsRectangle featureRect = featureGeometry.boundingBox().intersect( rasterBBox );
+      if ( featureRect.isEmpty() )
+      {
+        ++featureCounter;
+        continue;
+      }
+
+      calculateFeatureStatistics( featureGeometry, featureStats );
+      changeMap.insert( f.id(), statisticsAttributes( featureStats ) );
+      ++featureCounter;
+    }
   }
 
   vectorProvider->changeAttributeValues( changeMap );
@@ -356,6 +386,226 @@ int QgsZonalStatistics::calculateStatistics( QgsFeedback *feedback )
   return 0;
 }
 
+void QgsZonalStatistics::calculateFeatureStatistics( const QgsGeometry &geometry, FeatureStats &stats ) const
+{
+  const QgsRectangle rasterBBox = mRasterInterface->extent();
+  const QgsRectangle featureRect = geometry.boundingBox().intersect( rasterBBox );
+
+  int nCellsX, nCellsY;
+  QgsRectangle rasterBlockExtent;
+  QgsRasterAnalysisUtils::cellInfoForBBox( rasterBBox, featureRect, mCellSizeX, mCellSizeY, nCellsX, nCellsY, mRasterInterface->xSize(), mRasterInterface->ySize(), rasterBlockExtent );
+
+  stats.reset();
+  QgsRasterAnalysisUtils::statisticsFromMiddlePointTest( mRasterInterface, mRasterBand, geometry, nCellsX, nCellsY, mCellSizeX, mCellSizeY,
+  rasterBlockExtent, [ &stats ]( double value ) { stats.addValue( value ); } );
+
+  if ( stats.count <= 1 )
+  {
+    //the cell resolution is probably larger than the polygon area. We switch to precise pixel - polygon intersection in this case
+    stats.reset();
+    QgsRasterAnalysisUtils::statisticsFromPreciseIntersection( mRasterInterface, mRasterBand, geometry, nCellsX, nCellsY, mCellSizeX, mCellSizeY,
+    rasterBlockExtent, [ &stats ]( double value, double weight ) { stats.addValue( value, weight ); } );
+  }
+}
+
+void QgsZonalStatistics::calculateSinglePass( const QVector< QgsGeometry > &zones, QVector< FeatureStats > &stats, QgsFeedback *feedback ) const
+{
+  if ( zones.isEmpty() )
+  {
+    return;
+  }
+
+  const QgsRectangle rasterBBox = mRasterInterface->extent();
+  const int rasterWidth = mRasterInterface->xSize();
+  const int rasterHeight = mRasterInterface->ySize();
+
+  //same value storage options as the zone statistics
+  FeatureStats emptyStats = stats.at( 0 );
+  emptyStats.reset();
+
+  QgsRectangle zonesRect;
+  zonesRect.setMinimal();
+  for ( const QgsGeometry &zone : zones )
+  {
+    zonesRect.combineExtentWith( zone.boundingBox() );
+  }
+
+  //raster window covering all zones
+  int windowCols, windowRows;
+  QgsRectangle windowExtent;
+  QgsRasterAnalysisUtils::cellInfoForBBox( rasterBBox, zonesRect, mCellSizeX, mCellSizeY, windowCols, windowRows, rasterWidth, rasterHeight, windowExtent );
+  if ( windowCols <= 0 || windowRows <= 0 )
+  {
+    return;
+  }
+  int offsetX = static_cast< int >( std::round( ( windowExtent.xMinimum() - rasterBBox.xMinimum() ) / mCellSizeX ) );
+  int offsetY = static_cast< int >( std::round( ( rasterBBox.yMaximum() - windowExtent.yMaximum() ) / mCellSizeY ) );
+
+  //align the window and the tiles to the native blocks of the raster, so that each block is read only once
+  int tileWidth = QgsRasterIterator::DEFAULT_MAXIMUM_TILE_WIDTH;
+  int tileHeight = QgsRasterIterator::DEFAULT_MAXIMUM_TILE_HEIGHT;
+  const int blockWidth = mRasterInterface->xBlockSize();
+  const int blockHeight = mRasterInterface->yBlockSize();
+  if ( blockWidth > 0 && blockHeight > 0 )
+  {
+    windowCols += offsetX % blockWidth;
+    offsetX -= offsetX % blockWidth;
+    windowRows += offsetY % blockHeight;
+    offsetY -= offsetY % blockHeight;
+    tileWidth = std::max( 1, tileWidth / blockWidth ) * blockWidth;
+    tileHeight = std::max( 1, tileHeight / blockHeight ) * blockHeight;
+    windowExtent = QgsRectangle( rasterBBox.xMinimum() + offsetX * mCellSizeX,
+                                 rasterBBox.yMaximum() - ( offsetY + windowRows ) * mCellSizeY,
+                                 rasterBBox.xMinimum() + ( offsetX + windowCols ) * mCellSizeX,
+                                 rasterBBox.yMaximum() - offsetY * mCellSizeY );
+  }
+  const int tilesX = ( windowCols + tileWidth - 1 ) / tileWidth;
+  const int tilesY = ( windowRows + tileHeight - 1 ) / tileHeight;
+
+  //index the zones by the tiles they touch, with their pixel rectangle in window coordinates
+  struct Zone
+  {
+    int index;
+    int left;
+    int top;
+    int cols;
+    int rows;
+    std::unique_ptr< QgsPolygonRasterizer > rasterizer;
+  };
+  std::vector< Zone > zoneInfo;
+  zoneInfo.reserve( zones.size() );
+  QVector< QVector< int > > tileZones( tilesX * tilesY );
+  for ( int i = 0; i < zones.size(); ++i )
+  {
+    int nCellsX, nCellsY;
+    QgsRectangle zoneExtent;
+    QgsRasterAnalysisUtils::cellInfoForBBox( rasterBBox, zones.at( i ).boundingBox(), mCellSizeX, mCellSizeY, nCellsX, nCellsY, rasterWidth, rasterHeight, zoneExtent );
+    if ( nCellsX <= 0 || nCellsY <= 0 )
+      continue;
+
+    Zone zone;
+    zone.index = i;
+    zone.left = static_cast< int >( std::round( ( zoneExtent.xMinimum() - windowExtent.xMinimum() ) / mCellSizeX ) );
+    zone.top = static_cast< int >( std::round( ( windowExtent.yMaximum() - zoneExtent.yMaximum() ) / mCellSizeY ) );
+    zone.cols = nCellsX;
+    zone.rows = nCellsY;
+    zone.rasterizer = qgis::make_unique< QgsPolygonRasterizer >( zones.at( i ), windowExtent, mCellSizeX, mCellSizeY );
+    if ( zone.rasterizer->isEmpty() )
+      continue;
+
+    const int zoneNumber = static_cast< int >( zoneInfo.size() );
+    for ( int tileY = zone.top / tileHeight; tileY <= ( zone.top + zone.rows - 1 ) / tileHeight; ++tileY )
+    {
+      for ( int tileX = zone.left / tileWidth; tileX <= ( zone.left + zone.cols - 1 ) / tileWidth; ++tileX )
+      {
+        tileZones[ tileY * tilesX + tileX ].append( zoneNumber );
+      }
+    }
+    zoneInfo.push_back( std::move( zone ) );
+  }
+
+  struct Tile
+  {
+    std::unique_ptr< QgsRasterBlock > block;
+    int left = 0;
+    int top = 0;
+    int cols = 0;
+    int rows = 0;
+  };
+
+  //pixels of a tile within a zone, accumulated in their own statistics and merged into the zone afterwards
+  struct ZoneTile
+  {
+    const Tile *tile;
+    const Zone *zone;
+    FeatureStats stats;
+  };
+
+  auto processZoneTile = []( ZoneTile & zoneTile )
+  {
+    const Tile &tile = *zoneTile.tile;
+    const Zone &zone = *zoneTile.zone;
+    const int left = std::max( zone.left, tile.left );
+    const int top = std::max( zone.top, tile.top );
+    const int width = std::min( zone.left + zone.cols, tile.left + tile.cols ) - left;
+    const int height = std::min( zone.top + zone.rows, tile.top + tile.rows ) - top;
+    if ( width <= 0 || height <= 0 )
+      return;
+
+    std::vector< unsigned char > mask( static_cast< std::size_t >( width ) * height );
+    zone.rasterizer->rasterizeCenters( left, top, width, height, mask.data() );
+
+    bool isNoData = false;
+    const unsigned char *inside = mask.data();
+    for ( int row = top - tile.top; row < top - tile.top + height; ++row )
+    {
+      for ( int col = left - tile.left; col < left - tile.left + width; ++col, ++inside )
+      {
+        if ( !*inside )
+          continue;
+
+        const double pixelValue = tile.block->valueAndNoData( row, col, isNoData );
+        if ( QgsRasterAnalysisUtils::validPixel( pixelValue ) && !isNoData )
+        {
+          zoneTile.stats.addValue( pixelValue );
+        }
+      }
+    }
+  };
+
+  QgsRasterIterator iter( mRasterInterface );
+  iter.setMaximumTileWidth( tileWidth );
+  iter.setMaximumTileHeight( tileHeight );
+  iter.startRasterRead( mRasterBand, windowCols, windowRows, windowExtent );
+
+  //tiles are read sequentially in batches, then the zones of all tiles of a batch are processed in parallel
+  const int batchSize = std::max( 1, QThread::idealThreadCount() );
+  const int tileCount = tilesX * tilesY;
+  int tilesDone = 0;
+  std::vector< Tile > tiles;
+  std::vector< ZoneTile > zoneTiles;
+  bool finished = false;
+  while ( !finished )
+  {
+    if ( feedback && feedback->isCanceled() )
+      break;
+
+    tiles.clear();
+    while ( static_cast< int >( tiles.size() ) < batchSize )
+    {
+      Tile tile;
+      if ( !iter.readNextRasterPart( mRasterBand, tile.cols, tile.rows, tile.block, tile.left, tile.top ) )
+      {
+        finished = true;
+        break;
+      }
+      tiles.push_back( std::move( tile ) );
+    }
+
+    zoneTiles.clear();
+    for ( const Tile &tile : tiles )
+    {
+      const QVector< int > &touchingZones = tileZones.at( ( tile.top / tileHeight ) * tilesX + tile.left / tileWidth );
+      for ( int zoneNumber : touchingZones )
+      {
+        const Zone *zone = &zoneInfo[ zoneNumber ];
+        zoneTiles.push_back( { &tile, zone, emptyStats } );
+      }
+    }
+
+    QtConcurrent::blockingMap( zoneTiles, processZoneTile );
+
+    for ( const ZoneTile &zoneTile : zoneTiles )
+    {
+      stats[ zoneTile.zone->index ].merge( zoneTile.stats );
+    }
+
+    tilesDone += static_cast< int >( tiles.size() );
+    if ( feedback )
+      feedback->setProgress( 100.0 * tilesDone / tileCount );
+  }
+}
+
 QString QgsZonalStatistics::getUniqueFieldName( const QString &fieldName, const QList<QgsField> &newFields )
 {
   QgsVectorDataProvider *dp = mPolygonLayer->dataProvider();
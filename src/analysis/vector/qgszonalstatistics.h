@@ -20,6 +20,7 @@
 
 #include <QString>
 #include <QMap>
+#include <QVector>
 
 #include <limits>
 #include <cfloat>
@@ -63,6 +64,16 @@ class ANALYSIS_EXPORT QgsZonalStatistics
     };
     Q_DECLARE_FLAGS( Statistics, Statistic )
 
+    /**
+     * Methods for reading the raster pixels of the zones.
+     * \since QGIS 3.6
+     */
+    enum Method
+    {
+      PerFeature, //!< Read the raster window covering each feature separately
+      SinglePass, //!< Read the raster once in block order, and pass the pixels of each block to all features touching it
+    };
+
     /**
      * Convenience constructor for QgsZonalStatistics, using an input raster layer.
      *
@@ -118,6 +129,27 @@ class ANALYSIS_EXPORT QgsZonalStatistics
     */
     int calculateStatistics( QgsFeedback *feedback );
 
+    /**
+     * Returns the method used to read the raster pixels of the zones.
+     * \see setMethod()
+     * \since QGIS 3.6
+     */
+    Method method() const { return mMethod; }
+
+    /**
+     * Sets the \a method used to read the raster pixels of the zones.
+     *
+     * With the default PerFeature method, the raster window covering each feature is read separately,
+     * so blocks shared by adjacent or overlapping features are read several times. The SinglePass method
+     * indexes the features by raster tile and reads the raster only once, in the block order of the
+     * raster, processing the pixels of each tile for all the features touching it in parallel. This is
+     * much faster for layers with many features. Both methods give the same results.
+     *
+     * \see method()
+     * \since QGIS 3.6
+     */
+    void setMethod( Method method ) { mMethod = method; }
+
   private:
     QgsZonalStatistics() = default;
 
@@ -159,6 +191,22 @@ class ANALYSIS_EXPORT QgsZonalStatistics
           if ( mStoreValues )
             values.append( value );
         }
+
+        //! Adds the values of \a other, calculated for another part of the same zone
+        void merge( const FeatureStats &other )
+        {
+          sum += other.sum;
+          count += other.count;
+          min = std::min( min, other.min );
+          max = std::max( max, other.max );
+          if ( mStoreValueCounts )
+          {
+            for ( auto it = other.valueCount.constBegin(); it != other.valueCount.constEnd(); ++it )
+              valueCount.insert( it.key(), valueCount.value( it.key(), 0 ) + it.value() );
+          }
+          if ( mStoreValues )
+            values.append( other.values );
+        }
         double sum = 0.0;
         double count = 0.0;
         double max = std::numeric_limits<double>::lowest();
@@ -173,6 +221,12 @@ class ANALYSIS_EXPORT QgsZonalStatistics
 
     QString getUniqueFieldName( const QString &fieldName, const QList<QgsField> &newFields );
 
+    //! Calculates the statistics of a single feature \a geometry from the raster window covering it
+    void calculateFeatureStatistics( const QgsGeometry &geometry, FeatureStats &stats ) const;
+
+    //! Calculates the statistics of all \a zones in a single pass over the raster
+    void calculateSinglePass( const QVector< QgsGeometry > &zones, QVector< FeatureStats > &stats, QgsFeedback *feedback ) const;
+
     QgsRasterInterface *mRasterInterface = nullptr;
     QgsCoordinateReferenceSystem mRasterCrs;
 
@@ -184,6 +238,7 @@ class ANALYSIS_EXPORT QgsZonalStatistics
     QgsVectorLayer *mPolygonLayer = nullptr;
     QString mAttributePrefix;
     Statistics mStatistics = QgsZonalStatistics::All;
+    Method mMethod = PerFeature;
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS( QgsZonalStatistics::Statistics )
@@ -576,6 +576,10 @@ QgsOptions::QgsOptions( QWidget *parent, Qt::WindowFlags fl, const QList<QgsOpti
   //Changed to default to true as of QGIS 1.7
   chkAntiAliasing->setChecked( mSettings->value( QStringLiteral( "/qgis/enable_anti_aliasing" ), true ).toBool() );
   chkUseRenderCaching->setChecked( mSettings->value( QStringLiteral( "/qgis/enable_render_caching" ), true ).toBool() );
+  chkDiskRenderCache->setChecked( mSettings->value( QStringLiteral( "/Map/enableDiskRenderCache" ), false ).toBool() );
+  spinDiskRenderCacheSize->setValue( mSettings->value( QStringLiteral( "/Map/diskRenderCacheSize" ), 100 ).toInt() );
+  spinDiskRenderCacheSize->setEnabled( chkDiskRenderCache->isChecked() );
+  connect( chkDiskRenderCache, &QCheckBox::toggled, spinDiskRenderCacheSize, &QSpinBox::setEnabled );
   chkParallelRendering->setChecked( mSettings->value( QStringLiteral( "/qgis/parallel_rendering" ), true ).toBool() );
   spinMapUpdateInterval->setValue( mSettings->value( QStringLiteral( "/qgis/map_update_interval" ), 250 ).toInt() );
   chkMaxThreads->setChecked( QgsApplication::maxThreads() != -1 );
@@ -1432,6 +1436,8 @@ void QgsOptions::saveOptions()
   mSettings->setValue( QStringLiteral( "/qgis/new_layers_visible" ), chkAddedVisibility->isChecked() );
   mSettings->setValue( QStringLiteral( "/qgis/enable_anti_aliasing" ), chkAntiAliasing->isChecked() );
   mSettings->setValue( QStringLiteral( "/qgis/enable_render_caching" ), chkUseRenderCaching->isChecked() );
+  mSettings->setValue( QStringLiteral( "/Map/enableDiskRenderCache" ), chkDiskRenderCache->isChecked() );
+  mSettings->setValue( QStringLiteral( "/Map/diskRenderCacheSize" ), spinDiskRenderCacheSize->value() );
   mSettings->setValue( QStringLiteral( "/qgis/parallel_rendering" ), chkParallelRendering->isChecked() );
   int maxThreads = chkMaxThreads->isChecked() ? spinMaxThreads->value() : -1;
   QgsApplication::setMaxThreads( maxThreads );
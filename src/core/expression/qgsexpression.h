@@ -715,6 +715,7 @@ class CORE_EXPORT QgsExpression
     static void initVariableHelp() SIP_SKIP;
 
     friend class QgsOgcUtils;
+    friend class TestQgsExpression;
 };
 
 Q_DECLARE_METATYPE( QgsExpression )
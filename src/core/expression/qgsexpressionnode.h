@@ -266,6 +266,23 @@ class CORE_EXPORT QgsExpressionNode SIP_ABSTRACT
      */
     bool prepare( QgsExpression *parent, const QgsExpressionContext *context );
 
+    /**
+     * Returns true if the node has a static value, which was evaluated and cached
+     * during prepare().
+     *
+     * \see cachedStaticValue()
+     * \since QGIS 3.6
+     */
+    bool hasCachedStaticValue() const { return mHasCachedValue; }
+
+    /**
+     * Returns the node's static cached value. Only valid if hasCachedStaticValue() is true.
+     *
+     * \see hasCachedStaticValue()
+     * \since QGIS 3.6
+     */
+    QVariant cachedStaticValue() const { return mCachedStaticValue; }
+
     /**
      * First line in the parser this node was found.
      * \note This might not be complete for all nodes. Currently
@@ -90,6 +90,11 @@ QVariant QgsExpressionNodeUnaryOperator::evalNode( QgsExpression *parent, const
   QVariant val = mOperand->eval( parent, context );
   ENSURE_NO_EVAL_ERROR;
 
+  return evalValue( parent, val );
+}
+
+QVariant QgsExpressionNodeUnaryOperator::evalValue( QgsExpression *parent, const QVariant &val )
+{
   switch ( mOp )
   {
     case uoNot:
@@ -181,6 +186,11 @@ QVariant QgsExpressionNodeBinaryOperator::evalNode( QgsExpression *parent, const
   QVariant vR = mOpRight->eval( parent, context );
   ENSURE_NO_EVAL_ERROR;
 
+  return evalValues( parent, context, vL, vR );
+}
+
+QVariant QgsExpressionNodeBinaryOperator::evalValues( QgsExpression *parent, const QgsExpressionContext *context, const QVariant &vL, const QVariant &vR )
+{
   switch ( mOp )
   {
     case boPlus:
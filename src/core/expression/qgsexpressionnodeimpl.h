@@ -78,9 +78,15 @@ class CORE_EXPORT QgsExpressionNodeUnaryOperator : public QgsExpressionNode
     QString text() const;
 
   private:
+
+    //! Applies the operator to an already evaluated operand \a val
+    QVariant evalValue( QgsExpression *parent, const QVariant &val );
+
     UnaryOperator mOp;
     QgsExpressionNode *mOperand = nullptr;
 
+    friend class QgsExpressionProgram;
+
     static const char *UNARY_OPERATOR_TEXT[];
 };
 
@@ -188,6 +194,10 @@ class CORE_EXPORT QgsExpressionNodeBinaryOperator : public QgsExpressionNode
     QString text() const;
 
   private:
+
+    //! Applies the operator to already evaluated operands \a vL and \a vR
+    QVariant evalValues( QgsExpression *parent, const QgsExpressionContext *context, const QVariant &vL, const QVariant &vR );
+
     bool compare( double diff );
     qlonglong computeInt( qlonglong x, qlonglong y );
     double computeDouble( double x, double y );
@@ -203,6 +213,8 @@ class CORE_EXPORT QgsExpressionNodeBinaryOperator : public QgsExpressionNode
     QgsExpressionNode *mOpLeft = nullptr;
     QgsExpressionNode *mOpRight = nullptr;
 
+    friend class QgsExpressionProgram;
+
     static const char *BINARY_OPERATOR_TEXT[];
 };
 
@@ -431,6 +443,8 @@ class CORE_EXPORT QgsExpressionNodeColumnRef : public QgsExpressionNode
   private:
     QString mName;
     int mIndex;
+
+    friend class QgsExpressionProgram;
 };
 
 /**
@@ -0,0 +1,530 @@
+/***************************************************************************
+                         qgsexpressionprogram.cpp
+                         ------------------------
+    begin                : October 2026
+    copyright            : (C) 2026 by QGIS contributors
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsexpressionprogram.h"
+#include "qgsexpression.h"
+#include "qgsexpressionnodeimpl.h"
+#include "qgsexpressionutils.h"
+
+#include <QVarLengthArray>
+#include <algorithm>
+#include <cmath>
+
+///@cond PRIVATE
+
+namespace
+{
+
+  /**
+   * A value on the stack of the program. Integers and doubles are kept unboxed, converting
+   * to and from QVariant is lossless so the results are identical to the node tree.
+   */
+  struct Value
+  {
+    enum Kind
+    {
+      Variant, //!< Any other value, including typed NULL values
+      Int, //!< QVariant::Int
+      LongLong, //!< QVariant::LongLong
+      Double, //!< QVariant::Double
+      Null, //!< Invalid QVariant
+    };
+
+    Kind kind = Null;
+    qlonglong i = 0;
+    double d = 0;
+    QVariant v;
+
+    void setVariant( const QVariant &value )
+    {
+      if ( value.isNull() )
+      {
+        kind = Variant;
+        v = value;
+        return;
+      }
+
+      switch ( value.type() )
+      {
+        case QVariant::Int:
+          kind = Int;
+          i = value.toInt();
+          break;
+        case QVariant::LongLong:
+          kind = LongLong;
+          i = value.toLongLong();
+          break;
+        case QVariant::Double:
+          kind = Double;
+          d = value.toDouble();
+          break;
+        default:
+          kind = Variant;
+          v = value;
+          break;
+      }
+    }
+
+    void setTvl( QgsExpressionUtils::TVL tvl )
+    {
+      if ( tvl == QgsExpressionUtils::Unknown )
+      {
+        kind = Null;
+      }
+      else
+      {
+        kind = Int;
+        i = tvl == QgsExpressionUtils::True ? 1 : 0;
+      }
+    }
+
+    void setLongLong( qlonglong value )
+    {
+      kind = LongLong;
+      i = value;
+    }
+
+    void setDouble( double value )
+    {
+      kind = Double;
+      d = value;
+    }
+
+    bool isNumeric() const
+    {
+      return kind == Int || kind == LongLong || kind == Double;
+    }
+
+    bool isInteger() const
+    {
+      return kind == Int || kind == LongLong;
+    }
+
+    QVariant toVariant() const
+    {
+      switch ( kind )
+      {
+        case Int:
+          return QVariant( static_cast< int >( i ) );
+        case LongLong:
+          return QVariant( i );
+        case Double:
+          return QVariant( d );
+        case Null:
+          return QVariant();
+        case Variant:
+          break;
+      }
+      return v;
+    }
+
+    //! Same as QgsExpressionUtils::getDoubleValue() for a numeric value
+    double toDouble( QgsExpression *parent ) const
+    {
+      if ( kind != Double )
+        return static_cast< double >( i );
+
+      if ( std::isnan( d ) || !std::isfinite( d ) )
+        return QgsExpressionUtils::getDoubleValue( QVariant( d ), parent );
+
+      return d;
+    }
+
+    //! Same as QgsExpressionUtils::getTVLValue()
+    QgsExpressionUtils::TVL toTvl( QgsExpression *parent ) const
+    {
+      switch ( kind )
+      {
+        case Int:
+          return i != 0 ? QgsExpressionUtils::True : QgsExpressionUtils::False;
+        case LongLong:
+          return !qgsDoubleNear( static_cast< double >( i ), 0.0 ) ? QgsExpressionUtils::True : QgsExpressionUtils::False;
+        case Double:
+          return !qgsDoubleNear( d, 0.0 ) ? QgsExpressionUtils::True : QgsExpressionUtils::False;
+        case Null:
+          return QgsExpressionUtils::Unknown;
+        case Variant:
+          break;
+      }
+      return QgsExpressionUtils::getTVLValue( v, parent );
+    }
+  };
+
+}
+
+std::unique_ptr< QgsExpressionProgram > QgsExpressionProgram::compile( QgsExpressionNode *rootNode )
+{
+  if ( !rootNode || rootNode->hasCachedStaticValue() )
+    return nullptr;
+
+  switch ( rootNode->nodeType() )
+  {
+    case QgsExpressionNode::ntUnaryOperator:
+    case QgsExpressionNode::ntBinaryOperator:
+    case QgsExpressionNode::ntCondition:
+      break;
+
+    default:
+      // nothing to gain over the node tree
+      return nullptr;
+  }
+
+  std::unique_ptr< QgsExpressionProgram > program( new QgsExpressionProgram() );
+  if ( !program->compileNode( rootNode ) )
+    return nullptr;
+
+  // CASE returns NULL on errors in its branches, operators return their own result
+  program->mLastInstructionIsRoot = rootNode->nodeType() != QgsExpressionNode::ntCondition;
+  return program;
+}
+
+int QgsExpressionProgram::addInstruction( Opcode opcode, int arg, QgsExpressionNode *node )
+{
+  switch ( opcode )
+  {
+    case PushConstant:
+    case LoadColumn:
+    case EvalNode:
+    case PushNull:
+      mStackDepth++;
+      break;
+
+    case Binary:
+    case JumpIfNotTrue:
+      mStackDepth--;
+      break;
+
+    case Jump:
+      // the result of the branch jumping to the end stays on the stack, the next branch starts without it
+      mStackDepth--;
+      break;
+
+    case Unary:
+      break;
+  }
+  mMaxStackDepth = std::max( mMaxStackDepth, mStackDepth );
+
+  mInstructions.append( Instruction{ opcode, arg, node } );
+  return mInstructions.size() - 1;
+}
+
+bool QgsExpressionProgram::compileNode( QgsExpressionNode *node )
+{
+  if ( !node )
+    return false;
+
+  // static nodes were evaluated during prepare()
+  if ( node->hasCachedStaticValue() )
+  {
+    mConstants.append( node->cachedStaticValue() );
+    addInstruction( PushConstant, mConstants.size() - 1 );
+    return true;
+  }
+
+  switch ( node->nodeType() )
+  {
+    case QgsExpressionNode::ntLiteral:
+      mConstants.append( static_cast< QgsExpressionNodeLiteral * >( node )->value() );
+      addInstruction( PushConstant, mConstants.size() - 1 );
+      return true;
+
+    case QgsExpressionNode::ntColumnRef:
+    {
+      QgsExpressionNodeColumnRef *columnRef = static_cast< QgsExpressionNodeColumnRef * >( node );
+      if ( columnRef->mIndex >= 0 )
+        addInstruction( LoadColumn, columnRef->mIndex, node );
+      else
+        addInstruction( EvalNode, 0, node );
+      return true;
+    }
+
+    case QgsExpressionNode::ntUnaryOperator:
+      if ( !compileNode( static_cast< QgsExpressionNodeUnaryOperator * >( node )->operand() ) )
+        return false;
+      addInstruction( Unary, 0, node );
+      return true;
+
+    case QgsExpressionNode::ntBinaryOperator:
+    {
+      QgsExpressionNodeBinaryOperator *binary = static_cast< QgsExpressionNodeBinaryOperator * >( node );
+      if ( !compileNode( binary->opLeft() ) || !compileNode( binary->opRight() ) )
+        return false;
+      addInstruction( Binary, 0, node );
+      return true;
+    }
+
+    case QgsExpressionNode::ntCondition:
+    {
+      QgsExpressionNodeCondition *condition = static_cast< QgsExpressionNodeCondition * >( node );
+      QVector< int > endJumps;
+      const QgsExpressionNodeCondition::WhenThenList conditions = condition->conditions();
+      for ( QgsExpressionNodeCondition::WhenThen *whenThen : conditions )
+      {
+        if ( !compileNode( whenThen->whenExp() ) )
+          return false;
+        const int nextCondition = addInstruction( JumpIfNotTrue );
+        if ( !compileNode( whenThen->thenExp() ) )
+          return false;
+        endJumps << addInstruction( Jump );
+        mInstructions[ nextCondition ].arg = mInstructions.size();
+      }
+
+      if ( condition->elseExp() )
+      {
+        if ( !compileNode( condition->elseExp() ) )
+          return false;
+      }
+      else
+      {
+        addInstruction( PushNull );
+      }
+
+      for ( int jump : qgis::as_const( endJumps ) )
+        mInstructions[ jump ].arg = mInstructions.size();
+      return true;
+    }
+
+    default:
+      // functions, IN, index operators... go through the node tree
+      addInstruction( EvalNode, 0, node );
+      return true;
+  }
+}
+
+QVariant QgsExpressionProgram::evaluate( QgsExpression *parent, const QgsExpressionContext *context ) const
+{
+  QVarLengthArray< Value, 16 > stack( mMaxStackDepth );
+  int top = -1;
+
+  // the context feature is only fetched once per evaluation
+  bool featureFetched = false;
+  bool hasFeature = false;
+  QgsFeature feature;
+
+  const int instructionCount = mInstructions.size();
+  int pc = 0;
+  while ( pc < instructionCount )
+  {
+    const Instruction &instruction = mInstructions.at( pc );
+    int next = pc + 1;
+
+    switch ( instruction.opcode )
+    {
+      case PushConstant:
+        stack[ ++top ].setVariant( mConstants.at( instruction.arg ) );
+        break;
+
+      case PushNull:
+        stack[ ++top ].kind = Value::Null;
+        break;
+
+      case LoadColumn:
+      {
+        if ( !featureFetched )
+        {
+          hasFeature = context && context->hasFeature();
+          if ( hasFeature )
+            feature = context->feature();
+          featureFetched = true;
+        }
+
+        Value &value = stack[ ++top ];
+        if ( hasFeature )
+        {
+          value.setVariant( feature.attribute( instruction.arg ) );
+        }
+        else
+        {
+          value.kind = Value::Variant;
+          value.v = QVariant( '[' + static_cast< QgsExpressionNodeColumnRef * >( instruction.node )->name() + ']' );
+        }
+        break;
+      }
+
+      case EvalNode:
+        stack[ ++top ].setVariant( instruction.node->eval( parent, context ) );
+        break;
+
+      case Unary:
+      {
+        QgsExpressionNodeUnaryOperator *node = static_cast< QgsExpressionNodeUnaryOperator * >( instruction.node );
+        Value &value = stack[ top ];
+        if ( !value.isNumeric() )
+        {
+          value.setVariant( node->evalValue( parent, value.toVariant() ) );
+          break;
+        }
+
+        switch ( node->op() )
+        {
+          case QgsExpressionNodeUnaryOperator::uoNot:
+            value.setTvl( QgsExpressionUtils::NOT[ value.toTvl( parent ) ] );
+            break;
+
+          case QgsExpressionNodeUnaryOperator::uoMinus:
+            if ( value.isInteger() )
+              value.setLongLong( -value.i );
+            else
+              value.setDouble( -value.toDouble( parent ) );
+            break;
+        }
+        break;
+      }
+
+      case Binary:
+      {
+        QgsExpressionNodeBinaryOperator *node = static_cast< QgsExpressionNodeBinaryOperator * >( instruction.node );
+        const Value &right = stack[ top-- ];
+        Value &left = stack[ top ];
+        const QgsExpressionNodeBinaryOperator::BinaryOperator op = node->op();
+
+        bool handled = left.isNumeric() && right.isNumeric();
+        if ( handled )
+        {
+          // numeric fast paths, following QgsExpressionNodeBinaryOperator::evalValues()
+          switch ( op )
+          {
+            case QgsExpressionNodeBinaryOperator::boPlus:
+            case QgsExpressionNodeBinaryOperator::boMinus:
+            case QgsExpressionNodeBinaryOperator::boMul:
+            case QgsExpressionNodeBinaryOperator::boMod:
+            case QgsExpressionNodeBinaryOperator::boDiv:
+            {
+              if ( op != QgsExpressionNodeBinaryOperator::boDiv && left.isInteger() && right.isInteger() )
+              {
+                if ( op == QgsExpressionNodeBinaryOperator::boMod && right.i == 0 )
+                  left.kind = Value::Null;
+                else
+                  left.setLongLong( node->computeInt( left.i, right.i ) );
+                break;
+              }
+
+              const double fL = left.toDouble( parent );
+              if ( parent->hasEvalError() )
+                break;
+              const double fR = right.toDouble( parent );
+              if ( parent->hasEvalError() )
+                break;
+              if ( ( op == QgsExpressionNodeBinaryOperator::boDiv || op == QgsExpressionNodeBinaryOperator::boMod ) && fR == 0. )
+                left.kind = Value::Null;
+              else
+                left.setDouble( node->computeDouble( fL, fR ) );
+              break;
+            }
+
+            case QgsExpressionNodeBinaryOperator::boIntDiv:
+            {
+              const double fL = left.toDouble( parent );
+              if ( parent->hasEvalError() )
+                break;
+              const double fR = right.toDouble( parent );
+              if ( parent->hasEvalError() )
+                break;
+              if ( fR == 0. )
+                left.kind = Value::Null;
+              else
+                left.setLongLong( qlonglong( std::floor( fL / fR ) ) );
+              break;
+            }
+
+            case QgsExpressionNodeBinaryOperator::boPow:
+            {
+              const double fL = left.toDouble( parent );
+              if ( parent->hasEvalError() )
+                break;
+              const double fR = right.toDouble( parent );
+              if ( parent->hasEvalError() )
+                break;
+              left.setDouble( std::pow( fL, fR ) );
+              break;
+            }
+
+            case QgsExpressionNodeBinaryOperator::boAnd:
+              left.setTvl( QgsExpressionUtils::AND[ left.toTvl( parent ) ][ right.toTvl( parent ) ] );
+              break;
+
+            case QgsExpressionNodeBinaryOperator::boOr:
+              left.setTvl( QgsExpressionUtils::OR[ left.toTvl( parent ) ][ right.toTvl( parent ) ] );
+              break;
+
+            case QgsExpressionNodeBinaryOperator::boEQ:
+            case QgsExpressionNodeBinaryOperator::boNE:
+            case QgsExpressionNodeBinaryOperator::boLT:
+            case QgsExpressionNodeBinaryOperator::boGT:
+            case QgsExpressionNodeBinaryOperator::boLE:
+            case QgsExpressionNodeBinaryOperator::boGE:
+            case QgsExpressionNodeBinaryOperator::boIs:
+            case QgsExpressionNodeBinaryOperator::boIsNot:
+            {
+              const double fL = left.toDouble( parent );
+              if ( parent->hasEvalError() )
+                break;
+              const double fR = right.toDouble( parent );
+              if ( parent->hasEvalError() )
+                break;
+
+              bool result = false;
+              if ( op == QgsExpressionNodeBinaryOperator::boIs )
+                result = qgsDoubleNear( fL, fR );
+              else if ( op == QgsExpressionNodeBinaryOperator::boIsNot )
+                result = !qgsDoubleNear( fL, fR );
+              else
+                result = node->compare( fL - fR );
+              left.setTvl( result ? QgsExpressionUtils::True : QgsExpressionUtils::False );
+              break;
+            }
+
+            default:
+              handled = false;
+              break;
+          }
+        }
+
+        if ( !handled )
+          left.setVariant( node->evalValues( parent, context, left.toVariant(), right.toVariant() ) );
+        else if ( parent->hasEvalError() )
+          left.kind = Value::Null;
+        break;
+      }
+
+      case JumpIfNotTrue:
+      {
+        const QgsExpressionUtils::TVL tvl = stack[ top-- ].toTvl( parent );
+        if ( tvl != QgsExpressionUtils::True )
+          next = instruction.arg;
+        break;
+      }
+
+      case Jump:
+        next = instruction.arg;
+        break;
+    }
+
+    if ( parent->hasEvalError() )
+    {
+      // the node tree stops at the first error, only the root node returns its own result
+      if ( mLastInstructionIsRoot && pc == instructionCount - 1 )
+        return stack[ top ].toVariant();
+      return QVariant();
+    }
+
+    pc = next;
+  }
+
+  return top >= 0 ? stack[ top ].toVariant() : QVariant();
+}
+
+///@endcond
@@ -0,0 +1,100 @@
+/***************************************************************************
+                         qgsexpressionprogram.h
+                         ----------------------
+    begin                : October 2026
+    copyright            : (C) 2026 by QGIS contributors
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSEXPRESSIONPROGRAM_H
+#define QGSEXPRESSIONPROGRAM_H
+
+#define SIP_NO_FILE
+
+#include <QVariant>
+#include <QVector>
+#include <memory>
+
+class QgsExpression;
+class QgsExpressionContext;
+class QgsExpressionNode;
+
+///@cond PRIVATE
+
+/**
+ * A prepared expression compiled to a flat list of instructions for a small stack machine.
+ *
+ * Operators, literals, column references and CASE conditions are compiled to instructions,
+ * with nodes which were found to be static during prepare() folded into constants and
+ * column references resolved to attribute indexes. Integer and double values stay unboxed
+ * on the stack between operators. All other nodes (functions, IN, index operators...) are
+ * evaluated through the node tree.
+ *
+ * The program references the nodes of the expression it was compiled from, and must be
+ * discarded together with them. Results and evaluation errors match the node tree.
+ */
+class QgsExpressionProgram
+{
+  public:
+
+    /**
+     * Compiles a program for the prepared expression tree starting at \a rootNode.
+     * Returns nullptr if the expression would not benefit from it, e.g. if it is static or
+     * consists of a single column reference or function.
+     */
+    static std::unique_ptr< QgsExpressionProgram > compile( QgsExpressionNode *rootNode );
+
+    /**
+     * Evaluates the program for the given \a context. Errors are reported to \a parent.
+     */
+    QVariant evaluate( QgsExpression *parent, const QgsExpressionContext *context ) const;
+
+    //! Returns the number of instructions of the program
+    int instructionCount() const { return mInstructions.size(); }
+
+  private:
+
+    enum Opcode
+    {
+      PushConstant, //!< Push constant with index arg
+      LoadColumn, //!< Push the attribute with index arg of the context feature
+      EvalNode, //!< Evaluate node through the tree and push the result
+      Unary, //!< Apply unary operator node to the top value
+      Binary, //!< Apply binary operator node to the two top values
+      JumpIfNotTrue, //!< Pop a value and jump to arg unless it is true
+      Jump, //!< Jump to arg
+      PushNull, //!< Push a NULL value
+    };
+
+    struct Instruction
+    {
+      Opcode opcode;
+      int arg;
+      QgsExpressionNode *node;
+    };
+
+    QgsExpressionProgram() = default;
+
+    bool compileNode( QgsExpressionNode *node );
+    int addInstruction( Opcode opcode, int arg = 0, QgsExpressionNode *node = nullptr );
+
+    QVector< Instruction > mInstructions;
+    QVector< QVariant > mConstants;
+    int mMaxStackDepth = 0;
+    int mStackDepth = 0;
+
+    //! True if an error raised by the last instruction still returns its result, as for the root operator node
+    bool mLastInstructionIsRoot = false;
+};
+
+///@endcond
+
+#endif // QGSEXPRESSIONPROGRAM_H
@@ -1587,7 +1587,7 @@ int FeaturePart::createCandidates( QList< LabelPosition *> &lPos,
       i.remove();
       delete pos;
     }
-    else   // this one is OK
+    else if ( candidates )  // this one is OK
     {
       pos->insertIntoIndex( candidates );
     }
@@ -132,10 +132,10 @@ namespace pal
        * \param lPos pointer to an array of candidates, will be filled by generated candidates
        * \param mapBoundary map boundary geometry
        * \param mapShape generate candidates for this spatial entity
-       * \param candidates index for candidates
+       * \param candidates optional index for candidates. If set, the generated candidates will be inserted into the index.
        * \returns the number of candidates generated in lPos
        */
-      int createCandidates( QList<LabelPosition *> &lPos, const GEOSPreparedGeometry *mapBoundary, PointSet *mapShape, RTree<LabelPosition *, double, 2, double> *candidates );
+      int createCandidates( QList<LabelPosition *> &lPos, const GEOSPreparedGeometry *mapBoundary, PointSet *mapShape, RTree<LabelPosition *, double, 2, double> *candidates = nullptr );
 
       /**
        * Generate candidates for point feature, located around a specified point.
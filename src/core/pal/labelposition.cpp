@@ -37,6 +37,7 @@
 #include "qgsmessagelog.h"
 #include <cmath>
 #include <cfloat>
+#include <algorithm>
 
 using namespace pal;
 
@@ -58,8 +59,8 @@ LabelPosition::LabelPosition( int id, double x1, double y1, double w, double h,
 {
   type = GEOS_POLYGON;
   nbPoints = 4;
-  x = new double[nbPoints];
-  y = new double[nbPoints];
+  x = mCoordinates;
+  y = mCoordinates + nbPoints;
 
   // alpha take his value bw 0 and 2*pi rad
   while ( this->alpha > 2 * M_PI )
@@ -140,6 +141,13 @@ LabelPosition::LabelPosition( int id, double x1, double y1, double w, double h,
 LabelPosition::LabelPosition( const LabelPosition &other )
   : PointSet( other )
 {
+  // move the coordinates copied by PointSet to the inline storage
+  std::copy( x, x + nbPoints, mCoordinates );
+  std::copy( y, y + nbPoints, mCoordinates + nbPoints );
+  deleteCoords();
+  x = mCoordinates;
+  y = mCoordinates + nbPoints;
+
   id = other.id;
   mCost = other.mCost;
   feature = other.feature;
@@ -162,6 +170,15 @@ LabelPosition::LabelPosition( const LabelPosition &other )
   mUpsideDownCharCount = other.mUpsideDownCharCount;
 }
 
+LabelPosition::~LabelPosition()
+{
+  delete nextPart;
+
+  // coordinates use the inline storage, they must not be freed by PointSet
+  x = nullptr;
+  y = nullptr;
+}
+
 bool LabelPosition::isIn( double *bbox )
 {
   int i;
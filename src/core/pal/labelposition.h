@@ -97,7 +97,7 @@ namespace pal
       //! Copy constructor
       LabelPosition( const LabelPosition &other );
 
-      ~LabelPosition() override { delete nextPart; }
+      ~LabelPosition() override;
 
       /**
        * \brief Is the labelposition in the bounding-box ? (intersect or inside????)
@@ -325,6 +325,9 @@ namespace pal
       bool mHasObstacleConflict;
       int mUpsideDownCharCount;
 
+      //! Storage for the x and y coordinates of the four corners, avoiding separate allocations
+      double mCoordinates[8];
+
       /**
        * Calculates the total number of parts for this label position
        */
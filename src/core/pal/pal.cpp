@@ -41,10 +41,50 @@
 #include "pointset.h"
 #include "internalexception.h"
 #include "util.h"
+#include <algorithm>
 #include <cfloat>
+#include <limits>
+#include <map>
+#include <QtConcurrentMap>
+
+//! Number of feature parts for which label candidates are generated by a single task
+static const int CANDIDATES_CHUNK_SIZE = 256;
 
 using namespace pal;
 
+//! Candidates and obstacles extracted from a single layer, before they are merged into a problem
+struct Pal::ExtractedLayer
+{
+  ExtractedLayer() = default;
+  ExtractedLayer( const ExtractedLayer &other ) = delete;
+  ExtractedLayer &operator=( const ExtractedLayer &other ) = delete;
+
+  ~ExtractedLayer()
+  {
+    for ( Feats *feat : qgis::as_const( features ) )
+    {
+      qDeleteAll( feat->lPos );
+      delete feat;
+    }
+  }
+
+  //! Features with label candidates, in index order
+  QLinkedList< Feats * > features;
+  //! Obstacles within the extent, in the order they have to be indexed
+  QList< FeaturePart * > obstacles;
+  //! Number of obstacles which are not holes of labeled features
+  int obstacleCount = 0;
+};
+
+//! State of a problem extraction started by Pal::startProblemExtraction()
+struct Pal::Extraction
+{
+  QgsRectangle extent;
+  geos::unique_ptr mapBoundary;
+  std::map< Layer *, std::unique_ptr< ExtractedLayer > > layers;
+};
+
+
 Pal::Pal()
 {
   // do not init and exit GEOS - we do it inside QGIS
@@ -82,18 +122,37 @@ void Pal::removeLayer( Layer *layer )
   if ( QgsAbstractLabelProvider *key = mLayers.key( layer, nullptr ) )
   {
     mLayers.remove( key );
+    mLayerOrder.removeOne( layer );
     delete layer;
   }
   mMutex.unlock();
 }
 
+void Pal::sortLayers( const QList< QgsAbstractLabelProvider * > &providers )
+{
+  QHash< QgsAbstractLabelProvider *, int > providerIndex;
+  providerIndex.reserve( providers.size() );
+  for ( int i = 0; i < providers.size(); ++i )
+    providerIndex.insert( providers.at( i ), i );
+
+  mMutex.lock();
+  std::stable_sort( mLayerOrder.begin(), mLayerOrder.end(), [&providerIndex]( Layer * a, Layer * b )
+  {
+    return providerIndex.value( a->provider(), std::numeric_limits< int >::max() ) < providerIndex.value( b->provider(), std::numeric_limits< int >::max() );
+  } );
+  mMutex.unlock();
+}
+
 Pal::~Pal()
 {
 
   mMutex.lock();
 
+  // extracted candidates reference the features of the layers
+  mExtraction.reset();
   qDeleteAll( mLayers );
   mLayers.clear();
+  mLayerOrder.clear();
   mMutex.unlock();
 
   // do not init and exit GEOS - we do it inside QGIS
@@ -108,68 +167,27 @@ Layer *Pal::addLayer( QgsAbstractLabelProvider *provider, const QString &layerNa
 
   Layer *layer = new Layer( provider, layerName, arrangement, defaultPriority, active, toLabel, this, displayAll );
   mLayers.insert( provider, layer );
+  mLayerOrder.append( layer );
   mMutex.unlock();
 
   return layer;
 }
 
-typedef struct _featCbackCtx
-{
-  Layer *layer = nullptr;
-  QLinkedList<Feats *> *fFeats;
-  RTree<FeaturePart *, double, 2, double> *obstacles;
-  RTree<LabelPosition *, double, 2, double> *candidates;
-  const GEOSPreparedGeometry *mapBoundary = nullptr;
-} FeatCallBackCtx;
-
-
-
 /*
  * Callback function
  *
- * Extract a specific shape from indexes
+ * Collect the feature parts to label from indexes
  */
 bool extractFeatCallback( FeaturePart *ft_ptr, void *ctx )
 {
-  double amin[2], amax[2];
-  FeatCallBackCtx *context = reinterpret_cast< FeatCallBackCtx * >( ctx );
-
-  // Holes of the feature are obstacles
-  for ( int i = 0; i < ft_ptr->getNumSelfObstacles(); i++ )
-  {
-    ft_ptr->getSelfObstacle( i )->getBoundingBox( amin, amax );
-    context->obstacles->Insert( amin, amax, ft_ptr->getSelfObstacle( i ) );
-
-    if ( !ft_ptr->getSelfObstacle( i )->getHoleOf() )
-    {
-      //ERROR: SHOULD HAVE A PARENT!!!!!
-    }
-  }
-
-  // generate candidates for the feature part
-  QList< LabelPosition * > lPos;
-  if ( ft_ptr->createCandidates( lPos, context->mapBoundary, ft_ptr, context->candidates ) )
-  {
-    // valid features are added to fFeats
-    Feats *ft = new Feats();
-    ft->feature = ft_ptr;
-    ft->shape = nullptr;
-    ft->lPos = lPos;
-    ft->priority = ft_ptr->calculatePriority();
-    context->fFeats->append( ft );
-  }
-  else
-  {
-    // Others are deleted
-    qDeleteAll( lPos );
-  }
-
+  QList< FeaturePart * > *parts = reinterpret_cast< QList< FeaturePart * > * >( ctx );
+  parts->append( ft_ptr );
   return true;
 }
 
 typedef struct _obstaclebackCtx
 {
-  RTree<FeaturePart *, double, 2, double> *obstacles;
+  QList<FeaturePart *> *obstacles;
   int obstacleCount;
 } ObstacleCallBackCtx;
 
@@ -180,12 +198,10 @@ typedef struct _obstaclebackCtx
  */
 bool extractObstaclesCallback( FeaturePart *ft_ptr, void *ctx )
 {
-  double amin[2], amax[2];
   ObstacleCallBackCtx *context = reinterpret_cast< ObstacleCallBackCtx * >( ctx );
 
   // insert into obstacles
-  ft_ptr->getBoundingBox( amin, amax );
-  context->obstacles->Insert( amin, amax, ft_ptr );
+  context->obstacles->append( ft_ptr );
   context->obstacleCount++;
   return true;
 }
@@ -216,8 +232,142 @@ bool filteringCallback( FeaturePart *featurePart, void *ctx )
   return true;
 }
 
-std::unique_ptr<Problem> Pal::extract( const QgsRectangle &extent, const QgsGeometry &mapBoundary )
+void Pal::startProblemExtraction( const QgsRectangle &extent, const QgsGeometry &mapBoundary )
+{
+  std::unique_ptr< Extraction > extraction = qgis::make_unique< Extraction >();
+  extraction->extent = extent;
+  extraction->mapBoundary = QgsGeos::asGeos( mapBoundary );
+
+  QMutexLocker locker( &mMutex );
+  mExtraction = std::move( extraction );
+}
+
+void Pal::extractLayer( Layer *layer )
+{
+  if ( !layer )
+    return;
+
+  QgsRectangle extent;
+  const GEOSGeometry *mapBoundary = nullptr;
+  {
+    QMutexLocker locker( &mMutex );
+    if ( !mExtraction || mExtraction->layers.find( layer ) != mExtraction->layers.end() )
+      return;
+
+    extent = mExtraction->extent;
+    mapBoundary = mExtraction->mapBoundary.get();
+  }
+
+  std::unique_ptr< ExtractedLayer > extracted = extractLayerCandidates( layer, extent, mapBoundary );
+
+  QMutexLocker locker( &mMutex );
+  if ( mExtraction )
+    mExtraction->layers[ layer ] = std::move( extracted );
+}
+
+std::unique_ptr< Pal::ExtractedLayer > Pal::extractLayerCandidates( Layer *layer, const QgsRectangle &extent, const GEOSGeometry *mapBoundary )
+{
+  std::unique_ptr< ExtractedLayer > extracted = qgis::make_unique< ExtractedLayer >();
+
+  // only select those who are active
+  if ( !layer->active() )
+    return extracted;
+
+  double amin[2];
+  double amax[2];
+  amin[0] = extent.xMinimum();
+  amin[1] = extent.yMinimum();
+  amax[0] = extent.xMaximum();
+  amax[1] = extent.yMaximum();
+
+  QList< FeaturePart * > parts;
+  QList< FeaturePart * > layerObstacles;
+  ObstacleCallBackCtx obstacleContext;
+  obstacleContext.obstacles = &layerObstacles;
+  obstacleContext.obstacleCount = 0;
+
+  // check for connected features with the same label text and join them
+  if ( layer->mergeConnectedLines() )
+    layer->joinConnectedFeatures();
+
+  layer->chopFeaturesAtRepeatDistance();
+
+  layer->mMutex.lock();
+
+  // find features within bounding box
+  layer->mFeatureIndex->Search( amin, amax, extractFeatCallback, static_cast< void * >( &parts ) );
+  // find obstacles within bounding box
+  layer->mObstacleIndex->Search( amin, amax, extractObstaclesCallback, static_cast< void * >( &obstacleContext ) );
+
+  layer->mMutex.unlock();
+
+  // generate the candidates list of each feature part, in parallel chunks of parts
+  QVector< QList< LabelPosition * > > partCandidates( parts.size() );
+  QVector< int > chunkStarts;
+  for ( int chunkStart = 0; chunkStart < parts.size(); chunkStart += CANDIDATES_CHUNK_SIZE )
+    chunkStarts << chunkStart;
+
+  auto generateCandidates = [this, &parts, &partCandidates, mapBoundary]( int chunkStart )
+  {
+    // prepared geometries are not thread safe, so every task uses its own
+    geos::prepared_unique_ptr mapBoundaryPrepared( GEOSPrepare_r( QgsGeos::getGEOSHandler(), mapBoundary ) );
+
+    const int chunkEnd = std::min( chunkStart + CANDIDATES_CHUNK_SIZE, parts.size() );
+    for ( int i = chunkStart; i < chunkEnd; ++i )
+    {
+      if ( isCanceled() )
+        return;
+
+      FeaturePart *part = parts.at( i );
+      part->createCandidates( partCandidates[ i ], mapBoundaryPrepared.get(), part );
+    }
+  };
+
+  if ( chunkStarts.size() > 1 )
+    QtConcurrent::blockingMap( chunkStarts, generateCandidates );
+  else if ( !chunkStarts.isEmpty() )
+    generateCandidates( 0 );
+
+  // collect the results in index order, so that they do not depend on the scheduling of the tasks
+  for ( int i = 0; i < parts.size(); ++i )
+  {
+    FeaturePart *part = parts.at( i );
+
+    // Holes of the feature are obstacles
+    for ( int j = 0; j < part->getNumSelfObstacles(); j++ )
+    {
+      extracted->obstacles.append( part->getSelfObstacle( j ) );
+    }
+
+    if ( !partCandidates.at( i ).isEmpty() )
+    {
+      // valid features are added to the features list
+      Feats *ft = new Feats();
+      ft->feature = part;
+      ft->shape = nullptr;
+      ft->lPos = partCandidates.at( i );
+      ft->priority = part->calculatePriority();
+      extracted->features.append( ft );
+    }
+  }
+  extracted->obstacles.append( layerObstacles );
+
+  extracted->obstacleCount = obstacleContext.obstacleCount;
+  return extracted;
+}
+
+std::unique_ptr<Problem> Pal::finishProblemExtraction()
 {
+  std::unique_ptr< Extraction > extraction;
+  {
+    QMutexLocker locker( &mMutex );
+    extraction = std::move( mExtraction );
+  }
+  if ( !extraction )
+    return nullptr;
+
+  const QgsRectangle &extent = extraction->extent;
+
   // to store obstacles
   RTree<FeaturePart *, double, 2, double> *obstacles = new RTree<FeaturePart *, double, 2, double>();
 
@@ -235,39 +385,22 @@ std::unique_ptr<Problem> Pal::extract( const QgsRectangle &extent, const QgsGeom
 
   LabelPosition *lp = nullptr;
 
-  bbx[0] = bbx[3] = amin[0] = prob->bbox[0] = extent.xMinimum();
-  bby[0] = bby[1] = amin[1] = prob->bbox[1] = extent.yMinimum();
-  bbx[1] = bbx[2] = amax[0] = prob->bbox[2] = extent.xMaximum();
-  bby[2] = bby[3] = amax[1] = prob->bbox[3] = extent.yMaximum();
+  bbx[0] = bbx[3] = prob->bbox[0] = extent.xMinimum();
+  bby[0] = bby[1] = prob->bbox[1] = extent.yMinimum();
+  bbx[1] = bbx[2] = prob->bbox[2] = extent.xMaximum();
+  bby[2] = bby[3] = prob->bbox[3] = extent.yMaximum();
 
   prob->pal = this;
 
   QLinkedList<Feats *> *fFeats = new QLinkedList<Feats *>;
 
-  FeatCallBackCtx context;
-
-  // prepare map boundary
-  geos::unique_ptr mapBoundaryGeos( QgsGeos::asGeos( mapBoundary ) );
-  geos::prepared_unique_ptr mapBoundaryPrepared( GEOSPrepare_r( QgsGeos::getGEOSHandler(), mapBoundaryGeos.get() ) );
-
-  context.fFeats = fFeats;
-  context.obstacles = obstacles;
-  context.candidates = prob->candidates;
-  context.mapBoundary = mapBoundaryPrepared.get();
-
-  ObstacleCallBackCtx obstacleContext;
-  obstacleContext.obstacles = obstacles;
-  obstacleContext.obstacleCount = 0;
-
-  // first step : extract features from layers
-
-  int previousFeatureCount = 0;
-  int previousObstacleCount = 0;
+  // first step : extract features from layers, and merge them into the problem. Layers are
+  // always merged in the order they were added, regardless of the order in which they were extracted
 
   QStringList layersWithFeaturesInBBox;
 
   mMutex.lock();
-  Q_FOREACH ( Layer *layer, mLayers )
+  for ( Layer *layer : qgis::as_const( mLayerOrder ) )
   {
     if ( !layer )
     {
@@ -275,34 +408,36 @@ std::unique_ptr<Problem> Pal::extract( const QgsRectangle &extent, const QgsGeom
       continue;
     }
 
-    // only select those who are active
-    if ( !layer->active() )
-      continue;
-
-    // check for connected features with the same label text and join them
-    if ( layer->mergeConnectedLines() )
-      layer->joinConnectedFeatures();
-
-    layer->chopFeaturesAtRepeatDistance();
-
-    layer->mMutex.lock();
-
-    // find features within bounding box and generate candidates list
-    context.layer = layer;
-    layer->mFeatureIndex->Search( amin, amax, extractFeatCallback, static_cast< void * >( &context ) );
-    // find obstacles within bounding box
-    layer->mObstacleIndex->Search( amin, amax, extractObstaclesCallback, static_cast< void * >( &obstacleContext ) );
+    auto extractedIt = extraction->layers.find( layer );
+    if ( extractedIt == extraction->layers.end() )
+    {
+      extractedIt = extraction->layers.insert( std::make_pair( layer, extractLayerCandidates( layer, extent, extraction->mapBoundary.get() ) ) ).first;
+    }
+    ExtractedLayer *extracted = extractedIt->second.get();
 
-    layer->mMutex.unlock();
+    for ( FeaturePart *obstacle : qgis::as_const( extracted->obstacles ) )
+    {
+      obstacle->getBoundingBox( amin, amax );
+      obstacles->Insert( amin, amax, obstacle );
+    }
 
-    if ( context.fFeats->size() - previousFeatureCount > 0 || obstacleContext.obstacleCount > previousObstacleCount )
+    if ( !extracted->features.isEmpty() || extracted->obstacleCount > 0 )
     {
       layersWithFeaturesInBBox << layer->name();
     }
-    previousFeatureCount = context.fFeats->size();
-    previousObstacleCount = obstacleContext.obstacleCount;
+
+    while ( !extracted->features.isEmpty() )
+    {
+      Feats *feat = extracted->features.takeFirst();
+      for ( LabelPosition *candidate : qgis::as_const( feat->lPos ) )
+      {
+        candidate->insertIntoIndex( prob->candidates );
+      }
+      fFeats->append( feat );
+    }
   }
   mMutex.unlock();
+  extraction.reset();
 
   prob->nbLabelledLayers = layersWithFeaturesInBBox.size();
   prob->labelledLayersName = layersWithFeaturesInBBox;
@@ -449,7 +584,8 @@ void Pal::registerCancelationCallback( Pal::FnIsCanceled fnCanceled, void *conte
 
 std::unique_ptr<Problem> Pal::extractProblem( const QgsRectangle &extent, const QgsGeometry &mapBoundary )
 {
-  return extract( extent, mapBoundary );
+  startProblemExtraction( extent, mapBoundary );
+  return finishProblemExtraction();
 }
 
 QList<LabelPosition *> Pal::solveProblem( Problem *prob, bool displayAll )
@@ -461,12 +597,7 @@ QList<LabelPosition *> Pal::solveProblem( Problem *prob, bool displayAll )
 
   try
   {
-    if ( searchMethod == FALP )
-      prob->init_sol_falp();
-    else if ( searchMethod == CHAIN )
-      prob->chain_search();
-    else
-      prob->popmusic();
+    prob->solve();
   }
   catch ( InternalException::Empty & )
   {
@@ -126,6 +126,13 @@ namespace pal
        */
       void removeLayer( Layer *layer );
 
+      /**
+       * Sorts the layers by the position of their provider in \a providers, which sets the order in
+       * which layers are merged into the problem. Layers whose provider is not listed keep the order
+       * in which they were added, after the listed ones.
+       */
+      void sortLayers( const QList< QgsAbstractLabelProvider * > &providers );
+
       typedef bool ( *FnIsCanceled )( void *ctx );
 
       //! Register a function that returns whether this job has been canceled - PAL calls it during the computation
@@ -143,6 +150,40 @@ namespace pal
        */
       std::unique_ptr< Problem > extractProblem( const QgsRectangle &extent, const QgsGeometry &mapBoundary );
 
+      /**
+       * Starts the extraction of a labeling problem for the specified map \a extent, as an alternative
+       * to extractProblem() which allows the candidates of each layer to be generated as soon as
+       * all features of that layer have been registered.
+       *
+       * The \a mapBoundary argument has the same meaning as for extractProblem().
+       *
+       * \see extractLayer()
+       * \see finishProblemExtraction()
+       * \since QGIS 3.6
+       */
+      void startProblemExtraction( const QgsRectangle &extent, const QgsGeometry &mapBoundary );
+
+      /**
+       * Generates the label candidates and collects the obstacles of a single \a layer, for the
+       * problem started by startProblemExtraction(). No more features may be registered in the
+       * layer afterwards.
+       *
+       * This method may be called from several threads at once, as long as every call is for
+       * a different layer. All calls must have returned before finishProblemExtraction() is called.
+       *
+       * \since QGIS 3.6
+       */
+      void extractLayer( Layer *layer );
+
+      /**
+       * Completes the problem started by startProblemExtraction(). Layers which were not already
+       * extracted with extractLayer() are extracted now. The resulting problem does not depend on
+       * the order in which layers were extracted.
+       *
+       * \since QGIS 3.6
+       */
+      std::unique_ptr< Problem > finishProblemExtraction();
+
       QList<LabelPosition *> solveProblem( Problem *prob, bool displayAll );
 
       /**
@@ -215,6 +256,9 @@ namespace pal
 
       QHash< QgsAbstractLabelProvider *, Layer * > mLayers;
 
+      //! Layers in the order they were added, i.e. in the order of the labeling providers
+      QList< Layer * > mLayerOrder;
+
       QMutex mMutex;
 
       /**
@@ -256,12 +300,18 @@ namespace pal
       //! Application-specific context for the cancelation check function
       void *fnIsCanceledContext = nullptr;
 
+      struct ExtractedLayer;
+      struct Extraction;
+
+      //! Problem extraction in progress, protected by mMutex
+      std::unique_ptr< Extraction > mExtraction;
+
       /**
-       * Creates a Problem, by extracting labels and generating candidates from the given \a extent.
-       * The \a mapBoundary geometry specifies the actual visible region of the map, and is used
-       * for pruning candidates which fall outside the visible region.
+       * Generates the label candidates of a \a layer within the given \a extent, and collects
+       * its obstacles. The \a mapBoundary geometry specifies the actual visible region of the map,
+       * and is used for pruning candidates which fall outside the visible region.
        */
-      std::unique_ptr< Problem > extract( const QgsRectangle &extent, const QgsGeometry &mapBoundary );
+      std::unique_ptr< ExtractedLayer > extractLayerCandidates( Layer *layer, const QgsRectangle &extent, const GEOSGeometry *mapBoundary );
 
       /**
        * \brief Choose the size of popmusic subpart's
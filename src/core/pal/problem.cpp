@@ -40,6 +40,9 @@
 #include "internalexception.h"
 #include <cfloat>
 #include <limits> //for std::numeric_limits<int>::max()
+#include <numeric>
+#include <algorithm>
+#include <QtConcurrentMap>
 
 #include "qgslabelingengine.h"
 
@@ -2214,6 +2217,208 @@ void Problem::chain_search()
   delete[] ok;
 }
 
+void Problem::solveWithSearchMethod()
+{
+  if ( pal->searchMethod == FALP )
+    init_sol_falp();
+  else if ( pal->searchMethod == CHAIN )
+    chain_search();
+  else
+    popmusic();
+}
+
+static int componentRoot( std::vector< int > &parents, int feat )
+{
+  while ( parents[feat] != feat )
+  {
+    parents[feat] = parents[parents[feat]];
+    feat = parents[feat];
+  }
+  return feat;
+}
+
+typedef struct
+{
+  LabelPosition *lp = nullptr;
+  std::vector< int > *parents = nullptr;
+} ComponentContext;
+
+bool componentCallback( LabelPosition *lp, void *ctx )
+{
+  ComponentContext *context = reinterpret_cast< ComponentContext * >( ctx );
+
+  if ( lp->isInConflict( context->lp ) )
+  {
+    int root1 = componentRoot( *context->parents, lp->getProblemFeatureId() );
+    int root2 = componentRoot( *context->parents, context->lp->getProblemFeatureId() );
+    if ( root1 != root2 )
+      ( *context->parents )[std::max( root1, root2 )] = std::min( root1, root2 );
+  }
+  return true;
+}
+
+QVector< QVector< int > > Problem::connectedComponents()
+{
+  // union-find over the features, joining features with conflicting candidates
+  std::vector< int > parents( nbft );
+  std::iota( parents.begin(), parents.end(), 0 );
+
+  ComponentContext context;
+  context.parents = &parents;
+
+  double amin[2];
+  double amax[2];
+  for ( int i = 0; i < nbft; i++ )
+  {
+    for ( int j = 0; j < featNbLp[i]; j++ )
+    {
+      LabelPosition *lp = mLabelPositions.at( featStartId[i] + j );
+
+      // overlap counts are kept up to date by reduce(), no need to search for conflicts of isolated candidates
+      if ( lp->getNumOverlaps() == 0 )
+        continue;
+
+      lp->getBoundingBox( amin, amax );
+      context.lp = lp;
+      candidates->Search( amin, amax, componentCallback, reinterpret_cast< void * >( &context ) );
+    }
+  }
+
+  QVector< QVector< int > > components;
+  std::vector< int > rootComponent( nbft, -1 );
+  for ( int i = 0; i < nbft; i++ )
+  {
+    const int root = componentRoot( parents, i );
+    if ( rootComponent[root] < 0 )
+    {
+      rootComponent[root] = components.size();
+      components.append( QVector< int >() );
+    }
+    components[rootComponent[root]].append( i );
+  }
+  return components;
+}
+
+bool Problem::solveComponent( const QVector< int > &features, double &cost )
+{
+  Problem component;
+  component.pal = pal;
+  component.displayAll = displayAll;
+  std::copy( bbox, bbox + 4, component.bbox );
+
+  component.nbft = features.size();
+  component.featStartId = new int[component.nbft];
+  component.featNbLp = new int[component.nbft];
+  component.inactiveCost = new double[component.nbft];
+
+  // candidates are renumbered within the component while it is solved. Each candidate belongs
+  // to a single component, so this does not interfere with other components solved concurrently
+  int lpId = 0;
+  for ( int i = 0; i < component.nbft; i++ )
+  {
+    const int feat = features.at( i );
+    component.featStartId[i] = lpId;
+    component.featNbLp[i] = featNbLp[feat];
+    component.inactiveCost[i] = inactiveCost[feat];
+    for ( int j = 0; j < featNbLp[feat]; j++, lpId++ )
+    {
+      LabelPosition *lp = mLabelPositions.at( featStartId[feat] + j );
+      lp->setProblemIds( i, lpId );
+      lp->insertIntoIndex( component.candidates );
+      component.mLabelPositions.append( lp );
+    }
+  }
+  component.nblp = lpId;
+  component.all_nblp = lpId;
+
+  bool solved = true;
+  try
+  {
+    component.solveWithSearchMethod();
+  }
+  catch ( InternalException::Empty & )
+  {
+    solved = false;
+  }
+
+  // copy the solution back and restore the candidate numbering of this problem
+  for ( int i = 0; i < component.nbft; i++ )
+  {
+    const int feat = features.at( i );
+    const int label = component.sol ? component.sol->s[i] : -1;
+    sol->s[feat] = label < 0 ? -1 : featStartId[feat] + label - component.featStartId[i];
+
+    for ( int j = 0; j < featNbLp[feat]; j++ )
+    {
+      mLabelPositions.at( featStartId[feat] + j )->setProblemIds( feat, featStartId[feat] + j );
+    }
+  }
+  cost = component.sol ? component.sol->cost : 0.0;
+
+  // candidates are owned by this problem, not by the component
+  component.mLabelPositions.clear();
+  return solved;
+}
+
+void Problem::solve()
+{
+  if ( nbft == 0 )
+    return;
+
+  const QVector< QVector< int > > components = connectedComponents();
+  if ( components.size() < 2 )
+  {
+    solveWithSearchMethod();
+    return;
+  }
+
+  init_sol_empty();
+  sol->cost = 0.0;
+
+  QVector< int > componentsToSolve;
+  for ( int c = 0; c < components.size(); c++ )
+  {
+    const QVector< int > &features = components.at( c );
+
+    // an isolated feature is always labeled, reduce() left it with its best candidate only
+    if ( features.size() == 1 && featNbLp[features.at( 0 )] == 1 )
+    {
+      const int feat = features.at( 0 );
+      sol->s[feat] = featStartId[feat];
+      sol->cost += mLabelPositions.at( featStartId[feat] )->cost();
+      continue;
+    }
+    componentsToSolve << c;
+  }
+
+  // start with the largest components, for a better balance between threads
+  std::stable_sort( componentsToSolve.begin(), componentsToSolve.end(), [&components]( int c1, int c2 )
+  {
+    return components.at( c1 ).size() > components.at( c2 ).size();
+  } );
+
+  QVector< double > componentCosts( components.size(), 0.0 );
+  QVector< int > componentSolved( components.size(), 1 );
+  QtConcurrent::blockingMap( componentsToSolve, [this, &components, &componentCosts, &componentSolved]( int c )
+  {
+    componentSolved[c] = solveComponent( components.at( c ), componentCosts[c] ) ? 1 : 0;
+  } );
+
+  for ( int c : qgis::as_const( componentsToSolve ) )
+  {
+    if ( !componentSolved.at( c ) )
+      throw InternalException::Empty();
+
+    sol->cost += componentCosts.at( c );
+  }
+
+  for ( int i = 0; i < nbft; i++ )
+  {
+    if ( sol->s[i] >= 0 )
+      mLabelPositions.at( sol->s[i] )->insertIntoIndex( candidates_sol );
+  }
+}
+
 bool Problem::compareLabelArea( pal::LabelPosition *l1, pal::LabelPosition *l2 )
 {
   return l1->getWidth() * l1->getHeight() > l2->getWidth() * l2->getHeight();
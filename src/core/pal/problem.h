@@ -36,6 +36,7 @@
 #include "qgis_core.h"
 #include <list>
 #include <QList>
+#include <QVector>
 #include "rtree.hpp"
 
 namespace pal
@@ -140,6 +141,17 @@ namespace pal
 
       void reduce();
 
+      /**
+       * Solves the problem, using the search method of the associated Pal instance.
+       *
+       * The conflict graph between candidates is split into its connected components first.
+       * Components are independent of each other, so isolated features are labeled directly
+       * and larger components are solved concurrently, each as a separate problem.
+       *
+       * \since QGIS 3.6
+       */
+      void solve();
+
       /**
        * \brief popmusic framework
        */
@@ -253,6 +265,22 @@ namespace pal
 
       void solution_cost();
       void check_solution();
+
+      //! Solves the problem as a whole with the search method of the associated Pal instance
+      void solveWithSearchMethod();
+
+      /**
+       * Returns the features of each connected component of the conflict graph between
+       * the candidates, listed in problem order.
+       */
+      QVector< QVector< int > > connectedComponents();
+
+      /**
+       * Solves the component made of the specified \a features as a separate problem, and
+       * stores its solution in this problem. The cost of the component solution is stored
+       * in \a cost. Returns false if the component could not be solved.
+       */
+      bool solveComponent( const QVector< int > &features, double &cost );
   };
 
 } // namespace
@@ -15,6 +15,7 @@
 #include "qgsmemoryfeatureiterator.h"
 #include "qgsmemoryprovider.h"
 
+#include "qgsfeaturebatch.h"
 #include "qgsgeometry.h"
 #include "qgsgeometryengine.h"
 #include "qgslogger.h"
@@ -91,115 +92,117 @@ bool QgsMemoryFeatureIterator::fetchFeature( QgsFeature &feature )
   if ( mClosed )
     return false;
 
-  if ( mUsingFeatureIdList )
-    return nextFeatureUsingList( feature );
-  else
-    return nextFeatureTraverseAll( feature );
-}
+  const QgsFeature *next = mUsingFeatureIdList ? nextFeatureUsingList() : nextFeatureTraverseAll();
+  if ( !next )
+  {
+    close();
+    return false;
+  }
 
+  // copy feature
+  feature = *next;
+  feature.setValid( true );
+  feature.setFields( mSource->mFields ); // allow name-based attribute lookups
+  geometryToDestinationCrs( feature, mTransform );
+  return true;
+}
 
-bool QgsMemoryFeatureIterator::nextFeatureUsingList( QgsFeature &feature )
+int QgsMemoryFeatureIterator::fetchBatch( QgsFeatureBatch &batch, int maximumSize )
 {
-  bool hasFeature = false;
+  // reprojection works on feature geometries
+  if ( mTransform.isValid() )
+    return QgsAbstractFeatureIterator::fetchBatch( batch, maximumSize );
+
+  if ( mClosed )
+    return 0;
+
+  if ( batch.fields() != mSource->mFields )
+    batch.setFields( mSource->mFields );
+  batch.reserve( maximumSize );
 
+  // values are read straight from the stored features, without copying them
+  const bool fetchGeometry = !( mRequest.flags() & QgsFeatureRequest::NoGeometry );
+  int count = 0;
+  while ( count < maximumSize )
+  {
+    const QgsFeature *next = mUsingFeatureIdList ? nextFeatureUsingList() : nextFeatureTraverseAll();
+    if ( !next )
+    {
+      close();
+      break;
+    }
+
+    batch.appendFeature( *next, fetchGeometry );
+    count++;
+  }
+  return count;
+}
+
+const QgsFeature *QgsMemoryFeatureIterator::nextFeatureUsingList()
+{
   // option 1: we have a list of features to traverse
   while ( mFeatureIdListIterator != mFeatureIdList.constEnd() )
   {
+    QgsFeatureMap::const_iterator it = mSource->mFeatures.constFind( *mFeatureIdListIterator );
+    ++mFeatureIdListIterator;
+    if ( it == mSource->mFeatures.constEnd() )
+      continue;
+
+    bool hasFeature = true;
     if ( !mFilterRect.isNull() && mRequest.flags() & QgsFeatureRequest::ExactIntersect )
     {
       // do exact check in case we're doing intersection
-      if ( mSource->mFeatures.value( *mFeatureIdListIterator ).hasGeometry() && mSelectRectEngine->intersects( mSource->mFeatures.value( *mFeatureIdListIterator ).geometry().constGet() ) )
-        hasFeature = true;
+      hasFeature = it->hasGeometry() && mSelectRectEngine->intersects( it->geometry().constGet() );
     }
-    else
-      hasFeature = true;
 
-    if ( mSubsetExpression )
+    if ( hasFeature && mSubsetExpression )
     {
-      mSource->mExpressionContext.setFeature( mSource->mFeatures.value( *mFeatureIdListIterator ) );
-      if ( !mSubsetExpression->evaluate( &mSource->mExpressionContext ).toBool() )
-        hasFeature = false;
+      mSource->mExpressionContext.setFeature( *it );
+      hasFeature = mSubsetExpression->evaluate( &mSource->mExpressionContext ).toBool();
     }
 
     if ( hasFeature )
-      break;
-
-    ++mFeatureIdListIterator;
-  }
-
-  // copy feature
-  if ( hasFeature )
-  {
-    feature = mSource->mFeatures.value( *mFeatureIdListIterator );
-    ++mFeatureIdListIterator;
-  }
-  else
-    close();
-
-  if ( hasFeature )
-  {
-    feature.setFields( mSource->mFields ); // allow name-based attribute lookups
-    geometryToDestinationCrs( feature, mTransform );
+      return &it.value();
   }
 
-  return hasFeature;
+  return nullptr;
 }
 
-
-bool QgsMemoryFeatureIterator::nextFeatureTraverseAll( QgsFeature &feature )
+const QgsFeature *QgsMemoryFeatureIterator::nextFeatureTraverseAll()
 {
-  bool hasFeature = false;
-
   // option 2: traversing the whole layer
   while ( mSelectIterator != mSource->mFeatures.constEnd() )
   {
+    QgsFeatureMap::const_iterator it = mSelectIterator++;
+
+    bool hasFeature = false;
     if ( mFilterRect.isNull() )
     {
       // selection rect empty => using all features
       hasFeature = true;
     }
+    else if ( mRequest.flags() & QgsFeatureRequest::ExactIntersect )
+    {
+      // using exact test when checking for intersection
+      hasFeature = it->hasGeometry() && mSelectRectEngine->intersects( it->geometry().constGet() );
+    }
     else
     {
-      if ( mRequest.flags() & QgsFeatureRequest::ExactIntersect )
-      {
-        // using exact test when checking for intersection
-        if ( mSelectIterator->hasGeometry() && mSelectRectEngine->intersects( mSelectIterator->geometry().constGet() ) )
-          hasFeature = true;
-      }
-      else
-      {
-        // check just bounding box against rect when not using intersection
-        if ( mSelectIterator->hasGeometry() && mSelectIterator->geometry().boundingBox().intersects( mFilterRect ) )
-          hasFeature = true;
-      }
+      // check just bounding box against rect when not using intersection
+      hasFeature = it->hasGeometry() && it->geometry().boundingBox().intersects( mFilterRect );
     }
 
-    if ( mSubsetExpression )
+    if ( hasFeature && mSubsetExpression )
     {
-      mSource->mExpressionContext.setFeature( *mSelectIterator );
-      if ( !mSubsetExpression->evaluate( &mSource->mExpressionContext ).toBool() )
-        hasFeature = false;
+      mSource->mExpressionContext.setFeature( *it );
+      hasFeature = mSubsetExpression->evaluate( &mSource->mExpressionContext ).toBool();
     }
 
     if ( hasFeature )
-      break;
-
-    ++mSelectIterator;
+      return &it.value();
   }
 
-  // copy feature
-  if ( hasFeature )
-  {
-    feature = mSelectIterator.value();
-    ++mSelectIterator;
-    feature.setValid( true );
-    feature.setFields( mSource->mFields ); // allow name-based attribute lookups
-    geometryToDestinationCrs( feature, mTransform );
-  }
-  else
-    close();
-
-  return hasFeature;
+  return nullptr;
 }
 
 bool QgsMemoryFeatureIterator::rewind()
@@ -63,10 +63,12 @@ class QgsMemoryFeatureIterator : public QgsAbstractFeatureIteratorFromSource<Qgs
   protected:
 
     bool fetchFeature( QgsFeature &feature ) override;
+    int fetchBatch( QgsFeatureBatch &batch, int maximumSize ) override;
 
   private:
-    bool nextFeatureUsingList( QgsFeature &feature );
-    bool nextFeatureTraverseAll( QgsFeature &feature );
+    //! Returns the next stored feature matching the request, or nullptr if there are no more features
+    const QgsFeature *nextFeatureUsingList();
+    const QgsFeature *nextFeatureTraverseAll();
 
     QgsGeometry mSelectRectGeom;
     std::unique_ptr< QgsGeometryEngine > mSelectRectEngine;
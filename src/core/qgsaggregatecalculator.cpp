@@ -19,6 +19,7 @@
 #include "qgsfeature.h"
 #include "qgsfeaturerequest.h"
 #include "qgsfeatureiterator.h"
+#include "qgsfeaturebatch.h"
 #include "qgsgeometry.h"
 #include "qgsvectorlayer.h"
 
@@ -644,20 +645,57 @@ QVariant QgsAggregateCalculator::calculateNumericAggregate( QgsFeatureIterator &
   Q_ASSERT( expression || attr >= 0 );
 
   QgsStatisticalSummary s( stat );
-  QgsFeature f;
 
-  while ( fit.nextFeature( f ) )
+  if ( expression )
   {
-    if ( expression )
+    Q_ASSERT( context );
+    QgsFeature f;
+    while ( fit.nextFeature( f ) )
     {
-      Q_ASSERT( context );
       context->setFeature( f );
       QVariant v = expression->evaluate( context );
       s.addVariant( v );
     }
-    else
+  }
+  else
+  {
+    // read plain field values in column batches, avoiding a QgsFeature and QVariant per value
+    QgsFeatureBatch batch;
+    while ( fit.nextBatch( batch ) )
     {
-      s.addVariant( f.attribute( attr ) );
+      const int count = batch.count();
+      if ( attr >= batch.fields().count() )
+      {
+        for ( int i = 0; i < count; ++i )
+          s.addVariant( QVariant() );
+      }
+      else if ( const double *values = batch.doubleColumn( attr ) )
+      {
+        for ( int i = 0; i < count; ++i )
+        {
+          if ( batch.isNull( i, attr ) )
+            s.addVariant( QVariant() );
+          else
+            s.addValue( values[i] );
+        }
+      }
+      else if ( const qlonglong *values = batch.integerColumn( attr ) )
+      {
+        for ( int i = 0; i < count; ++i )
+        {
+          if ( batch.isNull( i, attr ) )
+            s.addVariant( QVariant() );
+          else
+            s.addValue( static_cast< double >( values[i] ) );
+        }
+      }
+      else
+      {
+        for ( int i = 0; i < count; ++i )
+        {
+          s.addVariant( batch.value( i, attr ) );
+        }
+      }
     }
   }
   s.finalize();
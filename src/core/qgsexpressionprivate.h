@@ -24,6 +24,7 @@
 #include "qgsdistancearea.h"
 #include "qgsunittypes.h"
 #include "qgsexpressionnode.h"
+#include "qgsexpressionprogram.h"
 
 ///@cond
 
@@ -53,6 +54,7 @@ class QgsExpressionPrivate
 
     ~QgsExpressionPrivate()
     {
+      mProgram.reset();
       delete mRootNode;
     }
 
@@ -60,6 +62,9 @@ class QgsExpressionPrivate
 
     QgsExpressionNode *mRootNode = nullptr;
 
+    //! Compiled form of the prepared root node, references nodes of mRootNode so it is never copied
+    std::unique_ptr< QgsExpressionProgram > mProgram;
+
     QString mParserErrorString;
     QString mEvalErrorString;
 
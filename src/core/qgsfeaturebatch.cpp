@@ -0,0 +1,353 @@
+/***************************************************************************
+     qgsfeaturebatch.cpp
+     --------------------------------------
+    Date                 : October 2026
+    Copyright            : (C) 2026 by QGIS contributors
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsfeaturebatch.h"
+#include "qgsfeature.h"
+
+#include <algorithm>
+
+QgsFeatureBatch::QgsFeatureBatch( const QgsFields &fields )
+{
+  setFields( fields );
+}
+
+void QgsFeatureBatch::setFields( const QgsFields &fields )
+{
+  mFields = fields;
+  mColumns.clear();
+  mColumns.resize( fields.count() );
+  for ( int i = 0; i < fields.count(); ++i )
+  {
+    Column &column = mColumns[ i ];
+    column.fieldType = fields.at( i ).type();
+    switch ( column.fieldType )
+    {
+      case QVariant::Double:
+        column.type = DoubleColumn;
+        break;
+
+      case QVariant::Int:
+      case QVariant::UInt:
+      case QVariant::LongLong:
+      case QVariant::ULongLong:
+      case QVariant::Bool:
+        column.type = IntegerColumn;
+        break;
+
+      case QVariant::String:
+        column.type = StringColumn;
+        break;
+
+      default:
+        column.type = VariantColumn;
+        break;
+    }
+  }
+  clear();
+}
+
+void QgsFeatureBatch::clear()
+{
+  for ( Column &column : mColumns )
+  {
+    column.doubles.resize( 0 );
+    column.integers.resize( 0 );
+    column.strings.resize( 0 );
+    column.variants.resize( 0 );
+    column.nulls.resize( 0 );
+  }
+  mIds.resize( 0 );
+  mWkb.resize( 0 );
+  mWkbOffsets.resize( 0 );
+  mWkbSizes.resize( 0 );
+  mGeometries.resize( 0 );
+}
+
+void QgsFeatureBatch::reserve( int size )
+{
+  for ( Column &column : mColumns )
+  {
+    switch ( column.type )
+    {
+      case DoubleColumn:
+        column.doubles.reserve( size );
+        break;
+      case IntegerColumn:
+        column.integers.reserve( size );
+        break;
+      case StringColumn:
+        column.strings.reserve( size );
+        break;
+      case VariantColumn:
+        column.variants.reserve( size );
+        break;
+    }
+    column.nulls.reserve( size / 64 + 1 );
+  }
+  mIds.reserve( size );
+  mWkbOffsets.reserve( size );
+  mWkbSizes.reserve( size );
+}
+
+QgsFeatureBatch::ColumnType QgsFeatureBatch::columnType( int field ) const
+{
+  return mColumns.at( field ).type;
+}
+
+QgsGeometry QgsFeatureBatch::geometry( int row ) const
+{
+  const int size = mWkbSizes.at( row );
+  if ( size < 0 )
+    return mGeometries.at( mWkbOffsets.at( row ) );
+  if ( size == 0 )
+    return QgsGeometry();
+
+  QgsGeometry geometry;
+  geometry.fromWkb( QByteArray( mWkb.constData() + mWkbOffsets.at( row ), size ) );
+  return geometry;
+}
+
+const unsigned char *QgsFeatureBatch::geometryWkb( int row, int &size ) const
+{
+  if ( mWkbSizes.at( row ) < 0 )
+  {
+    // only serialized when needed, consumers of the geometry objects do not need WKB
+    const QByteArray wkb = mGeometries.at( mWkbOffsets.at( row ) ).asWkb();
+    mWkbOffsets[ row ] = mWkb.size();
+    mWkbSizes[ row ] = wkb.size();
+    mWkb.append( wkb );
+  }
+
+  size = mWkbSizes.at( row );
+  if ( size <= 0 )
+    return nullptr;
+
+  return reinterpret_cast< const unsigned char * >( mWkb.constData() + mWkbOffsets.at( row ) );
+}
+
+QVariant QgsFeatureBatch::value( int row, int field ) const
+{
+  const Column &column = mColumns.at( field );
+  if ( isNull( row, field ) )
+    return QVariant( column.fieldType );
+
+  switch ( column.type )
+  {
+    case DoubleColumn:
+      return column.doubles.at( row );
+
+    case IntegerColumn:
+    {
+      QVariant value( column.integers.at( row ) );
+      if ( column.fieldType != QVariant::LongLong )
+        value.convert( column.fieldType );
+      return value;
+    }
+
+    case StringColumn:
+      return column.strings.at( row );
+
+    case VariantColumn:
+      return column.variants.at( row );
+  }
+  return QVariant();
+}
+
+const double *QgsFeatureBatch::doubleColumn( int field ) const
+{
+  const Column &column = mColumns.at( field );
+  return column.type == DoubleColumn ? column.doubles.constData() : nullptr;
+}
+
+const qlonglong *QgsFeatureBatch::integerColumn( int field ) const
+{
+  const Column &column = mColumns.at( field );
+  return column.type == IntegerColumn ? column.integers.constData() : nullptr;
+}
+
+const QString *QgsFeatureBatch::stringColumn( int field ) const
+{
+  const Column &column = mColumns.at( field );
+  return column.type == StringColumn ? column.strings.constData() : nullptr;
+}
+
+QgsFeature QgsFeatureBatch::feature( int row ) const
+{
+  QgsFeature feature( mFields, mIds.at( row ) );
+  QgsAttributes attributes( mColumns.size() );
+  for ( int i = 0; i < mColumns.size(); ++i )
+  {
+    attributes[ i ] = value( row, i );
+  }
+  feature.setAttributes( attributes );
+  if ( hasGeometry( row ) )
+    feature.setGeometry( geometry( row ) );
+  feature.setValid( true );
+  return feature;
+}
+
+void QgsFeatureBatch::appendFeature( const QgsFeature &feature, bool includeGeometry )
+{
+  if ( mIds.isEmpty() && !feature.fields().isEmpty() && feature.fields() != mFields )
+  {
+    setFields( feature.fields() );
+  }
+  else if ( mIds.isEmpty() && feature.fields().isEmpty() && feature.attributes().size() > mFields.count() )
+  {
+    // the types of the attributes are unknown, so they are stored as variants
+    QgsFields fields = mFields;
+    for ( int i = fields.count(); i < feature.attributes().size(); ++i )
+      fields.append( QgsField( QString::number( i ) ) );
+    setFields( fields );
+  }
+
+  const int row = appendRow( feature.id() );
+  if ( includeGeometry && feature.hasGeometry() )
+    setGeometry( row, feature.geometry() );
+
+  const QgsAttributes attributes = feature.attributes();
+  const int attributeCount = std::min( attributes.size(), mColumns.size() );
+  for ( int i = 0; i < attributeCount; ++i )
+  {
+    const QVariant &value = attributes.at( i );
+    if ( !value.isNull() )
+      setValue( row, i, value );
+  }
+}
+
+int QgsFeatureBatch::appendRow( QgsFeatureId id )
+{
+  const int row = mIds.size();
+  mIds.append( id );
+  mWkbOffsets.append( mWkb.size() );
+  mWkbSizes.append( 0 );
+
+  const bool newNullWord = ( row & 63 ) == 0;
+  for ( Column &column : mColumns )
+  {
+    switch ( column.type )
+    {
+      case DoubleColumn:
+        column.doubles.append( 0.0 );
+        break;
+      case IntegerColumn:
+        column.integers.append( 0 );
+        break;
+      case StringColumn:
+        column.strings.append( QString() );
+        break;
+      case VariantColumn:
+        column.variants.append( QVariant() );
+        break;
+    }
+    // all values of a new row are null
+    if ( newNullWord )
+      column.nulls.append( ~Q_UINT64_C( 0 ) );
+  }
+  return row;
+}
+
+void QgsFeatureBatch::setGeometryWkb( int row, const unsigned char *wkb, int size )
+{
+  if ( !wkb || size <= 0 )
+  {
+    mWkbSizes[ row ] = 0;
+    return;
+  }
+
+  mWkbOffsets[ row ] = mWkb.size();
+  mWkbSizes[ row ] = size;
+  mWkb.append( reinterpret_cast< const char * >( wkb ), size );
+}
+
+void QgsFeatureBatch::setGeometry( int row, const QgsGeometry &geometry )
+{
+  if ( geometry.isNull() )
+  {
+    mWkbSizes[ row ] = 0;
+    return;
+  }
+
+  // geometries are implicitly shared, keeping a copy is cheaper than converting it to WKB
+  mWkbOffsets[ row ] = mGeometries.size();
+  mWkbSizes[ row ] = -1;
+  mGeometries.append( geometry );
+}
+
+void QgsFeatureBatch::setValue( int row, int field, const QVariant &value )
+{
+  Column &column = mColumns[ field ];
+  if ( value.isNull() )
+  {
+    column.nulls[ row >> 6 ] |= Q_UINT64_C( 1 ) << ( row & 63 );
+    return;
+  }
+
+  bool ok = true;
+  switch ( column.type )
+  {
+    case DoubleColumn:
+    {
+      const double v = value.toDouble( &ok );
+      if ( ok )
+        column.doubles[ row ] = v;
+      break;
+    }
+
+    case IntegerColumn:
+    {
+      const qlonglong v = value.type() == QVariant::Bool ? static_cast< qlonglong >( value.toBool() ) : value.toLongLong( &ok );
+      if ( ok )
+        column.integers[ row ] = v;
+      break;
+    }
+
+    case StringColumn:
+      column.strings[ row ] = value.toString();
+      break;
+
+    case VariantColumn:
+      column.variants[ row ] = value;
+      break;
+  }
+
+  if ( ok )
+    setNotNull( column, row );
+  else
+    column.nulls[ row >> 6 ] |= Q_UINT64_C( 1 ) << ( row & 63 );
+}
+
+void QgsFeatureBatch::setDouble( int row, int field, double value )
+{
+  Column &column = mColumns[ field ];
+  Q_ASSERT( column.type == DoubleColumn );
+  column.doubles[ row ] = value;
+  setNotNull( column, row );
+}
+
+void QgsFeatureBatch::setInteger( int row, int field, qlonglong value )
+{
+  Column &column = mColumns[ field ];
+  Q_ASSERT( column.type == IntegerColumn );
+  column.integers[ row ] = value;
+  setNotNull( column, row );
+}
+
+void QgsFeatureBatch::setString( int row, int field, const QString &value )
+{
+  Column &column = mColumns[ field ];
+  Q_ASSERT( column.type == StringColumn );
+  column.strings[ row ] = value;
+  setNotNull( column, row );
+}
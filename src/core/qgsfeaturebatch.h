@@ -0,0 +1,269 @@
+/***************************************************************************
+     qgsfeaturebatch.h
+     --------------------------------------
+    Date                 : October 2026
+    Copyright            : (C) 2026 by QGIS contributors
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSFEATUREBATCH_H
+#define QGSFEATUREBATCH_H
+
+#include "qgis_core.h"
+#include "qgis_sip.h"
+#include "qgsfeatureid.h"
+#include "qgsfields.h"
+#include "qgsgeometry.h"
+
+#include <QByteArray>
+#include <QVariant>
+#include <QVector>
+
+class QgsFeature;
+
+/**
+ * \ingroup core
+ * \class QgsFeatureBatch
+ * \brief A column oriented block of features, as returned by QgsFeatureIterator::nextBatch().
+ *
+ * Instead of one QgsFeature object per feature, the batch stores the values of each field in
+ * a single typed array, together with a bitmap of null values. Numeric fields are stored as
+ * arrays of doubles or 64 bit integers, strings as an array of QString, and all other field
+ * types as QVariant values. Geometries read as WKB are packed into a single buffer. Geometries
+ * set from QgsGeometry objects are kept as shared copies, and only converted to WKB when their
+ * WKB is requested.
+ *
+ * This allows consumers such as aggregates and statistics to process many features without
+ * building a QgsFeature, a QVariant per attribute or a geometry object for each of them.
+ *
+ * Rows are appended with appendRow() or appendFeature(), the values of a row are then set
+ * with the setValue() overloads. All values of a new row are null.
+ *
+ * \since QGIS 3.6
+ */
+class CORE_EXPORT QgsFeatureBatch
+{
+  public:
+
+    //! Storage type of a column
+    enum ColumnType
+    {
+      DoubleColumn, //!< Values are stored as doubles
+      IntegerColumn, //!< Values are stored as 64 bit integers
+      StringColumn, //!< Values are stored as strings
+      VariantColumn, //!< Values are stored as QVariant
+    };
+
+    /**
+     * Constructor for QgsFeatureBatch with the specified \a fields.
+     */
+    explicit QgsFeatureBatch( const QgsFields &fields = QgsFields() );
+
+    /**
+     * Returns the fields of the batch, one column per field.
+     * \see setFields()
+     */
+    QgsFields fields() const { return mFields; }
+
+    /**
+     * Sets the \a fields of the batch. This clears all rows.
+     * \see fields()
+     */
+    void setFields( const QgsFields &fields );
+
+    /**
+     * Returns the number of features in the batch.
+     */
+    int count() const { return mIds.size(); }
+
+    /**
+     * Returns true if the batch does not contain any features.
+     */
+    bool isEmpty() const { return mIds.isEmpty(); }
+
+    /**
+     * Removes all features from the batch, keeping the fields and the allocated memory.
+     */
+    void clear();
+
+    /**
+     * Reserves memory for \a size features.
+     */
+    void reserve( int size );
+
+    /**
+     * Returns the storage type used for the column of the field with index \a field.
+     */
+    ColumnType columnType( int field ) const;
+
+    /**
+     * Returns the id of the feature at \a row.
+     */
+    QgsFeatureId id( int row ) const { return mIds.at( row ); }
+
+    /**
+     * Returns true if the feature at \a row has a geometry.
+     */
+    bool hasGeometry( int row ) const { return mWkbSizes.at( row ) != 0; }
+
+    /**
+     * Returns the geometry of the feature at \a row, or a null geometry if the feature
+     * has no geometry.
+     */
+    QgsGeometry geometry( int row ) const;
+
+    /**
+     * Returns the WKB of the geometry of the feature at \a row, or nullptr if the feature
+     * has no geometry. The size of the WKB is stored in \a size.
+     *
+     * If the geometry was set from a QgsGeometry object, it is converted to WKB by the first call.
+     * \note not available in Python bindings
+     */
+    const unsigned char *geometryWkb( int row, int &size ) const SIP_SKIP;
+
+    /**
+     * Returns true if the value of the field with index \a field is null at \a row.
+     */
+    bool isNull( int row, int field ) const
+    {
+      return mColumns.at( field ).nulls.at( row >> 6 ) & ( Q_UINT64_C( 1 ) << ( row & 63 ) );
+    }
+
+    /**
+     * Returns the value of the field with index \a field at \a row, converted to the type
+     * of the field.
+     */
+    QVariant value( int row, int field ) const;
+
+    /**
+     * Returns the values of the field with index \a field, or nullptr if the field is not
+     * stored in a DoubleColumn. Values of null rows are 0.
+     * \note not available in Python bindings
+     */
+    const double *doubleColumn( int field ) const SIP_SKIP;
+
+    /**
+     * Returns the values of the field with index \a field, or nullptr if the field is not
+     * stored in an IntegerColumn. Values of null rows are 0.
+     * \note not available in Python bindings
+     */
+    const qlonglong *integerColumn( int field ) const SIP_SKIP;
+
+    /**
+     * Returns the values of the field with index \a field, or nullptr if the field is not
+     * stored in a StringColumn. Values of null rows are null strings.
+     * \note not available in Python bindings
+     */
+    const QString *stringColumn( int field ) const SIP_SKIP;
+
+    /**
+     * Returns the feature at \a row as a QgsFeature.
+     */
+    QgsFeature feature( int row ) const;
+
+    /**
+     * Appends a \a feature to the batch. Attributes without a matching column are ignored.
+     * If \a includeGeometry is false, the geometry of the feature is not stored.
+     *
+     * If the batch is empty, its fields are replaced by the fields of the feature. If the
+     * feature has no fields, a VariantColumn is added for each attribute beyond the existing
+     * fields, so that no attribute is dropped.
+     */
+    void appendFeature( const QgsFeature &feature, bool includeGeometry = true );
+
+    /**
+     * Appends a new row for the feature with the specified \a id, and returns its index.
+     * All values of the row are null and it has no geometry.
+     */
+    int appendRow( QgsFeatureId id );
+
+    /**
+     * Sets the \a id of the feature at \a row.
+     */
+    void setId( int row, QgsFeatureId id ) { mIds[ row ] = id; }
+
+    /**
+     * Sets the geometry of the feature at \a row, as \a size bytes of WKB.
+     * \note not available in Python bindings
+     */
+    void setGeometryWkb( int row, const unsigned char *wkb, int size ) SIP_SKIP;
+
+    /**
+     * Sets the geometry of the feature at \a row. The geometry is not converted to WKB
+     * until geometryWkb() is called for the row.
+     */
+    void setGeometry( int row, const QgsGeometry &geometry );
+
+    /**
+     * Sets the \a value of the field with index \a field at \a row. The value is converted
+     * to the storage type of the column, values which cannot be converted are stored as null.
+     */
+    void setValue( int row, int field, const QVariant &value );
+
+    /**
+     * Sets the \a value of the field with index \a field at \a row, for a DoubleColumn.
+     * \note not available in Python bindings
+     */
+    void setDouble( int row, int field, double value ) SIP_SKIP;
+
+    /**
+     * Sets the \a value of the field with index \a field at \a row, for an IntegerColumn.
+     * \note not available in Python bindings
+     */
+    void setInteger( int row, int field, qlonglong value ) SIP_SKIP;
+
+    /**
+     * Sets the \a value of the field with index \a field at \a row, for a StringColumn.
+     * \note not available in Python bindings
+     */
+    void setString( int row, int field, const QString &value ) SIP_SKIP;
+
+#ifdef SIP_RUN
+
+    /**
+     * Returns the number of features in the batch.
+     */
+    int __len__() const;
+    % MethodCode
+    sipRes = sipCpp->count();
+    % End
+#endif
+
+  private:
+
+    struct Column
+    {
+      ColumnType type = VariantColumn;
+      QVariant::Type fieldType = QVariant::Invalid;
+      QVector< double > doubles;
+      QVector< qlonglong > integers;
+      QVector< QString > strings;
+      QVector< QVariant > variants;
+      //! One bit per row, set if the value is null
+      QVector< quint64 > nulls;
+    };
+
+    void setNotNull( Column &column, int row )
+    {
+      column.nulls[ row >> 6 ] &= ~( Q_UINT64_C( 1 ) << ( row & 63 ) );
+    }
+
+    QgsFields mFields;
+    QVector< Column > mColumns;
+    QVector< QgsFeatureId > mIds;
+
+    // Geometries of the rows. A positive size is the size of the WKB at the offset in mWkb.
+    // A negative size means that the geometry is the one at the offset in mGeometries, which
+    // is converted to WKB when the WKB is requested.
+    mutable QByteArray mWkb;
+    mutable QVector< int > mWkbOffsets;
+    mutable QVector< int > mWkbSizes;
+    QVector< QgsGeometry > mGeometries;
+};
+
+#endif // QGSFEATUREBATCH_H
@@ -13,12 +13,15 @@
  *                                                                         *
  ***************************************************************************/
 #include "qgsfeatureiterator.h"
+#include "qgsfeaturebatch.h"
 #include "qgslogger.h"
 
 #include "qgssimplifymethod.h"
 #include "qgsexception.h"
 #include "qgsexpressionsorter.h"
 
+#include <algorithm>
+
 QgsAbstractFeatureIterator::QgsAbstractFeatureIterator( const QgsFeatureRequest &request )
   : mRequest( request )
 {
@@ -71,6 +74,49 @@ bool QgsAbstractFeatureIterator::nextFeature( QgsFeature &f )
   return dataOk;
 }
 
+bool QgsAbstractFeatureIterator::nextBatch( QgsFeatureBatch &batch, int maximumSize )
+{
+  batch.clear();
+
+  if ( mRequest.limit() >= 0 )
+    maximumSize = static_cast< int >( std::min< long >( maximumSize, mRequest.limit() - mFetchedCount ) );
+  if ( maximumSize <= 0 )
+    return false;
+
+  int count = 0;
+  if ( mUseCachedFeatures || mRequest.filterType() == QgsFeatureRequest::FilterExpression || mRequest.filterType() == QgsFeatureRequest::FilterFids )
+  {
+    // ordered and filtered requests need the features
+    const bool fetchGeometry = !( mRequest.flags() & QgsFeatureRequest::NoGeometry );
+    QgsFeature f;
+    while ( count < maximumSize && nextFeature( f ) )
+    {
+      batch.appendFeature( f, fetchGeometry );
+      count++;
+    }
+  }
+  else
+  {
+    count = fetchBatch( batch, maximumSize );
+    mFetchedCount += count;
+  }
+
+  return count > 0;
+}
+
+int QgsAbstractFeatureIterator::fetchBatch( QgsFeatureBatch &batch, int maximumSize )
+{
+  const bool fetchGeometry = !( mRequest.flags() & QgsFeatureRequest::NoGeometry );
+  QgsFeature f;
+  int count = 0;
+  while ( count < maximumSize && fetchFeature( f ) )
+  {
+    batch.appendFeature( f, fetchGeometry );
+    count++;
+  }
+  return count;
+}
+
 bool QgsAbstractFeatureIterator::nextFeatureFilterExpression( QgsFeature &f )
 {
   while ( fetchFeature( f ) )
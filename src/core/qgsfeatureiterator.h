@@ -20,6 +20,7 @@
 #include "qgsindexedfeature.h"
 
 class QgsFeedback;
+class QgsFeatureBatch;
 
 /**
  * \ingroup core
@@ -46,6 +47,16 @@ class CORE_EXPORT QgsAbstractFeatureIterator
     //! fetch next feature, return true on success
     virtual bool nextFeature( QgsFeature &f );
 
+    /**
+     * Fetches the next block of up to \a maximumSize features into \a batch, replacing its
+     * previous contents. The fields of the batch are set by the iterator.
+     *
+     * Returns false if no more features are available.
+     * \see fetchBatch()
+     * \since QGIS 3.6
+     */
+    virtual bool nextBatch( QgsFeatureBatch &batch, int maximumSize );
+
     //! reset the iterator to the starting position
     virtual bool rewind() = 0;
     //! end of iterating: free the resources / lock
@@ -102,6 +113,19 @@ class CORE_EXPORT QgsAbstractFeatureIterator
      */
     virtual bool fetchFeature( QgsFeature &f ) = 0;
 
+    /**
+     * Appends up to \a maximumSize of the next features to \a batch, and returns the number of
+     * appended features. A return value of 0 means there are no more features.
+     *
+     * This is only called for requests without filter expression or feature id list. The default
+     * implementation appends the features returned by fetchFeature(). Iterators can override it
+     * to fill the batch columns directly, without creating a QgsFeature for every feature.
+     *
+     * \see nextBatch()
+     * \since QGIS 3.6
+     */
+    virtual int fetchBatch( QgsFeatureBatch &batch, int maximumSize );
+
     /**
      * By default, the iterator will fetch all features and check if the feature
      * matches the expression.
@@ -298,6 +322,20 @@ class CORE_EXPORT QgsFeatureIterator
     QgsFeatureIterator &operator=( const QgsFeatureIterator &other );
 
     bool nextFeature( QgsFeature &f );
+
+    /**
+     * Fetches the next block of up to \a maximumSize features into \a batch, replacing its
+     * previous contents.
+     *
+     * Iterating in batches avoids creating a QgsFeature for every feature with data providers
+     * which support it, and is considerably faster when only a few attributes of many features
+     * are needed.
+     *
+     * Returns false if no more features are available.
+     * \since QGIS 3.6
+     */
+    bool nextBatch( QgsFeatureBatch &batch, int maximumSize = 1024 );
+
     bool rewind();
     bool close();
 
@@ -375,6 +413,11 @@ inline bool QgsFeatureIterator::nextFeature( QgsFeature &f )
   return mIter ? mIter->nextFeature( f ) : false;
 }
 
+inline bool QgsFeatureIterator::nextBatch( QgsFeatureBatch &batch, int maximumSize )
+{
+  return mIter ? mIter->nextBatch( batch, maximumSize ) : false;
+}
+
 inline bool QgsFeatureIterator::rewind()
 {
   if ( mIter )
@@ -24,16 +24,20 @@
 #include "qgsogrutils.h"
 #include "qgsapplication.h"
 #include <QBuffer>
+#include <QFuture>
 #include <QList>
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QProgressDialog>
 #include <QSet>
 #include <QSettings>
+#include <QThreadPool>
 #include <QUrl>
+#include <QtConcurrentRun>
 
 #include "ogr_api.h"
 
+#include <deque>
 #include <limits>
 
 static const char NS_SEPARATOR = '?';
@@ -342,6 +346,7 @@ QgsGmlStreamingParser::QgsGmlStreamingParser( const QList<LayerProperties> &laye
     AxisOrientationLogic axisOrientationLogic,
     bool invertAxisOrientation )
   : mLayerProperties( layerProperties )
+  , mMapFieldNameToSrcLayerNameFieldName( mapFieldNameToSrcLayerNameFieldName )
   , mTypeNameUTF8Len( 0 )
   , mWkbType( QgsWkbTypes::Unknown )
   , mGeometryAttributeUTF8Len( 0 )
@@ -418,6 +423,63 @@ QgsGmlStreamingParser::QgsGmlStreamingParser( const QList<LayerProperties> &laye
 }
 
 
+///@cond PRIVATE
+
+//! Features and document state resulting from the parsing of a chunk of feature members
+struct QgsGmlStreamingParser::ParsedChunk
+{
+  QVector<QgsGmlFeaturePtrGmlIdPair> features;
+  QgsWkbTypes::Type wkbType = QgsWkbTypes::Unknown;
+  int epsg = 0;
+  QString srsName;
+  bool invertAxisOrientation = false;
+  bool ok = true;
+  QString errorMsg;
+};
+
+struct QgsGmlStreamingParser::ParallelParsing
+{
+  //! Chunk being parsed, or features already available, in document order
+  struct Entry
+  {
+    QFuture< ParsedChunk > future;
+    bool running = false;
+    ParsedChunk result;
+  };
+
+  QThreadPool threadPool;
+  //! False if the encoding of the document does not allow to split it, in which case the main parser does all the work
+  bool splitting = true;
+  bool started = false;
+  //! Data not scanned yet, starting at an incomplete token
+  QByteArray buffer;
+  int depth = 0;
+  bool rootFound = false;
+  //! Start of the document, up to the end of the root element start tag
+  QByteArray prologue;
+  QByteArray rootEndTag;
+  //! Depth of the children of the gml:featureMembers element being scanned, or 0
+  int containerDepth = 0;
+  QByteArray containerStartTag;
+  QByteArray containerEndTag;
+  //! Depth of the parent of the feature member being scanned, or 0
+  int memberDepth = 0;
+  QByteArray member;
+  //! Data to pass to the main parser
+  QByteArray mainData;
+  //! Feature members to parse in a thread
+  QByteArray chunk;
+  //! Size of the feature members parsed by the main parser, before the srs is known
+  int sequentialSize = 0;
+  std::deque< Entry > entries;
+  QgsFeatureId nextFeatureId = 0;
+};
+
+///@endcond
+
+//! Size of the chunks of feature members parsed by each thread
+static const int PARALLEL_CHUNK_SIZE = 1024 * 1024;
+
 QgsGmlStreamingParser::~QgsGmlStreamingParser()
 {
   XML_ParserFree( mParser );
@@ -429,6 +491,30 @@ QgsGmlStreamingParser::~QgsGmlStreamingParser()
   }
 
   delete mCurrentFeature;
+
+  if ( mParallel )
+  {
+    for ( ParallelParsing::Entry &entry : mParallel->entries )
+    {
+      if ( entry.running )
+        entry.result = entry.future.result();
+      for ( const QgsGmlFeaturePtrGmlIdPair &featPair : qgis::as_const( entry.result.features ) )
+        delete featPair.first;
+    }
+  }
+}
+
+void QgsGmlStreamingParser::setMaximumThreads( int threads )
+{
+  if ( threads > 1 )
+  {
+    mParallel.reset( new ParallelParsing() );
+    mParallel->threadPool.setMaxThreadCount( threads );
+  }
+  else
+  {
+    mParallel.reset();
+  }
 }
 
 bool QgsGmlStreamingParser::processData( const QByteArray &data, bool atEnd )
@@ -444,7 +530,15 @@ bool QgsGmlStreamingParser::processData( const QByteArray &data, bool atEnd )
 
 bool QgsGmlStreamingParser::processData( const QByteArray &data, bool atEnd, QString &errorMsg )
 {
-  if ( XML_Parse( mParser, data.data(), data.size(), atEnd ) == 0 )
+  if ( mParallel )
+    return processDataInParallel( data, atEnd, errorMsg );
+
+  return parseXml( data.constData(), data.size(), atEnd, errorMsg );
+}
+
+bool QgsGmlStreamingParser::parseXml( const char *data, int size, bool atEnd, QString &errorMsg )
+{
+  if ( XML_Parse( mParser, data, size, atEnd ) == 0 )
   {
     XML_Error errorCode = XML_GetErrorCode( mParser );
     errorMsg = QObject::tr( "Error: %1 on line %2, column %3" )
@@ -460,11 +554,422 @@ bool QgsGmlStreamingParser::processData( const QByteArray &data, bool atEnd, QSt
 
 QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> QgsGmlStreamingParser::getAndStealReadyFeatures()
 {
+  if ( mParallel )
+  {
+    // errors are reported by processData()
+    QString errorMsg;
+    collectParsedChunks( errorMsg );
+  }
+
   QVector<QgsGmlFeaturePtrGmlIdPair> ret = mFeatureList;
   mFeatureList.clear();
   return ret;
 }
 
+// Returns the position following the markup starting at pos, or -1 if the markup is incomplete
+static int markupEnd( const QByteArray &buffer, int pos )
+{
+  const char *data = buffer.constData();
+  const int size = buffer.size();
+  if ( pos + 1 >= size )
+    return -1;
+
+  int end = -1;
+  if ( data[pos + 1] == '?' )
+  {
+    end = buffer.indexOf( "?>", pos + 2 );
+    return end < 0 ? -1 : end + 2;
+  }
+  if ( data[pos + 1] == '!' )
+  {
+    if ( size - pos < 9 )
+      return -1;
+    if ( memcmp( data + pos, "<!--", 4 ) == 0 )
+    {
+      end = buffer.indexOf( "-->", pos + 4 );
+      return end < 0 ? -1 : end + 3;
+    }
+    if ( memcmp( data + pos, "<![CDATA[", 9 ) == 0 )
+    {
+      end = buffer.indexOf( "]]>", pos + 9 );
+      return end < 0 ? -1 : end + 3;
+    }
+  }
+
+  // tags and DOCTYPE declarations, where '>' may appear in quoted values or in the internal subset
+  char quote = 0;
+  int brackets = 0;
+  for ( int i = pos + 1; i < size; ++i )
+  {
+    const char c = data[i];
+    if ( quote )
+    {
+      if ( c == quote )
+        quote = 0;
+    }
+    else if ( c == '"' || c == '\'' )
+      quote = c;
+    else if ( c == '[' )
+      ++brackets;
+    else if ( c == ']' )
+      --brackets;
+    else if ( c == '>' && brackets <= 0 )
+      return i + 1;
+  }
+  return -1;
+}
+
+// Returns the qualified name of the element of the tag starting at pos
+static QByteArray tagName( const QByteArray &buffer, int pos, int end )
+{
+  const char *data = buffer.constData();
+  int start = pos + ( data[pos + 1] == '/' ? 2 : 1 );
+  int nameEnd = start;
+  while ( nameEnd < end && !strchr( " \t\r\n/>", data[nameEnd] ) )
+    ++nameEnd;
+  return buffer.mid( start, nameEnd - start );
+}
+
+static QByteArray localName( const QByteArray &qualifiedName )
+{
+  const int index = qualifiedName.indexOf( ':' );
+  return index < 0 ? qualifiedName : qualifiedName.mid( index + 1 );
+}
+
+bool QgsGmlStreamingParser::processDataInParallel( const QByteArray &data, bool atEnd, QString &errorMsg )
+{
+  ParallelParsing &p = *mParallel;
+  if ( !p.started && !data.isEmpty() )
+  {
+    p.started = true;
+    // the document is scanned as bytes, which does not work with UTF-16
+    if ( data.size() >= 2 && ( data[0] == '\0' || data[1] == '\0' ||
+                               ( static_cast<uchar>( data[0] ) == 0xFE && static_cast<uchar>( data[1] ) == 0xFF ) ||
+                               ( static_cast<uchar>( data[0] ) == 0xFF && static_cast<uchar>( data[1] ) == 0xFE ) ) )
+    {
+      p.splitting = false;
+    }
+  }
+
+  if ( p.splitting )
+  {
+    p.buffer.append( data );
+    if ( !splitData( errorMsg ) )
+      return false;
+    if ( atEnd )
+    {
+      if ( !p.chunk.isEmpty() && !dispatchChunk( errorMsg ) )
+        return false;
+      // incomplete markup or member, let the main parser report the error
+      p.mainData.append( p.member );
+      p.mainData.append( p.buffer );
+      p.member.clear();
+      p.buffer.clear();
+    }
+  }
+  else
+  {
+    p.mainData.append( data );
+  }
+
+  if ( !feedMainParser( atEnd, errorMsg ) )
+    return false;
+
+  if ( atEnd )
+  {
+    for ( ParallelParsing::Entry &entry : p.entries )
+    {
+      if ( entry.running )
+        entry.future.waitForFinished();
+    }
+  }
+
+  return collectParsedChunks( errorMsg );
+}
+
+bool QgsGmlStreamingParser::splitData( QString &errorMsg )
+{
+  ParallelParsing &p = *mParallel;
+  const QByteArray &buffer = p.buffer;
+  const char *data = buffer.constData();
+  const int size = buffer.size();
+  int pos = 0;
+  // start of the data not yet copied to the main parser data or to the current member
+  int runStart = 0;
+
+  auto appendToMain = [&p, data]( int start, int end )
+  {
+    p.mainData.append( data + start, end - start );
+    if ( !p.rootFound )
+      p.prologue.append( data + start, end - start );
+  };
+
+  while ( pos < size )
+  {
+    if ( data[pos] != '<' )
+    {
+      const char *next = static_cast<const char *>( memchr( data + pos, '<', size - pos ) );
+      pos = next ? next - data : size;
+      continue;
+    }
+
+    const int end = markupEnd( buffer, pos );
+    if ( end < 0 )
+      break;
+
+    const char type = data[pos + 1];
+    if ( type == '?' || type == '!' )
+    {
+      pos = end;
+      continue;
+    }
+
+    if ( type == '/' )
+    {
+      p.depth--;
+      if ( p.memberDepth > 0 )
+      {
+        if ( p.depth == p.memberDepth )
+        {
+          p.member.append( data + runStart, end - runStart );
+          runStart = end;
+          if ( !endMember( errorMsg ) )
+            return false;
+        }
+      }
+      else
+      {
+        if ( !p.chunk.isEmpty() )
+        {
+          appendToMain( runStart, pos );
+          runStart = pos;
+          if ( !dispatchChunk( errorMsg ) )
+            return false;
+        }
+        if ( p.containerDepth > 0 && p.depth == 1 )
+        {
+          p.containerDepth = 0;
+          p.containerStartTag.clear();
+          p.containerEndTag.clear();
+        }
+      }
+      pos = end;
+      continue;
+    }
+
+    const bool emptyElement = data[end - 2] == '/';
+    if ( !p.rootFound )
+    {
+      appendToMain( runStart, end );
+      runStart = end;
+      p.rootFound = true;
+      p.rootEndTag = "</" + tagName( buffer, pos, end ) + '>';
+    }
+    else if ( p.memberDepth > 0 )
+    {
+      // inside a feature member
+    }
+    else if ( p.depth > 0 && ( ( p.containerDepth > 0 && p.depth == p.containerDepth ) ||
+                               ( p.depth == 1 && p.containerDepth == 0 &&
+                                 ( localName( tagName( buffer, pos, end ) ) == "featureMember" ||
+                                   localName( tagName( buffer, pos, end ) ) == "member" ) ) ) )
+    {
+      appendToMain( runStart, pos );
+      runStart = pos;
+      if ( emptyElement )
+      {
+        p.member.append( data + pos, end - pos );
+        runStart = end;
+        if ( !endMember( errorMsg ) )
+          return false;
+      }
+      else
+      {
+        p.memberDepth = p.depth;
+      }
+    }
+    else
+    {
+      if ( !p.chunk.isEmpty() )
+      {
+        appendToMain( runStart, pos );
+        runStart = pos;
+        if ( !dispatchChunk( errorMsg ) )
+          return false;
+      }
+      if ( p.depth == 1 && !emptyElement && localName( tagName( buffer, pos, end ) ) == "featureMembers" )
+      {
+        p.containerDepth = 2;
+        p.containerStartTag = buffer.mid( pos, end - pos );
+        p.containerEndTag = "</" + tagName( buffer, pos, end ) + '>';
+      }
+    }
+
+    if ( !emptyElement )
+      p.depth++;
+    pos = end;
+  }
+
+  if ( p.memberDepth > 0 )
+    p.member.append( data + runStart, pos - runStart );
+  else
+    appendToMain( runStart, pos );
+  p.buffer.remove( 0, pos );
+  return true;
+}
+
+bool QgsGmlStreamingParser::endMember( QString &errorMsg )
+{
+  ParallelParsing &p = *mParallel;
+  p.memberDepth = 0;
+
+  // Until the srs of the features is known, members are parsed by the main parser,
+  // so that threads do not need to read it again
+  if ( mEpsg == 0 && p.sequentialSize < PARALLEL_CHUNK_SIZE && p.chunk.isEmpty() )
+  {
+    p.sequentialSize += p.member.size();
+    p.mainData.append( p.member );
+    p.member.clear();
+    return feedMainParser( false, errorMsg );
+  }
+
+  p.chunk.append( p.member );
+  p.member.clear();
+  if ( p.chunk.size() >= PARALLEL_CHUNK_SIZE )
+    return dispatchChunk( errorMsg );
+  return true;
+}
+
+bool QgsGmlStreamingParser::feedMainParser( bool atEnd, QString &errorMsg )
+{
+  ParallelParsing &p = *mParallel;
+  if ( p.mainData.isEmpty() && !atEnd )
+    return true;
+
+  const bool ok = parseXml( p.mainData.constData(), p.mainData.size(), atEnd, errorMsg );
+  p.mainData.clear();
+
+  // queue the features found by the main parser after the chunks dispatched before them
+  if ( !mFeatureList.isEmpty() )
+  {
+    ParallelParsing::Entry entry;
+    entry.result.features = mFeatureList;
+    mFeatureList.clear();
+    p.entries.push_back( entry );
+  }
+  return ok;
+}
+
+bool QgsGmlStreamingParser::dispatchChunk( QString &errorMsg )
+{
+  ParallelParsing &p = *mParallel;
+
+  // the main parser must be up to date to have the srs of the features
+  if ( !feedMainParser( false, errorMsg ) )
+    return false;
+
+  QByteArray document;
+  document.reserve( p.prologue.size() + p.containerStartTag.size() + p.chunk.size() + p.containerEndTag.size() + p.rootEndTag.size() );
+  document.append( p.prologue );
+  document.append( p.containerStartTag );
+  document.append( p.chunk );
+  document.append( p.containerEndTag );
+  document.append( p.rootEndTag );
+  p.chunk.clear();
+
+  ParallelParsing::Entry entry;
+  entry.running = true;
+  entry.future = QtConcurrent::run( &p.threadPool, &QgsGmlStreamingParser::parseChunk, createChunkParser().release(), document );
+  p.entries.push_back( entry );
+
+  // do not get too far ahead of the parsing threads, to bound memory use
+  int running = 0;
+  ParallelParsing::Entry *oldestRunning = nullptr;
+  for ( ParallelParsing::Entry &runningEntry : p.entries )
+  {
+    if ( runningEntry.running && !runningEntry.future.isFinished() )
+    {
+      if ( !oldestRunning )
+        oldestRunning = &runningEntry;
+      running++;
+    }
+  }
+  if ( running > 2 * p.threadPool.maxThreadCount() )
+    oldestRunning->future.waitForFinished();
+  return true;
+}
+
+bool QgsGmlStreamingParser::collectParsedChunks( QString &errorMsg )
+{
+  ParallelParsing &p = *mParallel;
+  while ( !p.entries.empty() )
+  {
+    ParallelParsing::Entry &entry = p.entries.front();
+    if ( entry.running )
+    {
+      if ( !entry.future.isFinished() )
+        break;
+      entry.result = entry.future.result();
+      entry.future = QFuture< ParsedChunk >();
+      entry.running = false;
+    }
+
+    const ParsedChunk &chunk = entry.result;
+    if ( !chunk.ok )
+    {
+      errorMsg = chunk.errorMsg;
+      return false;
+    }
+
+    if ( mEpsg == 0 && chunk.epsg != 0 )
+    {
+      mEpsg = chunk.epsg;
+      mSrsName = chunk.srsName;
+      mInvertAxisOrientation = chunk.invertAxisOrientation;
+    }
+    //keep multitype in case of geometry type mix
+    if ( chunk.wkbType != QgsWkbTypes::Unknown && QgsWkbTypes::multiType( chunk.wkbType ) != mWkbType )
+      mWkbType = chunk.wkbType;
+
+    for ( const QgsGmlFeaturePtrGmlIdPair &featPair : chunk.features )
+    {
+      featPair.first->setId( p.nextFeatureId++ );
+      mFeatureList.append( featPair );
+    }
+    p.entries.pop_front();
+  }
+  return true;
+}
+
+std::unique_ptr< QgsGmlStreamingParser > QgsGmlStreamingParser::createChunkParser() const
+{
+  std::unique_ptr< QgsGmlStreamingParser > parser;
+  if ( mLayerProperties.isEmpty() )
+    parser.reset( new QgsGmlStreamingParser( mTypeName, mGeometryAttribute, mFields, mAxisOrientationLogic, mInvertAxisOrientationRequest ) );
+  else
+    parser.reset( new QgsGmlStreamingParser( mLayerProperties, mFields, mMapFieldNameToSrcLayerNameFieldName, mAxisOrientationLogic, mInvertAxisOrientationRequest ) );
+
+  parser->mEpsg = mEpsg;
+  parser->mSrsName = mSrsName;
+  parser->mInvertAxisOrientation = mInvertAxisOrientation;
+  parser->mGMLNameSpaceURI = mGMLNameSpaceURI;
+  parser->mGMLNameSpaceURIPtr = mGMLNameSpaceURIPtr;
+  return parser;
+}
+
+QgsGmlStreamingParser::ParsedChunk QgsGmlStreamingParser::parseChunk( QgsGmlStreamingParser *parser, const QByteArray &document )
+{
+  std::unique_ptr< QgsGmlStreamingParser > chunkParser( parser );
+  ParsedChunk chunk;
+  chunk.ok = chunkParser->processData( document, true, chunk.errorMsg );
+  chunk.features = chunkParser->getAndStealReadyFeatures();
+  chunk.wkbType = chunkParser->mWkbType;
+  chunk.epsg = chunkParser->mEpsg;
+  chunk.srsName = chunkParser->mSrsName;
+  chunk.invertAxisOrientation = chunkParser->mInvertAxisOrientation;
+  return chunk;
+}
+
 #define LOCALNAME_EQUALS(string_constant) \
   ( localNameLen == static_cast<int>(strlen( string_constant )) && memcmp(pszLocalName, string_constant, localNameLen) == 0 )
 
@@ -1283,33 +1788,184 @@ bool QgsGmlStreamingParser::createBBoxFromCoordinateString( QgsRectangle &r, con
   return true;
 }
 
+//! Powers of ten which are exactly representable as doubles
+static const double EXACT_POWERS_OF_TEN[] =
+{
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static bool isAsciiDigit( QChar c )
+{
+  return c.unicode() >= '0' && c.unicode() <= '9';
+}
+
+/**
+ * Converts [begin, end) if it is a plain decimal number -?\d+(\.\d+)?([eE][+-]?\d+)?
+ * with at most 15 significant digits and a resulting power of ten within [-22, 22].
+ * The mantissa and the power of ten are then exact doubles, so that a single
+ * multiplication or division gives the correctly rounded value.
+ * Returns false for any other input, which must be converted by QString::toDouble().
+ */
+static bool parseSimpleDecimal( const QChar *begin, const QChar *end, double &value )
+{
+  const QChar *p = begin;
+  bool negative = false;
+  if ( p < end && *p == QLatin1Char( '-' ) )
+  {
+    negative = true;
+    ++p;
+  }
+
+  // leave numbers with leading zeros to toDouble()
+  if ( end - p > 1 && *p == QLatin1Char( '0' ) && isAsciiDigit( p[1] ) )
+    return false;
+
+  qint64 mantissa = 0;
+  int significantDigits = 0;
+  int exponent = 0;
+
+  const QChar *integerStart = p;
+  for ( ; p < end && isAsciiDigit( *p ); ++p )
+  {
+    const int digit = p->unicode() - '0';
+    if ( mantissa == 0 && digit == 0 )
+      continue;
+    if ( ++significantDigits > 15 )
+      return false;
+    mantissa = mantissa * 10 + digit;
+  }
+  if ( p == integerStart )
+    return false;
+
+  if ( p < end && *p == QLatin1Char( '.' ) )
+  {
+    ++p;
+    const QChar *fractionStart = p;
+    for ( ; p < end && isAsciiDigit( *p ); ++p )
+    {
+      const int digit = p->unicode() - '0';
+      exponent--;
+      if ( mantissa == 0 && digit == 0 )
+        continue;
+      if ( ++significantDigits > 15 )
+        return false;
+      mantissa = mantissa * 10 + digit;
+    }
+    if ( p == fractionStart )
+      return false;
+  }
+
+  if ( p < end && ( *p == QLatin1Char( 'e' ) || *p == QLatin1Char( 'E' ) ) )
+  {
+    ++p;
+    bool negativeExponent = false;
+    if ( p < end && ( *p == QLatin1Char( '-' ) || *p == QLatin1Char( '+' ) ) )
+    {
+      negativeExponent = *p == QLatin1Char( '-' );
+      ++p;
+    }
+    const QChar *exponentStart = p;
+    int explicitExponent = 0;
+    for ( ; p < end && isAsciiDigit( *p ); ++p )
+    {
+      if ( explicitExponent < 10000 )
+        explicitExponent = explicitExponent * 10 + ( p->unicode() - '0' );
+    }
+    if ( p == exponentStart )
+      return false;
+    exponent += negativeExponent ? -explicitExponent : explicitExponent;
+  }
+
+  if ( p != end )
+    return false;
+
+  if ( mantissa == 0 )
+  {
+    value = negative ? -0.0 : 0.0;
+    return true;
+  }
+  if ( exponent < -22 || exponent > 22 )
+    return false;
+
+  value = exponent >= 0 ? static_cast< double >( mantissa ) * EXACT_POWERS_OF_TEN[exponent]
+          : static_cast< double >( mantissa ) / EXACT_POWERS_OF_TEN[-exponent];
+  if ( negative )
+    value = -value;
+  return true;
+}
+
+bool QgsGmlStreamingParser::parseCoordinate( const QString &string, int start, int length, double &value )
+{
+  const QChar *data = string.constData() + start;
+  if ( parseSimpleDecimal( data, data + length, value ) )
+    return true;
+
+  bool ok = false;
+  value = QStringRef( &string, start, length ).toDouble( &ok );
+  return ok;
+}
+
 int QgsGmlStreamingParser::pointsFromCoordinateString( QList<QgsPointXY> &points, const QString &coordString ) const
 {
   //tuples are separated by space, x/y by ','
-  QStringList tuples = coordString.split( mTupleSeparator, QString::SkipEmptyParts );
-  QStringList tuples_coordinates;
-  double x, y;
-  bool conversionSuccess;
-
-  QStringList::const_iterator tupleIterator;
-  for ( tupleIterator = tuples.constBegin(); tupleIterator != tuples.constEnd(); ++tupleIterator )
+  const int tupleSeparatorLength = mTupleSeparator.size();
+  const int coordinateSeparatorLength = mCoordinateSeparator.size();
+  if ( tupleSeparatorLength == 0 || coordinateSeparatorLength == 0 )
   {
-    tuples_coordinates = tupleIterator->split( mCoordinateSeparator, QString::SkipEmptyParts );
-    if ( tuples_coordinates.size() < 2 )
+    // QString::split() semantics for empty separators
+    QStringList tuples = coordString.split( mTupleSeparator, QString::SkipEmptyParts );
+    for ( const QString &tuple : qgis::as_const( tuples ) )
     {
-      continue;
+      const QStringList tupleCoordinates = tuple.split( mCoordinateSeparator, QString::SkipEmptyParts );
+      if ( tupleCoordinates.size() < 2 )
+        continue;
+      double x, y;
+      if ( !parseCoordinate( tupleCoordinates.at( 0 ), 0, tupleCoordinates.at( 0 ).size(), x ) ||
+           !parseCoordinate( tupleCoordinates.at( 1 ), 0, tupleCoordinates.at( 1 ).size(), y ) )
+        continue;
+      points.push_back( ( mInvertAxisOrientation ) ? QgsPointXY( y, x ) : QgsPointXY( x, y ) );
     }
-    x = tuples_coordinates.at( 0 ).toDouble( &conversionSuccess );
-    if ( !conversionSuccess )
+    return 0;
+  }
+
+  // scan the string in place, with the same splitting rules as QString::split( ..., SkipEmptyParts )
+  const int length = coordString.size();
+  int tupleStart = 0;
+  while ( tupleStart < length )
+  {
+    int tupleEnd = coordString.indexOf( mTupleSeparator, tupleStart );
+    if ( tupleEnd < 0 )
+      tupleEnd = length;
+
+    // first two non empty coordinates of the tuple
+    int coordinateStarts[2];
+    int coordinateLengths[2];
+    int coordinateCount = 0;
+    int coordinateStart = tupleStart;
+    while ( coordinateStart < tupleEnd && coordinateCount < 2 )
     {
-      continue;
+      int coordinateEnd = coordString.indexOf( mCoordinateSeparator, coordinateStart );
+      if ( coordinateEnd < 0 || coordinateEnd + coordinateSeparatorLength > tupleEnd )
+        coordinateEnd = tupleEnd;
+      if ( coordinateEnd > coordinateStart )
+      {
+        coordinateStarts[coordinateCount] = coordinateStart;
+        coordinateLengths[coordinateCount] = coordinateEnd - coordinateStart;
+        coordinateCount++;
+      }
+      coordinateStart = coordinateEnd + coordinateSeparatorLength;
     }
-    y = tuples_coordinates.at( 1 ).toDouble( &conversionSuccess );
-    if ( !conversionSuccess )
+
+    double x, y;
+    if ( coordinateCount == 2 &&
+         parseCoordinate( coordString, coordinateStarts[0], coordinateLengths[0], x ) &&
+         parseCoordinate( coordString, coordinateStarts[1], coordinateLengths[1], y ) )
     {
-      continue;
+      points.push_back( ( mInvertAxisOrientation ) ? QgsPointXY( y, x ) : QgsPointXY( x, y ) );
     }
-    points.push_back( ( mInvertAxisOrientation ) ? QgsPointXY( y, x ) : QgsPointXY( x, y ) );
+
+    tupleStart = tupleEnd + tupleSeparatorLength;
   }
   return 0;
 }
@@ -1317,7 +1973,23 @@ int QgsGmlStreamingParser::pointsFromCoordinateString( QList<QgsPointXY> &points
 int QgsGmlStreamingParser::pointsFromPosListString( QList<QgsPointXY> &points, const QString &coordString, int dimension ) const
 {
   // coordinates separated by spaces
-  QStringList coordinates = coordString.split( ' ', QString::SkipEmptyParts );
+  QVector< QPair< int, int > > coordinates;
+  const QChar *data = coordString.constData();
+  const int length = coordString.size();
+  int start = 0;
+  while ( start < length )
+  {
+    if ( data[start] == ' ' )
+    {
+      start++;
+      continue;
+    }
+    int end = start + 1;
+    while ( end < length && data[end] != ' ' )
+      end++;
+    coordinates.append( qMakePair( start, end - start ) );
+    start = end;
+  }
 
   if ( coordinates.size() % dimension != 0 )
   {
@@ -1327,14 +1999,11 @@ int QgsGmlStreamingParser::pointsFromPosListString( QList<QgsPointXY> &points, c
   int ncoor = coordinates.size() / dimension;
   for ( int i = 0; i < ncoor; i++ )
   {
-    bool conversionSuccess;
-    double x = coordinates.value( i * dimension ).toDouble( &conversionSuccess );
-    if ( !conversionSuccess )
-    {
-      continue;
-    }
-    double y = coordinates.value( i * dimension + 1 ).toDouble( &conversionSuccess );
-    if ( !conversionSuccess )
+    const QPair< int, int > xCoordinate = coordinates.value( i * dimension );
+    const QPair< int, int > yCoordinate = coordinates.value( i * dimension + 1 );
+    double x, y;
+    if ( !parseCoordinate( coordString, xCoordinate.first, xCoordinate.second, x ) ||
+         !parseCoordinate( coordString, yCoordinate.first, yCoordinate.second, y ) )
     {
       continue;
     }
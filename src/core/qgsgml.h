@@ -30,6 +30,7 @@
 #include <QStack>
 #include <QVector>
 
+#include <memory>
 #include <string>
 
 class QgsCoordinateReferenceSystem;
@@ -142,8 +143,22 @@ class CORE_EXPORT QgsGmlStreamingParser
     //! Returns whether a "truncatedResponse" element is found
     bool isTruncatedResponse() const { return mTruncatedResponse; }
 
+    /**
+     * Sets the maximum number of \a threads used to parse features.
+     *
+     * When greater than 1, the data passed to processData() is split at feature member
+     * boundaries, and chunks of members are parsed concurrently by parsers sharing the
+     * settings of this parser. Features are still returned in document order.
+     * Must be called before the first call to processData().
+     * \since QGIS 3.6
+     */
+    void setMaximumThreads( int threads );
+
   private:
 
+    struct ParsedChunk;
+    struct ParallelParsing;
+
     enum ParseMode
     {
       None,
@@ -224,6 +239,13 @@ class CORE_EXPORT QgsGmlStreamingParser
       */
     int pointsFromPosListString( QList<QgsPointXY> &points, const QString &coordString, int dimension ) const;
 
+    /**
+     * Parses the \a length characters of \a string starting at \a start as a number.
+     * Accepts the same input and gives the same value as QString::toDouble().
+     * \returns true in case of success
+      */
+    static bool parseCoordinate( const QString &string, int start, int length, double &value );
+
     int pointsFromString( QList<QgsPointXY> &points, const QString &coordString ) const;
     int getPointWKB( QgsWkbPtr &wkbPtr, const QgsPointXY & ) const;
     int getLineWKB( QgsWkbPtr &wkbPtr, const QList<QgsPointXY> &lineCoordinates ) const;
@@ -248,6 +270,23 @@ class CORE_EXPORT QgsGmlStreamingParser
     //! Safely (if empty) pop from mode stack
     ParseMode modeStackPop() { return mParseModeStack.isEmpty() ? None : mParseModeStack.pop(); }
 
+    //! Passes data to the expat parser
+    bool parseXml( const char *data, int size, bool atEnd, QString &errorMsg );
+
+    //! Splits data at feature member boundaries and dispatches chunks of members to parsing threads
+    bool processDataInParallel( const QByteArray &data, bool atEnd, QString &errorMsg );
+    bool splitData( QString &errorMsg );
+    bool endMember( QString &errorMsg );
+    bool feedMainParser( bool atEnd, QString &errorMsg );
+    bool dispatchChunk( QString &errorMsg );
+
+    //! Moves the features of the chunks parsed so far, in document order, to the list of ready features
+    bool collectParsedChunks( QString &errorMsg );
+
+    //! Creates a parser with the same settings, and the srs and GML namespace found so far
+    std::unique_ptr< QgsGmlStreamingParser > createChunkParser() const;
+    static ParsedChunk parseChunk( QgsGmlStreamingParser *parser, const QByteArray &document );
+
     //! Expat parser
     XML_Parser mParser;
 
@@ -257,6 +296,7 @@ class CORE_EXPORT QgsGmlStreamingParser
     //! Describe the various feature types of a join layer
     QList<LayerProperties> mLayerProperties;
     QMap< QString, LayerProperties > mMapTypeNameToProperties;
+    QMap< QString, QPair<QString, QString> > mMapFieldNameToSrcLayerNameFieldName;
 
     //! Typename without namespace prefix
     QString mTypeName;
@@ -338,6 +378,8 @@ class CORE_EXPORT QgsGmlStreamingParser
     std::string mGeometryString;
     //! Whether we found a unhandled geometry element
     bool mFoundUnhandledGeometryElement;
+    //! State of the parallel parsing, if enabled
+    std::unique_ptr< ParallelParsing > mParallel;
 };
 
 #endif
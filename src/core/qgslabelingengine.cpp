@@ -27,6 +27,15 @@
 #include "qgsmaplayer.h"
 #include "qgssymbol.h"
 
+//! Appends \a provider and its sub-providers to \a providers, in the order they are processed by a serial run
+static void _appendProviders( QgsAbstractLabelProvider *provider, QList< QgsAbstractLabelProvider * > &providers )
+{
+  providers << provider;
+  const QList< QgsAbstractLabelProvider * > subProviders = provider->subProviders();
+  for ( QgsAbstractLabelProvider *subProvider : subProviders )
+    _appendProviders( subProvider, providers );
+}
+
 // helper function for checking for job cancelation within PAL
 static bool _palIsCanceled( void *ctx )
 {
@@ -77,6 +86,8 @@ QgsLabelingEngine::QgsLabelingEngine()
 
 QgsLabelingEngine::~QgsLabelingEngine()
 {
+  // PAL layers refer to the label features owned by the providers
+  mPal.reset();
   qDeleteAll( mProviders );
   qDeleteAll( mSubProviders );
 }
@@ -112,7 +123,7 @@ void QgsLabelingEngine::removeProvider( QgsAbstractLabelProvider *provider )
   }
 }
 
-void QgsLabelingEngine::processProvider( QgsAbstractLabelProvider *provider, QgsRenderContext &context, pal::Pal &p )
+void QgsLabelingEngine::processProvider( QgsAbstractLabelProvider *provider, QgsRenderContext &context, pal::Pal &p, QList< pal::Layer * > *palLayers )
 {
   QgsAbstractLabelProvider::Flags flags = provider->flags();
 
@@ -159,6 +170,8 @@ void QgsLabelingEngine::processProvider( QgsAbstractLabelProvider *provider, Qgs
   }
   l->setUpsidedownLabels( upsdnlabels );
 
+  if ( palLayers )
+    palLayers->append( l );
 
   QList<QgsLabelFeature *> features = provider->labelFeatures( context );
 
@@ -179,17 +192,38 @@ void QgsLabelingEngine::processProvider( QgsAbstractLabelProvider *provider, Qgs
   // any sub-providers?
   Q_FOREACH ( QgsAbstractLabelProvider *subProvider, provider->subProviders() )
   {
-    mSubProviders << subProvider;
-    processProvider( subProvider, context, p );
+    {
+      QMutexLocker locker( &mMutex );
+      mSubProviders << subProvider;
+    }
+    processProvider( subProvider, context, p, palLayers );
   }
 }
 
+QgsGeometry QgsLabelingEngine::mapBoundaryGeometry() const
+{
+  QPolygonF visiblePoly = mMapSettings.visiblePolygon();
+  visiblePoly.append( visiblePoly.at( 0 ) ); //close polygon
+
+  // get map label boundary geometry - if one hasn't been explicitly set, we use the whole of the map's visible polygon
+  QgsGeometry mapBoundaryGeom = !mMapSettings.labelBoundaryGeometry().isNull() ? mMapSettings.labelBoundaryGeometry() : QgsGeometry::fromQPolygonF( visiblePoly );
 
-void QgsLabelingEngine::run( QgsRenderContext &context )
+  // label blocking regions work by "chopping away" those regions from the permissible labeling area
+  const QList< QgsLabelBlockingRegion > blockingRegions = mMapSettings.labelBlockingRegions();
+  for ( const QgsLabelBlockingRegion &region : blockingRegions )
+  {
+    mapBoundaryGeom = mapBoundaryGeom.difference( region.geometry );
+  }
+  return mapBoundaryGeom;
+}
+
+void QgsLabelingEngine::prepare( QgsRenderContext &context )
 {
   const QgsLabelingEngineSettings &settings = mMapSettings.labelingEngineSettings();
 
-  pal::Pal p;
+  mPal = qgis::make_unique< pal::Pal >();
+  mProcessedProviders.clear();
+
   pal::SearchMethod s;
   switch ( settings.searchMethod() )
   {
@@ -210,21 +244,86 @@ void QgsLabelingEngine::run( QgsRenderContext &context )
       s = pal::FALP;
       break;
   }
-  p.setSearch( s );
+  mPal->setSearch( s );
 
   // set number of candidates generated per feature
   int candPoint, candLine, candPolygon;
   settings.numCandidatePositions( candPoint, candLine, candPolygon );
-  p.setPointP( candPoint );
-  p.setLineP( candLine );
-  p.setPolyP( candPolygon );
+  mPal->setPointP( candPoint );
+  mPal->setLineP( candLine );
+  mPal->setPolyP( candPolygon );
 
-  p.setShowPartial( settings.testFlag( QgsLabelingEngineSettings::UsePartialCandidates ) );
+  mPal->setShowPartial( settings.testFlag( QgsLabelingEngineSettings::UsePartialCandidates ) );
 
+  QgsGeometry extentGeom = QgsGeometry::fromRect( mMapSettings.visibleExtent() );
+  QgsGeometry mapBoundaryGeom = mapBoundaryGeometry();
+  if ( !qgsDoubleNear( mMapSettings.rotation(), 0.0 ) )
+  {
+    //PAL features are prerotated, so extent also needs to be unrotated
+    extentGeom.rotate( -mMapSettings.rotation(), mMapSettings.visibleExtent().center() );
+    // yes - this is rotated in the opposite direction... phew, this is confusing!
+    mapBoundaryGeom.rotate( mMapSettings.rotation(), mMapSettings.visibleExtent().center() );
+  }
+
+  mPal->registerCancelationCallback( &_palIsCanceled, reinterpret_cast< void * >( &context ) );
+  mPal->startProblemExtraction( extentGeom.boundingBox(), mapBoundaryGeom );
+}
+
+void QgsLabelingEngine::processLayer( const QString &layerId, QgsRenderContext &context )
+{
+  if ( !mPal )
+    return;
+
+  QList< QgsAbstractLabelProvider * > providers;
+  {
+    QMutexLocker locker( &mMutex );
+    for ( QgsAbstractLabelProvider *provider : qgis::as_const( mProviders ) )
+    {
+      if ( provider->layerId() == layerId && !mProcessedProviders.contains( provider ) )
+      {
+        providers << provider;
+        mProcessedProviders << provider;
+      }
+    }
+  }
+  if ( providers.isEmpty() )
+    return;
+
+  QList< pal::Layer * > palLayers;
+  for ( QgsAbstractLabelProvider *provider : qgis::as_const( providers ) )
+  {
+    processProvider( provider, context, *mPal, &palLayers );
+  }
 
-  // for each provider: get labels and register them in PAL
+  // the features of these layers are complete, so their candidates can be generated right away
+  for ( pal::Layer *layer : qgis::as_const( palLayers ) )
+  {
+    if ( context.renderingStopped() )
+      break;
+
+    mPal->extractLayer( layer );
+  }
+}
+
+
+void QgsLabelingEngine::run( QgsRenderContext &context )
+{
+  const QgsLabelingEngineSettings &settings = mMapSettings.labelingEngineSettings();
+
+  if ( !mPal )
+    prepare( context );
+
+  // the PAL instance is only needed until the labels are drawn
+  std::unique_ptr< pal::Pal > palInstance = std::move( mPal );
+  pal::Pal &p = *palInstance;
+  p.registerCancelationCallback( &_palIsCanceled, reinterpret_cast< void * >( &context ) );
+
+  // for each provider which was not already processed along with its layer: get labels and register them in PAL
   Q_FOREACH ( QgsAbstractLabelProvider *provider, mProviders )
   {
+    if ( mProcessedProviders.contains( provider ) )
+      continue;
+
     bool appendedLayerScope = false;
     if ( QgsMapLayer *ml = provider->layer() )
     {
@@ -235,31 +334,25 @@ void QgsLabelingEngine::run( QgsRenderContext &context )
     if ( appendedLayerScope )
       delete context.expressionContext().popScope();
   }
+  mProcessedProviders.clear();
+
+  // layers processed while rendering were added in the order the layers finished, merge them
+  // into the problem in the order of the providers instead, so that the layout is deterministic
+  QList< QgsAbstractLabelProvider * > providerOrder;
+  for ( QgsAbstractLabelProvider *provider : qgis::as_const( mProviders ) )
+    _appendProviders( provider, providerOrder );
+  p.sortLayers( providerOrder );
 
 
   // NOW DO THE LAYOUT (from QgsPalLabeling::drawLabeling)
 
   QPainter *painter = context.painter();
 
-  QgsGeometry extentGeom = QgsGeometry::fromRect( mMapSettings.visibleExtent() );
-  QPolygonF visiblePoly = mMapSettings.visiblePolygon();
-  visiblePoly.append( visiblePoly.at( 0 ) ); //close polygon
-
-  // get map label boundary geometry - if one hasn't been explicitly set, we use the whole of the map's visible polygon
-  QgsGeometry mapBoundaryGeom = !mMapSettings.labelBoundaryGeometry().isNull() ? mMapSettings.labelBoundaryGeometry() : QgsGeometry::fromQPolygonF( visiblePoly );
-
-  // label blocking regions work by "chopping away" those regions from the permissible labeling area
-  const QList< QgsLabelBlockingRegion > blockingRegions = mMapSettings.labelBlockingRegions();
-  for ( const QgsLabelBlockingRegion &region : blockingRegions )
-  {
-    mapBoundaryGeom = mapBoundaryGeom.difference( region.geometry );
-  }
-
   if ( settings.flags() & QgsLabelingEngineSettings::DrawCandidates )
   {
     // draw map boundary
     QgsFeature f;
-    f.setGeometry( mapBoundaryGeom );
+    f.setGeometry( mapBoundaryGeometry() );
     QgsStringMap properties;
     properties.insert( QStringLiteral( "style" ), QStringLiteral( "no" ) );
     properties.insert( QStringLiteral( "style_border" ), QStringLiteral( "solid" ) );
@@ -272,19 +365,6 @@ void QgsLabelingEngine::run( QgsRenderContext &context )
     boundarySymbol->stopRender( context );
   }
 
-  if ( !qgsDoubleNear( mMapSettings.rotation(), 0.0 ) )
-  {
-    //PAL features are prerotated, so extent also needs to be unrotated
-    extentGeom.rotate( -mMapSettings.rotation(), mMapSettings.visibleExtent().center() );
-    // yes - this is rotated in the opposite direction... phew, this is confusing!
-    mapBoundaryGeom.rotate( mMapSettings.rotation(), mMapSettings.visibleExtent().center() );
-  }
-
-  QgsRectangle extent = extentGeom.boundingBox();
-
-
-  p.registerCancelationCallback( &_palIsCanceled, reinterpret_cast< void * >( &context ) );
-
   QTime t;
   t.start();
 
@@ -292,7 +372,7 @@ void QgsLabelingEngine::run( QgsRenderContext &context )
   std::unique_ptr< pal::Problem > problem;
   try
   {
-    problem = p.extractProblem( extent, mapBoundaryGeom );
+    problem = p.finishProblemExtraction();
   }
   catch ( std::exception &e )
   {
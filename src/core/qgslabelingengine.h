@@ -21,6 +21,9 @@
 #include "qgis_core.h"
 #include "qgsmapsettings.h"
 
+#include <QMutex>
+#include <QSet>
+
 #include "qgspallabeling.h"
 #include "qgslabelingenginesettings.h"
 
@@ -200,6 +203,33 @@ class CORE_EXPORT QgsLabelingEngine
     //! Remove provider if the provider's initialization failed. Provider instance is deleted.
     void removeProvider( QgsAbstractLabelProvider *provider );
 
+    /**
+     * Prepares the engine for labeling layers while the map is still being rendered.
+     *
+     * Once prepared, processLayer() may be called for each layer as soon as it has finished
+     * rendering, generating the label candidates of that layer while other layers are still
+     * being rendered. run() then only processes the remaining providers and solves the labeling
+     * problem. Calling prepare() is optional, run() prepares the engine itself if required.
+     *
+     * \see processLayer()
+     * \since QGIS 3.6
+     */
+    void prepare( QgsRenderContext &context );
+
+    /**
+     * Registers the label features of all providers for the layer with matching \a layerId
+     * and generates their label candidates. The \a context should be the render context
+     * which was used to render the layer.
+     *
+     * This has no effect unless prepare() was called first. It is safe to call this method
+     * from several threads at once, for different layers, but all calls must have returned
+     * before run() is called.
+     *
+     * \see prepare()
+     * \since QGIS 3.6
+     */
+    void processLayer( const QString &layerId, QgsRenderContext &context );
+
     //! compute the labeling with given map settings and providers
     void run( QgsRenderContext &context );
 
@@ -210,7 +240,12 @@ class CORE_EXPORT QgsLabelingEngine
     QgsLabelingResults *results() const { return mResults.get(); }
 
   protected:
-    void processProvider( QgsAbstractLabelProvider *provider, QgsRenderContext &context, pal::Pal &p );
+
+    /**
+     * Registers the label features of a \a provider and its sub providers in \a p. If \a palLayers
+     * is set, the PAL layers created for the providers are appended to it.
+     */
+    void processProvider( QgsAbstractLabelProvider *provider, QgsRenderContext &context, pal::Pal &p, QList< pal::Layer * > *palLayers = nullptr );
 
   protected:
     //! Associated map settings instance
@@ -223,6 +258,18 @@ class CORE_EXPORT QgsLabelingEngine
     //! Resulting labeling layout
     std::unique_ptr< QgsLabelingResults > mResults;
 
+  private:
+
+    //! Returns the map boundary used for labeling, without rotation
+    QgsGeometry mapBoundaryGeometry() const;
+
+    //! PAL instance created by prepare(), used until the end of run()
+    std::unique_ptr< pal::Pal > mPal;
+    //! Providers which were already registered in mPal
+    QSet< QgsAbstractLabelProvider * > mProcessedProviders;
+    //! Protects mProcessedProviders and mSubProviders while layers are processed
+    QMutex mMutex;
+
 };
 
 
@@ -15,14 +15,40 @@
 
 #include "qgsmaprenderercache.h"
 
+#include "qgsdataprovider.h"
+#include "qgslogger.h"
 #include "qgsmaplayer.h"
 #include "qgsmaplayerlistutils.h"
+#include "qgsmaplayerstyle.h"
+#include "qgsmapsettings.h"
+#include "qgsvectorlayer.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageWriter>
+#include <QUuid>
+#include <QtConcurrentRun>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 QgsMapRendererCache::QgsMapRendererCache()
 {
+  // a single writer is enough, and keeps the disk tier from competing with rendering threads
+  mDiskCacheWritePool.setMaxThreadCount( 1 );
   clear();
 }
 
+QgsMapRendererCache::~QgsMapRendererCache()
+{
+  // pending writes access the disk cache state
+  mDiskCacheWritePool.waitForDone();
+}
+
 void QgsMapRendererCache::clear()
 {
   QMutexLocker lock( &mMutex );
@@ -44,6 +70,8 @@ void QgsMapRendererCache::clearInternal()
     }
   }
   mCachedImages.clear();
+  mPreviousImages.clear();
+  mPreviousExtent.setMinimal();
   mConnectedLayers.clear();
 }
 
@@ -66,13 +94,16 @@ void QgsMapRendererCache::dropUnusedConnections()
 QSet<QgsWeakMapLayerPointer > QgsMapRendererCache::dependentLayers() const
 {
   QSet< QgsWeakMapLayerPointer > result;
-  QMap<QString, CacheParameters>::const_iterator it = mCachedImages.constBegin();
-  for ( ; it != mCachedImages.constEnd(); ++it )
+  for ( const QMap<QString, CacheParameters> *images : { &mCachedImages, &mPreviousImages } )
   {
-    Q_FOREACH ( const QgsWeakMapLayerPointer &l, it.value().dependentLayers )
+    QMap<QString, CacheParameters>::const_iterator it = images->constBegin();
+    for ( ; it != images->constEnd(); ++it )
     {
-      if ( l.data() )
-        result << l;
+      Q_FOREACH ( const QgsWeakMapLayerPointer &l, it.value().dependentLayers )
+      {
+        if ( l.data() )
+          result << l;
+      }
     }
   }
   return result;
@@ -87,7 +118,21 @@ bool QgsMapRendererCache::init( const QgsRectangle &extent, double scale )
        qgsDoubleNear( scale, mScale ) )
     return true;
 
-  clearInternal();
+  // after a pan most of the previous images is still valid, so keep them around until the next change
+  const bool panned = !mExtent.isEmpty() && qgsDoubleNear( scale, mScale ) &&
+                      qgsDoubleNear( extent.width(), mExtent.width(), mExtent.width() * 1e-8 ) &&
+                      qgsDoubleNear( extent.height(), mExtent.height(), mExtent.height() * 1e-8 );
+  if ( panned )
+  {
+    mPreviousImages = mCachedImages;
+    mPreviousExtent = mExtent;
+    mCachedImages.clear();
+    dropUnusedConnections();
+  }
+  else
+  {
+    clearInternal();
+  }
 
   // set new params
   mExtent = extent;
@@ -161,6 +206,16 @@ void QgsMapRendererCache::layerRequestedRepaint()
 
     it = mCachedImages.erase( it );
   }
+  for ( it = mPreviousImages.begin(); it != mPreviousImages.end(); )
+  {
+    if ( !it.value().dependentLayers.contains( layer ) )
+    {
+      ++it;
+      continue;
+    }
+
+    it = mPreviousImages.erase( it );
+  }
   dropUnusedConnections();
 }
 
@@ -169,5 +224,428 @@ void QgsMapRendererCache::clearCacheImage( const QString &cacheKey )
   QMutexLocker lock( &mMutex );
 
   mCachedImages.remove( cacheKey );
+  mPreviousImages.remove( cacheKey );
   dropUnusedConnections();
 }
+
+QImage QgsMapRendererCache::pannedCacheImage( const QString &cacheKey, QRegion &exposedRegion ) const
+{
+  exposedRegion = QRegion();
+
+  QMutexLocker lock( &mMutex );
+  QMap<QString, CacheParameters>::const_iterator it = mPreviousImages.constFind( cacheKey );
+  if ( it == mPreviousImages.constEnd() || it->cachedImage.isNull() || mExtent.isEmpty() )
+    return QImage();
+
+  const QImage &previous = it->cachedImage;
+  const double dpr = previous.devicePixelRatio();
+  const int bytesPerPixel = previous.depth() / 8;
+  // fractional ratios would leave device pixels which are neither copied nor rendered
+  if ( !qgsDoubleNear( dpr, std::round( dpr ) ) || previous.depth() % 8 != 0 )
+    return QImage();
+
+  // offset of the previous image within the current extent, in device pixels
+  const double mapUnitsPerPixel = mPreviousExtent.width() / previous.width();
+  const double dx = ( mPreviousExtent.xMinimum() - mExtent.xMinimum() ) / mapUnitsPerPixel;
+  const double dy = ( mExtent.yMaximum() - mPreviousExtent.yMaximum() ) / mapUnitsPerPixel;
+  const int offsetX = static_cast< int >( std::round( dx ) );
+  const int offsetY = static_cast< int >( std::round( dy ) );
+  if ( std::fabs( dx - offsetX ) > 0.01 || std::fabs( dy - offsetY ) > 0.01 )
+    return QImage();
+
+  // area of the new image still covered by the previous one, in logical pixels
+  const int ratio = static_cast< int >( std::round( dpr ) );
+  const int logicalWidth = previous.width() / ratio;
+  const int logicalHeight = previous.height() / ratio;
+  int left = ( std::max( offsetX, 0 ) + ratio - 1 ) / ratio;
+  int top = ( std::max( offsetY, 0 ) + ratio - 1 ) / ratio;
+  int right = std::min( previous.width(), previous.width() + offsetX ) / ratio;
+  int bottom = std::min( previous.height(), previous.height() + offsetY ) / ratio;
+
+  // symbols of features outside the previous extent were cut at its edge, so render these parts again
+  if ( offsetX > 0 )
+    left += PANNED_IMAGE_MARGIN;
+  else if ( offsetX < 0 )
+    right -= PANNED_IMAGE_MARGIN;
+  if ( offsetY > 0 )
+    top += PANNED_IMAGE_MARGIN;
+  else if ( offsetY < 0 )
+    bottom -= PANNED_IMAGE_MARGIN;
+
+  if ( right <= left || bottom <= top )
+    return QImage();
+
+  QImage image( previous.size(), previous.format() );
+  if ( image.isNull() )
+    return QImage();
+  image.setDevicePixelRatio( dpr );
+  image.fill( 0 );
+
+  const int copyX = left * ratio;
+  const int copyWidth = ( right - left ) * ratio;
+  for ( int y = top * ratio; y < bottom * ratio; ++y )
+  {
+    std::memcpy( image.scanLine( y ) + copyX * bytesPerPixel,
+                 previous.constScanLine( y - offsetY ) + ( copyX - offsetX ) * bytesPerPixel,
+                 static_cast< size_t >( copyWidth ) * bytesPerPixel );
+  }
+
+  exposedRegion = QRegion( 0, 0, logicalWidth, logicalHeight ).subtracted( QRegion( left, top, right - left, bottom - top ) );
+  return image;
+}
+
+void QgsMapRendererCache::setDiskCacheDirectory( const QString &directory, qint64 maximumSize )
+{
+  mDiskCacheWritePool.waitForDone();
+
+  QMutexLocker lock( &mMutex );
+
+  mDiskCacheDirectory = directory;
+  mDiskCacheMaximumSize = maximumSize;
+  mDiskCacheEntries.clear();
+  mDiskCacheSize = 0;
+  mDiskCacheUseCounter = 0;
+
+  if ( mDiskCacheDirectory.isEmpty() )
+    return;
+
+  QDir dir( mDiskCacheDirectory );
+  if ( !dir.exists() && !dir.mkpath( QStringLiteral( "." ) ) )
+  {
+    QgsDebugMsg( QStringLiteral( "Could not create render cache directory %1" ).arg( mDiskCacheDirectory ) );
+    mDiskCacheDirectory.clear();
+    return;
+  }
+
+  // reuse images from previous sessions, least recently written first
+  const QFileInfoList files = dir.entryInfoList( QStringList() << QStringLiteral( "*.png" ), QDir::Files, QDir::Time | QDir::Reversed );
+  for ( const QFileInfo &file : files )
+  {
+    const QString key = file.completeBaseName();
+    const int separator = key.indexOf( '-' );
+    if ( separator < 0 )
+      continue;
+
+    DiskCacheEntry entry;
+    entry.layerPrefix = key.left( separator );
+    entry.size = file.size();
+    entry.lastUsed = ++mDiskCacheUseCounter;
+    mDiskCacheEntries.insert( key, entry );
+    mDiskCacheSize += entry.size;
+  }
+  trimDiskCache();
+}
+
+QString QgsMapRendererCache::diskCacheDirectory() const
+{
+  QMutexLocker lock( &mMutex );
+  return mDiskCacheDirectory;
+}
+
+qint64 QgsMapRendererCache::diskCacheMaximumSize() const
+{
+  QMutexLocker lock( &mMutex );
+  return mDiskCacheMaximumSize;
+}
+
+///@cond PRIVATE
+//! Returns the prefix of the disk cache keys of the layer with the specified id
+static QString diskCacheLayerPrefix( const QString &layerId )
+{
+  return QString::fromLatin1( QCryptographicHash::hash( layerId.toUtf8(), QCryptographicHash::Sha1 ).toHex().left( 16 ) );
+}
+///@endcond
+
+QString QgsMapRendererCache::diskCacheKey( QgsMapLayer *layer, const QgsMapSettings &settings )
+{
+  if ( !layer || layer->hasAutoRefreshEnabled() )
+    return QString();
+
+  if ( QgsVectorLayer *vl = qobject_cast< QgsVectorLayer * >( layer ) )
+  {
+    // edits and selections are not covered by the key
+    if ( vl->isEditable() || vl->selectedFeatureCount() > 0 )
+      return QString();
+  }
+
+  QByteArray styleHash;
+  int dataGeneration = 0;
+  {
+    QMutexLocker lock( &mMutex );
+    // connect first, so that style and data changes from now on are noticed
+    connectDiskCacheLayer( layer );
+    const DiskCacheLayerState state = mDiskCacheLayerStates.value( layer->id() );
+    styleHash = state.styleHash;
+    dataGeneration = state.dataGeneration;
+  }
+
+  if ( styleHash.isEmpty() )
+  {
+    // only serialize the style after it possibly changed, not for every render
+    QgsMapLayerStyle style;
+    style.readFromLayer( layer );
+    styleHash = QCryptographicHash::hash( style.xmlData().toUtf8(), QCryptographicHash::Sha1 );
+
+    QMutexLocker lock( &mMutex );
+    mDiskCacheLayerStates[ layer->id() ].styleHash = styleHash;
+  }
+
+  // images of data sources without a timestamp are only valid for the current session
+  QString dataVersion;
+  QDateTime dataTimestamp = layer->dataProvider() ? layer->dataProvider()->dataTimestamp() : QDateTime();
+  if ( !dataTimestamp.isValid() )
+  {
+    const QFileInfo sourceFile( layer->source().section( '|', 0, 0 ) );
+    if ( sourceFile.isFile() )
+      dataTimestamp = sourceFile.lastModified();
+  }
+  if ( dataTimestamp.isValid() )
+  {
+    dataVersion = QString::number( dataTimestamp.toMSecsSinceEpoch() );
+  }
+  else
+  {
+    static const QString sSessionId = QUuid::createUuid().toString();
+    dataVersion = sSessionId + QString::number( dataGeneration );
+  }
+
+  const QgsRectangle extent = settings.visibleExtent();
+  const QString mapParameters = QStringLiteral( "%1,%2,%3,%4|%5|%6x%7|%8|%9|%10|%11|%12" )
+                                .arg( QString::number( extent.xMinimum(), 'g', 17 ),
+                                      QString::number( extent.yMinimum(), 'g', 17 ),
+                                      QString::number( extent.xMaximum(), 'g', 17 ),
+                                      QString::number( extent.yMaximum(), 'g', 17 ),
+                                      QString::number( settings.scale(), 'g', 17 ) )
+                                .arg( settings.outputSize().width() )
+                                .arg( settings.outputSize().height() )
+                                .arg( settings.outputDpi() )
+                                .arg( settings.devicePixelRatio() )
+                                .arg( settings.rotation() )
+                                .arg( static_cast< int >( settings.flags() ) )
+                                .arg( static_cast< int >( settings.outputImageFormat() ) );
+
+  QCryptographicHash hash( QCryptographicHash::Sha1 );
+  hash.addData( layer->id().toUtf8() );
+  hash.addData( layer->source().toUtf8() );
+  hash.addData( styleHash );
+  hash.addData( dataVersion.toUtf8() );
+  hash.addData( settings.destinationCrs().toWkt().toUtf8() );
+  hash.addData( mapParameters.toUtf8() );
+
+  // the layer prefix allows removing all images of a layer without knowing their keys
+  return diskCacheLayerPrefix( layer->id() ) + '-' + QString::fromLatin1( hash.result().toHex() );
+}
+
+QString QgsMapRendererCache::diskCacheFilePath( const QString &diskCacheKey ) const
+{
+  return mDiskCacheDirectory + '/' + diskCacheKey + QStringLiteral( ".png" );
+}
+
+void QgsMapRendererCache::setDiskCacheImage( const QString &diskCacheKey, const QImage &image, QgsMapLayer *layer )
+{
+  if ( diskCacheKey.isEmpty() || image.isNull() || !layer )
+    return;
+
+  const QString layerPrefix = diskCacheKey.left( diskCacheKey.indexOf( '-' ) );
+  QString path;
+  int invalidations = 0;
+  {
+    QMutexLocker lock( &mMutex );
+    if ( mDiskCacheDirectory.isEmpty() )
+      return;
+
+    connectDiskCacheLayer( layer );
+    path = diskCacheFilePath( diskCacheKey );
+    invalidations = mDiskCacheInvalidations.value( layerPrefix );
+  }
+
+  QtConcurrent::run( &mDiskCacheWritePool, [this, diskCacheKey, image, path, layerPrefix, invalidations]
+  {
+    // write to a temporary file first, so that readers never see partially written images
+    const QString tempPath = path + QStringLiteral( ".tmp" );
+    QImageWriter writer( tempPath, "png" );
+    // favor speed, layer images are mostly transparent and compress well anyway
+    writer.setCompression( 1 );
+    if ( !writer.write( image ) )
+    {
+      QFile::remove( tempPath );
+      return;
+    }
+
+    QMutexLocker lock( &mMutex );
+    if ( path != diskCacheFilePath( diskCacheKey ) || invalidations != mDiskCacheInvalidations.value( layerPrefix ) )
+    {
+      // the cache directory was changed or the layer requested a repaint meanwhile
+      QFile::remove( tempPath );
+      return;
+    }
+
+    QFile::remove( path );
+    if ( !QFile::rename( tempPath, path ) )
+    {
+      QFile::remove( tempPath );
+      return;
+    }
+
+    DiskCacheEntry &entry = mDiskCacheEntries[ diskCacheKey ];
+    mDiskCacheSize -= entry.size;
+    entry.layerPrefix = layerPrefix;
+    entry.size = QFileInfo( path ).size();
+    entry.lastUsed = ++mDiskCacheUseCounter;
+    mDiskCacheSize += entry.size;
+    trimDiskCache();
+  } );
+}
+
+QImage QgsMapRendererCache::diskCacheImage( const QString &diskCacheKey, QgsMapLayer *layer )
+{
+  if ( diskCacheKey.isEmpty() || !layer )
+    return QImage();
+
+  QString path;
+  {
+    QMutexLocker lock( &mMutex );
+    auto it = mDiskCacheEntries.find( diskCacheKey );
+    if ( it == mDiskCacheEntries.end() )
+      return QImage();
+
+    it->lastUsed = ++mDiskCacheUseCounter;
+    connectDiskCacheLayer( layer );
+    path = diskCacheFilePath( diskCacheKey );
+  }
+
+  QImage image( path );
+  if ( image.isNull() )
+  {
+    // unreadable file, forget about it
+    QMutexLocker lock( &mMutex );
+    auto it = mDiskCacheEntries.find( diskCacheKey );
+    if ( it != mDiskCacheEntries.end() )
+    {
+      mDiskCacheSize -= it->size;
+      mDiskCacheEntries.erase( it );
+    }
+    QFile::remove( path );
+  }
+  return image;
+}
+
+void QgsMapRendererCache::clearDiskCache()
+{
+  mDiskCacheWritePool.waitForDone();
+
+  QMutexLocker lock( &mMutex );
+  for ( auto it = mDiskCacheEntries.constBegin(); it != mDiskCacheEntries.constEnd(); ++it )
+  {
+    QFile::remove( diskCacheFilePath( it.key() ) );
+  }
+  mDiskCacheEntries.clear();
+  mDiskCacheSize = 0;
+}
+
+void QgsMapRendererCache::waitForDiskCacheWrites()
+{
+  mDiskCacheWritePool.waitForDone();
+}
+
+void QgsMapRendererCache::connectDiskCacheLayer( QgsMapLayer *layer )
+{
+  if ( mDiskCacheConnectedLayers.contains( QgsWeakMapLayerPointer( layer ) ) )
+    return;
+
+  // only repaints and data changes invalidate images on disk, the layer being deleted (e.g. when the project is closed) does not
+  connect( layer, &QgsMapLayer::repaintRequested, this, &QgsMapRendererCache::layerRequestedDiskCacheRepaint );
+  connect( layer, &QgsMapLayer::dataChanged, this, &QgsMapRendererCache::layerDiskCacheDataChanged );
+  connect( layer, &QgsMapLayer::styleChanged, this, &QgsMapRendererCache::layerDiskCacheStyleChanged );
+  connect( layer, &QgsMapLayer::rendererChanged, this, &QgsMapRendererCache::layerDiskCacheStyleChanged );
+  connect( layer, &QgsMapLayer::willBeDeleted, this, &QgsMapRendererCache::layerDiskCacheWillBeDeleted );
+  mDiskCacheConnectedLayers << layer;
+}
+
+void QgsMapRendererCache::removeDiskCacheLayerImages( const QString &layerId )
+{
+  const QString layerPrefix = diskCacheLayerPrefix( layerId );
+  mDiskCacheInvalidations[ layerPrefix ]++;
+  for ( auto it = mDiskCacheEntries.begin(); it != mDiskCacheEntries.end(); )
+  {
+    if ( it->layerPrefix != layerPrefix )
+    {
+      ++it;
+      continue;
+    }
+
+    QFile::remove( diskCacheFilePath( it.key() ) );
+    mDiskCacheSize -= it->size;
+    it = mDiskCacheEntries.erase( it );
+  }
+}
+
+void QgsMapRendererCache::trimDiskCache()
+{
+  if ( mDiskCacheSize <= mDiskCacheMaximumSize )
+    return;
+
+  QVector< QPair< qint64, QString > > entries;
+  entries.reserve( mDiskCacheEntries.size() );
+  for ( auto it = mDiskCacheEntries.constBegin(); it != mDiskCacheEntries.constEnd(); ++it )
+  {
+    entries << qMakePair( it->lastUsed, it.key() );
+  }
+  std::sort( entries.begin(), entries.end() );
+
+  for ( const QPair< qint64, QString > &entry : qgis::as_const( entries ) )
+  {
+    if ( mDiskCacheSize <= mDiskCacheMaximumSize )
+      break;
+
+    QFile::remove( diskCacheFilePath( entry.second ) );
+    mDiskCacheSize -= mDiskCacheEntries.value( entry.second ).size;
+    mDiskCacheEntries.remove( entry.second );
+  }
+}
+
+void QgsMapRendererCache::layerRequestedDiskCacheRepaint()
+{
+  QgsMapLayer *layer = qobject_cast<QgsMapLayer *>( sender() );
+  if ( !layer )
+    return;
+
+  QMutexLocker lock( &mMutex );
+  // not all style changes are signaled, but they are followed by a repaint
+  mDiskCacheLayerStates[ layer->id() ].styleHash.clear();
+  removeDiskCacheLayerImages( layer->id() );
+}
+
+void QgsMapRendererCache::layerDiskCacheDataChanged()
+{
+  QgsMapLayer *layer = qobject_cast<QgsMapLayer *>( sender() );
+  if ( !layer )
+    return;
+
+  QMutexLocker lock( &mMutex );
+  mDiskCacheLayerStates[ layer->id() ].dataGeneration++;
+  removeDiskCacheLayerImages( layer->id() );
+}
+
+void QgsMapRendererCache::layerDiskCacheStyleChanged()
+{
+  QgsMapLayer *layer = qobject_cast<QgsMapLayer *>( sender() );
+  if ( !layer )
+    return;
+
+  QMutexLocker lock( &mMutex );
+  mDiskCacheLayerStates[ layer->id() ].styleHash.clear();
+}
+
+void QgsMapRendererCache::layerDiskCacheWillBeDeleted()
+{
+  QgsMapLayer *layer = qobject_cast<QgsMapLayer *>( sender() );
+  if ( !layer )
+    return;
+
+  // the images stay on disk, but images keyed by the data generation must not be used by a new layer with the same id
+  QMutexLocker lock( &mMutex );
+  DiskCacheLayerState &state = mDiskCacheLayerStates[ layer->id() ];
+  state.styleHash.clear();
+  state.dataGeneration++;
+}
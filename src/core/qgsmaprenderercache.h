@@ -17,13 +17,19 @@
 #define QGSMAPRENDERERCACHE_H
 
 #include "qgis_core.h"
+#include "qgis_sip.h"
 #include <QMap>
+#include <QHash>
 #include <QImage>
 #include <QMutex>
+#include <QRegion>
+#include <QThreadPool>
 
 #include "qgsrectangle.h"
 #include "qgsmaplayer.h"
 
+class QgsMapSettings;
+
 
 /**
  * \ingroup core
@@ -35,6 +41,11 @@
  * If triggered, the cache removes the rendered image (and disconnects from the
  * layers).
  *
+ * Optionally, rendered layer images can also be kept in a persistent tier on disk,
+ * see setDiskCacheDirectory(). Images on disk are keyed by the layer, its style and
+ * the map settings used for rendering, so they remain valid when the map extent
+ * changes and across application restarts.
+ *
  * The class is thread-safe (multiple classes can access the same instance safely).
  *
  * \since QGIS 2.4
@@ -46,6 +57,8 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
 
     QgsMapRendererCache();
 
+    ~QgsMapRendererCache() override;
+
     /**
      * Invalidates the cache contents, clearing all cached images.
      * \see clearCacheImage()
@@ -55,6 +68,11 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
     /**
      * Initialize cache: set new parameters and clears the cache if any
      * parameters have changed since last initialization.
+     *
+     * If the map was only panned (i.e. the scale and the size of the extent are unchanged),
+     * the images cached for the previous extent are kept and can be retrieved with
+     * pannedCacheImage() until the next initialization.
+     *
      * \returns flag whether the parameters are the same as last time
      */
     bool init( const QgsRectangle &extent, double scale );
@@ -85,6 +103,26 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
      */
     QImage cacheImage( const QString &cacheKey ) const;
 
+    /**
+     * Returns the image cached for \a cacheKey for the extent before the map was last panned,
+     * shifted by the pan offset so that it matches the current extent.
+     *
+     * The \a exposedRegion is set to the area of the returned image (in logical pixels) which
+     * is not covered by the previous image and must be rendered. Pixels within this region are
+     * transparent. The region extends a few pixels into the previous image, so that symbols
+     * crossing the edge of the previous extent are redrawn completely.
+     *
+     * Returns a null image if there is no previous image for \a cacheKey, or if the pan offset is
+     * not a whole number of pixels.
+     *
+     * \see init()
+     * \since QGIS 3.6
+     */
+    QImage pannedCacheImage( const QString &cacheKey, QRegion &exposedRegion SIP_OUT ) const;
+
+    //! Logical pixels of the previous image which are rendered again around the exposed area after a pan
+    static const int PANNED_IMAGE_MARGIN = 32;
+
     /**
      * Returns a list of map layers on which an image in the cache depends.
      * \since QGIS 3.0
@@ -97,10 +135,105 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
      */
     void clearCacheImage( const QString &cacheKey );
 
+    /**
+     * Sets the \a directory used for the persistent disk tier of the cache, and the
+     * \a maximumSize (in bytes) of the images stored there. When the size is exceeded,
+     * the least recently used images are removed.
+     *
+     * Images already present in the directory, e.g. from a previous session, are reused.
+     * An empty \a directory disables the disk tier, which is the default.
+     *
+     * \see diskCacheDirectory()
+     * \see diskCacheMaximumSize()
+     * \since QGIS 3.6
+     */
+    void setDiskCacheDirectory( const QString &directory, qint64 maximumSize = 100 * 1024 * 1024 );
+
+    /**
+     * Returns the directory used for the disk tier of the cache, or an empty string
+     * if the disk tier is disabled.
+     * \see setDiskCacheDirectory()
+     * \since QGIS 3.6
+     */
+    QString diskCacheDirectory() const;
+
+    /**
+     * Returns the maximum size (in bytes) of the images stored in the disk tier of the cache.
+     * \see setDiskCacheDirectory()
+     * \since QGIS 3.6
+     */
+    qint64 diskCacheMaximumSize() const;
+
+    /**
+     * Returns the key identifying the rendered image of a \a layer with the specified map
+     * \a settings in the disk tier of the cache.
+     *
+     * The key covers the layer id, source, style and data version, as well as the extent,
+     * scale, output size, DPI and destination CRS of the map. An empty string is returned
+     * if the layer cannot be cached on disk, e.g. because it automatically refreshes, has edits
+     * or has selected features.
+     *
+     * The style of the layer is only serialized again after the layer changed its style or
+     * renderer or requested a repaint. The data version is the data timestamp of the provider,
+     * or the modification time of the source file. For other layers, it is the number of data
+     * changes of the layer in the current session, so that their images are not reused in
+     * later sessions.
+     *
+     * \since QGIS 3.6
+     */
+    QString diskCacheKey( QgsMapLayer *layer, const QgsMapSettings &settings );
+
+    /**
+     * Stores the rendered \a image of a \a layer in the disk tier of the cache, under the
+     * specified \a diskCacheKey. The image is written in a background thread.
+     *
+     * The image is removed from the disk tier as soon as the layer triggers a repaint or its data changes.
+     *
+     * \see diskCacheImage()
+     * \see diskCacheKey()
+     * \since QGIS 3.6
+     */
+    void setDiskCacheImage( const QString &diskCacheKey, const QImage &image, QgsMapLayer *layer );
+
+    /**
+     * Returns the image stored in the disk tier of the cache with the specified \a diskCacheKey,
+     * or a null image if there is none. The \a layer which the image is a render of
+     * must be specified, so that the image is invalidated when the layer triggers a repaint.
+     *
+     * \see setDiskCacheImage()
+     * \see diskCacheKey()
+     * \since QGIS 3.6
+     */
+    QImage diskCacheImage( const QString &diskCacheKey, QgsMapLayer *layer );
+
+    /**
+     * Removes all images from the disk tier of the cache.
+     * \since QGIS 3.6
+     */
+    void clearDiskCache();
+
+    /**
+     * Blocks until all images queued with setDiskCacheImage() have been written to disk.
+     * \since QGIS 3.6
+     */
+    void waitForDiskCacheWrites();
+
   private slots:
     //! Remove layer (that emitted the signal) from the cache
     void layerRequestedRepaint();
 
+    //! Remove images of the layer (that emitted the signal) from the disk tier of the cache
+    void layerRequestedDiskCacheRepaint();
+
+    //! Remove images of the layer (that emitted the signal) from the disk tier of the cache and bump its data version
+    void layerDiskCacheDataChanged();
+
+    //! Serialize the style of the layer (that emitted the signal) again for the next disk cache key
+    void layerDiskCacheStyleChanged();
+
+    //! Forget the disk cache key state of the layer (that emitted the signal), another layer may reuse its id
+    void layerDiskCacheWillBeDeleted();
+
   private:
 
     struct CacheParameters
@@ -123,8 +256,57 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
 
     //! Map of cache key to cache parameters
     QMap<QString, CacheParameters> mCachedImages;
+    //! Images cached for the extent before the last pan, see pannedCacheImage()
+    QMap<QString, CacheParameters> mPreviousImages;
+    QgsRectangle mPreviousExtent;
     //! List of all layers on which this cache is currently connected
     QSet< QgsWeakMapLayerPointer > mConnectedLayers;
+
+    struct DiskCacheEntry
+    {
+      //! Prefix of the image file name, identifying the layer
+      QString layerPrefix;
+      //! Size of the image file in bytes
+      qint64 size = 0;
+      //! Value of the use counter when the image was last stored or read
+      qint64 lastUsed = 0;
+    };
+
+    //! State of a layer used for computing its disk cache keys
+    struct DiskCacheLayerState
+    {
+      //! Hash of the serialized style, empty if it must be computed again
+      QByteArray styleHash;
+      //! Number of data changes of the layer in this session
+      int dataGeneration = 0;
+    };
+
+    //! Connects to a layer to remove its images from the disk tier when it triggers a repaint or its data changes (without locking)
+    void connectDiskCacheLayer( QgsMapLayer *layer );
+
+    //! Removes all images of the layer with the specified id from the disk tier (without locking)
+    void removeDiskCacheLayerImages( const QString &layerId );
+
+    //! Returns the path of the image file for a disk cache key
+    QString diskCacheFilePath( const QString &diskCacheKey ) const;
+
+    //! Removes least recently used images until the disk tier fits its maximum size (without locking)
+    void trimDiskCache();
+
+    QString mDiskCacheDirectory;
+    qint64 mDiskCacheMaximumSize = 0;
+    qint64 mDiskCacheSize = 0;
+    qint64 mDiskCacheUseCounter = 0;
+    //! Map of disk cache key to image file details
+    QHash< QString, DiskCacheEntry > mDiskCacheEntries;
+    //! Number of repaints requested by each layer (by layer prefix), for discarding outdated pending writes
+    QHash< QString, int > mDiskCacheInvalidations;
+    //! Map of layer id to the state used for computing the disk cache keys of the layer
+    QHash< QString, DiskCacheLayerState > mDiskCacheLayerStates;
+    //! Layers which are connected for invalidating the disk tier
+    QSet< QgsWeakMapLayerPointer > mDiskCacheConnectedLayers;
+    //! Thread pool for writing images to disk without blocking the rendering
+    QThreadPool mDiskCacheWritePool;
 };
 
 
@@ -259,7 +259,8 @@ void QgsMapRendererCustomPainterJob::doRender()
       QTime layerTime;
       layerTime.start();
 
-      if ( job.img )
+      // partial jobs already contain the image from before a pan
+      if ( job.img && !job.partial )
       {
         job.img->fill( 0 );
         job.imageInitialized = true;
@@ -36,6 +36,12 @@
 #include "qgsmaplayerlistutils.h"
 #include "qgsvectorlayerlabeling.h"
 #include "qgssettings.h"
+#include "qgsrenderer.h"
+#include "qgssymbol.h"
+#include "qgssymbollayer.h"
+#include "qgspainteffect.h"
+#include "qgsrasterlayer.h"
+#include "qgsrasterrenderer.h"
 
 ///@cond PRIVATE
 
@@ -216,6 +222,69 @@ bool QgsMapRendererJob::reprojectToLayerExtent( const QgsMapLayer *ml, const Qgs
   return split;
 }
 
+bool QgsMapRendererJob::canRenderPanned( QgsMapLayer *ml ) const
+{
+  // rotated maps are not shifted by whole pixels
+  if ( !qgsDoubleNear( mSettings.rotation(), 0.0 ) )
+    return false;
+
+  switch ( ml->type() )
+  {
+    case QgsMapLayer::RasterLayer:
+    {
+      QgsRasterLayer *rl = qobject_cast<QgsRasterLayer *>( ml );
+      QgsRasterRenderer *renderer = rl->renderer();
+      if ( !renderer )
+        return false;
+
+      // min/max values computed from the visible data would only be computed from the exposed area
+      return renderer->minMaxOrigin().limits() == QgsRasterMinMaxOrigin::None ||
+             renderer->minMaxOrigin().extent() != QgsRasterMinMaxOrigin::UpdatedCanvas;
+    }
+
+    case QgsMapLayer::VectorLayer:
+    {
+      QgsVectorLayer *vl = qobject_cast<QgsVectorLayer *>( ml );
+      // blending between features must happen on a single image
+      if ( vl->featureBlendMode() != QPainter::CompositionMode_SourceOver )
+        return false;
+
+      QgsFeatureRenderer *renderer = vl->renderer();
+      if ( !renderer )
+        return false;
+
+      // effects spread the rendering over the whole image
+      if ( renderer->paintEffect() && renderer->paintEffect()->enabled() )
+        return false;
+
+      // renderers which need to see neighboring features (e.g. point displacement or heatmaps) extend their request extent
+      QgsRenderContext context = QgsRenderContext::fromMapSettings( mSettings );
+      const QgsRectangle extent = mSettings.visibleExtent();
+      QgsRectangle requestExtent = extent;
+      renderer->modifyRequestExtent( requestExtent, context );
+      if ( requestExtent != extent )
+        return false;
+
+      const QgsSymbolList symbols = renderer->symbols( context );
+      for ( QgsSymbol *symbol : symbols )
+      {
+        const QgsSymbolLayerList symbolLayers = symbol->symbolLayers();
+        for ( QgsSymbolLayer *symbolLayer : symbolLayers )
+        {
+          if ( symbolLayer->paintEffect() && symbolLayer->paintEffect()->enabled() )
+            return false;
+        }
+      }
+      return true;
+    }
+
+    case QgsMapLayer::PluginLayer:
+    case QgsMapLayer::MeshLayer:
+      break;
+  }
+  return false;
+}
+
 LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter *painter, QgsLabelingEngine *labelingEngine2 )
 {
   LayerRenderJobs layerJobs;
@@ -268,6 +337,7 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter *painter, QgsLabelingEn
 
     // Force render of layers that are being edited
     // or if there's a labeling engine that needs the layer to register features
+    bool forceRender = false;
     if ( mCache && ml->type() == QgsMapLayer::VectorLayer )
     {
       QgsVectorLayer *vl = qobject_cast<QgsVectorLayer *>( ml );
@@ -276,6 +346,7 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter *painter, QgsLabelingEn
       if ( vl->isEditable() || requiresLabeling )
       {
         mCache->clearCacheImage( ml->id() );
+        forceRender = true;
       }
     }
 
@@ -319,14 +390,44 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter *painter, QgsLabelingEn
       continue;
     }
 
+    // otherwise the image might have been stored on disk by a previous rendering, possibly in a previous session
+    if ( mCache && !mCache->diskCacheDirectory().isEmpty() )
+    {
+      job.diskCacheKey = mCache->diskCacheKey( ml, mSettings );
+      QImage diskImage = forceRender ? QImage() : mCache->diskCacheImage( job.diskCacheKey, ml );
+      if ( !diskImage.isNull() )
+      {
+        diskImage = diskImage.convertToFormat( mSettings.outputImageFormat() );
+        diskImage.setDevicePixelRatio( mSettings.devicePixelRatio() );
+        mCache->setCacheImage( ml->id(), diskImage, QList< QgsMapLayer * >() << ml );
+
+        job.cached = true;
+        job.imageInitialized = true;
+        job.img = new QImage( diskImage );
+        job.renderer = nullptr;
+        job.context.setPainter( nullptr );
+        continue;
+      }
+    }
+
+    // after a pan, the previous image shifted by the pan offset is still valid except for the newly exposed area
+    QImage pannedImage;
+    QRegion exposedRegion;
+    if ( mCache && !forceRender && canRenderPanned( ml ) )
+    {
+      pannedImage = mCache->pannedCacheImage( ml->id(), exposedRegion );
+      if ( pannedImage.size() != mSettings.deviceOutputSize() )
+        pannedImage = QImage();
+    }
+
     // If we are drawing with an alternative blending mode then we need to render to a separate image
     // before compositing this on the map. This effectively flattens the layer and prevents
     // blending occurring between objects on the layer
     if ( mCache || !painter || needTemporaryImage( ml ) )
     {
       // Flattened image for drawing when a blending mode is set
-      QImage *mypFlattenedImage = new QImage( mSettings.deviceOutputSize(),
-                                              mSettings.outputImageFormat() );
+      QImage *mypFlattenedImage = pannedImage.isNull() ? new QImage( mSettings.deviceOutputSize(), mSettings.outputImageFormat() )
+                                  : new QImage( pannedImage.convertToFormat( mSettings.outputImageFormat() ) );
       mypFlattenedImage->setDevicePixelRatio( mSettings.devicePixelRatio() );
       if ( mypFlattenedImage->isNull() )
       {
@@ -340,6 +441,27 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter *painter, QgsLabelingEn
       QPainter *mypPainter = new QPainter( job.img );
       mypPainter->setRenderHint( QPainter::Antialiasing, mSettings.testFlag( QgsMapSettings::Antialiasing ) );
       job.context.setPainter( mypPainter );
+
+      if ( !pannedImage.isNull() )
+      {
+        QgsDebugMsgLevel( "reusing panned image for " + ml->id(), 2 );
+        job.partial = true;
+        job.imageInitialized = true;
+        mypPainter->setClipRegion( exposedRegion );
+
+        // only fetch what is needed to fill the exposed area, plus a margin for symbols of nearby features
+        const int margin = QgsMapRendererCache::PANNED_IMAGE_MARGIN;
+        const QRect exposedRect = exposedRegion.boundingRect().adjusted( -margin, -margin, margin, margin );
+        const QgsPointXY topLeft = mSettings.mapToPixel().toMapCoordinates( exposedRect.left(), exposedRect.top() );
+        const QgsPointXY bottomRight = mSettings.mapToPixel().toMapCoordinates( exposedRect.right() + 1, exposedRect.bottom() + 1 );
+        QgsRectangle exposedExtent( topLeft, bottomRight );
+        QgsRectangle exposedExtentSplit;
+        if ( !ct.isValid() || !reprojectToLayerExtent( ml, ct, exposedExtent, exposedExtentSplit ) )
+        {
+          if ( exposedExtent.isFinite() )
+            job.context.setExtent( exposedExtent.intersect( r1 ) );
+        }
+      }
     }
 
     QTime layerTime;
@@ -409,6 +531,7 @@ void QgsMapRendererJob::cleanupJobs( LayerRenderJobs &jobs )
       {
         QgsDebugMsgLevel( "caching image for " + ( job.layer ? job.layer->id() : QString() ), 2 );
         mCache->setCacheImage( job.layer->id(), *job.img, QList< QgsMapLayer * >() << job.layer );
+        mCache->setDiskCacheImage( job.diskCacheKey, *job.img, job.layer );
       }
 
       delete job.img;
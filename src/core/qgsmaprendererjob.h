@@ -55,6 +55,8 @@ struct LayerRenderJob
   QgsWeakMapLayerPointer layer;
   int renderingTime; //!< Time it took to render the layer in ms (it is -1 if not rendered or still rendering)
   QStringList errors; //!< Rendering errors
+  QString diskCacheKey; //!< Key of the layer image in the disk tier of the cache, empty if not cached on disk
+  bool partial = false; //!< True if img already contains the shifted image from before a pan, and only the exposed area is rendered
 };
 
 typedef QList<LayerRenderJob> LayerRenderJobs;
@@ -308,6 +310,9 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
 
     bool needTemporaryImage( QgsMapLayer *ml );
 
+    //! Returns true if the layer can reuse its image from before a pan, rendering only the newly exposed area
+    bool canRenderPanned( QgsMapLayer *ml ) const;
+
     const QgsFeatureFilterProvider *mFeatureFilterProvider = nullptr;
 };
 
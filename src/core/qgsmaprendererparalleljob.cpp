@@ -22,10 +22,19 @@
 #include "qgsproject.h"
 #include "qgsmaplayer.h"
 #include "qgsmaplayerlistutils.h"
+#include "qgsmaplayerstylemanager.h"
+#include "qgspainteffect.h"
+#include "qgspallabeling.h"
+#include "qgsrenderer.h"
+#include "qgsvectorlayer.h"
+#include "qgsvectorlayerrenderer.h"
 
 #include <QtConcurrentMap>
 #include <QtConcurrentRun>
 
+#include <cmath>
+#include <limits>
+
 QgsMapRendererParallelJob::QgsMapRendererParallelJob( const QgsMapSettings &settings )
   : QgsMapRendererQImageJob( settings )
   , mStatus( Idle )
@@ -61,13 +70,31 @@ void QgsMapRendererParallelJob::start()
   mLayerJobs = prepareJobs( nullptr, mLabelingEngineV2.get() );
   mLabelJob = prepareLabelingJob( nullptr, mLabelingEngineV2.get(), canUseLabelCache );
 
+  // label candidates of each layer are generated as soon as the layer has been rendered,
+  // so that only solving the labeling problem is left once all layers are done
+  if ( mLabelingEngineV2 && !mLabelJob.cached )
+    mLabelingEngineV2->prepare( mLabelJob.context );
+
   QgsDebugMsg( QStringLiteral( "QThreadPool max thread count is %1" ).arg( QThreadPool::globalInstance()->maxThreadCount() ) );
 
+  prepareTileJobs();
+
+  mRenderQueue.clear();
+  for ( int i = 0; i < mLayerJobs.count(); ++i )
+  {
+    mRenderQueue << &mLayerJobs[i];
+    if ( i == mTiledJobIndex )
+    {
+      for ( LayerRenderJob &tileJob : mTileJobs )
+        mRenderQueue << &tileJob;
+    }
+  }
+
   // start async job
 
   connect( &mFutureWatcher, &QFutureWatcher<void>::finished, this, &QgsMapRendererParallelJob::renderLayersFinished );
 
-  mFuture = QtConcurrent::map( mLayerJobs, renderLayerStatic );
+  mFuture = QtConcurrent::map( mRenderQueue, []( LayerRenderJob * job ) { renderLayerStatic( *job ); } );
   mFutureWatcher.setFuture( mFuture );
 }
 
@@ -79,11 +106,11 @@ void QgsMapRendererParallelJob::cancel()
   QgsDebugMsg( QStringLiteral( "PARALLEL cancel at status %1" ).arg( mStatus ) );
 
   mLabelJob.context.setRenderingStopped( true );
-  for ( LayerRenderJobs::iterator it = mLayerJobs.begin(); it != mLayerJobs.end(); ++it )
+  for ( LayerRenderJob *job : qgis::as_const( mRenderQueue ) )
   {
-    it->context.setRenderingStopped( true );
-    if ( it->renderer && it->renderer->feedback() )
-      it->renderer->feedback()->cancel();
+    job->context.setRenderingStopped( true );
+    if ( job->renderer && job->renderer->feedback() )
+      job->renderer->feedback()->cancel();
   }
 
   if ( mStatus == RenderingLayers )
@@ -115,11 +142,11 @@ void QgsMapRendererParallelJob::cancelWithoutBlocking()
   QgsDebugMsg( QStringLiteral( "PARALLEL cancel at status %1" ).arg( mStatus ) );
 
   mLabelJob.context.setRenderingStopped( true );
-  for ( LayerRenderJobs::iterator it = mLayerJobs.begin(); it != mLayerJobs.end(); ++it )
+  for ( LayerRenderJob *job : qgis::as_const( mRenderQueue ) )
   {
-    it->context.setRenderingStopped( true );
-    if ( it->renderer && it->renderer->feedback() )
-      it->renderer->feedback()->cancel();
+    job->context.setRenderingStopped( true );
+    if ( job->renderer && job->renderer->feedback() )
+      job->renderer->feedback()->cancel();
   }
 
   if ( mStatus == RenderingLayers )
@@ -204,6 +231,8 @@ void QgsMapRendererParallelJob::renderLayersFinished()
     }
   }
 
+  composeTileJobs();
+
   // compose final image
   mFinalImage = composeImage( mSettings, mLayerJobs, mLabelJob );
 
@@ -232,6 +261,10 @@ void QgsMapRendererParallelJob::renderingFinished()
 
   logRenderingTime( mLayerJobs, mLabelJob );
 
+  mRenderQueue.clear();
+  mTiledJobIndex = -1;
+  cleanupJobs( mTileJobs );
+  mTileRects.clear();
   cleanupJobs( mLayerJobs );
 
   cleanupLabelJob( mLabelJob );
@@ -243,6 +276,194 @@ void QgsMapRendererParallelJob::renderingFinished()
   emit finished();
 }
 
+void QgsMapRendererParallelJob::prepareTileJobs()
+{
+  mTiledJobIndex = -1;
+  mTileJobs.clear();
+  mTileRects.clear();
+  mTileCount = 0;
+
+  const int threadCount = QThreadPool::globalInstance()->maxThreadCount();
+  if ( !mSettings.testFlag( QgsMapSettings::RenderTiledLayers ) || threadCount < 2 )
+    return;
+
+  // find the layer with most features, only worth splitting if it dominates the rendering work
+  long totalFeatureCount = 0;
+  long tiledFeatureCount = 0;
+  for ( int i = 0; i < mLayerJobs.count(); ++i )
+  {
+    const LayerRenderJob &job = mLayerJobs.at( i );
+    QgsVectorLayer *vl = qobject_cast< QgsVectorLayer * >( job.layer.data() );
+    if ( !vl || job.cached || !job.renderer )
+      continue;
+
+    const long featureCount = vl->featureCount();
+    if ( featureCount <= 0 )
+      continue;
+
+    totalFeatureCount += featureCount;
+    if ( featureCount > tiledFeatureCount && canRenderInTiles( job ) )
+    {
+      tiledFeatureCount = featureCount;
+      mTiledJobIndex = i;
+    }
+  }
+
+  static const long MIN_TILED_FEATURE_COUNT = 1000;
+  if ( mTiledJobIndex < 0 || tiledFeatureCount < MIN_TILED_FEATURE_COUNT || tiledFeatureCount * 2 < totalFeatureCount )
+  {
+    mTiledJobIndex = -1;
+    return;
+  }
+
+  LayerRenderJob &job = mLayerJobs[ mTiledJobIndex ];
+  QgsVectorLayer *vl = qobject_cast< QgsVectorLayer * >( job.layer.data() );
+
+  // one tile per thread, arranged in a roughly square grid of whole pixels
+  const int columns = static_cast< int >( std::ceil( std::sqrt( static_cast< double >( threadCount ) ) ) );
+  const int rows = ( threadCount + columns - 1 ) / columns;
+  const QSize size = mSettings.outputSize();
+  if ( size.width() < columns || size.height() < rows )
+  {
+    mTiledJobIndex = -1;
+    return;
+  }
+
+  QgsMapLayerStyleOverride styleOverride( vl );
+  if ( mSettings.layerStyleOverrides().contains( vl->id() ) )
+    styleOverride.setOverrideStyle( mSettings.layerStyleOverrides().value( vl->id() ) );
+
+  for ( int row = 0; row < rows; ++row )
+  {
+    for ( int column = 0; column < columns; ++column )
+    {
+      const QRect tileRect( QPoint( size.width() * column / columns, size.height() * row / rows ),
+                            QPoint( size.width() * ( column + 1 ) / columns - 1, size.height() * ( row + 1 ) / rows - 1 ) );
+
+      // every tile renders all the features of the layer, clipped to its own part of the layer image, so
+      // that each pixel is drawn from the same features in the same order as without tiles
+      if ( row == 0 && column == 0 )
+      {
+        // the first tile is drawn by the layer job, directly into the layer image
+        job.context.painter()->setClipRect( tileRect );
+        continue;
+      }
+
+      QImage *img = new QImage( tileRect.size() * mSettings.devicePixelRatio(), mSettings.outputImageFormat() );
+      img->setDevicePixelRatio( mSettings.devicePixelRatio() );
+      if ( img->isNull() )
+      {
+        // not enough memory for another tile, render the layer in one piece instead
+        delete img;
+        for ( LayerRenderJob &tileJob : mTileJobs )
+        {
+          delete tileJob.context.painter();
+          delete tileJob.img;
+          delete tileJob.renderer;
+        }
+        mTileJobs.clear();
+        mTileRects.clear();
+        job.context.painter()->setClipping( false );
+        mTiledJobIndex = -1;
+        return;
+      }
+
+      mTileJobs.append( LayerRenderJob() );
+      mTileRects.append( tileRect );
+      LayerRenderJob &tileJob = mTileJobs.last();
+      // the context keeps the full map extent and map to pixel transform, the painter is translated so
+      // that the tile image covers the tile rectangle
+      tileJob.context = job.context;
+      tileJob.img = img;
+      QPainter *painter = new QPainter( img );
+      painter->setRenderHint( QPainter::Antialiasing, mSettings.testFlag( QgsMapSettings::Antialiasing ) );
+      painter->translate( -tileRect.topLeft() );
+      tileJob.context.setPainter( painter );
+      tileJob.blendMode = QPainter::CompositionMode_SourceOver;
+      tileJob.opacity = 1.0;
+      tileJob.cached = false;
+      // no layer, so that tile images are never cached or reported as separate layers
+      tileJob.layer = nullptr;
+      tileJob.renderingTime = 0;
+      tileJob.renderer = new QgsVectorLayerRenderer( vl, tileJob.context );
+    }
+  }
+  mTileCount = mTileJobs.count() + 1;
+}
+
+bool QgsMapRendererParallelJob::canRenderInTiles( const LayerRenderJob &job ) const
+{
+  QgsVectorLayer *vl = qobject_cast< QgsVectorLayer * >( job.layer.data() );
+  if ( !vl || !job.img || job.partial || !dynamic_cast< QgsVectorLayerRenderer * >( job.renderer ) )
+    return false;
+
+  // tiles are aligned on whole device pixels
+  if ( !qgsDoubleNear( mSettings.devicePixelRatio(), std::round( mSettings.devicePixelRatio() ) ) )
+    return false;
+
+  const QgsRectangle extent = job.context.extent();
+  if ( !extent.isFinite() || extent.isEmpty() || extent.width() >= std::numeric_limits<double>::max() || extent.height() >= std::numeric_limits<double>::max() )
+    return false;
+
+  // labels and diagrams would be registered once per tile
+  if ( mLabelingEngineV2 && QgsPalLabeling::staticWillUseLayer( vl ) )
+    return false;
+
+  // blending between features must happen on a single image
+  if ( vl->featureBlendMode() != QPainter::CompositionMode_SourceOver )
+    return false;
+
+  QgsMapLayerStyleOverride styleOverride( vl );
+  if ( mSettings.layerStyleOverrides().contains( vl->id() ) )
+    styleOverride.setOverrideStyle( mSettings.layerStyleOverrides().value( vl->id() ) );
+
+  QgsFeatureRenderer *renderer = vl->renderer();
+  if ( !renderer )
+    return false;
+
+  // the drawing order of symbol levels, feature ordering and layer effects span all features of the layer
+  if ( ( renderer->capabilities() & QgsFeatureRenderer::SymbolLevels ) && renderer->usingSymbolLevels() )
+    return false;
+  if ( renderer->orderByEnabled() )
+    return false;
+  if ( renderer->paintEffect() && renderer->paintEffect()->enabled() )
+    return false;
+
+  // renderers which need to see neighboring features (e.g. point displacement or heatmaps) extend their request extent
+  QgsRectangle requestExtent = extent;
+  QgsRenderContext context = job.context;
+  renderer->modifyRequestExtent( requestExtent, context );
+  return requestExtent == extent;
+}
+
+void QgsMapRendererParallelJob::composeTileJobs()
+{
+  if ( mTiledJobIndex < 0 )
+    return;
+
+  LayerRenderJob &job = mLayerJobs[ mTiledJobIndex ];
+  QPainter *painter = job.context.painter();
+  if ( !job.imageInitialized || !painter )
+    return;
+
+  painter->save();
+  painter->resetTransform();
+  // the layer job only drew the first tile, the other parts of the layer image are still transparent
+  painter->setClipping( false );
+  painter->setCompositionMode( QPainter::CompositionMode_SourceOver );
+  painter->setOpacity( 1.0 );
+  for ( int i = 0; i < mTileJobs.count(); ++i )
+  {
+    const LayerRenderJob &tileJob = mTileJobs.at( i );
+    if ( !tileJob.imageInitialized )
+      continue;
+
+    painter->drawImage( mTileRects.at( i ).topLeft(), *tileJob.img );
+    job.renderingTime = std::max( job.renderingTime, tileJob.renderingTime );
+  }
+  painter->restore();
+}
+
 void QgsMapRendererParallelJob::renderLayerStatic( LayerRenderJob &job )
 {
   if ( job.context.renderingStopped() )
@@ -251,7 +472,8 @@ void QgsMapRendererParallelJob::renderLayerStatic( LayerRenderJob &job )
   if ( job.cached )
     return;
 
-  if ( job.img )
+  // partial jobs already contain the image from before a pan
+  if ( job.img && !job.partial )
   {
     job.img->fill( 0 );
     job.imageInitialized = true;
@@ -282,6 +504,21 @@ void QgsMapRendererParallelJob::renderLayerStatic( LayerRenderJob &job )
   job.errors = job.renderer->errors();
   job.renderingTime += t.elapsed();
   QgsDebugMsgLevel( QStringLiteral( "job %1 end [%2 ms] (layer %3)" ).arg( reinterpret_cast< quint64 >( &job ), 0, 16 ).arg( job.renderingTime ).arg( job.layer ? job.layer->id() : QString() ), 2 );
+
+  // all label features of the layer are known now, generate their candidates while other layers are still rendering
+  QgsLabelingEngine *labelingEngine = job.context.labelingEngine();
+  if ( labelingEngine && job.layer && !job.context.renderingStopped() )
+  {
+    try
+    {
+      labelingEngine->processLayer( job.layer->id(), job.context );
+    }
+    catch ( std::exception &e )
+    {
+      Q_UNUSED( e );
+      QgsDebugMsg( "Caught unhandled std::exception while labeling: " + QString::fromLatin1( e.what() ) );
+    }
+  }
 }
 
 
@@ -27,6 +27,11 @@
  * The resulting map image can be retrieved with renderedImage() function.
  * It is safe to call that function while rendering is active to see preview of the map.
  *
+ * If the QgsMapSettings::RenderTiledLayers flag is set, a vector layer holding most of the
+ * features to render is additionally split into tiles of the map image, which are rendered in
+ * parallel and composited into the layer's image once all of them are finished. Each tile
+ * renders all the features of the layer, clipped to its part of the image.
+ *
  * \since QGIS 2.4
  */
 class CORE_EXPORT QgsMapRendererParallelJob : public QgsMapRendererQImageJob
@@ -61,6 +66,22 @@ class CORE_EXPORT QgsMapRendererParallelJob : public QgsMapRendererQImageJob
     //! \note not available in Python bindings
     static void renderLabelsStatic( QgsMapRendererParallelJob *self ) SIP_SKIP;
 
+    /**
+     * Splits the heaviest eligible vector layer job into tiles, if tiled rendering is enabled.
+     * \note not available in Python bindings
+     */
+    void prepareTileJobs() SIP_SKIP;
+
+    /**
+     * Returns true if the layer rendered by \a job can be split into tiles without
+     * changing the rendered result.
+     * \note not available in Python bindings
+     */
+    bool canRenderInTiles( const LayerRenderJob &job ) const SIP_SKIP;
+
+    //! Composites the images of finished tile jobs into the image of the tiled layer job
+    void composeTileJobs();
+
     QImage mFinalImage;
 
     //! \note not available in Python bindings
@@ -72,11 +93,23 @@ class CORE_EXPORT QgsMapRendererParallelJob : public QgsMapRendererQImageJob
     LayerRenderJobs mLayerJobs;
     LabelRenderJob mLabelJob;
 
+    //! Additional tiles of the tiled layer job, the first tile is rendered by the layer job itself
+    LayerRenderJobs mTileJobs;
+    //! Parts of the layer image covered by the images of mTileJobs, in logical pixels
+    QList< QRect > mTileRects;
+    //! Index of the tiled layer job in mLayerJobs, or -1 if no layer is rendered in tiles
+    int mTiledJobIndex = -1;
+    //! Number of tiles the tiled layer was split into during the last render, including the layer job itself
+    int mTileCount = 0;
+    //! All jobs which are rendered concurrently, i.e. layer jobs and tile jobs
+    QList< LayerRenderJob * > mRenderQueue;
+
     //! New labeling engine
     std::unique_ptr< QgsLabelingEngine > mLabelingEngineV2;
     QFuture<void> mLabelingFuture;
     QFutureWatcher<void> mLabelingFutureWatcher;
 
+    friend class TestQgsMapRendererJob;
 };
 
 
@@ -29,9 +29,13 @@
 #include "qgsvectordataprovider.h"
 #include "qgsvectorlayer.h"
 
+#include <QElapsedTimer>
 #include <QProgressDialog>
 
-#define FEATURE_BUFFER_SIZE 200
+#include <algorithm>
+
+// large enough for providers to write the buffered features in bulk, e.g. with COPY in PostgreSQL
+#define FEATURE_BUFFER_SIZE 1000
 
 typedef QgsVectorLayerExporter::ExportError createEmptyLayer_t(
   const QString &uri,
@@ -362,6 +366,9 @@ QgsVectorLayerExporter::exportLayer( QgsVectorLayer *layer,
   long n = 0;
   long approxTotal = onlySelected ? layer->selectedFeatureCount() : layer->featureCount();
 
+  QElapsedTimer timer;
+  timer.start();
+
   if ( errorMessage )
   {
     *errorMessage = QObject::tr( "Feature write errors:" );
@@ -441,6 +448,11 @@ QgsVectorLayerExporter::exportLayer( QgsVectorLayer *layer,
   }
   int errors = writer->errorCount();
 
+  QgsDebugMsgLevel( QStringLiteral( "Wrote %1 features in %2 ms (%3 features/s)" )
+                    .arg( n )
+                    .arg( timer.elapsed() )
+                    .arg( n * 1000.0 / std::max< qint64 >( 1, timer.elapsed() ), 0, 'f', 0 ), 2 );
+
   if ( !writer->createSpatialIndex() )
   {
     if ( writer->errorCode() && errorMessage )
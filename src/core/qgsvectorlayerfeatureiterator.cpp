@@ -13,6 +13,7 @@
  *                                                                         *
  ***************************************************************************/
 #include "qgsvectorlayerfeatureiterator.h"
+#include "qgsfeaturebatch.h"
 
 #include "qgsexpressionfieldbuffer.h"
 #include "qgsgeometrysimplifier.h"
@@ -376,6 +377,35 @@ bool QgsVectorLayerFeatureIterator::fetchFeature( QgsFeature &f )
 }
 
 
+int QgsVectorLayerFeatureIterator::fetchBatch( QgsFeatureBatch &batch, int maximumSize )
+{
+  bool passThrough = !mSource->mHasEditBuffer && !mHasVirtualAttributes && !mTransform.isValid()
+                     && mRequest.filterType() == QgsFeatureRequest::FilterNone
+                     && mRequest.invalidGeometryCheck() == QgsFeatureRequest::GeometryNoCheck;
+  for ( int i = 0; passThrough && i < mSource->mFields.count(); ++i )
+  {
+    passThrough = mSource->mFields.fieldOrigin( i ) == QgsFields::OriginProvider;
+  }
+  if ( !passThrough )
+    return QgsAbstractFeatureIterator::fetchBatch( batch, maximumSize );
+
+  if ( mClosed )
+    return 0;
+
+  if ( mProviderIterator.isClosed() )
+  {
+    mChangedFeaturesIterator.close();
+    mProviderIterator = mSource->mProviderFeatureSource->getFeatures( mProviderRequest );
+    mProviderIterator.setInterruptionChecker( mInterruptionChecker );
+  }
+
+  if ( !mProviderIterator.nextBatch( batch, maximumSize ) )
+  {
+    close();
+    return 0;
+  }
+  return batch.count();
+}
 
 bool QgsVectorLayerFeatureIterator::rewind()
 {
@@ -162,6 +162,12 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
      */
     bool nextFeatureFilterExpression( QgsFeature &f ) override { return fetchFeature( f ); }
 
+    /**
+     * Passes batches straight through from the provider iterator when the layer does not
+     * modify the provider features (no edit buffer, virtual fields or reprojection).
+     */
+    int fetchBatch( QgsFeatureBatch &batch, int maximumSize ) override;
+
     //! Setup the simplification of geometries to fetch using the specified simplify method
     bool prepareSimplification( const QgsSimplifyMethod &simplifyMethod ) override;
 
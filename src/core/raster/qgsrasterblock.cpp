@@ -15,7 +15,9 @@
  *                                                                         *
  ***************************************************************************/
 
+#include <algorithm>
 #include <limits>
+#include <vector>
 
 #include <QByteArray>
 #include <QColor>
@@ -27,6 +29,176 @@
 // See #9101 before any change of NODATA_COLOR!
 const QRgb QgsRasterBlock::NO_DATA_COLOR = qRgba( 0, 0, 0, 0 );
 
+///@cond PRIVATE
+
+// Bulk kernels working on whole rows of typed data. They are written as simple
+// loops without branches so that compilers can vectorize them.
+namespace
+{
+
+  /**
+   * Calls \a function with \a data cast to a pointer to the numeric type of \a dataType.
+   * \returns false if the type is not numeric
+   */
+  template< typename F >
+  bool dispatchType( Qgis::DataType dataType, void *data, F &function )
+  {
+    switch ( dataType )
+    {
+      case Qgis::Byte:
+        function( static_cast< quint8 * >( data ) );
+        return true;
+      case Qgis::UInt16:
+        function( static_cast< quint16 * >( data ) );
+        return true;
+      case Qgis::Int16:
+        function( static_cast< qint16 * >( data ) );
+        return true;
+      case Qgis::UInt32:
+        function( static_cast< quint32 * >( data ) );
+        return true;
+      case Qgis::Int32:
+        function( static_cast< qint32 * >( data ) );
+        return true;
+      case Qgis::Float32:
+        function( static_cast< float * >( data ) );
+        return true;
+      case Qgis::Float64:
+        function( static_cast< double * >( data ) );
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  struct ReadValues
+  {
+    qgssize offset;
+    int count;
+    double *values;
+
+    template< typename T > void operator()( const T *data )
+    {
+      const T *src = data + offset;
+      for ( int i = 0; i < count; ++i )
+        values[i] = static_cast< double >( src[i] );
+    }
+  };
+
+  struct FillValue
+  {
+    qgssize size;
+    double value;
+
+    template< typename T > void operator()( T *data )
+    {
+      std::fill( data, data + size, static_cast< T >( value ) );
+    }
+  };
+
+  struct SetValues
+  {
+    qgssize offset;
+    int count;
+    const quint8 *mask;
+    double value;
+
+    template< typename T > void operator()( T *data )
+    {
+      T *dest = data + offset;
+      const T v = static_cast< T >( value );
+      for ( int i = 0; i < count; ++i )
+        dest[i] = mask[i] ? v : dest[i];
+    }
+  };
+
+  struct ScaleOffset
+  {
+    qgssize offset;
+    int count;
+    const quint8 *mask;
+    double scale;
+    double add;
+
+    template< typename T > void operator()( T *data )
+    {
+      T *dest = data + offset;
+      for ( int i = 0; i < count; ++i )
+      {
+        // the scaled value is only cast for valid pixels, no data may be out of the range of the type
+        dest[i] = mask[i] ? dest[i] : static_cast< T >( static_cast< double >( dest[i] ) * scale + add );
+      }
+    }
+  };
+
+  template< typename S >
+  struct ConvertTo
+  {
+    const S *src;
+    qgssize size;
+
+    template< typename D > void operator()( D *dest )
+    {
+      // converted through double, as writeValue( readValue() ) does
+      for ( qgssize i = 0; i < size; ++i )
+        dest[i] = static_cast< D >( static_cast< double >( src[i] ) );
+    }
+  };
+
+  struct Convert
+  {
+    Qgis::DataType destDataType;
+    void *destData;
+    qgssize size;
+    bool ok;
+
+    template< typename S > void operator()( const S *src )
+    {
+      ConvertTo< S > to{ src, size };
+      ok = dispatchType( destDataType, destData, to );
+    }
+  };
+
+  //! Fills \a mask with 1 for values which are nan or equal to \a noDataValue, as QgsRasterBlock::isNoDataValue()
+  void noDataValueMask( const double *values, int count, double noDataValue, quint8 *mask )
+  {
+    for ( int i = 0; i < count; ++i )
+    {
+      const double value = values[i];
+      mask[i] = static_cast< quint8 >( std::isnan( value ) || qgsDoubleNear( value, noDataValue ) );
+    }
+  }
+
+  //! Expands \a count bits of a no data bitmap row to one byte per pixel
+  void bitmapMask( const char *bitmapRow, int count, quint8 *mask )
+  {
+    const quint8 *bits = reinterpret_cast< const quint8 * >( bitmapRow );
+    for ( int i = 0; i < count; ++i )
+      mask[i] = ( bits[i >> 3] >> ( 7 - ( i & 7 ) ) ) & 1;
+  }
+
+  //! Sets the bits of a no data bitmap row for every pixel where \a mask is not 0
+  void setBitmapMask( char *bitmapRow, int count, const quint8 *mask )
+  {
+    quint8 *bits = reinterpret_cast< quint8 * >( bitmapRow );
+    const int fullBytes = count / 8;
+    for ( int byte = 0; byte < fullBytes; ++byte )
+    {
+      const quint8 *m = mask + byte * 8;
+      const quint8 packed = ( ( m[0] != 0 ) << 7 ) | ( ( m[1] != 0 ) << 6 ) | ( ( m[2] != 0 ) << 5 ) | ( ( m[3] != 0 ) << 4 )
+                            | ( ( m[4] != 0 ) << 3 ) | ( ( m[5] != 0 ) << 2 ) | ( ( m[6] != 0 ) << 1 ) | ( m[7] != 0 );
+      bits[byte] |= packed;
+    }
+    for ( int i = fullBytes * 8; i < count; ++i )
+    {
+      bits[i >> 3] |= static_cast< quint8 >( ( mask[i] != 0 ) << ( 7 - ( i & 7 ) ) );
+    }
+  }
+
+}
+
+///@endcond
+
 QgsRasterBlock::QgsRasterBlock()
   : mNoDataValue( std::numeric_limits<double>::quiet_NaN() )
 {
@@ -245,14 +417,8 @@ bool QgsRasterBlock::setIsNoData()
       }
 
       QgsDebugMsgLevel( QStringLiteral( "set mData to mNoDataValue" ), 4 );
-      int dataTypeSize = typeSize( mDataType );
-      QByteArray noDataByteArray = valueBytes( mDataType, mNoDataValue );
-
-      char *nodata = noDataByteArray.data();
-      for ( qgssize i = 0; i < static_cast< qgssize >( mWidth )*mHeight; i++ )
-      {
-        memcpy( reinterpret_cast< char * >( mData ) + i * dataTypeSize, nodata, dataTypeSize );
-      }
+      FillValue fill{ static_cast< qgssize >( mWidth ) * mHeight, mNoDataValue };
+      dispatchType( mDataType, mData, fill );
     }
     else
     {
@@ -550,10 +716,14 @@ void QgsRasterBlock::applyScaleOffset( double scale, double offset )
   if ( !typeIsNumeric( mDataType ) ) return;
   if ( scale == 1.0 && offset == 0.0 ) return;
 
-  qgssize size = static_cast< qgssize >( mWidth ) * mHeight;
-  for ( qgssize i = 0; i < size; ++i )
+  std::vector< double > values( mWidth );
+  std::vector< quint8 > isNoData( mWidth );
+  for ( int row = 0; row < mHeight; ++row )
   {
-    if ( !isNoData( i ) ) setValue( i, value( i ) * scale + offset );
+    if ( !readRow( row, values.data(), isNoData.data() ) )
+      return;
+    ScaleOffset scaleOffset{ static_cast< qgssize >( row ) * mWidth, mWidth, isNoData.data(), scale, offset };
+    dispatchType( mDataType, mData, scaleOffset );
   }
 }
 
@@ -563,17 +733,106 @@ void QgsRasterBlock::applyNoDataValues( const QgsRasterRangeList &rangeList )
   {
     return;
   }
+  if ( isEmpty() || !typeIsNumeric( mDataType ) )
+  {
+    return;
+  }
+
+  std::vector< double > values( mWidth );
+  std::vector< quint8 > inRange( mWidth );
+  for ( int row = 0; row < mHeight; ++row )
+  {
+    if ( !readRow( row, values.data() ) )
+      return;
+    bool found = false;
+    for ( int column = 0; column < mWidth; ++column )
+    {
+      const bool contains = QgsRasterRange::contains( values[column], rangeList );
+      inRange[column] = contains;
+      found |= contains;
+    }
+    if ( found )
+      setRowIsNoData( row, inRange.data() );
+  }
+}
+
+bool QgsRasterBlock::readRow( int row, double *values, quint8 *isNoData ) const
+{
+  if ( !mData || row < 0 || row >= mHeight )
+    return false;
+
+  ReadValues read{ static_cast< qgssize >( row ) * mWidth, mWidth, values };
+  if ( !dispatchType( mDataType, mData, read ) )
+    return false;
+
+  if ( isNoData )
+  {
+    if ( mHasNoDataValue )
+      noDataValueMask( values, mWidth, mNoDataValue, isNoData );
+    else if ( mNoDataBitmap )
+      bitmapMask( mNoDataBitmap + static_cast< qgssize >( row ) * mNoDataBitmapWidth, mWidth, isNoData );
+    else
+      std::fill( isNoData, isNoData + mWidth, 0 );
+  }
+  return true;
+}
+
+bool QgsRasterBlock::setRowIsNoData( int row, const quint8 *isNoData )
+{
+  if ( !mData || row < 0 || row >= mHeight || !typeIsNumeric( mDataType ) )
+    return false;
+
+  if ( mHasNoDataValue )
+  {
+    SetValues set{ static_cast< qgssize >( row ) * mWidth, mWidth, isNoData, mNoDataValue };
+    return dispatchType( mDataType, mData, set );
+  }
 
-  qgssize size = static_cast< qgssize >( mWidth ) * static_cast< qgssize >( mHeight );
-  for ( qgssize i = 0; i < size; ++i )
+  if ( !mNoDataBitmap )
   {
-    double val = value( i );
-    if ( QgsRasterRange::contains( val, rangeList ) )
+    if ( !createNoDataBitmap() )
     {
-      //setValue( i, mNoDataValue );
-      setIsNoData( i );
+      return false;
     }
   }
+  setBitmapMask( mNoDataBitmap + static_cast< qgssize >( row ) * mNoDataBitmapWidth, mWidth, isNoData );
+  return true;
+}
+
+bool QgsRasterBlock::computeStatistics( double &minimum, double &maximum, double &sum, qgssize &count ) const
+{
+  minimum = std::numeric_limits<double>::max();
+  maximum = std::numeric_limits<double>::lowest();
+  sum = 0;
+  count = 0;
+  if ( isEmpty() || !typeIsNumeric( mDataType ) )
+    return false;
+
+  std::vector< double > values( mWidth );
+  std::vector< quint8 > isNoData( mWidth );
+  for ( int row = 0; row < mHeight; ++row )
+  {
+    if ( !readRow( row, values.data(), isNoData.data() ) )
+      return false;
+    double rowMin = std::numeric_limits<double>::max();
+    double rowMax = std::numeric_limits<double>::lowest();
+    double rowSum = 0;
+    int rowCount = 0;
+    for ( int column = 0; column < mWidth; ++column )
+    {
+      const double value = values[column];
+      const bool valid = !isNoData[column] && !std::isnan( value );
+      rowMin = valid && value < rowMin ? value : rowMin;
+      rowMax = valid && value > rowMax ? value : rowMax;
+      rowSum += valid ? value : 0.0;
+      rowCount += valid;
+    }
+    minimum = std::min( minimum, rowMin );
+    maximum = std::max( maximum, rowMax );
+    sum += rowSum;
+    count += rowCount;
+  }
+  return count > 0;
 }
 
 QImage QgsRasterBlock::image() const
@@ -664,12 +923,15 @@ void *QgsRasterBlock::convert( void *srcData, Qgis::DataType srcDataType, Qgis::
 {
   int destDataTypeSize = typeSize( destDataType );
   void *destData = qgsMalloc( destDataTypeSize * size );
-  for ( qgssize i = 0; i < size; i++ )
+  if ( !destData )
+    return nullptr;
+
+  Convert convert{ destDataType, destData, size, false };
+  if ( !dispatchType( srcDataType, srcData, convert ) || !convert.ok )
   {
-    double value = readValue( srcData, srcDataType, i );
-    writeValue( destData, destDataType, i, value );
-    //double newValue = readValue( destData, destDataType, i );
-    //QgsDebugMsg( QStringLiteral("convert %1 type %2 to %3: %4 -> %5").arg(i).arg(srcDataType).arg(destDataType).arg( value ).arg( newValue ) );
+    QgsDebugMsg( QStringLiteral( "Cannot convert data type %1 to %2" ).arg( srcDataType ).arg( destDataType ) );
+    qgsFree( destData );
+    return nullptr;
   }
   return destData;
 }
@@ -595,6 +595,43 @@ class CORE_EXPORT QgsRasterBlock
     */
     void applyScaleOffset( double scale, double offset );
 
+    /**
+     * Reads all values of a \a row of the block, converted to double, into \a values.
+     * If \a isNoData is not null, it is filled with 1 for pixels which are no data and 0 for other pixels.
+     * \a values and \a isNoData must have room for width() values.
+     *
+     * This is much faster than calling valueAndNoData() for each pixel and should be
+     * preferred when processing whole rows, e.g. in renderers.
+     *
+     * \returns false if the block is not numeric or \a row is out of range
+     * \note not available in Python bindings
+     * \see setRowIsNoData()
+     * \since QGIS 3.6
+     */
+    bool readRow( int row, double *values, quint8 *isNoData = nullptr ) const SIP_SKIP;
+
+    /**
+     * Sets pixels of a \a row as no data, for every pixel where \a isNoData is not 0. Other pixels
+     * are left untouched. \a isNoData must contain width() values.
+     *
+     * \returns false if the block is not numeric, \a row is out of range or the no data bitmap could not be allocated
+     * \note not available in Python bindings
+     * \see readRow()
+     * \since QGIS 3.6
+     */
+    bool setRowIsNoData( int row, const quint8 *isNoData ) SIP_SKIP;
+
+    /**
+     * Calculates the \a minimum, \a maximum and \a sum of all values of the block which are not no data
+     * or NaN, and stores the number of these values in \a count.
+     *
+     * \returns false if the block is not numeric, if its values cannot be read (e.g. complex types)
+     * or if it does not contain any value which is not no data
+     * \note not available in Python bindings
+     * \since QGIS 3.6
+     */
+    bool computeStatistics( double &minimum, double &maximum, double &sum, qgssize &count ) const SIP_SKIP;
+
     //! Returns the last error
     QgsError error() const { return mError; }
 
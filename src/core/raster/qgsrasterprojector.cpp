@@ -22,6 +22,11 @@
 #include "qgscoordinatetransform.h"
 #include "qgsexception.h"
 
+#include <QMutex>
+#include <QThreadPool>
+#include <QtConcurrentMap>
+#include <memory>
+
 
 QgsRasterProjector::QgsRasterProjector()
   : QgsRasterInterface( nullptr )
@@ -39,6 +44,8 @@ QgsRasterProjector *QgsRasterProjector::clone() const
   projector->mSrcDatumTransform = mSrcDatumTransform;
   projector->mDestDatumTransform = mDestDatumTransform;
   projector->mPrecision = mPrecision;
+  projector->mSrcCrsWkt = mSrcCrsWkt;
+  projector->mDestCrsWkt = mDestCrsWkt;
   return projector;
 }
 
@@ -66,12 +73,32 @@ void QgsRasterProjector::setCrs( const QgsCoordinateReferenceSystem &srcCRS, con
   mDestCRS = destCRS;
   mSrcDatumTransform = srcDatumTransform;
   mDestDatumTransform = destDatumTransform;
+  mSrcCrsWkt = mSrcCRS.toWkt();
+  mDestCrsWkt = mDestCRS.toWkt();
 }
 
 
+void ProjectorData::sourceGrid( QgsRasterInterface *input, QgsRectangle &extent, double &xRes, double &yRes )
+{
+  xRes = 0;
+  yRes = 0;
+  if ( !input )
+    return;
+
+  QgsRasterDataProvider *provider = dynamic_cast<QgsRasterDataProvider *>( input->sourceInput() );
+  if ( provider )
+  {
+    if ( provider->capabilities() & QgsRasterDataProvider::Size )
+    {
+      xRes = provider->extent().width() / provider->xSize();
+      yRes = provider->extent().height() / provider->ySize();
+    }
+    extent = provider->extent();
+  }
+}
+
 ProjectorData::ProjectorData( const QgsRectangle &extent, int width, int height, QgsRasterInterface *input, const QgsCoordinateTransform &inverseCt, QgsRasterProjector::Precision precision )
   : mApproximate( false )
-  , mInverseCt( inverseCt )
   , mDestExtent( extent )
   , mDestRows( height )
   , mDestCols( width )
@@ -83,7 +110,6 @@ ProjectorData::ProjectorData( const QgsRectangle &extent, int width, int height,
   , mSrcYRes( 0.0 )
   , mDestRowsPerMatrixRow( 0.0 )
   , mDestColsPerMatrixCol( 0.0 )
-  , mHelperTopRow( 0 )
   , mCPCols( 0 )
   , mCPRows( 0 )
   , mSqrTolerance( 0.0 )
@@ -93,23 +119,7 @@ ProjectorData::ProjectorData( const QgsRectangle &extent, int width, int height,
   QgsDebugMsgLevel( QStringLiteral( "Entered" ), 4 );
 
   // Get max source resolution and extent if possible
-  if ( input )
-  {
-    QgsRasterDataProvider *provider = dynamic_cast<QgsRasterDataProvider *>( input->sourceInput() );
-    if ( provider )
-    {
-      if ( provider->capabilities() & QgsRasterDataProvider::Size )
-      {
-        mMaxSrcXRes = provider->extent().width() / provider->xSize();
-        mMaxSrcYRes = provider->extent().height() / provider->ySize();
-      }
-      // Get source extent
-      if ( mExtent.isEmpty() )
-      {
-        mExtent = provider->extent();
-      }
-    }
-  }
+  sourceGrid( input, mExtent, mMaxSrcXRes, mMaxSrcYRes );
 
   mDestXRes = mDestExtent.width() / ( mDestCols );
   mDestYRes = mDestExtent.height() / ( mDestRows );
@@ -186,26 +196,13 @@ ProjectorData::ProjectorData( const QgsRectangle &extent, int width, int height,
   QgsDebugMsgLevel( QStringLiteral( "CPMatrix:" ), 5 );
   QgsDebugMsgLevel( cpToString(), 5 );
 
-  // init helper points
-  pHelperTop = new QgsPointXY[mDestCols];
-  pHelperBottom = new QgsPointXY[mDestCols];
-  calcHelper( 0, pHelperTop );
-  calcHelper( 1, pHelperBottom );
-  mHelperTopRow = 0;
-
   // Calculate source dimensions
   calcSrcExtent();
-  calcSrcRowsCols();
+  calcSrcRowsCols( inverseCt );
   mSrcYRes = mSrcExtent.height() / mSrcRows;
   mSrcXRes = mSrcExtent.width() / mSrcCols;
 }
 
-ProjectorData::~ProjectorData()
-{
-  delete[] pHelperTop;
-  delete[] pHelperBottom;
-}
-
 
 void ProjectorData::calcSrcExtent()
 {
@@ -296,7 +293,7 @@ QString ProjectorData::cpToString()
   return myString;
 }
 
-void ProjectorData::calcSrcRowsCols()
+void ProjectorData::calcSrcRowsCols( const QgsCoordinateTransform &ct )
 {
   // Wee need to calculate minimum cell size in the source
   // TODO: Think it over better, what is the right source resolution?
@@ -338,7 +335,7 @@ void ProjectorData::calcSrcRowsCols()
     //double
     QgsRectangle srcExtent;
     int srcXSize, srcYSize;
-    if ( QgsRasterProjector::extentSize( mInverseCt, mDestExtent, mDestCols, mDestRows, srcExtent, srcXSize, srcYSize ) )
+    if ( QgsRasterProjector::extentSize( ct, mDestExtent, mDestCols, mDestRows, srcExtent, srcXSize, srcYSize ) )
     {
       double srcXRes = srcExtent.width() / srcXSize;
       double srcYRes = srcExtent.height() / srcYSize;
@@ -370,22 +367,22 @@ void ProjectorData::calcSrcRowsCols()
 }
 
 
-inline void ProjectorData::destPointOnCPMatrix( int row, int col, double *theX, double *theY )
+inline void ProjectorData::destPointOnCPMatrix( int row, int col, double *theX, double *theY ) const
 {
   *theX = mDestExtent.xMinimum() + col * mDestExtent.width() / ( mCPCols - 1 );
   *theY = mDestExtent.yMaximum() - row * mDestExtent.height() / ( mCPRows - 1 );
 }
 
-inline int ProjectorData::matrixRow( int destRow )
+inline int ProjectorData::matrixRow( int destRow ) const
 {
   return static_cast< int >( std::floor( ( destRow + 0.5 ) / mDestRowsPerMatrixRow ) );
 }
-inline int ProjectorData::matrixCol( int destCol )
+inline int ProjectorData::matrixCol( int destCol ) const
 {
   return static_cast< int >( std::floor( ( destCol + 0.5 ) / mDestColsPerMatrixCol ) );
 }
 
-void ProjectorData::calcHelper( int matrixRow, QgsPointXY *points )
+void ProjectorData::calcHelper( int matrixRow, QgsPointXY *points ) const
 {
   // TODO?: should we also precalc dest cell center coordinates for x and y?
   for ( int myDestCol = 0; myDestCol < mDestCols; myDestCol++ )
@@ -401,8 +398,8 @@ void ProjectorData::calcHelper( int matrixRow, QgsPointXY *points )
 
     double xfrac = ( myDestX - myDestXMin ) / ( myDestXMax - myDestXMin );
 
-    QgsPointXY &mySrcPoint0 = mCPMatrix[matrixRow][myMatrixCol];
-    QgsPointXY &mySrcPoint1 = mCPMatrix[matrixRow][myMatrixCol + 1];
+    const QgsPointXY &mySrcPoint0 = mCPMatrix.at( matrixRow ).at( myMatrixCol );
+    const QgsPointXY &mySrcPoint1 = mCPMatrix.at( matrixRow ).at( myMatrixCol + 1 );
     double s = mySrcPoint0.x() + ( mySrcPoint1.x() - mySrcPoint0.x() ) * xfrac;
     double t = mySrcPoint0.y() + ( mySrcPoint1.y() - mySrcPoint0.y() ) * xfrac;
 
@@ -411,133 +408,124 @@ void ProjectorData::calcHelper( int matrixRow, QgsPointXY *points )
   }
 }
 
-void ProjectorData::nextHelper()
-{
-  // We just switch pHelperTop and pHelperBottom, memory is not lost
-  QgsPointXY *tmp = nullptr;
-  tmp = pHelperTop;
-  pHelperTop = pHelperBottom;
-  pHelperBottom = tmp;
-  calcHelper( mHelperTopRow + 2, pHelperBottom );
-  mHelperTopRow++;
-}
-
-bool ProjectorData::srcRowCol( int destRow, int destCol, int *srcRow, int *srcCol )
+void ProjectorData::srcIndexes( int destRow, qint64 *indexes, ApproximateHelper &helper, const QgsCoordinateTransform &inverseCt ) const
 {
   if ( mApproximate )
   {
-    return approximateSrcRowCol( destRow, destCol, srcRow, srcCol );
+    approximateSrcIndexes( destRow, indexes, helper );
   }
   else
   {
-    return preciseSrcRowCol( destRow, destCol, srcRow, srcCol );
+    preciseSrcIndexes( destRow, indexes, inverseCt );
   }
 }
 
-bool ProjectorData::preciseSrcRowCol( int destRow, int destCol, int *srcRow, int *srcCol )
+inline qint64 ProjectorData::srcIndex( double x, double y ) const
 {
-#ifdef QGISDEBUG
-  QgsDebugMsgLevel( QStringLiteral( "theDestRow = %1" ).arg( destRow ), 5 );
-  QgsDebugMsgLevel( QStringLiteral( "theDestRow = %1 mDestExtent.yMaximum() = %2 mDestYRes = %3" ).arg( destRow ).arg( mDestExtent.yMaximum() ).arg( mDestYRes ), 5 );
-#endif
-
-  // Get coordinate of center of destination cell
-  double x = mDestExtent.xMinimum() + ( destCol + 0.5 ) * mDestXRes;
-  double y = mDestExtent.yMaximum() - ( destRow + 0.5 ) * mDestYRes;
-  double z = 0;
-
-#ifdef QGISDEBUG
-  QgsDebugMsgLevel( QStringLiteral( "x = %1 y = %2" ).arg( x ).arg( y ), 5 );
-#endif
+  const double row = std::floor( ( mSrcExtent.yMaximum() - y ) / mSrcYRes );
+  const double col = std::floor( ( x - mSrcExtent.xMinimum() ) / mSrcXRes );
+
+  // With epsg 32661 (Polar Stereographic) it was happening that srcCol == mSrcCols,
+  // so limits are checked as well as the source extent.
+  // Non short-circuit operators, so that the whole row can be computed without branches
+  const bool inside = ( mExtent.xMinimum() <= x ) & ( x <= mExtent.xMaximum() )
+                      & ( mExtent.yMinimum() <= y ) & ( y <= mExtent.yMaximum() )
+                      & ( row >= 0 ) & ( row < mSrcRows ) & ( col >= 0 ) & ( col < mSrcCols );
+  return inside ? static_cast< qint64 >( row ) * mSrcCols + static_cast< qint64 >( col ) : -1;
+}
 
-  if ( mInverseCt.isValid() )
+void ProjectorData::preciseSrcIndexes( int destRow, qint64 *indexes, const QgsCoordinateTransform &inverseCt ) const
+{
+  // Get coordinates of centers of destination cells
+  const double destY = mDestExtent.yMaximum() - ( destRow + 0.5 ) * mDestYRes;
+  std::vector< double > x( mDestCols );
+  std::vector< double > y( mDestCols, destY );
+  std::vector< double > z( mDestCols, 0.0 );
+  for ( int destCol = 0; destCol < mDestCols; ++destCol )
   {
-    mInverseCt.transformInPlace( x, y, z );
+    x[destCol] = mDestExtent.xMinimum() + ( destCol + 0.5 ) * mDestXRes;
   }
 
-#ifdef QGISDEBUG
-  QgsDebugMsgLevel( QStringLiteral( "x = %1 y = %2" ).arg( x ).arg( y ), 5 );
-#endif
-
-  if ( !mExtent.contains( QgsPointXY( x, y ) ) )
+  if ( inverseCt.isValid() )
   {
-    return false;
+    try
+    {
+      inverseCt.transformCoords( mDestCols, x.data(), y.data(), z.data() );
+    }
+    catch ( QgsCsException & )
+    {
+      // transform points one by one, points which cannot be transformed are outside of the source
+      for ( int destCol = 0; destCol < mDestCols; ++destCol )
+      {
+        x[destCol] = mDestExtent.xMinimum() + ( destCol + 0.5 ) * mDestXRes;
+        y[destCol] = destY;
+        z[destCol] = 0;
+        try
+        {
+          inverseCt.transformInPlace( x[destCol], y[destCol], z[destCol] );
+        }
+        catch ( QgsCsException & )
+        {
+          x[destCol] = std::numeric_limits< double >::quiet_NaN();
+        }
+      }
+    }
   }
-  // Get source row col
-  *srcRow = static_cast< int >( std::floor( ( mSrcExtent.yMaximum() - y ) / mSrcYRes ) );
-  *srcCol = static_cast< int >( std::floor( ( x - mSrcExtent.xMinimum() ) / mSrcXRes ) );
-#ifdef QGISDEBUG
-  QgsDebugMsgLevel( QStringLiteral( "mSrcExtent.yMinimum() = %1 mSrcExtent.yMaximum() = %2 mSrcYRes = %3" ).arg( mSrcExtent.yMinimum() ).arg( mSrcExtent.yMaximum() ).arg( mSrcYRes ), 5 );
-  QgsDebugMsgLevel( QStringLiteral( "theSrcRow = %1 srcCol = %2" ).arg( *srcRow ).arg( *srcCol ), 5 );
-#endif
-
-  // With epsg 32661 (Polar Stereographic) it was happening that *srcCol == mSrcCols
-  // For now silently correct limits to avoid crashes
-  // TODO: review
-  // should not happen
-  if ( *srcRow >= mSrcRows ) return false;
-  if ( *srcRow < 0 ) return false;
-  if ( *srcCol >= mSrcCols ) return false;
-  if ( *srcCol < 0 ) return false;
 
-  return true;
+  for ( int destCol = 0; destCol < mDestCols; ++destCol )
+  {
+    indexes[destCol] = srcIndex( x[destCol], y[destCol] );
+  }
 }
 
-bool ProjectorData::approximateSrcRowCol( int destRow, int destCol, int *srcRow, int *srcCol )
+void ProjectorData::approximateSrcIndexes( int destRow, qint64 *indexes, ApproximateHelper &helper ) const
 {
-  int myMatrixRow = matrixRow( destRow );
-  int myMatrixCol = matrixCol( destCol );
+  const int myMatrixRow = matrixRow( destRow );
 
-  if ( myMatrixRow > mHelperTopRow )
+  if ( static_cast< int >( helper.top.size() ) != mDestCols )
   {
-    // TODO: make it more robust (for random, not sequential reading)
-    nextHelper();
+    helper.top.resize( mDestCols );
+    helper.bottom.resize( mDestCols );
+    helper.topRow = -1;
+  }
+  if ( myMatrixRow != helper.topRow )
+  {
+    if ( helper.topRow >= 0 && myMatrixRow == helper.topRow + 1 )
+    {
+      // We just switch top and bottom when reading sequentially
+      std::swap( helper.top, helper.bottom );
+    }
+    else
+    {
+      calcHelper( myMatrixRow, helper.top.data() );
+    }
+    calcHelper( myMatrixRow + 1, helper.bottom.data() );
+    helper.topRow = myMatrixRow;
   }
 
   double myDestY = mDestExtent.yMaximum() - ( destRow + 0.5 ) * mDestYRes;
 
   // See the schema in javax.media.jai.WarpGrid doc (but up side down)
-  // TODO: use some kind of cache of values which can be reused
   double myDestXMin, myDestYMin, myDestXMax, myDestYMax;
 
-  destPointOnCPMatrix( myMatrixRow + 1, myMatrixCol, &myDestXMin, &myDestYMin );
-  destPointOnCPMatrix( myMatrixRow, myMatrixCol + 1, &myDestXMax, &myDestYMax );
-
-  double yfrac = ( myDestY - myDestYMin ) / ( myDestYMax - myDestYMin );
+  destPointOnCPMatrix( myMatrixRow + 1, 0, &myDestXMin, &myDestYMin );
+  destPointOnCPMatrix( myMatrixRow, 1, &myDestXMax, &myDestYMax );
 
-  QgsPointXY &myTop = pHelperTop[destCol];
-  QgsPointXY &myBot = pHelperBottom[destCol];
+  const double yfrac = ( myDestY - myDestYMin ) / ( myDestYMax - myDestYMin );
 
-  // Warning: this is very SLOW compared to the following code!:
-  //double mySrcX = myBot.x() + (myTop.x() - myBot.x()) * yfrac;
-  //double mySrcY = myBot.y() + (myTop.y() - myBot.y()) * yfrac;
-
-  double tx = myTop.x();
-  double ty = myTop.y();
-  double bx = myBot.x();
-  double by = myBot.y();
-  double mySrcX = bx + ( tx - bx ) * yfrac;
-  double mySrcY = by + ( ty - by ) * yfrac;
-
-  if ( !mExtent.contains( QgsPointXY( mySrcX, mySrcY ) ) )
+  const QgsPointXY *top = helper.top.data();
+  const QgsPointXY *bottom = helper.bottom.data();
+  for ( int destCol = 0; destCol < mDestCols; ++destCol )
   {
-    return false;
+    const double tx = top[destCol].x();
+    const double ty = top[destCol].y();
+    const double bx = bottom[destCol].x();
+    const double by = bottom[destCol].y();
+    const double mySrcX = bx + ( tx - bx ) * yfrac;
+    const double mySrcY = by + ( ty - by ) * yfrac;
+
+    indexes[destCol] = srcIndex( mySrcX, mySrcY );
   }
-
-  // TODO: check again cell selection (coor is in the middle)
-
-  *srcRow = static_cast< int >( std::floor( ( mSrcExtent.yMaximum() - mySrcY ) / mSrcYRes ) );
-  *srcCol = static_cast< int >( std::floor( ( mySrcX - mSrcExtent.xMinimum() ) / mSrcXRes ) );
-
-  // For now silently correct limits to avoid crashes
-  // TODO: review
-  // should not happen
-  if ( *srcRow >= mSrcRows ) return false;
-  if ( *srcRow < 0 ) return false;
-  if ( *srcCol >= mSrcCols ) return false;
-  if ( *srcCol < 0 ) return false;
-
-  return true;
 }
 
 void ProjectorData::insertRows( const QgsCoordinateTransform &ct )
@@ -734,6 +722,116 @@ QString QgsRasterProjector::precisionLabel( Precision precision )
   return QStringLiteral( "Unknown" );
 }
 
+///@cond PRIVATE
+
+namespace
+{
+  //! Key of a cached reprojection grid
+  struct ProjectorDataKey
+  {
+    QString srcCrs;
+    QString destCrs;
+    int srcDatumTransform = -1;
+    int destDatumTransform = -1;
+    QgsRasterProjector::Precision precision = QgsRasterProjector::Approximate;
+    QgsRectangle extent;
+    int width = 0;
+    int height = 0;
+    QgsRectangle sourceExtent;
+    double sourceXRes = 0;
+    double sourceYRes = 0;
+
+    bool operator==( const ProjectorDataKey &other ) const
+    {
+      return width == other.width && height == other.height && precision == other.precision
+             && srcDatumTransform == other.srcDatumTransform && destDatumTransform == other.destDatumTransform
+             && extent == other.extent && sourceExtent == other.sourceExtent
+             && qgsDoubleNear( sourceXRes, other.sourceXRes ) && qgsDoubleNear( sourceYRes, other.sourceYRes )
+             && srcCrs == other.srcCrs && destCrs == other.destCrs;
+    }
+  };
+
+  typedef QPair< ProjectorDataKey, std::shared_ptr< const ProjectorData > > ProjectorDataCacheEntry;
+
+  //! Maximum number of reprojection grids kept in the cache
+  const int PROJECTOR_DATA_CACHE_SIZE = 16;
+
+  QMutex sProjectorDataCacheMutex;
+  // Only plain values are stored in the key, so that no CRS objects are destroyed after the proj context at exit
+  QList< ProjectorDataCacheEntry > sProjectorDataCache;
+
+  // Copies pixels of a row from the input to the output block, leaving pixels outside of the source untouched
+  template< typename T >
+  void copyPixels( const T *src, qgssize srcSize, const qint64 *indexes, T *dest, int count )
+  {
+    for ( int i = 0; i < count; ++i )
+    {
+      const qint64 index = indexes[i];
+      const T value = src[ std::max( index, static_cast< qint64 >( 0 ) ) ];
+      dest[i] = static_cast< quint64 >( index ) < srcSize ? value : dest[i];
+    }
+  }
+}
+
+/**
+ * Returns the reprojection grid for the given request, computing it if it is not cached yet.
+ * Grids are shared between threads and are not modified once created.
+ */
+static std::shared_ptr< const ProjectorData > cachedProjectorData( const QgsRectangle &extent, int width, int height, QgsRasterInterface *input,
+    const QgsCoordinateReferenceSystem &srcCrs, const QgsCoordinateReferenceSystem &destCrs,
+    const QString &srcCrsWkt, const QString &destCrsWkt,
+    int srcDatumTransform, int destDatumTransform, QgsRasterProjector::Precision precision )
+{
+  ProjectorDataKey key;
+  key.srcCrs = srcCrsWkt;
+  key.destCrs = destCrsWkt;
+  key.srcDatumTransform = srcDatumTransform;
+  key.destDatumTransform = destDatumTransform;
+  key.precision = precision;
+  key.extent = extent;
+  key.width = width;
+  key.height = height;
+  ProjectorData::sourceGrid( input, key.sourceExtent, key.sourceXRes, key.sourceYRes );
+
+  {
+    QMutexLocker locker( &sProjectorDataCacheMutex );
+    for ( int i = 0; i < sProjectorDataCache.size(); ++i )
+    {
+      if ( sProjectorDataCache.at( i ).first == key )
+      {
+        // move to front, the least recently used grids are dropped first
+        ProjectorDataCacheEntry entry = sProjectorDataCache.takeAt( i );
+        sProjectorDataCache.prepend( entry );
+        return entry.second;
+      }
+    }
+  }
+
+  // computed outside of the lock, the grid may be computed twice by concurrent requests but that is harmless
+  QgsCoordinateTransform inverseCt( destCrs, srcCrs, destDatumTransform, srcDatumTransform );
+  std::shared_ptr< const ProjectorData > pd = std::make_shared< const ProjectorData >( extent, width, height, input, inverseCt, precision );
+
+  QMutexLocker locker( &sProjectorDataCacheMutex );
+  sProjectorDataCache.prepend( qMakePair( key, pd ) );
+  while ( sProjectorDataCache.size() > PROJECTOR_DATA_CACHE_SIZE )
+    sProjectorDataCache.removeLast();
+  return pd;
+}
+
+///@endcond
+
+void QgsRasterProjector::clearProjectorDataCache()
+{
+  QMutexLocker locker( &sProjectorDataCacheMutex );
+  sProjectorDataCache.clear();
+}
+
+int QgsRasterProjector::projectorDataCacheSize()
+{
+  QMutexLocker locker( &sProjectorDataCacheMutex );
+  return sProjectorDataCache.size();
+}
+
 QgsRasterBlock *QgsRasterProjector::block( int bandNo, QgsRectangle  const &extent, int width, int height, QgsRasterBlockFeedback *feedback )
 {
   QgsDebugMsgLevel( QStringLiteral( "extent:\n%1" ).arg( extent.toString() ), 4 );
@@ -753,9 +851,9 @@ QgsRasterBlock *QgsRasterProjector::block( int bandNo, QgsRectangle  const &exte
     return mInput->block( bandNo, extent, width, height, feedback );
   }
 
-  QgsCoordinateTransform inverseCt( mDestCRS, mSrcCRS, mDestDatumTransform, mSrcDatumTransform );
-
-  ProjectorData pd( extent, width, height, mInput, inverseCt, mPrecision );
+  const std::shared_ptr< const ProjectorData > pdPtr = cachedProjectorData( extent, width, height, mInput, mSrcCRS, mDestCRS,
+      mSrcCrsWkt, mDestCrsWkt, mSrcDatumTransform, mDestDatumTransform, mPrecision );
+  const ProjectorData &pd = *pdPtr;
 
   QgsDebugMsgLevel( QStringLiteral( "srcExtent:\n%1" ).arg( pd.srcExtent().toString() ), 4 );
   QgsDebugMsgLevel( QStringLiteral( "srcCols = %1 srcRows = %2" ).arg( pd.srcCols() ).arg( pd.srcRows() ), 4 );
@@ -787,9 +885,6 @@ QgsRasterBlock *QgsRasterProjector::block( int bandNo, QgsRectangle  const &exte
     return outputBlock.release();
   }
 
-  // set output to no data, it should be fast
-  outputBlock->setIsNoData();
-
   // No data: because isNoData()/setIsNoData() is slow with respect to simple memcpy,
   // we use if only if necessary:
   // 1) no data value exists (numerical) -> memcpy, not necessary isNoData()/setIsNoData()
@@ -800,46 +895,97 @@ QgsRasterBlock *QgsRasterProjector::block( int bandNo, QgsRectangle  const &exte
 
   // To copy no data values stored in bitmaps we have to use isNoData()/setIsNoData(),
   // we cannot fill output block with no data because we use memcpy for data, not setValue().
-  bool doNoData = !QgsRasterBlock::typeIsNumeric( inputBlock->dataType() ) && inputBlock->hasNoData() && !inputBlock->hasNoDataValue();
+  const bool doNoData = !QgsRasterBlock::typeIsNumeric( inputBlock->dataType() ) && inputBlock->hasNoData() && !inputBlock->hasNoDataValue();
+  // without a no data value the output no data bitmap must be cleared for each copied pixel
+  const bool setData = !outputBlock->hasNoDataValue();
 
+  // set output to no data, it should be fast
   outputBlock->setIsNoData();
 
-  int srcRow, srcCol;
-  for ( int i = 0; i < height; ++i )
+  const qgssize srcSize = static_cast< qgssize >( pd.srcRows() ) * pd.srcCols();
+  const char *srcBits = inputBlock->bits();
+  char *destBits = outputBlock->bits();
+  if ( !srcBits || !destBits )
   {
-    if ( feedback && feedback->isCanceled() )
-      break;
-    for ( int j = 0; j < width; ++j )
+    QgsDebugMsg( QStringLiteral( "Cannot get block data" ) );
+    return outputBlock.release();
+  }
+
+  QgsRasterBlock *input = inputBlock.get();
+  QgsRasterBlock *output = outputBlock.get();
+  QgsCoordinateTransform inverseCt;
+  if ( !pd.approximate() )
+    inverseCt = QgsCoordinateTransform( mDestCRS, mSrcCRS, mDestDatumTransform, mSrcDatumTransform );
+
+  // Rows are resampled in parallel, each output row is written by a single task
+  auto processRows = [ =, &pd, &inverseCt ]( const QPair< int, int > &rows )
+  {
+    std::vector< qint64 > indexes( width );
+    ProjectorData::ApproximateHelper helper;
+    for ( int i = rows.first; i < rows.second; ++i )
     {
-      bool inside = pd.srcRowCol( i, j, &srcRow, &srcCol );
-      if ( !inside ) continue; // we have everything set to no data
+      if ( feedback && feedback->isCanceled() )
+        return;
 
-      qgssize srcIndex = static_cast< qgssize >( srcRow ) * pd.srcCols() + srcCol;
+      pd.srcIndexes( i, indexes.data(), helper, inverseCt );
 
-      // isNoData() may be slow so we check doNoData first
-      if ( doNoData && inputBlock->isNoData( srcRow, srcCol ) )
+      char *destRow = destBits + static_cast< qgssize >( i ) * width * pixelSize;
+      switch ( pixelSize )
       {
-        outputBlock->setIsNoData( i, j );
-        continue;
+        case 1:
+          copyPixels( reinterpret_cast< const quint8 * >( srcBits ), srcSize, indexes.data(), reinterpret_cast< quint8 * >( destRow ), width );
+          break;
+        case 2:
+          copyPixels( reinterpret_cast< const quint16 * >( srcBits ), srcSize, indexes.data(), reinterpret_cast< quint16 * >( destRow ), width );
+          break;
+        case 4:
+          copyPixels( reinterpret_cast< const quint32 * >( srcBits ), srcSize, indexes.data(), reinterpret_cast< quint32 * >( destRow ), width );
+          break;
+        case 8:
+          copyPixels( reinterpret_cast< const quint64 * >( srcBits ), srcSize, indexes.data(), reinterpret_cast< quint64 * >( destRow ), width );
+          break;
+        default:
+          for ( int j = 0; j < width; ++j )
+          {
+            const qint64 index = indexes[j];
+            if ( index >= 0 )
+              memcpy( destRow + j * pixelSize, srcBits + index * pixelSize, pixelSize );
+          }
+          break;
       }
 
-      qgssize destIndex = static_cast< qgssize >( i ) * width + j;
-      char *srcBits = inputBlock->bits( srcIndex );
-      char *destBits = outputBlock->bits( destIndex );
-      if ( !srcBits )
-      {
-        // QgsDebugMsg( QStringLiteral( "Cannot get input block data: row = %1 col = %2" ).arg( i ).arg( j ) );
+      if ( !setData && !doNoData )
         continue;
-      }
-      if ( !destBits )
+
+      for ( int j = 0; j < width; ++j )
       {
-        // QgsDebugMsg( QStringLiteral( "Cannot set output block data: srcRow = %1 srcCol = %2" ).arg( srcRow ).arg( srcCol ) );
-        continue;
+        const qint64 index = indexes[j];
+        if ( index < 0 )
+          continue; // we have everything set to no data
+
+        // isNoData() may be slow so we check doNoData first
+        if ( doNoData && input->isNoData( index ) )
+        {
+          output->setIsNoData( i, j );
+          continue;
+        }
+        if ( setData )
+          output->setIsData( i, j );
       }
-      memcpy( destBits, srcBits, pixelSize );
-      outputBlock->setIsData( i, j );
     }
-  }
+  };
+
+  // Split rows in chunks, at least one per thread of the global pool
+  const int threadCount = std::max( 1, QThreadPool::globalInstance()->maxThreadCount() );
+  const int rowsPerTask = std::max( 16, ( height + threadCount - 1 ) / threadCount );
+  QVector< QPair< int, int > > chunks;
+  for ( int row = 0; row < height; row += rowsPerTask )
+    chunks.append( qMakePair( row, std::min( row + rowsPerTask, height ) ) );
+
+  if ( chunks.size() == 1 )
+    processRows( chunks.at( 0 ) );
+  else
+    QtConcurrent::blockingMap( chunks, processRows );
 
   return outputBlock.release();
 }
@@ -34,6 +34,7 @@
 #include "qgsrasterinterface.h"
 
 #include <cmath>
+#include <vector>
 
 class QgsPointXY;
 
@@ -112,6 +113,19 @@ class CORE_EXPORT QgsRasterProjector : public QgsRasterInterface
     //! Requested precision
     Precision mPrecision = Approximate;
 
+    //! WKT of the source CRS, used as cache key for reprojection grids
+    QString mSrcCrsWkt;
+
+    //! WKT of the destination CRS, used as cache key for reprojection grids
+    QString mDestCrsWkt;
+
+    //! Removes all cached reprojection grids
+    static void clearProjectorDataCache();
+
+    //! Returns the number of cached reprojection grids
+    static int projectorDataCacheSize();
+
+    friend class TestQgsRasterProjector;
 };
 
 
@@ -120,46 +134,70 @@ class CORE_EXPORT QgsRasterProjector : public QgsRasterInterface
 
 /**
  * Internal class for reprojection of rasters - either exact or approximate.
- * QgsRasterProjector creates it and then keeps calling srcRowCol() to get source pixel position
- * for every destination pixel position.
+ * QgsRasterProjector creates it and then calls srcIndexes() to get source pixel positions
+ * for every destination row.
+ *
+ * ProjectorData does not change once created, so it can be cached and shared between threads.
+ * Precise reprojection and the per-thread approximation helpers are passed to srcIndexes().
  */
-class ProjectorData
+class CORE_EXPORT ProjectorData
 {
   public:
     //! Initialize reprojector and calculate matrix
     ProjectorData( const QgsRectangle &extent, int width, int height, QgsRasterInterface *input, const QgsCoordinateTransform &inverseCt, QgsRasterProjector::Precision precision );
-    ~ProjectorData();
 
     ProjectorData( const ProjectorData &other ) = delete;
     ProjectorData &operator=( const ProjectorData &other ) = delete;
 
+    //! Source points interpolated on the approximation matrix rows around the current destination row
+    struct ApproximateHelper
+    {
+      //! Matrix row of top, or -1 if not calculated yet
+      int topRow = -1;
+      std::vector< QgsPointXY > top;
+      std::vector< QgsPointXY > bottom;
+    };
+
     /**
-     * Returns the source row and column indexes for current source extent and resolution.
-     * If the source pixel is outside source extent srcRow and srcCol are left unchanged.
-     * \returns true if inside source
+     * Calculates the index ( row * srcCols() + column ) of the source pixel for every pixel of
+     * destination row \a destRow. Pixels outside of the source are set to -1.
+     * \a helper keeps approximation state between calls, each thread must use its own helper.
+     * \a inverseCt is used for precise reprojection.
      */
-    bool srcRowCol( int destRow, int destCol, int *srcRow, int *srcCol );
+    void srcIndexes( int destRow, qint64 *indexes, ApproximateHelper &helper, const QgsCoordinateTransform &inverseCt ) const;
 
     QgsRectangle srcExtent() const { return mSrcExtent; }
     int srcRows() const { return mSrcRows; }
     int srcCols() const { return mSrcCols; }
 
+    //! Returns true if source pixels are interpolated on the approximation matrix, false if each pixel is reprojected
+    bool approximate() const { return mApproximate; }
+
+    /**
+     * Gets the extent and resolution of the source provider of \a input. The resolution is
+     * left at 0 if the provider does not have a fixed size.
+     */
+    static void sourceGrid( QgsRasterInterface *input, QgsRectangle &extent, double &xRes, double &yRes );
+
   private:
 
     //! Returns the destination point for _current_ destination position.
-    void destPointOnCPMatrix( int row, int col, double *theX, double *theY );
+    void destPointOnCPMatrix( int row, int col, double *theX, double *theY ) const;
 
     //! Returns the matrix upper left row index for destination row.
-    int matrixRow( int destRow );
+    int matrixRow( int destRow ) const;
 
     //! Returns the matrix upper left col index for destination col.
-    int matrixCol( int destCol );
+    int matrixCol( int destCol ) const;
 
-    //! Returns precise source row and column indexes for current source extent and resolution.
-    inline bool preciseSrcRowCol( int destRow, int destCol, int *srcRow, int *srcCol );
+    //! Returns the index of the source pixel at source coordinates, or -1 if outside of the source
+    inline qint64 srcIndex( double x, double y ) const;
 
-    //! Returns approximate source row and column indexes for current source extent and resolution.
-    inline bool approximateSrcRowCol( int destRow, int destCol, int *srcRow, int *srcCol );
+    //! Calculates precise source pixel indexes for a destination row
+    void preciseSrcIndexes( int destRow, qint64 *indexes, const QgsCoordinateTransform &inverseCt ) const;
+
+    //! Calculates approximate source pixel indexes for a destination row
+    void approximateSrcIndexes( int destRow, qint64 *indexes, ApproximateHelper &helper ) const;
 
     //! \brief insert rows to matrix
     void insertRows( const QgsCoordinateTransform &ct );
@@ -180,7 +218,7 @@ class ProjectorData
     void calcSrcExtent();
 
     //! \brief calculate minimum source width and height
-    void calcSrcRowsCols();
+    void calcSrcRowsCols( const QgsCoordinateTransform &ct );
 
     /**
      * \brief check error along columns
@@ -193,10 +231,7 @@ class ProjectorData
     bool checkRows( const QgsCoordinateTransform &ct );
 
     //! Calculate array of src helper points
-    void calcHelper( int matrixRow, QgsPointXY *points );
-
-    //! Calc / switch helper
-    void nextHelper();
+    void calcHelper( int matrixRow, QgsPointXY *points ) const;
 
     //! Gets mCPMatrix as string
     QString cpToString();
@@ -206,9 +241,6 @@ class ProjectorData
      *  an approximation matrix with a sufficient precision) */
     bool mApproximate;
 
-    //! Transformation from destination CRS to source CRS
-    QgsCoordinateTransform mInverseCt;
-
     //! Destination extent
     QgsRectangle mDestExtent;
 
@@ -255,17 +287,6 @@ class ProjectorData
     /* Same size as mCPMatrix */
     QList< QList<bool> > mCPLegalMatrix;
 
-    //! Array of source points for each destination column on top of current CPMatrix grid row
-    /* Warning: using QList is slow on access */
-    QgsPointXY *pHelperTop = nullptr;
-
-    //! Array of source points for each destination column on bottom of current CPMatrix grid row
-    /* Warning: using QList is slow on access */
-    QgsPointXY *pHelperBottom = nullptr;
-
-    //! Current mHelperTop matrix row
-    int mHelperTopRow;
-
     //! Number of mCPMatrix columns
     int mCPCols;
     //! Number of mCPMatrix rows
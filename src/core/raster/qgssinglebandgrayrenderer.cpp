@@ -22,7 +22,11 @@
 #include <QDomElement>
 #include <QImage>
 #include <QColor>
+#include <QThread>
+#include <QtConcurrentMap>
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 QgsSingleBandGrayRenderer::QgsSingleBandGrayRenderer( QgsRasterInterface *input, int grayBand )
   : QgsRasterRenderer( input, QStringLiteral( "singlebandgray" ) )
@@ -116,18 +120,9 @@ QgsRasterBlock *QgsSingleBandGrayRenderer::block( int bandNo, const QgsRectangle
     return outputBlock.release();
   }
 
-  QRgb myDefaultColor = NODATA_COLOR;
-  bool isNoData = false;
-  for ( qgssize i = 0; i < ( qgssize )width * height; i++ )
+  // Color of a value, for a given value of the alpha band
+  auto grayColor = [this]( double grayVal, double alphaValue ) -> QRgb
   {
-    double grayVal = inputBlock->valueAndNoData( i, isNoData );
-
-    if ( isNoData )
-    {
-      outputBlock->setColor( i, myDefaultColor );
-      continue;
-    }
-
     double currentAlpha = mOpacity;
     if ( mRasterTransparency )
     {
@@ -135,15 +130,14 @@ QgsRasterBlock *QgsSingleBandGrayRenderer::block( int bandNo, const QgsRectangle
     }
     if ( mAlphaBand > 0 )
     {
-      currentAlpha *= alphaBlock->value( i ) / 255.0;
+      currentAlpha *= alphaValue / 255.0;
     }
 
     if ( mContrastEnhancement )
     {
       if ( !mContrastEnhancement->isValueInDisplayableRange( grayVal ) )
       {
-        outputBlock->setColor( i, myDefaultColor );
-        continue;
+        return NODATA_COLOR;
       }
       grayVal = mContrastEnhancement->enhanceContrast( grayVal );
     }
@@ -155,14 +149,99 @@ QgsRasterBlock *QgsSingleBandGrayRenderer::block( int bandNo, const QgsRectangle
 
     if ( qgsDoubleNear( currentAlpha, 1.0 ) )
     {
-      outputBlock->setColor( i, qRgba( grayVal, grayVal, grayVal, 255 ) );
+      return qRgba( grayVal, grayVal, grayVal, 255 );
     }
     else
     {
-      outputBlock->setColor( i, qRgba( currentAlpha * grayVal, currentAlpha * grayVal, currentAlpha * grayVal, currentAlpha * 255 ) );
+      return qRgba( currentAlpha * grayVal, currentAlpha * grayVal, currentAlpha * grayVal, currentAlpha * 255 );
+    }
+  };
+
+  // initialize the contrast enhancement lookup table before using it from several threads
+  if ( mContrastEnhancement )
+    mContrastEnhancement->enhanceContrast( 0 );
+
+  // Without an alpha band, colors of 8 and 16 bit values are precomputed if there are more pixels than values
+  const qgssize count = static_cast< qgssize >( width ) * height;
+  std::vector< QRgb > colorTable;
+  int colorTableOffset = 0;
+  if ( mAlphaBand <= 0 )
+  {
+    int colorTableSize = 0;
+    switch ( inputBlock->dataType() )
+    {
+      case Qgis::Byte:
+        colorTableSize = 256;
+        break;
+      case Qgis::UInt16:
+        colorTableSize = 65536;
+        break;
+      case Qgis::Int16:
+        colorTableSize = 65536;
+        colorTableOffset = 32768;
+        break;
+      default:
+        break;
+    }
+    if ( colorTableSize > 0 && static_cast< qgssize >( colorTableSize ) <= count )
+    {
+      colorTable.resize( colorTableSize );
+      for ( int i = 0; i < colorTableSize; ++i )
+        colorTable[i] = grayColor( i - colorTableOffset, 0 );
     }
   }
 
+  QRgb *outputBlockData = outputBlock->colorData();
+  auto processRows = [ =, &colorTable ]( const QPair< int, int > &rows )
+  {
+    std::vector< double > values( width );
+    std::vector< quint8 > isNoData( width );
+    std::vector< double > alphaValues( width, 0.0 );
+    for ( int row = rows.first; row < rows.second; ++row )
+    {
+      if ( feedback && feedback->isCanceled() )
+        return;
+
+      QRgb *output = outputBlockData + static_cast< qgssize >( row ) * width;
+      if ( !inputBlock->readRow( row, values.data(), isNoData.data() ) )
+      {
+        std::fill( output, output + width, NODATA_COLOR );
+        continue;
+      }
+
+      if ( !colorTable.empty() )
+      {
+        const QRgb *colors = colorTable.data() + colorTableOffset;
+        for ( int column = 0; column < width; ++column )
+        {
+          output[column] = isNoData[column] ? NODATA_COLOR : colors[ static_cast< int >( values[column] ) ];
+        }
+        continue;
+      }
+
+      if ( mAlphaBand > 0 )
+        alphaBlock->readRow( row, alphaValues.data() );
+
+      for ( int column = 0; column < width; ++column )
+      {
+        output[column] = isNoData[column] ? NODATA_COLOR : grayColor( values[column], alphaValues[column] );
+      }
+    }
+  };
+
+  // User defined contrast enhancement functions, e.g. implemented in Python, may not be thread safe
+  const bool threadSafeEnhancement = !mContrastEnhancement || mContrastEnhancement->contrastEnhancementAlgorithm() != QgsContrastEnhancement::UserDefinedEnhancement;
+  const int threadCount = threadSafeEnhancement ? std::max( 1, QThread::idealThreadCount() ) : 1;
+  const int rowsPerTask = threadCount > 1 ? std::max( 16, ( height + threadCount - 1 ) / threadCount ) : std::max( 1, height );
+  QVector< QPair< int, int > > chunks;
+  for ( int row = 0; row < height; row += rowsPerTask )
+    chunks.append( qMakePair( row, std::min( row + rowsPerTask, height ) ) );
+
+  if ( chunks.size() == 1 )
+    processRows( chunks.at( 0 ) );
+  else
+    QtConcurrent::blockingMap( chunks, processRows );
+
   return outputBlock.release();
 }
 
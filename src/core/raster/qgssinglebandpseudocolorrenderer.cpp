@@ -25,6 +25,13 @@
 #include <QDomDocument>
 #include <QDomElement>
 #include <QImage>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
+#include <typeinfo>
+#include <vector>
 
 QgsSingleBandPseudoColorRenderer::QgsSingleBandPseudoColorRenderer( QgsRasterInterface *input, int band, QgsRasterShader *shader )
   : QgsRasterRenderer( input, QStringLiteral( "singlebandpseudocolor" ) )
@@ -98,6 +105,7 @@ QgsSingleBandPseudoColorRenderer *QgsSingleBandPseudoColorRenderer::clone() cons
   }
   QgsSingleBandPseudoColorRenderer *renderer = new QgsSingleBandPseudoColorRenderer( nullptr, mBand, shader );
   renderer->copyCommonProperties( this );
+  renderer->mShadingTolerance = mShadingTolerance;
 
   return renderer;
 }
@@ -145,6 +153,7 @@ QgsRasterRenderer *QgsSingleBandPseudoColorRenderer::create( const QDomElement &
   // TODO: add _readXML in superclass?
   r->setClassificationMin( elem.attribute( QStringLiteral( "classificationMin" ), QStringLiteral( "NaN" ) ).toDouble() );
   r->setClassificationMax( elem.attribute( QStringLiteral( "classificationMax" ), QStringLiteral( "NaN" ) ).toDouble() );
+  r->setShadingTolerance( elem.attribute( QStringLiteral( "shadingTolerance" ), QStringLiteral( "0" ) ).toDouble() );
 
   // Backward compatibility with serialization of QGIS 2.X era
   QString minMaxOrigin = elem.attribute( QStringLiteral( "classificationMinMaxOrigin" ) );
@@ -193,6 +202,130 @@ QgsRasterRenderer *QgsSingleBandPseudoColorRenderer::create( const QDomElement &
   return r;
 }
 
+///@cond PRIVATE
+
+namespace
+{
+  //! Maximum number of entries of a color table
+  const int MAX_COLOR_TABLE_SIZE = 65536;
+
+  //! Returns the premultiplied color of a value, or NODATA_COLOR if the value cannot be shaded
+  QRgb shadedColor( const QgsRasterShaderFunction *fcn, double value )
+  {
+    int red, green, blue, alpha;
+    if ( !fcn->shade( value, &red, &green, &blue, &alpha ) )
+    {
+      return QgsRasterRenderer::NODATA_COLOR;
+    }
+
+    if ( alpha < 255 )
+    {
+      // Working with premultiplied colors, so multiply values by alpha
+      red *= ( alpha / 255.0 );
+      blue *= ( alpha / 255.0 );
+      green *= ( alpha / 255.0 );
+    }
+    return qRgba( red, green, blue, alpha );
+  }
+
+  /**
+   * Colors of values between minimum and maximum, precomputed with a constant step.
+   * Values outside of the table are shaded directly.
+   */
+  struct ColorTable
+  {
+    std::vector< QRgb > colors;
+    double minimum = 0;
+    double maximum = -1;
+    double factor = 1;
+
+    QRgb color( const QgsRasterShaderFunction *fcn, double value ) const
+    {
+      if ( value >= minimum && value < maximum )
+        return colors[ std::min( static_cast< int >( ( value - minimum ) * factor ), static_cast< int >( colors.size() ) - 1 ) ];
+      return shadedColor( fcn, value );
+    }
+  };
+
+  //! Creates an exact table for the values of integer data types, if it has at most \a maximumSize entries
+  bool createIntegerColorTable( ColorTable &table, const QgsRasterShaderFunction *fcn, Qgis::DataType dataType, qgssize maximumSize )
+  {
+    int minimum = 0;
+    int size = 0;
+    switch ( dataType )
+    {
+      case Qgis::Byte:
+        size = 256;
+        break;
+      case Qgis::UInt16:
+        size = 65536;
+        break;
+      case Qgis::Int16:
+        minimum = -32768;
+        size = 65536;
+        break;
+      default:
+        return false;
+    }
+    if ( static_cast< qgssize >( size ) > maximumSize )
+      return false;
+
+    table.minimum = minimum;
+    table.maximum = minimum + size;
+    table.factor = 1;
+    table.colors.resize( size );
+    for ( int i = 0; i < size; ++i )
+      table.colors[i] = shadedColor( fcn, table.minimum + i );
+    return true;
+  }
+
+  /**
+   * Creates a table for the range of an interpolated color ramp, with a step small enough that
+   * colors in a step differ by less than \a tolerance from the color of the step center.
+   * Fails if the table would have more than \a maximumSize entries.
+   */
+  bool createQuantizedColorTable( ColorTable &table, const QgsColorRampShader *shader, double tolerance, qgssize maximumSize )
+  {
+    const QList<QgsColorRampShader::ColorRampItem> items = shader->colorRampItemList();
+    if ( items.size() < 2 )
+      return false;
+
+    // maximum change of a premultiplied color component per value unit
+    double maxSlope = 0;
+    for ( int i = 1; i < items.size(); ++i )
+    {
+      const QColor &c1 = items.at( i - 1 ).color;
+      const QColor &c2 = items.at( i ).color;
+      const double colorChange = std::max( { std::abs( c2.red() - c1.red() ), std::abs( c2.green() - c1.green() ), std::abs( c2.blue() - c1.blue() ) } )
+                                 + std::abs( c2.alpha() - c1.alpha() );
+      if ( colorChange == 0 )
+        continue;
+      const double valueChange = items.at( i ).value - items.at( i - 1 ).value;
+      if ( valueChange <= 0 )
+        return false;
+      maxSlope = std::max( maxSlope, colorChange / valueChange );
+    }
+
+    const double range = items.last().value - items.first().value;
+    if ( !( range > 0 ) )
+      return false;
+
+    const double size = std::max( 1.0, std::ceil( range * maxSlope / ( 2 * tolerance ) ) );
+    if ( size > MAX_COLOR_TABLE_SIZE || size > maximumSize )
+      return false;
+
+    table.minimum = items.first().value;
+    table.maximum = items.last().value;
+    table.factor = size / range;
+    table.colors.resize( static_cast< int >( size ) );
+    for ( int i = 0; i < static_cast< int >( size ); ++i )
+      table.colors[i] = shadedColor( shader, table.minimum + ( i + 0.5 ) / table.factor );
+    return true;
+  }
+}
+
+///@endcond
+
 QgsRasterBlock *QgsSingleBandPseudoColorRenderer::block( int bandNo, QgsRectangle  const &extent, int width, int height, QgsRasterBlockFeedback *feedback )
 {
   Q_UNUSED( bandNo );
@@ -233,56 +366,88 @@ QgsRasterBlock *QgsSingleBandPseudoColorRenderer::block( int bandNo, QgsRectangl
     return outputBlock.release();
   }
 
-  QRgb myDefaultColor = NODATA_COLOR;
   QRgb *outputBlockData = outputBlock->colorData();
   const QgsRasterShaderFunction *fcn = mShader->rasterShaderFunction();
 
-  qgssize count = ( qgssize )width * height;
-  bool isNoData = false;
-  for ( qgssize i = 0; i < count; i++ )
+  // Colors of all possible values of integer data, or of quantized values of continuous ramps.
+  // Only built if there are more pixels than table entries, as it shades every entry.
+  const qgssize count = static_cast< qgssize >( width ) * height;
+  const QgsColorRampShader *colorRampShader = dynamic_cast< const QgsColorRampShader * >( fcn );
+  ColorTable table;
+  if ( !createIntegerColorTable( table, fcn, inputBlock->dataType(), count )
+       && colorRampShader && colorRampShader->colorRampType() == QgsColorRampShader::Interpolated && mShadingTolerance > 0 )
   {
-    double val = inputBlock->valueAndNoData( i, isNoData );
-    if ( isNoData )
-    {
-      outputBlockData[i] = myDefaultColor;
-      continue;
-    }
+    createQuantizedColorTable( table, colorRampShader, mShadingTolerance, count );
+  }
 
-    int red, green, blue, alpha;
-    if ( !fcn->shade( val, &red, &green, &blue, &alpha ) )
-    {
-      outputBlockData[i] = myDefaultColor;
-      continue;
-    }
+  // initialize lazily computed state of the shader before using it from several threads
+  int red, green, blue, alpha;
+  fcn->shade( 0, &red, &green, &blue, &alpha );
 
-    if ( alpha < 255 )
+  auto processRows = [ =, &table ]( const QPair< int, int > &rows )
+  {
+    std::vector< double > values( width );
+    std::vector< quint8 > isNoData( width );
+    std::vector< double > alphaValues( alphaBlock ? width : 0 );
+    for ( int row = rows.first; row < rows.second; ++row )
     {
-      // Working with premultiplied colors, so multiply values by alpha
-      red *= ( alpha / 255.0 );
-      blue *= ( alpha / 255.0 );
-      green *= ( alpha / 255.0 );
-    }
+      if ( feedback && feedback->isCanceled() )
+        return;
 
-    if ( !hasTransparency )
-    {
-      outputBlockData[i] = qRgba( red, green, blue, alpha );
-    }
-    else
-    {
-      //opacity
-      double currentOpacity = mOpacity;
-      if ( mRasterTransparency )
+      QRgb *output = outputBlockData + static_cast< qgssize >( row ) * width;
+      if ( !inputBlock->readRow( row, values.data(), isNoData.data() ) )
       {
-        currentOpacity = mRasterTransparency->alphaValue( val, mOpacity * 255 ) / 255.0;
+        std::fill( output, output + width, NODATA_COLOR );
+        continue;
       }
-      if ( mAlphaBand > 0 )
+      if ( alphaBlock )
+        alphaBlock->readRow( row, alphaValues.data() );
+
+      for ( int column = 0; column < width; ++column )
       {
-        currentOpacity *= alphaBlock->value( i ) / 255.0;
+        if ( isNoData[column] )
+        {
+          output[column] = NODATA_COLOR;
+          continue;
+        }
+
+        const double val = values[column];
+        const QRgb color = table.color( fcn, val );
+        if ( !hasTransparency || color == NODATA_COLOR )
+        {
+          output[column] = color;
+          continue;
+        }
+
+        //opacity
+        double currentOpacity = mOpacity;
+        if ( mRasterTransparency )
+        {
+          currentOpacity = mRasterTransparency->alphaValue( val, mOpacity * 255 ) / 255.0;
+        }
+        if ( mAlphaBand > 0 )
+        {
+          currentOpacity *= alphaValues[column] / 255.0;
+        }
+
+        output[column] = qRgba( currentOpacity * qRed( color ), currentOpacity * qGreen( color ), currentOpacity * qBlue( color ), currentOpacity * qAlpha( color ) );
       }
-
-      outputBlockData[i] = qRgba( currentOpacity * red, currentOpacity * green, currentOpacity * blue, currentOpacity * alpha );
     }
-  }
+  };
+
+  // Only shade from several threads with the built-in color ramp shader. Subclasses, including
+  // shaders implemented in Python, may not be thread safe.
+  const bool threadSafeShader = typeid( *fcn ) == typeid( QgsColorRampShader );
+  const int threadCount = threadSafeShader ? std::max( 1, QThread::idealThreadCount() ) : 1;
+  const int rowsPerTask = threadCount > 1 ? std::max( 16, ( height + threadCount - 1 ) / threadCount ) : std::max( 1, height );
+  QVector< QPair< int, int > > chunks;
+  for ( int row = 0; row < height; row += rowsPerTask )
+    chunks.append( qMakePair( row, std::min( row + rowsPerTask, height ) ) );
+
+  if ( chunks.size() == 1 )
+    processRows( chunks.at( 0 ) );
+  else
+    QtConcurrent::blockingMap( chunks, processRows );
 
   return outputBlock.release();
 }
@@ -303,6 +468,8 @@ void QgsSingleBandPseudoColorRenderer::writeXml( QDomDocument &doc, QDomElement
   }
   rasterRendererElem.setAttribute( QStringLiteral( "classificationMin" ), QgsRasterBlock::printValue( mClassificationMin ) );
   rasterRendererElem.setAttribute( QStringLiteral( "classificationMax" ), QgsRasterBlock::printValue( mClassificationMax ) );
+  if ( mShadingTolerance > 0 )
+    rasterRendererElem.setAttribute( QStringLiteral( "shadingTolerance" ), mShadingTolerance );
 
   parentElem.appendChild( rasterRendererElem );
 }
@@ -100,6 +100,28 @@ class CORE_EXPORT QgsSingleBandPseudoColorRenderer: public QgsRasterRenderer
     void setClassificationMin( double min );
     void setClassificationMax( double max );
 
+    /**
+     * Returns the maximum difference of color components (in the 0-255 range) allowed when
+     * shading floating point data through a precomputed color table.
+     * \see setShadingTolerance()
+     * \since QGIS 3.6
+     */
+    double shadingTolerance() const { return mShadingTolerance; }
+
+    /**
+     * Sets the maximum difference of color components (in the 0-255 range) allowed when
+     * shading floating point data through a precomputed color table.
+     *
+     * With a tolerance greater than 0, values of floating point and 32 bit rasters shaded by an interpolated
+     * color ramp are quantized so that the color of each quantization step differs from the exact
+     * color by less than \a tolerance, in addition to rounding. A tolerance of 0 (the default)
+     * shades every value exactly. 8 and 16 bit integer rasters are always shaded exactly.
+     *
+     * \see shadingTolerance()
+     * \since QGIS 3.6
+     */
+    void setShadingTolerance( double tolerance ) { mShadingTolerance = tolerance; }
+
   private:
 #ifdef SIP_RUN
     QgsSingleBandPseudoColorRenderer( const QgsSingleBandPseudoColorRenderer & );
@@ -114,6 +136,8 @@ class CORE_EXPORT QgsSingleBandPseudoColorRenderer: public QgsRasterRenderer
     double mClassificationMin;
     double mClassificationMax;
 
+    double mShadingTolerance = 0;
+
 };
 
 #endif // QGSSINGLEBANDPSEUDOCOLORRENDERER_H
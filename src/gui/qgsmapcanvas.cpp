@@ -18,6 +18,7 @@ email                : sherman at mrcc.com
 
 #include <QtGlobal>
 #include <QApplication>
+#include <QCryptographicHash>
 #include <QCursor>
 #include <QDir>
 #include <QFile>
@@ -438,6 +439,16 @@ void QgsMapCanvas::setCachingEnabled( bool enabled )
   if ( enabled )
   {
     mCache = new QgsMapRendererCache;
+
+    // each canvas keeps its images and their size accounting in a directory of its own,
+    // found again by later sessions through the canvas name
+    QgsSettings settings;
+    if ( !objectName().isEmpty() && settings.value( QStringLiteral( "Map/enableDiskRenderCache" ), false ).toBool() )
+    {
+      const qint64 maxSize = settings.value( QStringLiteral( "Map/diskRenderCacheSize" ), 100 ).toLongLong() * 1024 * 1024;
+      const QString canvasDir = QString::fromLatin1( QCryptographicHash::hash( objectName().toUtf8(), QCryptographicHash::Md5 ).toHex() );
+      mCache->setDiskCacheDirectory( QgsApplication::qgisSettingsDirPath() + QStringLiteral( "renderCache/" ) + canvasDir, maxSize );
+    }
   }
   else
   {
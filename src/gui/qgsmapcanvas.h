@@ -140,6 +140,11 @@ class GUI_EXPORT QgsMapCanvas : public QGraphicsView
 
     /**
      * Set whether to cache images of rendered layers
+     *
+     * If the "Map/enableDiskRenderCache" setting is on, images of rendered layers are also
+     * kept on disk for canvases with an objectName(), in a directory of their own under the
+     * "renderCache" directory of the QGIS settings. The "Map/diskRenderCacheSize" setting
+     * limits the size of each canvas cache directory, in megabytes.
      * \since QGIS 2.4
      */
     void setCachingEnabled( bool enabled );
@@ -239,6 +239,7 @@ bool QgsDelimitedTextFeatureIterator::rewind()
   if ( mMode == FileScan )
   {
     mSource->mFile->reset();
+    mCurrentBlock = -1;
   }
   else
   {
@@ -298,6 +299,10 @@ bool QgsDelimitedTextFeatureIterator::nextFeatureInternal( QgsFeature &feature )
   bool first = true;
   bool scanning = mMode == FileScan;
 
+  // When scanning for features in a rectangle, blocks of records of the record
+  // index which do not intersect the rectangle are skipped
+  const QgsDelimitedTextRecordIndex *index = scanning && mTestGeometry ? file->recordIndex() : nullptr;
+
   while ( scanning || first )
   {
     first = false;
@@ -310,6 +315,25 @@ bool QgsDelimitedTextFeatureIterator::nextFeatureInternal( QgsFeature &feature )
 
     QgsDelimitedTextFile::Status status = file->nextRecord( tokens );
     if ( status == QgsDelimitedTextFile::RecordEOF ) break;
+
+    if ( index )
+    {
+      const int blockCount = index->blocks.size();
+      if ( mCurrentBlock + 1 < blockCount && file->recordId() >= index->blocks.at( mCurrentBlock + 1 ).lineNumber )
+      {
+        mCurrentBlock = index->blockForLine( file->recordId() );
+        if ( ! blockIntersects( index->blocks.at( mCurrentBlock ) ) )
+        {
+          int nextBlock = mCurrentBlock + 1;
+          while ( nextBlock < blockCount && ! blockIntersects( index->blocks.at( nextBlock ) ) )
+            nextBlock++;
+          if ( nextBlock >= blockCount || ! file->setNextRecordId( index->blocks.at( nextBlock ).lineNumber ) )
+            break;
+          continue;
+        }
+      }
+    }
+
     if ( status != QgsDelimitedTextFile::RecordOk ) continue;
 
     // We ignore empty records, such as added randomly by spreadsheets
@@ -390,6 +414,11 @@ bool QgsDelimitedTextFeatureIterator::nextFeatureInternal( QgsFeature &feature )
   return false;
 }
 
+bool QgsDelimitedTextFeatureIterator::blockIntersects( const QgsDelimitedTextRecordIndex::Block &block ) const
+{
+  return block.hasGeometries && mFilterRect.intersects( block.extent );
+}
+
 bool QgsDelimitedTextFeatureIterator::setNextFeatureId( qint64 fid )
 {
   return mSource->mFile->setNextRecordId( ( long ) fid );
@@ -528,6 +557,7 @@ QgsDelimitedTextFeatureSource::QgsDelimitedTextFeatureSource( const QgsDelimited
 
   mFile.reset( new QgsDelimitedTextFile() );
   mFile->setFromUrl( url );
+  mFile->setRecordIndex( p->mRecordIndex );
 
   mExpressionContext << QgsExpressionContextUtils::globalScope()
                      << QgsExpressionContextUtils::projectScope( QgsProject::instance() );
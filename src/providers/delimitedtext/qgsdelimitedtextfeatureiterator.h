@@ -82,6 +82,9 @@ class QgsDelimitedTextFeatureIterator : public QgsAbstractFeatureIteratorFromSou
 
     bool setNextFeatureId( qint64 fid );
 
+    //! Tests whether a block of the record index may contain features in the filter rectangle
+    bool blockIntersects( const QgsDelimitedTextRecordIndex::Block &block ) const;
+
     bool nextFeatureInternal( QgsFeature &feature );
     QgsGeometry loadGeometryWkt( const QStringList &tokens, bool &isNull );
     QgsGeometry loadGeometryXY( const QStringList &tokens, bool &isNull );
@@ -90,6 +93,8 @@ class QgsDelimitedTextFeatureIterator : public QgsAbstractFeatureIteratorFromSou
     QList<QgsFeatureId> mFeatureIds;
     IteratorMode mMode = FileScan;
     long mNextId = 0;
+    //! Block of the record index containing the last record read when scanning the file
+    int mCurrentBlock = -1;
     bool mTestSubset = false;
     bool mTestGeometry = false;
     bool mTestGeometryExact = false;
@@ -29,6 +29,15 @@
 #include <QRegExp>
 #include <QUrl>
 
+#include <algorithm>
+#include <cstring>
+
+int QgsDelimitedTextRecordIndex::blockForLine( long lineNumber ) const
+{
+  auto it = std::upper_bound( blocks.constBegin(), blocks.constEnd(), lineNumber,
+                              []( long line, const Block & block ) { return line < block.lineNumber; } );
+  return static_cast< int >( it - blocks.constBegin() ) - 1;
+}
 
 QgsDelimitedTextFile::QgsDelimitedTextFile( const QString &url )
   : mFileName( QString() )
@@ -56,9 +65,13 @@ void QgsDelimitedTextFile::close()
   }
   if ( mFile )
   {
+    // Also unmaps the file
     delete mFile;
     mFile = nullptr;
   }
+  mMap = nullptr;
+  mMapSize = 0;
+  mCodec = nullptr;
   if ( mWatcher )
   {
     delete mWatcher;
@@ -68,6 +81,8 @@ void QgsDelimitedTextFile::close()
   mRecordLineNumber = -1;
   mRecordNumber = -1;
   mMaxRecordNumber = -1;
+  mLineOffset = -1;
+  mRecordOffset = -1;
   mHoldCurrentRecord = false;
 }
 
@@ -85,11 +100,43 @@ bool QgsDelimitedTextFile::open()
     }
     if ( mFile )
     {
-      mStream = new QTextStream( mFile );
-      if ( ! mEncoding.isEmpty() )
+      QTextCodec *codec = mEncoding.isEmpty() ? QTextCodec::codecForLocale() : QTextCodec::codecForName( mEncoding.toLatin1() );
+
+      // Lines are read directly from a memory map if a new line is a single \n byte in
+      // the encoding. UTF-16 and UTF-32 files are read through the text stream, as
+      // are files with a unicode byte order mark other than UTF-8. Watched files are
+      // also read through the stream, as they may be truncated or rewritten in place
+      // while mapped.
+      if ( !mUseWatcher && codec && codec->fromUnicode( QStringLiteral( "\n" ) ) == "\n" )
+      {
+        mMapSize = mFile->size();
+        mMap = mMapSize > 0 ? mFile->map( 0, mMapSize ) : nullptr;
+      }
+      if ( mMap )
+      {
+        mMapStart = 0;
+        mCodec = codec->mibEnum() == 106 ? nullptr : codec;
+        if ( mMapSize >= 3 && mMap[0] == 0xEF && mMap[1] == 0xBB && mMap[2] == 0xBF )
+        {
+          mMapStart = 3;
+          mCodec = nullptr;
+        }
+        else if ( mMapSize >= 2 && ( ( mMap[0] == 0xFF && mMap[1] == 0xFE ) || ( mMap[0] == 0xFE && mMap[1] == 0xFF ) ) )
+        {
+          mFile->unmap( mMap );
+          mMap = nullptr;
+        }
+        mPosition = mMapStart;
+      }
+      if ( ! mMap )
       {
-        QTextCodec *codec = QTextCodec::codecForName( mEncoding.toLatin1() );
-        mStream->setCodec( codec );
+        mMapSize = 0;
+        mCodec = nullptr;
+        mStream = new QTextStream( mFile );
+        if ( ! mEncoding.isEmpty() )
+        {
+          mStream->setCodec( codec );
+        }
       }
       if ( mUseWatcher )
       {
@@ -102,6 +149,18 @@ bool QgsDelimitedTextFile::open()
   return nullptr != mFile;
 }
 
+void QgsDelimitedTextFile::setRecordIndex( const std::shared_ptr<const QgsDelimitedTextRecordIndex> &index )
+{
+  mRecordIndex = index;
+}
+
+const QgsDelimitedTextRecordIndex *QgsDelimitedTextFile::recordIndex() const
+{
+  if ( ! mMap || ! mRecordIndex || mRecordIndex->fileSize != mMapSize )
+    return nullptr;
+  return mRecordIndex.get();
+}
+
 void QgsDelimitedTextFile::updateFile()
 {
   close();
@@ -360,6 +419,13 @@ void QgsDelimitedTextFile::setTypeCSV( const QString &delim, const QString &quot
   mDelimChars = decodeChars( delim );
   mQuoteChar = decodeChars( quote );
   mEscapeChar = decodeChars( escape );
+  for ( int c = 0; c < 128; c++ )
+  {
+    QChar ch( c );
+    mCharClass[c] = ( mDelimChars.contains( ch ) ? CharDelim : 0 )
+                    | ( mQuoteChar.contains( ch ) ? CharQuote : 0 )
+                    | ( mEscapeChar.contains( ch ) ? CharEscape : 0 );
+  }
   mParser = &QgsDelimitedTextFile::parseQuoted;
   mDefinitionValid = !mDelimChars.isEmpty();
   if ( ! mDefinitionValid )
@@ -515,6 +581,7 @@ QgsDelimitedTextFile::Status QgsDelimitedTextFile::nextRecord( QStringList &reco
 
     mCurrentRecord.clear();
     mRecordLineNumber = mLineNumber;
+    mRecordOffset = mLineOffset;
     if ( mRecordNumber >= 0 )
     {
       mRecordNumber++;
@@ -536,15 +603,17 @@ QgsDelimitedTextFile::Status  QgsDelimitedTextFile::reset()
   if ( ! isValid() || ! open() ) return InvalidDefinition;
 
   // Reset the file pointer
-  mStream->seek( 0 );
+  rewindFile();
   mLineNumber = 0;
   mRecordNumber = -1;
   mRecordLineNumber = -1;
+  mRecordOffset = -1;
 
   // Skip header lines
+  QString buffer;
   for ( int i = mSkipLines; i-- > 0; )
   {
-    if ( mStream->readLine().isNull() ) return RecordEOF;
+    if ( ! readLine( buffer ) ) return RecordEOF;
     mLineNumber++;
   }
   // Read the column names
@@ -559,18 +628,54 @@ QgsDelimitedTextFile::Status  QgsDelimitedTextFile::reset()
   return result;
 }
 
+bool QgsDelimitedTextFile::readLine( QString &buffer )
+{
+  if ( ! mMap )
+  {
+    if ( mStream->atEnd() ) return false;
+    buffer = mStream->readLine();
+    return ! buffer.isNull();
+  }
+
+  if ( mPosition >= mMapSize ) return false;
+
+  const char *start = reinterpret_cast< const char * >( mMap ) + mPosition;
+  const qint64 available = mMapSize - mPosition;
+  const char *end = static_cast< const char * >( std::memchr( start, '\n', static_cast< size_t >( available ) ) );
+  qint64 length = end ? end - start : available;
+
+  mLineOffset = mPosition;
+  mPosition += end ? length + 1 : length;
+
+  // Lines may end with \r\n
+  if ( length > 0 && start[length - 1] == '\r' ) length--;
+
+  if ( mCodec )
+    buffer = mCodec->toUnicode( start, static_cast< int >( length ) );
+  else
+    buffer = QString::fromUtf8( start, static_cast< int >( length ) );
+  return true;
+}
+
+void QgsDelimitedTextFile::rewindFile()
+{
+  if ( mMap )
+    mPosition = mMapStart;
+  else
+    mStream->seek( 0 );
+  mLineOffset = -1;
+}
+
 QgsDelimitedTextFile::Status QgsDelimitedTextFile::nextLine( QString &buffer, bool skipBlank )
 {
-  if ( ! mStream )
+  if ( ! mFile )
   {
     Status status = reset();
     if ( status != RecordOk ) return status;
   }
 
-  while ( ! mStream->atEnd() )
+  while ( readLine( buffer ) )
   {
-    buffer = mStream->readLine();
-    if ( buffer.isNull() ) break;
     mLineNumber++;
     if ( skipBlank && buffer.isEmpty() ) continue;
     return RecordOk;
@@ -582,11 +687,29 @@ QgsDelimitedTextFile::Status QgsDelimitedTextFile::nextLine( QString &buffer, bo
 
 bool QgsDelimitedTextFile::setNextLineNumber( long nextLineNumber )
 {
-  if ( ! mStream ) return false;
+  if ( ! mFile ) return false;
+
+  // If the file is indexed, jump to the start of the closest indexed record
+  // before the line, unless the line is already reached faster by reading on.
+  if ( const QgsDelimitedTextRecordIndex *index = recordIndex() )
+  {
+    int block = index->blockForLine( nextLineNumber );
+    if ( block >= 0 )
+    {
+      const QgsDelimitedTextRecordIndex::Block &b = index->blocks.at( block );
+      if ( mLineNumber > nextLineNumber - 1 || mLineNumber < b.lineNumber - 1 )
+      {
+        mRecordNumber = -1;
+        mPosition = b.offset;
+        mLineNumber = b.lineNumber - 1;
+      }
+    }
+  }
+
   if ( mLineNumber > nextLineNumber - 1 )
   {
     mRecordNumber = -1;
-    mStream->seek( 0 );
+    rewindFile();
     mLineNumber = 0;
   }
   QString buffer;
@@ -675,6 +798,50 @@ QgsDelimitedTextFile::Status QgsDelimitedTextFile::parseRegexp( QString &buffer,
 
 QgsDelimitedTextFile::Status QgsDelimitedTextFile::parseQuoted( QString &buffer, QStringList &fields )
 {
+  auto charClass = [this]( QChar c ) -> int
+  {
+    if ( c.unicode() < 128 ) return mCharClass[c.unicode()];
+    return ( mDelimChars.contains( c ) ? CharDelim : 0 )
+           | ( mQuoteChar.contains( c ) ? CharQuote : 0 )
+           | ( mEscapeChar.contains( c ) ? CharEscape : 0 );
+  };
+
+  // Records without quote or escape characters are simply split at the
+  // delimiters.  As below, a trailing field is only added if it contains
+  // something other than whitespace.
+  const QChar *data = buffer.constData();
+  const int size = buffer.size();
+  bool plain = true;
+  for ( int i = 0; i < size; i++ )
+  {
+    int cls = charClass( data[i] );
+    if ( cls && !( cls & CharDelim ) )
+    {
+      plain = false;
+      break;
+    }
+  }
+  if ( plain )
+  {
+    int start = 0;
+    bool started = false;
+    for ( int i = 0; i < size; i++ )
+    {
+      if ( charClass( data[i] ) & CharDelim )
+      {
+        appendField( fields, buffer.mid( start, i - start ) );
+        start = i + 1;
+        started = false;
+      }
+      else if ( ! started && ! data[i].isSpace() )
+      {
+        started = true;
+      }
+    }
+    if ( started ) appendField( fields, buffer.mid( start ) );
+    return RecordOk;
+  }
+
   Status status = RecordOk;
   QString field;        // String in which to accumulate next field
   bool escaped = false; // Next char is escaped
@@ -728,12 +895,13 @@ QgsDelimitedTextFile::Status QgsDelimitedTextFile::parseQuoted( QString &buffer,
 
     bool isQuote = false;
     bool isEscape = false;
-    bool isDelim = mDelimChars.contains( c );
+    int cls = charClass( c );
+    bool isDelim = cls & CharDelim;
     if ( ! isDelim )
     {
-      bool isQuoteChar = mQuoteChar.contains( c );
+      bool isQuoteChar = cls & CharQuote;
       isQuote = quoted ? c == quoteChar : isQuoteChar;
-      isEscape = mEscapeChar.contains( c );
+      isEscape = cls & CharEscape;
       if ( isQuoteChar && isEscape ) isEscape = isQuote;
     }
 
@@ -22,13 +22,60 @@
 #include <QRegExp>
 #include <QUrl>
 #include <QObject>
+#include <QVector>
+#include <memory>
+
+#include "qgsrectangle.h"
 
 class QgsFeature;
 class QgsField;
 class QFile;
 class QFileSystemWatcher;
+class QTextCodec;
 class QTextStream;
 
+/**
+ * \class QgsDelimitedTextRecordIndex
+ * \brief Byte offsets and extents of blocks of consecutive records of a delimited text file.
+ *
+ * The index is built by the provider while scanning the file, and shared with the
+ * feature sources.  It is used to seek to a record without reading all the lines
+ * before it, and to skip blocks of records which cannot intersect a filter rectangle.
+ * It is only used for memory mapped files, and is ignored if the size of the file
+ * has changed since it was built.
+ */
+class QgsDelimitedTextRecordIndex
+{
+  public:
+
+    //! Number of records in each block
+    static const int BLOCK_SIZE = 1024;
+
+    struct Block
+    {
+      //! Line number of the first record of the block
+      long lineNumber;
+      //! Byte offset of the start of the first record of the block
+      qint64 offset;
+      //! True if the block contains valid geometries
+      bool hasGeometries;
+      //! Extent of the valid geometries of the block, if any
+      QgsRectangle extent;
+    };
+
+    /**
+     * Returns the index of the last block starting at or before \a lineNumber,
+     * or -1 if there is none
+     */
+    int blockForLine( long lineNumber ) const;
+
+    //! Size of the file when the index was built
+    qint64 fileSize = 0;
+
+    //! Blocks of records, in file order
+    QVector<Block> blocks;
+};
+
 
 /**
 \class QgsDelimitedTextFile
@@ -298,6 +345,30 @@ class QgsDelimitedTextFile : public QObject
      */
     long recordCount() { return mMaxRecordNumber; }
 
+    /**
+     * Returns the byte offset of the start of the last record read, or -1
+     *  if the file is not memory mapped
+     */
+    qint64 recordOffset() const { return mRecordOffset; }
+
+    /**
+     * Returns the size of the file if it is memory mapped, or -1 otherwise
+     */
+    qint64 mappedSize() const { return mMap ? mMapSize : -1; }
+
+    /**
+     * Set the record index used to locate records.  The index is only used
+     *  if the file is memory mapped and its size matches the index.
+     *  \param index The record index built when scanning the file
+     */
+    void setRecordIndex( const std::shared_ptr< const QgsDelimitedTextRecordIndex > &index );
+
+    /**
+     * Returns the record index if it can be used for the open file, or
+     *  nullptr otherwise
+     */
+    const QgsDelimitedTextRecordIndex *recordIndex() const;
+
     /**
      * Reset the file to reread from the beginning
      */
@@ -378,6 +449,17 @@ class QgsDelimitedTextFile : public QObject
     //! Parse quote delimited fields, where quote and escape are different
     Status parseQuoted( QString &buffer, QStringList &fields );
 
+    /**
+     * Read the next line of the file into buffer, without the end of line
+     * characters.  Returns false at the end of the file.
+     */
+    bool readLine( QString &buffer );
+
+    /**
+     * Move back to the start of the file
+     */
+    void rewindFile();
+
     /**
      * Returns the next line from the data file.  If skipBlank is true then
      * blank lines will be skipped - this is for compatibility with previous
@@ -403,6 +485,16 @@ class QgsDelimitedTextFile : public QObject
     QString mEncoding;
     QFile *mFile = nullptr;
     QTextStream *mStream = nullptr;
+
+    // Memory mapped file contents, used instead of the stream for encodings
+    // in which a new line is a single \n byte. The codec is nullptr for UTF-8.
+    uchar *mMap = nullptr;
+    qint64 mMapSize = 0;
+    qint64 mMapStart = 0;
+    qint64 mPosition = 0;
+    QTextCodec *mCodec = nullptr;
+    std::shared_ptr< const QgsDelimitedTextRecordIndex > mRecordIndex;
+
     bool mUseWatcher = false;
     QFileSystemWatcher *mWatcher = nullptr;
 
@@ -423,11 +515,23 @@ class QgsDelimitedTextFile : public QObject
     QString mQuoteChar;
     QString mEscapeChar;
 
+    // Classification of ASCII characters as delimiter, quote and escape
+    // characters for the CSV parser
+    enum CharClass
+    {
+      CharDelim = 1,
+      CharQuote = 2,
+      CharEscape = 4
+    };
+    quint8 mCharClass[128];
+
     // Information extracted from file
     QStringList mFieldNames;
     long mLineNumber = -1;
     long mRecordLineNumber = -1;
     long mRecordNumber = -1;
+    qint64 mLineOffset = -1;
+    qint64 mRecordOffset = -1;
     QStringList mCurrentRecord;
     bool mHoldCurrentRecord = false;
     // Maximum number of record (ie maximum record number visited)
@@ -27,6 +27,7 @@
 #include <QRegExp>
 #include <QUrl>
 #include <QUrlQuery>
+#include <QtConcurrentMap>
 
 #include "qgsapplication.h"
 #include "qgsdataprovider.h"
@@ -60,7 +61,10 @@ static const QString TEXT_PROVIDER_DESCRIPTION = QStringLiteral( "Delimited text
 
 static const int SUBSET_ID_THRESHOLD_FACTOR = 10;
 
-QRegExp QgsDelimitedTextProvider::sWktPrefixRegexp( "^\\s*(?:\\d+\\s+|SRID\\=\\d+\\;)", Qt::CaseInsensitive );
+// Number of records parsed in parallel when scanning the file
+static const int SCAN_BATCH_SIZE = 8192;
+
+const QRegularExpression QgsDelimitedTextProvider::sWktPrefixRegexp( "^\\s*(?:\\d+\\s+|SRID\\=\\d+\\;)", QRegularExpression::CaseInsensitiveOption );
 QRegExp QgsDelimitedTextProvider::sCrdDmsRegexp( "^\\s*(?:([-+nsew])\\s*)?(\\d{1,3})(?:[^0-9.]+([0-5]?\\d))?[^0-9.]+([0-5]?\\d(?:\\.\\d+)?)[^0-9.]*([-+nsew])?\\s*$", Qt::CaseInsensitive );
 
 QgsDelimitedTextProvider::QgsDelimitedTextProvider( const QString &uri, const ProviderOptions &options )
@@ -306,6 +310,7 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
   // Initiallize indexes
 
   resetIndexes();
+  mRecordIndex.reset();
   bool buildSpatialIndex = buildIndexes && nullptr != mSpatialIndex;
 
   // No point building a subset index if there is no geometry, as all
@@ -364,7 +369,6 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
   //
   // Also build subset and spatial indexes.
 
-  QStringList parts;
   long nEmptyRecords = 0;
   long nBadFormatRecords = 0;
   long nIncompatibleGeometry = 0;
@@ -379,110 +383,150 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
   QList<bool> couldBeDouble;
   bool foundFirstGeometry = false;
 
-  while ( true )
+  // Records are read in batches. The geometries and the possible types of the
+  // values of each batch are parsed in parallel, and the results are then
+  // merged in file order.  For memory mapped files an index of the offsets and
+  // extents of blocks of records is built at the same time.
+
+  std::shared_ptr< QgsDelimitedTextRecordIndex > recordIndex;
+  long recordCount = 0;
+
+  QVector<ScannedRecord> batch( SCAN_BATCH_SIZE );
+  bool atEnd = false;
+  while ( !atEnd )
   {
-    QgsDelimitedTextFile::Status status = mFile->nextRecord( parts );
-    if ( status == QgsDelimitedTextFile::RecordEOF )
-      break;
-    if ( status != QgsDelimitedTextFile::RecordOk )
-    {
-      nBadFormatRecords++;
-      recordInvalidLine( tr( "Invalid record format at line %1" ) );
-      continue;
-    }
-    // Skip over empty records
-    if ( recordIsEmpty( parts ) )
+    int batchCount = 0;
+    while ( batchCount < SCAN_BATCH_SIZE )
     {
-      nEmptyRecords++;
-      continue;
+      ScannedRecord &record = batch[batchCount];
+      record.status = mFile->nextRecord( record.parts );
+      if ( record.status == QgsDelimitedTextFile::RecordEOF )
+      {
+        atEnd = true;
+        break;
+      }
+      record.recordId = mFile->recordId();
+      record.block = -1;
+
+      if ( mFile->recordOffset() >= 0 )
+      {
+        if ( recordCount % QgsDelimitedTextRecordIndex::BLOCK_SIZE == 0 )
+        {
+          if ( !recordIndex )
+            recordIndex = std::make_shared< QgsDelimitedTextRecordIndex >();
+          QgsDelimitedTextRecordIndex::Block newBlock;
+          newBlock.lineNumber = record.recordId;
+          newBlock.offset = mFile->recordOffset();
+          newBlock.hasGeometries = false;
+          recordIndex->blocks.append( newBlock );
+        }
+        if ( recordIndex )
+          record.block = recordIndex->blocks.size() - 1;
+      }
+      recordCount++;
+      batchCount++;
     }
 
-    // Check geometries are valid
-    bool geomValid = true;
+    QtConcurrent::blockingMap( batch.begin(), batch.begin() + batchCount, [this]( ScannedRecord & record )
+    {
+      scanRecord( record );
+    } );
 
-    if ( mGeomRep == GeomAsWkt )
+    for ( int r = 0; r < batchCount; r++ )
     {
-      if ( mWktFieldIndex >= parts.size() || parts[mWktFieldIndex].isEmpty() )
+      const ScannedRecord &record = batch.at( r );
+      if ( record.status != QgsDelimitedTextFile::RecordOk )
       {
-        nEmptyGeometry++;
-        mNumberFeatures++;
+        nBadFormatRecords++;
+        recordInvalidLine( tr( "Invalid record format at line %1" ), record.recordId );
+        continue;
       }
-      else
+      // Skip over empty records
+      if ( record.isEmpty )
       {
-        // Get the wkt - confirm it is valid, get the type, and
-        // if compatible with the rest of file, add to the extents
+        nEmptyRecords++;
+        continue;
+      }
+
+      QgsDelimitedTextRecordIndex::Block *block = record.block >= 0 ? &recordIndex->blocks[record.block] : nullptr;
 
-        QString sWkt = parts[mWktFieldIndex];
-        QgsGeometry geom;
-        if ( !mWktHasPrefix && sWkt.indexOf( sWktPrefixRegexp ) >= 0 )
-          mWktHasPrefix = true;
-        geom = geomFromWkt( sWkt, mWktHasPrefix );
+      // Check geometries are valid
+      bool geomValid = true;
 
-        if ( !geom.isNull() )
+      if ( mGeomRep == GeomAsWkt )
+      {
+        if ( record.isNullGeometry )
         {
-          QgsWkbTypes::Type type = geom.wkbType();
-          if ( type != QgsWkbTypes::NoGeometry )
+          nEmptyGeometry++;
+          mNumberFeatures++;
+        }
+        else
+        {
+          // Confirm the wkt is valid, get the type, and
+          // if compatible with the rest of file, add to the extents
+
+          const QgsGeometry &geom = record.geometry;
+          if ( record.wktHasPrefix )
+            mWktHasPrefix = true;
+
+          if ( !geom.isNull() )
           {
-            if ( mGeometryType == QgsWkbTypes::UnknownGeometry || geom.type() == mGeometryType )
+            QgsWkbTypes::Type type = geom.wkbType();
+            if ( type != QgsWkbTypes::NoGeometry )
             {
-              mGeometryType = geom.type();
-              if ( !foundFirstGeometry )
+              if ( mGeometryType == QgsWkbTypes::UnknownGeometry || geom.type() == mGeometryType )
               {
-                mNumberFeatures++;
-                mWkbType = type;
-                mExtent = geom.boundingBox();
-                foundFirstGeometry = true;
-              }
-              else
-              {
-                mNumberFeatures++;
-                if ( geom.isMultipart() )
+                mGeometryType = geom.type();
+                if ( !foundFirstGeometry )
+                {
+                  mNumberFeatures++;
                   mWkbType = type;
-                QgsRectangle bbox( geom.boundingBox() );
-                mExtent.combineExtentWith( bbox );
+                  mExtent = geom.boundingBox();
+                  foundFirstGeometry = true;
+                }
+                else
+                {
+                  mNumberFeatures++;
+                  if ( geom.isMultipart() )
+                    mWkbType = type;
+                  QgsRectangle bbox( geom.boundingBox() );
+                  mExtent.combineExtentWith( bbox );
+                }
+                if ( block )
+                  addToBlockExtent( *block, geom.boundingBox() );
+                if ( buildSpatialIndex )
+                {
+                  QgsFeature f;
+                  f.setId( record.recordId );
+                  f.setGeometry( geom );
+                  mSpatialIndex->addFeature( f );
+                }
               }
-              if ( buildSpatialIndex )
+              else
               {
-                QgsFeature f;
-                f.setId( mFile->recordId() );
-                f.setGeometry( geom );
-                mSpatialIndex->addFeature( f );
+                nIncompatibleGeometry++;
+                geomValid = false;
               }
             }
-            else
-            {
-              nIncompatibleGeometry++;
-              geomValid = false;
-            }
+          }
+          else
+          {
+            geomValid = false;
+            nInvalidGeometry++;
+            recordInvalidLine( tr( "Invalid WKT at line %1" ), record.recordId );
           }
         }
-        else
-        {
-          geomValid = false;
-          nInvalidGeometry++;
-          recordInvalidLine( tr( "Invalid WKT at line %1" ) );
-        }
-      }
-    }
-    else if ( mGeomRep == GeomAsXy )
-    {
-      // Get the x and y values, first checking to make sure they
-      // aren't null.
-
-      QString sX = mXFieldIndex < parts.size() ? parts[mXFieldIndex] : QString();
-      QString sY = mYFieldIndex < parts.size() ? parts[mYFieldIndex] : QString();
-      if ( sX.isEmpty() && sY.isEmpty() )
-      {
-        nEmptyGeometry++;
-        mNumberFeatures++;
       }
-      else
+      else if ( mGeomRep == GeomAsXy )
       {
-        QgsPointXY pt;
-        bool ok = pointFromXY( sX, sY, pt, mDecimalPoint, mXyDms );
-
-        if ( ok )
+        if ( record.isNullGeometry )
         {
+          nEmptyGeometry++;
+          mNumberFeatures++;
+        }
+        else if ( record.pointOk )
+        {
+          const QgsPointXY &pt = record.point;
           if ( foundFirstGeometry )
           {
             mExtent.combineExtentWith( pt.x(), pt.y() );
@@ -496,10 +540,12 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
             foundFirstGeometry = true;
           }
           mNumberFeatures++;
+          if ( block )
+            addToBlockExtent( *block, QgsRectangle( pt.x(), pt.y(), pt.x(), pt.y() ) );
           if ( buildSpatialIndex && std::isfinite( pt.x() ) && std::isfinite( pt.y() ) )
           {
             QgsFeature f;
-            f.setId( mFile->recordId() );
+            f.setId( record.recordId );
             f.setGeometry( QgsGeometry::fromPointXY( pt ) );
             mSpatialIndex->addFeature( f );
           }
@@ -508,84 +554,74 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
         {
           geomValid = false;
           nInvalidGeometry++;
-          recordInvalidLine( tr( "Invalid X or Y fields at line %1" ) );
+          recordInvalidLine( tr( "Invalid X or Y fields at line %1" ), record.recordId );
         }
       }
-    }
-    else
-    {
-      mWkbType = QgsWkbTypes::NoGeometry;
-      mNumberFeatures++;
-    }
-
-    if ( !geomValid )
-      continue;
-
-    if ( buildSubsetIndex )
-      mSubsetIndex.append( mFile->recordId() );
-
-
-    // If we are going to use this record, then assess the potential types of each column
-
-    for ( int i = 0; i < parts.size(); i++ )
-    {
+      else
+      {
+        mWkbType = QgsWkbTypes::NoGeometry;
+        mNumberFeatures++;
+      }
 
-      QString &value = parts[i];
-      // Ignore empty fields - spreadsheet generated CSV files often
-      // have random empty fields at the end of a row
-      if ( value.isEmpty() )
+      if ( !geomValid )
         continue;
 
-      // Expand the columns to include this non empty field if necessary
-
-      while ( couldBeInt.size() <= i )
-      {
-        isEmpty.append( true );
-        couldBeInt.append( false );
-        couldBeLongLong.append( false );
-        couldBeDouble.append( false );
-      }
+      if ( buildSubsetIndex )
+        mSubsetIndex.append( record.recordId );
 
-      // If this column has been empty so far then initiallize it
-      // for possible types
+      // If we are going to use this record, then merge the potential types of each column
 
-      if ( isEmpty[i] )
+      for ( int i = 0; i < record.fieldTypes.size(); i++ )
       {
-        isEmpty[i] = false;
-        couldBeInt[i] = true;
-        couldBeLongLong[i] = true;
-        couldBeDouble[i] = true;
-      }
+        const int types = record.fieldTypes.at( i );
 
-      if ( ! mDetectTypes )
-      {
-        continue;
-      }
+        // Ignore empty fields - spreadsheet generated CSV files often
+        // have random empty fields at the end of a row
+        if ( !( types & ScannedRecord::NotEmpty ) )
+          continue;
 
-      // Now test for still valid possible types for the field
-      // Types are possible until first record which cannot be parsed
+        // Expand the columns to include this non empty field if necessary
 
-      if ( couldBeInt[i] )
-      {
-        value.toInt( &couldBeInt[i] );
-      }
+        while ( couldBeInt.size() <= i )
+        {
+          isEmpty.append( true );
+          couldBeInt.append( false );
+          couldBeLongLong.append( false );
+          couldBeDouble.append( false );
+        }
 
-      if ( couldBeLongLong[i] && ! couldBeInt[i] )
-      {
-        value.toLongLong( &couldBeLongLong[i] );
-      }
+        // If this column has been empty so far then initiallize it
+        // for possible types
 
-      if ( couldBeDouble[i] && ! couldBeLongLong[i] )
-      {
-        if ( ! mDecimalPoint.isEmpty() )
+        if ( isEmpty[i] )
         {
-          value.replace( mDecimalPoint, QLatin1String( "." ) );
+          isEmpty[i] = false;
+          couldBeInt[i] = true;
+          couldBeLongLong[i] = true;
+          couldBeDouble[i] = true;
         }
-        value.toDouble( &couldBeDouble[i] );
+
+        if ( ! mDetectTypes )
+        {
+          continue;
+        }
+
+        // Types are possible until first record which cannot be parsed
+
+        couldBeInt[i] = couldBeInt[i] && ( types & ScannedRecord::CouldBeInt );
+        couldBeLongLong[i] = couldBeLongLong[i] && ( types & ScannedRecord::CouldBeLongLong );
+        couldBeDouble[i] = couldBeDouble[i] && ( types & ScannedRecord::CouldBeDouble );
       }
     }
   }
 
+  if ( recordIndex )
+  {
+    recordIndex->fileSize = mFile->mappedSize();
+    mRecordIndex = recordIndex;
+    QgsDebugMsg( QStringLiteral( "Indexed %1 blocks of records" ).arg( recordIndex->blocks.size() ) );
+  }
+
   // Now create the attribute fields.  Field types are integer by preference,
   // failing that double, failing that text.
 
@@ -687,6 +723,111 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
   connect( mFile.get(), &QgsDelimitedTextFile::fileUpdated, this, &QgsDelimitedTextProvider::onFileUpdated );
 }
 
+void QgsDelimitedTextProvider::scanRecord( ScannedRecord &record ) const
+{
+  record.isEmpty = false;
+  record.isNullGeometry = false;
+  record.wktHasPrefix = false;
+  record.geometry = QgsGeometry();
+  record.pointOk = false;
+  record.fieldTypes.clear();
+
+  if ( record.status != QgsDelimitedTextFile::RecordOk )
+    return;
+
+  QStringList &parts = record.parts;
+  record.isEmpty = recordIsEmpty( parts );
+  if ( record.isEmpty )
+    return;
+
+  if ( mGeomRep == GeomAsWkt )
+  {
+    if ( mWktFieldIndex >= parts.size() || parts[mWktFieldIndex].isEmpty() )
+    {
+      record.isNullGeometry = true;
+    }
+    else
+    {
+      // Removing the prefix is a no-op for values without one, so each value
+      // can be parsed independently of whether previous records had a prefix
+      QString sWkt = parts[mWktFieldIndex];
+      record.wktHasPrefix = sWktPrefixRegexp.match( sWkt ).hasMatch();
+      record.geometry = geomFromWkt( sWkt, record.wktHasPrefix );
+    }
+  }
+  else if ( mGeomRep == GeomAsXy )
+  {
+    // Get the x and y values, first checking to make sure they
+    // aren't null.
+
+    QString sX = mXFieldIndex < parts.size() ? parts[mXFieldIndex] : QString();
+    QString sY = mYFieldIndex < parts.size() ? parts[mYFieldIndex] : QString();
+    if ( sX.isEmpty() && sY.isEmpty() )
+      record.isNullGeometry = true;
+    else
+      record.pointOk = pointFromXY( sX, sY, record.point, mDecimalPoint, mXyDms );
+  }
+
+  // Test the possible types of each value. A value which can be parsed as an
+  // integer can also be parsed as a long long and as a double.
+
+  record.fieldTypes.resize( parts.size() );
+  for ( int i = 0; i < parts.size(); i++ )
+  {
+    QString &value = parts[i];
+    int types = 0;
+    if ( !value.isEmpty() )
+    {
+      types = ScannedRecord::NotEmpty;
+      if ( mDetectTypes )
+      {
+        bool ok = false;
+        value.toInt( &ok );
+        if ( ok )
+        {
+          types |= ScannedRecord::CouldBeInt | ScannedRecord::CouldBeLongLong | ScannedRecord::CouldBeDouble;
+        }
+        else
+        {
+          value.toLongLong( &ok );
+          if ( ok )
+          {
+            types |= ScannedRecord::CouldBeLongLong | ScannedRecord::CouldBeDouble;
+          }
+          else
+          {
+            if ( ! mDecimalPoint.isEmpty() )
+            {
+              value.replace( mDecimalPoint, QLatin1String( "." ) );
+            }
+            value.toDouble( &ok );
+            if ( ok )
+              types |= ScannedRecord::CouldBeDouble;
+          }
+        }
+      }
+    }
+    record.fieldTypes[i] = static_cast< quint8 >( types );
+  }
+}
+
+void QgsDelimitedTextProvider::addToBlockExtent( QgsDelimitedTextRecordIndex::Block &block, const QgsRectangle &rect )
+{
+  if ( !std::isfinite( rect.xMinimum() ) || !std::isfinite( rect.yMinimum() ) || !std::isfinite( rect.xMaximum() ) || !std::isfinite( rect.yMaximum() ) )
+    return;
+
+  if ( !block.hasGeometries )
+  {
+    block.extent = rect;
+    block.hasGeometries = true;
+  }
+  else
+  {
+    block.extent.include( QgsPointXY( rect.xMinimum(), rect.yMinimum() ) );
+    block.extent.include( QgsPointXY( rect.xMaximum(), rect.yMaximum() ) );
+  }
+}
+
 // rescanFile.  Called if something has changed file definition, such as
 // selecting a subset, the file has been changed by another program, etc
 
@@ -908,11 +1049,11 @@ bool QgsDelimitedTextProvider::recordIsEmpty( QStringList &record )
   return true;
 }
 
-void QgsDelimitedTextProvider::recordInvalidLine( const QString &message )
+void QgsDelimitedTextProvider::recordInvalidLine( const QString &message, long recordId )
 {
   if ( mInvalidLines.size() < mMaxInvalidLines )
   {
-    mInvalidLines.append( message.arg( mFile->recordId() ) );
+    mInvalidLines.append( message.arg( recordId ) );
   }
   else
   {
@@ -1076,6 +1217,9 @@ void QgsDelimitedTextProvider::setUriParameter( const QString &parameter, const
 
 void QgsDelimitedTextProvider::onFileUpdated()
 {
+  // Record offsets are no longer valid
+  mRecordIndex.reset();
+
   if ( ! mRescanRequired )
   {
     QStringList messages;
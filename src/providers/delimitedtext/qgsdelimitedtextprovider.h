@@ -22,13 +22,14 @@
 #include "qgscoordinatereferencesystem.h"
 #include "qgsdelimitedtextfile.h"
 #include "qgsfields.h"
+#include "qgsgeometry.h"
+#include "qgspointxy.h"
 
 #include <QStringList>
+#include <QRegularExpression>
 
 class QgsFeature;
 class QgsField;
-class QgsGeometry;
-class QgsPointXY;
 class QFile;
 class QTextStream;
 
@@ -65,7 +66,7 @@ class QgsDelimitedTextProvider : public QgsVectorDataProvider
      * Regular expression defining possible prefixes to WKT string,
      * (EWKT srid, Informix SRID)
      */
-    static QRegExp sWktPrefixRegexp;
+    static const QRegularExpression sWktPrefixRegexp;
     static QRegExp sCrdDmsRegexp;
 
     enum GeomRepresentationType
@@ -192,14 +193,47 @@ class QgsDelimitedTextProvider : public QgsVectorDataProvider
 
   private:
 
+    //! A record read by scanFile, with the results of parsing it
+    struct ScannedRecord
+    {
+      enum FieldType
+      {
+        NotEmpty = 1,
+        CouldBeInt = 2,
+        CouldBeLongLong = 4,
+        CouldBeDouble = 8
+      };
+
+      QStringList parts;
+      QgsDelimitedTextFile::Status status = QgsDelimitedTextFile::RecordOk;
+      long recordId = -1;
+      //! Index of the block of the record index containing the record, or -1
+      int block = -1;
+      bool isEmpty = false;
+      bool isNullGeometry = false;
+      bool wktHasPrefix = false;
+      QgsGeometry geometry;
+      QgsPointXY point;
+      bool pointOk = false;
+      //! Combination of FieldType flags for each value of the record
+      QVector<quint8> fieldTypes;
+    };
+
     void scanFile( bool buildIndexes );
 
+    /**
+     * Parses the geometry of a record and tests the possible types of its values.
+     * Only reads the settings of the provider, so records can be scanned in parallel.
+     */
+    void scanRecord( ScannedRecord &record ) const;
+    static void addToBlockExtent( QgsDelimitedTextRecordIndex::Block &block, const QgsRectangle &rect );
+
     //some of these methods const, as they need to be called from const methods such as extent()
     void rescanFile() const;
     void resetCachedSubset() const;
     void resetIndexes() const;
     void clearInvalidLines() const;
-    void recordInvalidLine( const QString &message );
+    void recordInvalidLine( const QString &message, long recordId );
     void reportErrors( const QStringList &messages = QStringList(), bool showDialog = false ) const;
     static bool recordIsEmpty( QStringList &record );
     void setUriParameter( const QString &parameter, const QString &value );
@@ -277,6 +311,9 @@ class QgsDelimitedTextProvider : public QgsVectorDataProvider
     mutable bool mCachedUseSpatialIndex;
     mutable std::unique_ptr< QgsSpatialIndex > mSpatialIndex;
 
+    //! Offsets and extents of blocks of records, if the file is memory mapped
+    std::shared_ptr< const QgsDelimitedTextRecordIndex > mRecordIndex;
+
     friend class QgsDelimitedTextFeatureIterator;
     friend class QgsDelimitedTextFeatureSource;
 };
@@ -27,6 +27,7 @@
 #include "qgsexception.h"
 #include "qgswkbtypes.h"
 #include "qgsogrtransaction.h"
+#include "qgsfeaturebatch.h"
 
 #include <QTextCodec>
 #include <QFile>
@@ -465,6 +466,129 @@ void QgsOgrFeatureIterator::getFeatureAttribute( OGRFeatureH ogrFet, QgsFeature
   f.setAttribute( attindex, value );
 }
 
+void QgsOgrFeatureIterator::getBatchAttribute( OGRFeatureH ogrFet, QgsFeatureBatch &batch, int row, int attindex ) const
+{
+  if ( mFirstFieldIsFid && attindex == 0 )
+  {
+    batch.setValue( row, 0, static_cast<qint64>( OGR_F_GetFID( ogrFet ) ) );
+    return;
+  }
+
+  int attindexWithoutFid = ( mFirstFieldIsFid ) ? attindex - 1 : attindex;
+  if ( !OGR_F_IsFieldSetAndNotNull( ogrFet, attindexWithoutFid ) )
+    return;
+
+  // read the common types straight into the typed columns, without a QVariant round trip
+  switch ( mFieldsWithoutFid.at( attindexWithoutFid ).type() )
+  {
+    case QVariant::Double:
+      batch.setDouble( row, attindex, OGR_F_GetFieldAsDouble( ogrFet, attindexWithoutFid ) );
+      return;
+
+    case QVariant::Int:
+    case QVariant::LongLong:
+      batch.setInteger( row, attindex, OGR_F_GetFieldAsInteger64( ogrFet, attindexWithoutFid ) );
+      return;
+
+    case QVariant::String:
+    {
+      const char *value = OGR_F_GetFieldAsString( ogrFet, attindexWithoutFid );
+      batch.setString( row, attindex, mSource->mEncoding ? mSource->mEncoding->toUnicode( value ) : QString::fromUtf8( value ) );
+      return;
+    }
+
+    default:
+      break;
+  }
+
+  bool ok = false;
+  QVariant value = QgsOgrUtils::getOgrFeatureAttribute( ogrFet, mFieldsWithoutFid, attindexWithoutFid, mSource->mEncoding, &ok );
+  if ( ok )
+    batch.setValue( row, attindex, value );
+}
+
+void QgsOgrFeatureIterator::getBatchGeometry( OGRFeatureH ogrFet, QgsFeatureBatch &batch, int row, QByteArray &wkbBuffer ) const
+{
+  OGRGeometryH geom = OGR_F_GetGeometryRef( ogrFet );
+  if ( !geom )
+    return;
+
+  const OGRwkbGeometryType flatType = wkbFlatten( OGR_G_GetGeometryType( geom ) );
+  const bool isMulti = flatType == wkbMultiPoint || flatType == wkbMultiLineString || flatType == wkbMultiPolygon || flatType == wkbGeometryCollection;
+  const bool isLinear = flatType >= wkbPoint && flatType <= wkbGeometryCollection;
+  if ( !isLinear || ( QgsWkbTypes::isMultiType( mSource->mWkbType ) && !isMulti ) )
+  {
+    // curves, TINs and single parts of multipart datasets need the same conversion as readFeature()
+    QgsGeometry g = QgsOgrUtils::ogrGeometryToQgsGeometry( geom );
+    if ( QgsWkbTypes::isMultiType( mSource->mWkbType ) && !g.isMultipart() )
+      g.convertToMultiType();
+    batch.setGeometry( row, g );
+    return;
+  }
+
+  const int size = OGR_G_WkbSize( geom );
+  if ( size <= 0 )
+    return;
+
+  wkbBuffer.resize( size );
+  unsigned char *wkb = reinterpret_cast< unsigned char * >( wkbBuffer.data() );
+  if ( OGR_G_ExportToIsoWkb( geom, ( OGRwkbByteOrder ) QgsApplication::endian(), wkb ) == OGRERR_NONE )
+    batch.setGeometryWkb( row, wkb, size );
+}
+
+int QgsOgrFeatureIterator::fetchBatch( QgsFeatureBatch &batch, int maximumSize )
+{
+  // the batch path reads features sequentially without any filtering or reprojection
+  if ( mTransform.isValid() || !mFilterRect.isNull() || mSource->mOgrGeometryTypeFilter != wkbUnknown
+       || mRequest.filterType() != QgsFeatureRequest::FilterNone )
+    return QgsAbstractFeatureIterator::fetchBatch( batch, maximumSize );
+
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(2,2,0)
+  if ( !QgsOgrProviderUtils::canDriverShareSameDatasetAmongLayers( mSource->mDriverName ) )
+    return QgsAbstractFeatureIterator::fetchBatch( batch, maximumSize );
+#endif
+
+  QMutexLocker locker( mSharedDS ? &mSharedDS->mutex() : nullptr );
+
+  if ( mClosed || !mOgrLayer )
+    return 0;
+
+  if ( batch.fields() != mSource->mFields )
+    batch.setFields( mSource->mFields );
+  batch.reserve( maximumSize );
+
+  QgsAttributeList attrs;
+  if ( mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes )
+    attrs = mRequest.subsetOfAttributes();
+  else
+    attrs = mSource->mFields.allAttributesList();
+
+  QByteArray wkbBuffer;
+  gdal::ogr_feature_unique_ptr fet;
+  int count = 0;
+  while ( count < maximumSize )
+  {
+    fet.reset( OGR_L_GetNextFeature( mOgrLayer ) );
+    if ( !fet )
+    {
+      close();
+      break;
+    }
+
+    const int row = batch.appendRow( OGR_F_GetFID( fet.get() ) );
+    if ( mFetchGeometry )
+      getBatchGeometry( fet.get(), batch, row, wkbBuffer );
+
+    for ( int idx : qgis::as_const( attrs ) )
+    {
+      getBatchAttribute( fet.get(), batch, row, idx );
+    }
+    ++count;
+  }
+
+  return count;
+}
+
 bool QgsOgrFeatureIterator::readFeature( gdal::ogr_feature_unique_ptr fet, QgsFeature &feature ) const
 {
   feature.setId( OGR_F_GetFID( fet.get() ) );
@@ -71,6 +71,7 @@ class QgsOgrFeatureIterator : public QgsAbstractFeatureIteratorFromSource<QgsOgr
     bool checkFeature( gdal::ogr_feature_unique_ptr &fet, QgsFeature &feature ) ;
     bool fetchFeature( QgsFeature &feature ) override;
     bool nextFeatureFilterExpression( QgsFeature &f ) override;
+    int fetchBatch( QgsFeatureBatch &batch, int maximumSize ) override;
 
   private:
 
@@ -79,6 +80,12 @@ class QgsOgrFeatureIterator : public QgsAbstractFeatureIteratorFromSource<QgsOgr
     //! Gets an attribute associated with a feature
     void getFeatureAttribute( OGRFeatureH ogrFet, QgsFeature &f, int attindex ) const;
 
+    //! Stores an attribute of an OGR feature directly into a batch row
+    void getBatchAttribute( OGRFeatureH ogrFet, QgsFeatureBatch &batch, int row, int attindex ) const;
+
+    //! Stores the geometry of an OGR feature into a batch row
+    void getBatchGeometry( OGRFeatureH ogrFet, QgsFeatureBatch &batch, int row, QByteArray &wkbBuffer ) const;
+
     QgsOgrConn *mConn = nullptr;
     OGRLayerH mOgrLayer = nullptr; // when mOgrLayerUnfiltered != null and mOgrLayer != mOgrLayerUnfiltered, this is a SQL layer
     OGRLayerH mOgrLayerOri = nullptr; // only set when there's a mSubsetString. In which case this a regular OGR layer. Potentially == mOgrLayer
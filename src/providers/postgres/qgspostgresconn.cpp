@@ -30,6 +30,7 @@
 
 #include <QApplication>
 #include <QThread>
+#include <QtEndian>
 
 #include <climits>
 
@@ -1204,6 +1205,18 @@ PGresult *QgsPostgresConn::PQgetResult()
   return ::PQgetResult( mConn );
 }
 
+int QgsPostgresConn::PQputCopyData( const QByteArray &data )
+{
+  Q_ASSERT( mConn );
+  return ::PQputCopyData( mConn, data.constData(), data.size() );
+}
+
+int QgsPostgresConn::PQputCopyEnd( const QString &errorMessage )
+{
+  Q_ASSERT( mConn );
+  return ::PQputCopyEnd( mConn, errorMessage.isEmpty() ? nullptr : errorMessage.toUtf8().constData() );
+}
+
 PGresult *QgsPostgresConn::PQprepare( const QString &stmtName, const QString &query, int nParams, const Oid *paramTypes )
 {
   QMutexLocker locker( &mLock );
@@ -1388,6 +1401,26 @@ qint64 QgsPostgresConn::getBinaryInt( QgsPostgresResult &queryResult, int row, i
   return oid;
 }
 
+double QgsPostgresConn::getBinaryDouble( QgsPostgresResult &queryResult, int row, int col )
+{
+  Q_ASSERT( ::PQgetlength( queryResult.result(), row, col ) == sizeof( double ) );
+
+  quint64 bits;
+  memcpy( &bits, PQgetvalue( queryResult.result(), row, col ), sizeof( bits ) );
+  if ( mSwapEndian )
+    bits = qFromBigEndian( bits );
+
+  double value;
+  memcpy( &value, &bits, sizeof( value ) );
+  return value;
+}
+
+bool QgsPostgresConn::integerDatetimes() const
+{
+  // servers since PostgreSQL 10 always use integers, older ones could be built with floating point datetimes
+  return qstrcmp( ::PQparameterStatus( mConn, "integer_datetimes" ), "on" ) == 0;
+}
+
 QString QgsPostgresConn::fieldExpression( const QgsField &fld, QString expr )
 {
   const QString &type = fld.typeName();
@@ -264,6 +264,19 @@ class QgsPostgresConn : public QObject
      */
     PGresult *PQgetResult();
 
+    /**
+     * PQputCopyData sends rows of a COPY FROM STDIN started with PQexec()
+     * Thread safety must be ensured by the caller by calling QgsPostgresConn::lock() and QgsPostgresConn::unlock()
+     */
+    int PQputCopyData( const QByteArray &data );
+
+    /**
+     * PQputCopyEnd ends a COPY FROM STDIN, the COPY fails with \a errorMessage if it is not empty.
+     * Its result is returned by PQgetResult()
+     * Thread safety must be ensured by the caller by calling QgsPostgresConn::lock() and QgsPostgresConn::unlock()
+     */
+    int PQputCopyEnd( const QString &errorMessage = QString() );
+
     bool begin();
     bool commit();
     bool rollback();
@@ -322,6 +335,12 @@ class QgsPostgresConn : public QObject
 
     qint64 getBinaryInt( QgsPostgresResult &queryResult, int row, int col );
 
+    //! Returns the float8 value of a binary cursor result
+    double getBinaryDouble( QgsPostgresResult &queryResult, int row, int col );
+
+    //! Returns true if the server transfers binary date and time values as integers
+    bool integerDatetimes() const;
+
     QString fieldExpression( const QgsField &fld, QString expr = "%1" );
 
     QString connInfo() const { return mConnInfo; }
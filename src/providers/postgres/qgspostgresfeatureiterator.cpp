@@ -22,10 +22,14 @@
 #include "qgsmessagelog.h"
 #include "qgssettings.h"
 #include "qgsexception.h"
+#include "qgsfeaturebatch.h"
 
+#include <QDateTime>
 #include <QElapsedTimer>
 #include <QObject>
 
+#include <limits>
+
 QgsPostgresFeatureIterator::QgsPostgresFeatureIterator( QgsPostgresFeatureSource *source, bool ownSource, const QgsFeatureRequest &request )
   : QgsAbstractFeatureIteratorFromSource<QgsPostgresFeatureSource>( source, ownSource, request )
 {
@@ -46,6 +50,7 @@ QgsPostgresFeatureIterator::QgsPostgresFeatureIterator( QgsPostgresFeatureSource
     mConn = source->mTransactionConnection;
     mIsTransactionConnection = true;
   }
+  mPrefetch = !mIsTransactionConnection;
 
   if ( !mConn || mConn->PQstatus() != CONNECTION_OK )
   {
@@ -259,34 +264,15 @@ bool QgsPostgresFeatureIterator::fetchFeature( QgsFeature &feature )
     timer.start();
 #endif
 
-    QString fetch = QStringLiteral( "FETCH FORWARD %1 FROM %2" ).arg( mFeatureQueueSize ).arg( mCursorName );
-    QgsDebugMsgLevel( QStringLiteral( "fetching %1 features." ).arg( mFeatureQueueSize ), 4 );
-
     lock();
-    if ( mConn->PQsendQuery( fetch ) == 0 ) // fetch features asynchronously
-    {
-      QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName, mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
-    }
-
     QgsPostgresResult queryResult;
-    for ( ;; )
+    if ( ( mFetchPending || sendFetch( mFeatureQueueSize ) ) && receiveFetch( queryResult ) )
     {
-      queryResult = mConn->PQgetResult();
-      if ( !queryResult.result() )
-        break;
-
-      if ( queryResult.PQresultStatus() != PGRES_TUPLES_OK )
-      {
-        QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName, mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
-        break;
-      }
+      // request the next features while these ones are processed
+      if ( mPrefetch && !mLastFetch )
+        sendFetch( mFeatureQueueSize );
 
       int rows = queryResult.PQntuples();
-      if ( rows == 0 )
-        continue;
-
-      mLastFetch = rows < mFeatureQueueSize;
-
       for ( int row = 0; row < rows; row++ )
       {
         mFeatureQueue.enqueue( QgsFeature() );
@@ -327,6 +313,52 @@ bool QgsPostgresFeatureIterator::fetchFeature( QgsFeature &feature )
   return true;
 }
 
+int QgsPostgresFeatureIterator::fetchBatch( QgsFeatureBatch &batch, int maximumSize )
+{
+  // features already queued by fetchFeature() and reprojected requests go through the generic path
+  // as well as features of a pending fetch which would not fit into the batch
+  if ( mTransform.isValid() || !mFeatureQueue.empty() || mSource->mPrimaryKeyType == PktUnknown ||
+       ( mFetchPending && mPendingFetchSize > maximumSize ) )
+    return QgsAbstractFeatureIterator::fetchBatch( batch, maximumSize );
+
+  if ( mClosed )
+    return 0;
+
+  if ( batch.fields() != mSource->mFields )
+    batch.setFields( mSource->mFields );
+  batch.reserve( maximumSize );
+
+  if ( !mLastFetch )
+  {
+    lock();
+    QgsPostgresResult queryResult;
+    if ( ( mFetchPending || sendFetch( maximumSize ) ) && receiveFetch( queryResult ) )
+    {
+      if ( mPrefetch && !mLastFetch )
+        sendFetch( maximumSize );
+
+      int rows = queryResult.PQntuples();
+      for ( int row = 0; row < rows; row++ )
+      {
+        getBatchRow( queryResult, row, batch );
+      }
+    }
+    unlock();
+  }
+
+  if ( batch.isEmpty() )
+  {
+    QgsDebugMsg( QStringLiteral( "Finished after %1 features" ).arg( mFetched ) );
+    close();
+
+    mSource->mShared->ensureFeaturesCountedAtLeast( mFetched );
+    return 0;
+  }
+
+  mFetched += batch.count();
+  return batch.count();
+}
+
 bool QgsPostgresFeatureIterator::nextFeatureFilterExpression( QgsFeature &f )
 {
   if ( !mExpressionCompiled )
@@ -335,6 +367,64 @@ bool QgsPostgresFeatureIterator::nextFeatureFilterExpression( QgsFeature &f )
     return fetchFeature( f );
 }
 
+bool QgsPostgresFeatureIterator::sendFetch( int count )
+{
+  QString fetch = QStringLiteral( "FETCH FORWARD %1 FROM %2" ).arg( count ).arg( mCursorName );
+  QgsDebugMsgLevel( QStringLiteral( "fetching %1 features." ).arg( count ), 4 );
+
+  if ( mConn->PQsendQuery( fetch ) == 0 ) // fetch features asynchronously
+  {
+    QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName, mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
+    return false;
+  }
+
+  mFetchPending = true;
+  mPendingFetchSize = count;
+  return true;
+}
+
+bool QgsPostgresFeatureIterator::receiveFetch( QgsPostgresResult &queryResult )
+{
+  mFetchPending = false;
+
+  // collect all results, so that the connection is ready for the next query
+  bool ok = true;
+  for ( ;; )
+  {
+    PGresult *result = mConn->PQgetResult();
+    if ( !result )
+      break;
+
+    if ( ::PQresultStatus( result ) != PGRES_TUPLES_OK )
+    {
+      QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName, mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
+      ::PQclear( result );
+      ok = false;
+      continue;
+    }
+
+    queryResult = result;
+  }
+
+  if ( !ok || !queryResult.result() )
+  {
+    mLastFetch = true;
+    return false;
+  }
+
+  mLastFetch = queryResult.PQntuples() < mPendingFetchSize;
+  return true;
+}
+
+void QgsPostgresFeatureIterator::discardFetch()
+{
+  if ( !mFetchPending )
+    return;
+
+  QgsPostgresResult queryResult;
+  receiveFetch( queryResult );
+}
+
 bool QgsPostgresFeatureIterator::prepareSimplification( const QgsSimplifyMethod &simplifyMethod )
 {
   // setup simplification of geometries to fetch
@@ -387,6 +477,7 @@ bool QgsPostgresFeatureIterator::rewind()
 
   // move cursor to first record
 
+  discardFetch();
   mConn->PQexecNR( QStringLiteral( "move absolute 0 in %1" ).arg( mCursorName ) );
   mFeatureQueue.clear();
   mFetched = 0;
@@ -400,6 +491,7 @@ bool QgsPostgresFeatureIterator::close()
   if ( !mConn )
     return false;
 
+  discardFetch();
   mConn->closeCursor( mCursorName );
 
   if ( !mIsTransactionConnection )
@@ -628,13 +720,17 @@ bool QgsPostgresFeatureIterator::declareCursor( const QString &whereClause, long
       return false;
   }
 
+  // common types are transferred in their binary form, all others as text
+  mBinaryValueTypes.fill( TextValue, mSource->mFields.count() );
   bool subsetOfAttributes = mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes;
   Q_FOREACH ( int idx, subsetOfAttributes ? mRequest.subsetOfAttributes() : mSource->mFields.allAttributesList() )
   {
     if ( mSource->mPrimaryKeyAttrs.contains( idx ) )
       continue;
 
-    query += delim + mConn->fieldExpression( mSource->mFields.at( idx ) );
+    const QgsField &fld = mSource->mFields.at( idx );
+    mBinaryValueTypes[idx] = binaryValueType( fld );
+    query += delim + ( mBinaryValueTypes.at( idx ) == TextValue ? mConn->fieldExpression( fld ) : QgsPostgresConn::quotedIdentifier( fld.name() ) );
   }
 
   query += " FROM " + mSource->mQuery;
@@ -677,45 +773,7 @@ bool QgsPostgresFeatureIterator::getFeature( QgsPostgresResult &queryResult, int
       memcpy( featureGeom, PQgetvalue( queryResult.result(), row, col ), returnedLength );
       memset( featureGeom + returnedLength, 0, 1 );
 
-      unsigned int wkbType;
-      memcpy( &wkbType, featureGeom + 1, sizeof( wkbType ) );
-      QgsWkbTypes::Type newType = QgsPostgresConn::wkbTypeFromOgcWkbType( wkbType );
-
-      if ( ( unsigned int )newType != wkbType )
-      {
-        // overwrite type
-        unsigned int n = newType;
-        memcpy( featureGeom + 1, &n, sizeof( n ) );
-      }
-
-      // PostGIS stores TIN as a collection of Triangles.
-      // Since Triangles are not supported, they have to be converted to Polygons
-      const int nDims = 2 + ( QgsWkbTypes::hasZ( newType ) ? 1 : 0 ) + ( QgsWkbTypes::hasM( newType ) ? 1 : 0 );
-      if ( wkbType % 1000 == 16 )
-      {
-        unsigned int numGeoms;
-        memcpy( &numGeoms, featureGeom + 5, sizeof( unsigned int ) );
-        unsigned char *wkb = featureGeom + 9;
-        for ( unsigned int i = 0; i < numGeoms; ++i )
-        {
-          const unsigned int localType = QgsWkbTypes::singleType( newType ); // polygon(Z|M)
-          memcpy( wkb + 1, &localType, sizeof( localType ) );
-
-          // skip endian and type info
-          wkb += sizeof( unsigned int ) + 1;
-
-          // skip coordinates
-          unsigned int nRings;
-          memcpy( &nRings, wkb, sizeof( int ) );
-          wkb += sizeof( int );
-          for ( unsigned int j = 0; j < nRings; ++j )
-          {
-            unsigned int nPoints;
-            memcpy( &nPoints, wkb, sizeof( int ) );
-            wkb += sizeof( nPoints ) + sizeof( double ) * nDims * nPoints;
-          }
-        }
-      }
+      fixGeometryWkbTypes( featureGeom );
 
       QgsGeometry g;
       g.fromWkb( featureGeom, returnedLength + 1 );
@@ -729,11 +787,89 @@ bool QgsPostgresFeatureIterator::getFeature( QgsPostgresResult &queryResult, int
     col++;
   }
 
-  QgsFeatureId fid = 0;
-
   bool subsetOfAttributes = mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes;
   QgsAttributeList fetchAttributes = mRequest.subsetOfAttributes();
 
+  if ( mSource->mPrimaryKeyType == PktUnknown )
+  {
+    Q_ASSERT( !"FAILURE: cannot get feature with unknown primary key" );
+    return false;
+  }
+
+  QVariantList primaryKeyVals;
+  QgsFeatureId fid = getFeatureId( queryResult, row, col, primaryKeyVals );
+  for ( int i = 0; i < primaryKeyVals.size(); ++i )
+  {
+    const int idx = mSource->mPrimaryKeyAttrs.at( i );
+    if ( !subsetOfAttributes || fetchAttributes.contains( idx ) )
+      feature.setAttribute( idx, primaryKeyVals.at( i ) );
+  }
+
+  feature.setId( fid );
+  QgsDebugMsgLevel( QStringLiteral( "fid=%1" ).arg( fid ), 4 );
+
+  // iterate attributes
+  if ( subsetOfAttributes )
+  {
+    Q_FOREACH ( int idx, fetchAttributes )
+      getFeatureAttribute( idx, queryResult, row, col, feature );
+  }
+  else
+  {
+    for ( int idx = 0; idx < mSource->mFields.count(); ++idx )
+      getFeatureAttribute( idx, queryResult, row, col, feature );
+  }
+
+  return true;
+}
+
+void QgsPostgresFeatureIterator::fixGeometryWkbTypes( unsigned char *featureGeom )
+{
+  unsigned int wkbType;
+  memcpy( &wkbType, featureGeom + 1, sizeof( wkbType ) );
+  QgsWkbTypes::Type newType = QgsPostgresConn::wkbTypeFromOgcWkbType( wkbType );
+
+  if ( ( unsigned int )newType != wkbType )
+  {
+    // overwrite type
+    unsigned int n = newType;
+    memcpy( featureGeom + 1, &n, sizeof( n ) );
+  }
+
+  // PostGIS stores TIN as a collection of Triangles.
+  // Since Triangles are not supported, they have to be converted to Polygons
+  const int nDims = 2 + ( QgsWkbTypes::hasZ( newType ) ? 1 : 0 ) + ( QgsWkbTypes::hasM( newType ) ? 1 : 0 );
+  if ( wkbType % 1000 == 16 )
+  {
+    unsigned int numGeoms;
+    memcpy( &numGeoms, featureGeom + 5, sizeof( unsigned int ) );
+    unsigned char *wkb = featureGeom + 9;
+    for ( unsigned int i = 0; i < numGeoms; ++i )
+    {
+      const unsigned int localType = QgsWkbTypes::singleType( newType ); // polygon(Z|M)
+      memcpy( wkb + 1, &localType, sizeof( localType ) );
+
+      // skip endian and type info
+      wkb += sizeof( unsigned int ) + 1;
+
+      // skip coordinates
+      unsigned int nRings;
+      memcpy( &nRings, wkb, sizeof( int ) );
+      wkb += sizeof( int );
+      for ( unsigned int j = 0; j < nRings; ++j )
+      {
+        unsigned int nPoints;
+        memcpy( &nPoints, wkb, sizeof( int ) );
+        wkb += sizeof( nPoints ) + sizeof( double ) * nDims * nPoints;
+      }
+    }
+  }
+}
+
+QgsFeatureId QgsPostgresFeatureIterator::getFeatureId( QgsPostgresResult &queryResult, int row, int &col, QVariantList &primaryKeyVals )
+{
+  QgsFeatureId fid = 0;
+
   switch ( mSource->mPrimaryKeyType )
   {
     case PktOid:
@@ -744,23 +880,16 @@ bool QgsPostgresFeatureIterator::getFeature( QgsPostgresResult &queryResult, int
     case PktInt:
     case PktUint64:
       fid = mConn->getBinaryInt( queryResult, row, col++ );
-      if ( !subsetOfAttributes || fetchAttributes.contains( mSource->mPrimaryKeyAttrs.at( 0 ) ) )
-      {
-        feature.setAttribute( mSource->mPrimaryKeyAttrs[0], fid );
-      }
+      // the attribute value is 1:1 with the database value, only the fid is mapped
+      primaryKeyVals << fid;
       if ( mSource->mPrimaryKeyType == PktInt )
       {
-        // NOTE: this needs be done _after_ the setAttribute call
-        // above as we want the attribute value to be 1:1 with
-        // database value
         fid = QgsPostgresUtils::int32pk_to_fid( fid );
       }
       break;
 
     case PktFidMap:
     {
-      QVariantList primaryKeyVals;
-
       Q_FOREACH ( int idx, mSource->mPrimaryKeyAttrs )
       {
         QgsField fld = mSource->mFields.at( idx );
@@ -768,38 +897,139 @@ bool QgsPostgresFeatureIterator::getFeature( QgsPostgresResult &queryResult, int
         QVariant v = QgsPostgresProvider::convertValue( fld.type(), fld.subType(), queryResult.PQgetvalue( row, col ), fld.typeName() );
         primaryKeyVals << v;
 
-        if ( !subsetOfAttributes || fetchAttributes.contains( idx ) )
-          feature.setAttribute( idx, v );
-
         col++;
       }
 
       fid = mSource->mShared->lookupFid( primaryKeyVals );
-
     }
     break;
 
     case PktUnknown:
-      Q_ASSERT( !"FAILURE: cannot get feature with unknown primary key" );
-      return false;
+      break;
   }
 
-  feature.setId( fid );
-  QgsDebugMsgLevel( QStringLiteral( "fid=%1" ).arg( fid ), 4 );
+  return fid;
+}
+
+void QgsPostgresFeatureIterator::getBatchRow( QgsPostgresResult &queryResult, int row, QgsFeatureBatch &batch )
+{
+  int col = 0;
+  int geometryCol = -1;
+  if ( mFetchGeometry )
+    geometryCol = col++;
+
+  QVariantList primaryKeyVals;
+  const QgsFeatureId fid = getFeatureId( queryResult, row, col, primaryKeyVals );
+  const int batchRow = batch.appendRow( fid );
+
+  if ( geometryCol >= 0 )
+  {
+    const int returnedLength = ::PQgetlength( queryResult.result(), row, geometryCol );
+    if ( returnedLength > 0 )
+    {
+      // the type fixes are done in place, in a buffer which is reused for every row
+      mBatchWkb.resize( returnedLength );
+      unsigned char *featureGeom = reinterpret_cast< unsigned char * >( mBatchWkb.data() );
+      memcpy( featureGeom, ::PQgetvalue( queryResult.result(), row, geometryCol ), returnedLength );
+      fixGeometryWkbTypes( featureGeom );
+      batch.setGeometryWkb( batchRow, featureGeom, returnedLength );
+    }
+  }
+
+  bool subsetOfAttributes = mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes;
+  QgsAttributeList fetchAttributes = mRequest.subsetOfAttributes();
+
+  for ( int i = 0; i < primaryKeyVals.size(); ++i )
+  {
+    const int idx = mSource->mPrimaryKeyAttrs.at( i );
+    if ( !subsetOfAttributes || fetchAttributes.contains( idx ) )
+      batch.setValue( batchRow, idx, primaryKeyVals.at( i ) );
+  }
 
-  // iterate attributes
   if ( subsetOfAttributes )
   {
-    Q_FOREACH ( int idx, fetchAttributes )
-      getFeatureAttribute( idx, queryResult, row, col, feature );
+    for ( int idx : qgis::as_const( fetchAttributes ) )
+      getBatchAttribute( idx, queryResult, row, col, batch, batchRow );
   }
   else
   {
     for ( int idx = 0; idx < mSource->mFields.count(); ++idx )
-      getFeatureAttribute( idx, queryResult, row, col, feature );
+      getBatchAttribute( idx, queryResult, row, col, batch, batchRow );
   }
+}
 
-  return true;
+void QgsPostgresFeatureIterator::getBatchAttribute( int idx, QgsPostgresResult &queryResult, int row, int &col, QgsFeatureBatch &batch, int batchRow )
+{
+  if ( mSource->mPrimaryKeyAttrs.contains( idx ) )
+    return;
+
+  const int valueCol = col++;
+  if ( ::PQgetisnull( queryResult.result(), row, valueCol ) )
+    return;
+
+  const QgsField &fld = mSource->mFields.at( idx );
+  const BinaryValueType binaryType = mBinaryValueTypes.at( idx );
+  switch ( binaryType )
+  {
+    case IntegerValue:
+      batch.setInteger( batchRow, idx, mConn->getBinaryInt( queryResult, row, valueCol ) );
+      return;
+
+    case DoubleValue:
+      batch.setDouble( batchRow, idx, mConn->getBinaryDouble( queryResult, row, valueCol ) );
+      return;
+
+    case BoolValue:
+      batch.setInteger( batchRow, idx, *::PQgetvalue( queryResult.result(), row, valueCol ) ? 1 : 0 );
+      return;
+
+    case DateValue:
+    case TimeValue:
+    case DateTimeValue:
+      batch.setValue( batchRow, idx, binaryValue( binaryType, fld, queryResult, row, valueCol ) );
+      return;
+
+    case TextValue:
+      break;
+  }
+
+  // numbers, booleans and strings are parsed from the raw text value straight into the typed columns
+  const char *value = ::PQgetvalue( queryResult.result(), row, valueCol );
+  const int length = ::PQgetlength( queryResult.result(), row, valueCol );
+  bool ok = false;
+  switch ( fld.type() )
+  {
+    case QVariant::Double:
+    {
+      const double v = QByteArray::fromRawData( value, length ).toDouble( &ok );
+      if ( ok )
+        batch.setDouble( batchRow, idx, v );
+      return;
+    }
+
+    case QVariant::Int:
+    case QVariant::LongLong:
+    {
+      const qlonglong v = QByteArray::fromRawData( value, length ).toLongLong( &ok );
+      if ( ok )
+        batch.setInteger( batchRow, idx, v );
+      return;
+    }
+
+    case QVariant::Bool:
+      if ( length == 1 && ( value[0] == 't' || value[0] == 'f' ) )
+        batch.setInteger( batchRow, idx, value[0] == 't' ? 1 : 0 );
+      return;
+
+    case QVariant::String:
+      batch.setString( batchRow, idx, QString::fromUtf8( value, length ) );
+      return;
+
+    default:
+      break;
+  }
+
+  batch.setValue( batchRow, idx, QgsPostgresProvider::convertValue( fld.type(), fld.subType(), QString::fromUtf8( value, length ), fld.typeName() ) );
 }
 
 void QgsPostgresFeatureIterator::getFeatureAttribute( int idx, QgsPostgresResult &queryResult, int row, int &col, QgsFeature &feature )
@@ -808,12 +1038,95 @@ void QgsPostgresFeatureIterator::getFeatureAttribute( int idx, QgsPostgresResult
     return;
 
   const QgsField fld = mSource->mFields.at( idx );
-  QVariant v = QgsPostgresProvider::convertValue( fld.type(), fld.subType(), queryResult.PQgetvalue( row, col ), fld.typeName() );
+  const BinaryValueType binaryType = mBinaryValueTypes.at( idx );
+  QVariant v;
+  if ( binaryType == TextValue )
+    v = QgsPostgresProvider::convertValue( fld.type(), fld.subType(), queryResult.PQgetvalue( row, col ), fld.typeName() );
+  else if ( queryResult.PQgetisnull( row, col ) )
+    v = QVariant( fld.type() );
+  else
+    v = binaryValue( binaryType, fld, queryResult, row, col );
   feature.setAttribute( idx, v );
 
   col++;
 }
 
+QgsPostgresFeatureIterator::BinaryValueType QgsPostgresFeatureIterator::binaryValueType( const QgsField &fld ) const
+{
+  // the type name is the one of the column, domains and other types keep the text conversion
+  const QString &typeName = fld.typeName();
+  if ( typeName == QLatin1String( "int2" ) || typeName == QLatin1String( "int4" ) || typeName == QLatin1String( "int8" ) )
+    return IntegerValue;
+  else if ( typeName == QLatin1String( "float8" ) )
+    return DoubleValue;
+  else if ( typeName == QLatin1String( "bool" ) )
+    return BoolValue;
+  else if ( typeName == QLatin1String( "date" ) )
+    return DateValue;
+  else if ( !mConn->integerDatetimes() )
+    return TextValue;
+  else if ( typeName == QLatin1String( "time" ) )
+    return TimeValue;
+  else if ( typeName == QLatin1String( "timestamp" ) )
+    return DateTimeValue;
+  else
+    return TextValue;
+}
+
+QVariant QgsPostgresFeatureIterator::binaryValue( BinaryValueType type, const QgsField &fld, QgsPostgresResult &queryResult, int row, int col ) const
+{
+  // PostgreSQL dates and timestamps count from 2000-01-01, infinite values are mapped to null values as for text
+  static const QDate POSTGRES_EPOCH( 2000, 1, 1 );
+  static const qint64 USECS_PER_DAY = Q_INT64_C( 86400000000 );
+
+  switch ( type )
+  {
+    case IntegerValue:
+    {
+      const qint64 value = mConn->getBinaryInt( queryResult, row, col );
+      return fld.type() == QVariant::LongLong ? QVariant( value ) : QVariant( static_cast< int >( value ) );
+    }
+
+    case DoubleValue:
+      return mConn->getBinaryDouble( queryResult, row, col );
+
+    case BoolValue:
+      return *::PQgetvalue( queryResult.result(), row, col ) != 0;
+
+    case DateValue:
+    {
+      const qint64 days = mConn->getBinaryInt( queryResult, row, col );
+      if ( days == std::numeric_limits< qint32 >::max() || days == std::numeric_limits< qint32 >::min() )
+        return QVariant( fld.type() );
+      return POSTGRES_EPOCH.addDays( days );
+    }
+
+    case TimeValue:
+      return QTime( 0, 0 ).addMSecs( static_cast< int >( mConn->getBinaryInt( queryResult, row, col ) / 1000 ) );
+
+    case DateTimeValue:
+    {
+      const qint64 usecs = mConn->getBinaryInt( queryResult, row, col );
+      if ( usecs == std::numeric_limits< qint64 >::max() || usecs == std::numeric_limits< qint64 >::min() )
+        return QVariant( fld.type() );
+      // split into date and time of day, as local date times created from the text value
+      qint64 days = usecs / USECS_PER_DAY;
+      qint64 timeOfDay = usecs % USECS_PER_DAY;
+      if ( timeOfDay < 0 )
+      {
+        days--;
+        timeOfDay += USECS_PER_DAY;
+      }
+      return QDateTime( POSTGRES_EPOCH.addDays( days ), QTime( 0, 0 ).addMSecs( static_cast< int >( timeOfDay / 1000 ) ) );
+    }
+
+    case TextValue:
+      break;
+  }
+
+  return QgsPostgresProvider::convertValue( fld.type(), fld.subType(), queryResult.PQgetvalue( row, col ), fld.typeName() );
+}
+
 
 //  ------------------
 
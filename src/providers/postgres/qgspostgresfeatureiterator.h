@@ -81,16 +81,59 @@ class QgsPostgresFeatureIterator : public QgsAbstractFeatureIteratorFromSource<Q
   protected:
     bool fetchFeature( QgsFeature &feature ) override;
     bool nextFeatureFilterExpression( QgsFeature &f ) override;
+    int fetchBatch( QgsFeatureBatch &batch, int maximumSize ) override;
     bool prepareSimplification( const QgsSimplifyMethod &simplifyMethod ) override;
 
   private:
 
     QgsPostgresConn *mConn = nullptr;
 
+    /**
+     * Format of attribute values in the binary cursor. Values of other types are cast to text
+     * by the query and converted with QgsPostgresProvider::convertValue().
+     */
+    enum BinaryValueType
+    {
+      TextValue, //!< Text representation
+      IntegerValue, //!< int2, int4 or int8
+      DoubleValue, //!< float8
+      BoolValue, //!< bool
+      DateValue, //!< date, as days since 2000-01-01
+      TimeValue, //!< time, as microseconds since midnight
+      DateTimeValue, //!< timestamp, as microseconds since 2000-01-01
+    };
 
     QString whereClauseRect();
     bool getFeature( QgsPostgresResult &queryResult, int row, QgsFeature &feature );
     void getFeatureAttribute( int idx, QgsPostgresResult &queryResult, int row, int &col, QgsFeature &feature );
+
+    //! Reads the feature id and the primary key attribute values, advancing \a col past the key columns
+    QgsFeatureId getFeatureId( QgsPostgresResult &queryResult, int row, int &col, QVariantList &primaryKeyVals );
+
+    //! Appends the feature at \a row of a query result to a batch
+    void getBatchRow( QgsPostgresResult &queryResult, int row, QgsFeatureBatch &batch );
+    void getBatchAttribute( int idx, QgsPostgresResult &queryResult, int row, int &col, QgsFeatureBatch &batch, int batchRow );
+
+    //! Returns the format used to transfer values of a field which is not part of the primary key
+    BinaryValueType binaryValueType( const QgsField &fld ) const;
+
+    //! Converts a non null binary value to the type of the field
+    QVariant binaryValue( BinaryValueType type, const QgsField &fld, QgsPostgresResult &queryResult, int row, int col ) const;
+
+    //! Sends a FETCH of the next \a count features, without waiting for its result
+    bool sendFetch( int count );
+
+    /**
+     * Waits for the result of the pending FETCH and stores it in \a queryResult.
+     * Returns false if the fetch failed.
+     */
+    bool receiveFetch( QgsPostgresResult &queryResult );
+
+    //! Waits for the pending FETCH, if any, and discards its result
+    void discardFetch();
+
+    //! Converts the geometry types of PostGIS WKB to QGIS types in place, turning TIN triangles into polygons
+    static void fixGeometryWkbTypes( unsigned char *featureGeom );
     bool declareCursor( const QString &whereClause, long limit = -1, bool closeOnFail = true, const QString &orderBy = QString() );
 
     QString mCursorName;
@@ -110,6 +153,25 @@ class QgsPostgresFeatureIterator : public QgsAbstractFeatureIteratorFromSource<Q
     //! Sets to true, if geometry is in the requested columns
     bool mFetchGeometry = false;
 
+    //! Reusable buffer for geometries read by fetchBatch()
+    QByteArray mBatchWkb;
+
+    //! Transfer format of the attributes, by field index
+    QVector<BinaryValueType> mBinaryValueTypes;
+
+    /**
+     * True if the next FETCH is sent as soon as the result of the previous one is received,
+     * so that it is transferred while the current features are processed.
+     * Transaction connections are shared with the provider and cannot have pending queries.
+     */
+    bool mPrefetch = false;
+
+    //! True if a FETCH was sent and its result is not received yet
+    bool mFetchPending = false;
+
+    //! Number of features requested by the pending FETCH
+    int mPendingFetchSize = 0;
+
     bool mIsTransactionConnection = false;
 
     bool providerCanSimplify( QgsSimplifyMethod::MethodType methodType ) const override;
@@ -27,8 +27,11 @@
 #include "qgsxmlutils.h"
 #include "qgsvectorlayer.h"
 
+#include <QElapsedTimer>
 #include <QMessageBox>
 
+#include <algorithm>
+
 #include "qgsvectorlayerexporter.h"
 #include "qgspostgresprovider.h"
 #include "qgspostgresconn.h"
@@ -2012,6 +2015,20 @@ bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist, Flags flags )
   {
     conn->begin();
 
+    // Without values to return, features are streamed with COPY. Features which need evaluation of
+    // default values or which fail, e.g. on unique constraint violations, go through the INSERT
+    // statements below, which report the failing feature.
+    if ( ( flags & QgsFeatureSink::FastInsert ) && flist.size() > 1 && copyFeatures( conn, flist ) )
+    {
+      returnvalue &= conn->commit();
+      if ( mTransaction )
+        mTransaction->dirtyLastSavePoint();
+
+      mShared->addFeaturesCounted( flist.size() );
+      conn->unlock();
+      return returnvalue;
+    }
+
     // Prepare the INSERT statement
     QString insert = QStringLiteral( "INSERT INTO %1(" ).arg( mQuery );
     QString values = QStringLiteral( ") VALUES (" );
@@ -2301,6 +2318,229 @@ bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist, Flags flags )
   return returnvalue;
 }
 
+static void appendCopyValue( QByteArray &row, const QString &value )
+{
+  if ( value.isNull() )
+  {
+    row += "\\N";
+    return;
+  }
+
+  const QByteArray utf8 = value.toUtf8();
+  for ( const char c : utf8 )
+  {
+    switch ( c )
+    {
+      case '\\':
+        row += "\\\\";
+        break;
+      case '\t':
+        row += "\\t";
+        break;
+      case '\n':
+        row += "\\n";
+        break;
+      case '\r':
+        row += "\\r";
+        break;
+      default:
+        row += c;
+    }
+  }
+}
+
+/**
+ * Returns the COPY text representation of a non-NULL attribute value. Lists and maps are
+ * serialized with QgsPostgresConn::quotedValue(), as for INSERT statements, without the
+ * enclosing string literal.
+ */
+static QString copyTextValue( const QVariant &value )
+{
+  switch ( value.type() )
+  {
+    case QVariant::Map:
+    case QVariant::StringList:
+    case QVariant::List:
+    {
+      // E'{...}' for arrays and E'...'::hstore for maps
+      const QString literal = QgsPostgresConn::quotedValue( value );
+      const int end = literal.lastIndexOf( '\'' );
+      QString text( QLatin1String( "" ) );
+      for ( int i = 2; i < end; ++i )
+      {
+        if ( literal.at( i ) == '\\' && i + 1 < end )
+          ++i;
+        text += literal.at( i );
+      }
+      return text;
+    }
+
+    default:
+      return value.toString();
+  }
+}
+
+bool QgsPostgresProvider::copyFeatures( QgsPostgresConn *conn, const QgsFeatureList &flist )
+{
+  // the geometry is copied as hex EWKB, COPY cannot convert it to topogeometries
+  if ( !mGeometryColumn.isNull() && mSpatialColType != SctGeometry && mSpatialColType != SctGeography )
+    return false;
+
+  const bool hasPrimaryKeyFields = mPrimaryKeyType == PktInt || mPrimaryKeyType == PktFidMap || mPrimaryKeyType == PktUint64;
+
+  // the columns are the same as the ones of the INSERT statement: the primary key columns, without
+  // the single primary key generated by a sequence if it is not set for any feature, and the
+  // attributes of the first feature. Server defaults apply to the other columns.
+  QStringList columns;
+  if ( !mGeometryColumn.isNull() )
+    columns << quotedIdentifier( mGeometryColumn );
+
+  const int attributeCount = flist.at( 0 ).attributes().count();
+  QList<int> fieldIds;
+  for ( int idx = 0; idx < mAttributeFields.count(); ++idx )
+  {
+    const QString fieldName = mAttributeFields.at( idx ).name();
+    if ( fieldName.isEmpty() || fieldName == mGeometryColumn )
+      continue;
+
+    const bool isPrimaryKey = hasPrimaryKeyFields && mPrimaryKeyAttrs.contains( idx );
+    if ( !isPrimaryKey && idx >= attributeCount )
+      continue;
+
+    const QString defVal = defaultValueClause( idx );
+
+    bool hasNull = false;
+    bool allEqual = true;
+    const QVariant first = flist.at( 0 ).attributes().value( idx, QVariant( QVariant::Int ) );
+    for ( const QgsFeature &feature : flist )
+    {
+      const QVariant v = feature.attributes().value( idx, QVariant( QVariant::Int ) );
+      if ( v.isNull() )
+        hasNull = true;
+      else if ( !defVal.isNull() && v.toString() == defVal )
+        return false; // the default value clause would be evaluated
+      if ( allEqual && v != first )
+        allEqual = false;
+    }
+
+    if ( isPrimaryKey && mPrimaryKeyAttrs.size() == 1 && allEqual && hasNull && defVal.startsWith( QLatin1String( "nextval(" ) ) )
+      continue;
+
+    // parameters which are NULL get the evaluated default value
+    if ( hasNull && !defVal.isNull() && ( isPrimaryKey || !allEqual ) )
+      return false;
+
+    columns << quotedIdentifier( fieldName );
+    fieldIds << idx;
+  }
+
+  const bool forceMulti = QgsWkbTypes::isMultiType( wkbType() );
+  const int srid = ( mRequestedSrid.isEmpty() ? mDetectedSrid : mRequestedSrid ).toInt();
+
+  QElapsedTimer timer;
+  timer.start();
+
+  if ( !conn->PQexecNR( QStringLiteral( "SAVEPOINT copyfeatures" ) ) )
+    return false;
+
+  const QString copy = QStringLiteral( "COPY %1(%2) FROM STDIN" ).arg( mQuery, columns.join( ',' ) );
+  QgsDebugMsg( QStringLiteral( "copy addfeatures: %1" ).arg( copy ) );
+
+  QgsPostgresResult result( conn->PQexec( copy, false ) );
+  bool ok = result.PQresultStatus() == PGRES_COPY_IN;
+  if ( ok )
+  {
+    QByteArray buffer;
+    for ( const QgsFeature &feature : flist )
+    {
+      bool firstColumn = true;
+      if ( !mGeometryColumn.isNull() )
+      {
+        const QgsGeometry &geom = feature.geometry();
+        if ( geom.isNull() )
+        {
+          buffer += "\\N";
+        }
+        else
+        {
+          QgsGeometry convertedGeom( convertToProviderType( geom ) );
+          if ( convertedGeom.isNull() )
+            convertedGeom = geom;
+          if ( forceMulti && !convertedGeom.isMultipart() )
+            convertedGeom.convertToMultiType();
+
+          // insert the SRID into the WKB type and after it, the WKB is in native byte order
+          QByteArray wkb = convertedGeom.asWkb();
+          if ( srid > 0 && wkb.size() >= 5 )
+          {
+            quint32 type;
+            memcpy( &type, wkb.constData() + 1, sizeof( type ) );
+            type |= 0x20000000;
+            const qint32 ewkbSrid = srid;
+            memcpy( wkb.data() + 1, &type, sizeof( type ) );
+            wkb.insert( 5, reinterpret_cast< const char * >( &ewkbSrid ), sizeof( ewkbSrid ) );
+          }
+          buffer += wkb.toHex();
+        }
+        firstColumn = false;
+      }
+
+      const QgsAttributes attrs = feature.attributes();
+      for ( int idx : qgis::as_const( fieldIds ) )
+      {
+        if ( !firstColumn )
+          buffer += '\t';
+        const QVariant value = attrs.value( idx, QVariant( QVariant::Int ) );
+        appendCopyValue( buffer, value.isNull() ? QString() : copyTextValue( value ) );
+        firstColumn = false;
+      }
+      buffer += '\n';
+
+      if ( buffer.size() > 1024 * 1024 )
+      {
+        ok = conn->PQputCopyData( buffer ) == 1;
+        buffer.clear();
+        if ( !ok )
+          break;
+      }
+    }
+
+    if ( ok && !buffer.isEmpty() )
+      ok = conn->PQputCopyData( buffer ) == 1;
+
+    ok = conn->PQputCopyEnd( ok ? QString() : tr( "Sending features failed" ) ) == 1 && ok;
+
+    // collect all results of the COPY
+    bool copied = false;
+    for ( ;; )
+    {
+      result = conn->PQgetResult();
+      if ( !result.result() )
+        break;
+
+      if ( result.PQresultStatus() == PGRES_COMMAND_OK )
+        copied = true;
+      else
+        QgsDebugMsg( QStringLiteral( "COPY failed: %1" ).arg( result.PQresultErrorMessage() ) );
+    }
+    ok = ok && copied;
+  }
+
+  if ( !ok )
+  {
+    conn->PQexecNR( QStringLiteral( "ROLLBACK TO SAVEPOINT copyfeatures" ) );
+    return false;
+  }
+
+  conn->PQexecNR( QStringLiteral( "RELEASE SAVEPOINT copyfeatures" ) );
+
+  QgsDebugMsgLevel( QStringLiteral( "copied %1 features in %2 ms (%3 features/s)" )
+                    .arg( flist.size() )
+                    .arg( timer.elapsed() )
+                    .arg( flist.size() * 1000.0 / std::max< qint64 >( 1, timer.elapsed() ), 0, 'f', 0 ), 2 );
+  return true;
+}
+
 bool QgsPostgresProvider::deleteFeatures( const QgsFeatureIds &id )
 {
   bool returnvalue = true;
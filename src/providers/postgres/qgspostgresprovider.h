@@ -438,6 +438,13 @@ class QgsPostgresProvider : public QgsVectorDataProvider
 
     QString paramValue( const QString &fieldvalue, const QString &defaultValue ) const;
 
+    /**
+     * Streams the features to the table with COPY FROM STDIN, as part of the current transaction
+     * of \a conn. Returns false without changes if the features cannot be copied, e.g. because
+     * default values would have to be evaluated for some of them or they violate a constraint.
+     */
+    bool copyFeatures( QgsPostgresConn *conn, const QgsFeatureList &flist );
+
     QgsPostgresConn *mConnectionRO = nullptr ; //! read-only database connection (initially)
     QgsPostgresConn *mConnectionRW = nullptr ; //! read-write database connection (on update)
 
@@ -38,6 +38,7 @@
 #include <QProgressDialog>
 #include <QTimer>
 #include <QStyle>
+#include <QThread>
 
 QgsWFSFeatureHitsAsyncRequest::QgsWFSFeatureHitsAsyncRequest( QgsWFSDataSourceURI &uri )
   : QgsWfsRequest( uri )
@@ -505,6 +506,8 @@ void QgsWFSFeatureDownloader::run( bool serializeFeatures, int maxFeatures )
   {
     success = true;
     QgsGmlStreamingParser *parser = mShared->createParser();
+    // Large responses are parsed by chunks of features in several threads
+    parser->setMaximumThreads( QThread::idealThreadCount() );
 
     if ( maxTotalFeatures > 0 && mTotalDownloadedFeatureCount >= maxTotalFeatures )
     {
@@ -959,11 +962,11 @@ QgsWFSFeatureIterator::QgsWFSFeatureIterator( QgsWFSFeatureSource *source,
   if ( mShared->mCacheDataProvider &&
        mRequest.filterType() == QgsFeatureRequest::FilterFid )
   {
-    QgsFeatureRequest requestCache = buildRequestCache( -1 );
+    QgsFeatureRequest requestCache = buildRequestCache();
     QgsFeature f;
-    if ( mShared->mCacheDataProvider->getFeatures( requestCache ).nextFeature( f ) )
+    if ( mShared->getCachedFeatures( requestCache ).nextFeature( f ) )
     {
-      mCacheIterator = mShared->mCacheDataProvider->getFeatures( requestCache );
+      mCacheIterator = mShared->getCachedFeatures( requestCache );
       mDownloadFinished = true;
       return;
     }
@@ -978,10 +981,10 @@ QgsWFSFeatureIterator::QgsWFSFeatureIterator( QgsWFSFeatureSource *source,
 
   QgsDebugMsgLevel( QStringLiteral( "QgsWFSFeatureIterator::constructor(): genCounter=%1 " ).arg( genCounter ), 4 );
 
-  mCacheIterator = mShared->mCacheDataProvider->getFeatures( buildRequestCache( genCounter ) );
+  mCacheIterator = mShared->getCachedFeatures( buildRequestCache(), genCounter );
 }
 
-QgsFeatureRequest QgsWFSFeatureIterator::buildRequestCache( int genCounter )
+QgsFeatureRequest QgsWFSFeatureIterator::buildRequestCache()
 {
   QgsFeatureRequest requestCache;
   if ( mRequest.filterType() == QgsFeatureRequest::FilterFid ||
@@ -1001,10 +1004,6 @@ QgsFeatureRequest QgsWFSFeatureIterator::buildRequestCache( int genCounter )
       }
       requestCache.setExpressionContext( ctx );
     }
-    if ( genCounter >= 0 )
-    {
-      requestCache.combineFilterExpression( QString( QgsWFSConstants::FIELD_GEN_COUNTER + " <= %1" ).arg( genCounter ) );
-    }
   }
 
   requestCache.setFilterRect( mFilterRect );
@@ -1014,6 +1013,10 @@ QgsFeatureRequest QgsWFSFeatureIterator::buildRequestCache( int genCounter )
   {
     mFetchGeometry = true;
   }
+  else
+  {
+    requestCache.setFlags( requestCache.flags() | QgsFeatureRequest::NoGeometry );
+  }
 
   if ( mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes )
   {
@@ -1061,8 +1064,8 @@ QgsFeatureRequest QgsWFSFeatureIterator::buildRequestCache( int genCounter )
     if ( mFetchGeometry )
     {
       int hexwkbGeomIdx = dataProviderFields.indexFromName( QgsWFSConstants::FIELD_HEXWKB_GEOM );
-      Q_ASSERT( hexwkbGeomIdx >= 0 );
-      cacheSubSet.append( hexwkbGeomIdx );
+      if ( hexwkbGeomIdx >= 0 )
+        cacheSubSet.append( hexwkbGeomIdx );
     }
     requestCache.setSubsetOfAttributes( cacheSubSet );
   }
@@ -1205,32 +1208,34 @@ bool QgsWFSFeatureIterator::fetchFeature( QgsFeature &f )
 
     if ( !mShared->mGeometryAttribute.isEmpty() && mFetchGeometry )
     {
+      // the in-process store has no hexwkb field, and returns the geometries themselves
       int idx = cachedFeature.fields().indexFromName( QgsWFSConstants::FIELD_HEXWKB_GEOM );
-      Q_ASSERT( idx >= 0 );
-
-      const QVariant &v = cachedFeature.attributes().value( idx );
-      if ( !v.isNull() && v.type() == QVariant::String )
+      if ( idx >= 0 )
       {
-        QByteArray wkbGeom( QByteArray::fromHex( v.toString().toLatin1() ) );
-        QgsGeometry g;
-        unsigned char *wkbClone = new unsigned char[wkbGeom.size()];
-        memcpy( wkbClone, wkbGeom.data(), wkbGeom.size() );
-        try
+        const QVariant &v = cachedFeature.attributes().value( idx );
+        if ( !v.isNull() && v.type() == QVariant::String )
         {
-          g.fromWkb( wkbClone, wkbGeom.size() );
-          cachedFeature.setGeometry( g );
+          QByteArray wkbGeom( QByteArray::fromHex( v.toString().toLatin1() ) );
+          QgsGeometry g;
+          unsigned char *wkbClone = new unsigned char[wkbGeom.size()];
+          memcpy( wkbClone, wkbGeom.data(), wkbGeom.size() );
+          try
+          {
+            g.fromWkb( wkbClone, wkbGeom.size() );
+            cachedFeature.setGeometry( g );
+          }
+          catch ( const QgsWkbException & )
+          {
+            QgsDebugMsg( QStringLiteral( "Invalid WKB for cached feature %1" ).arg( cachedFeature.id() ) );
+            delete[] wkbClone;
+            cachedFeature.clearGeometry();
+          }
         }
-        catch ( const QgsWkbException & )
+        else
         {
-          QgsDebugMsg( QStringLiteral( "Invalid WKB for cached feature %1" ).arg( cachedFeature.id() ) );
-          delete[] wkbClone;
           cachedFeature.clearGeometry();
         }
       }
-      else
-      {
-        cachedFeature.clearGeometry();
-      }
     }
     else
     {
@@ -1388,14 +1393,11 @@ bool QgsWFSFeatureIterator::rewind()
     }
   }
 
-  QgsFeatureRequest requestCache;
   int genCounter = mShared->getUpdatedCounter();
-  if ( genCounter >= 0 )
-    requestCache.setFilterExpression( QString( QgsWFSConstants::FIELD_GEN_COUNTER + " <= %1" ).arg( genCounter ) );
-  else
+  if ( genCounter < 0 )
     mDownloadFinished = true;
   if ( mShared->mCacheDataProvider )
-    mCacheIterator = mShared->mCacheDataProvider->getFeatures( requestCache );
+    mCacheIterator = mShared->getCachedFeatures( QgsFeatureRequest(), genCounter );
   return true;
 }
 
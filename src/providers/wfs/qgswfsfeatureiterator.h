@@ -221,8 +221,8 @@ class QgsWFSFeatureIterator : public QObject,
 
   private:
 
-    //! Translate mRequest to a request compatible of the Spatialite cache
-    QgsFeatureRequest buildRequestCache( int gencounter );
+    //! Translate mRequest to a request compatible of the cache
+    QgsFeatureRequest buildRequestCache();
 
     bool fetchFeature( QgsFeature &f ) override;
 
@@ -0,0 +1,792 @@
+/***************************************************************************
+    qgswfsfeaturestore.cpp
+    ---------------------
+    begin                : October 2026
+    copyright            : (C) 2026 by QGIS contributors
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgswfsfeaturestore.h"
+#include "qgswfsconstants.h"
+
+#include "qgsfeatureiterator.h"
+#include "qgsgeometry.h"
+#include "qgsgeometryengine.h"
+#include "qgslogger.h"
+#include "qgsmessagelog.h"
+#include "qgsspatialindex.h"
+
+#include <QFile>
+#include <QReadWriteLock>
+
+#include <algorithm>
+#include <cstring>
+
+///@cond PRIVATE
+
+//! Sizes of the first and largest blocks of the arena kept in memory
+static const int ARENA_INITIAL_BLOCK_SIZE = 64 * 1024;
+static const int ARENA_BLOCK_SIZE = 4 * 1024 * 1024;
+
+/**
+ * Storage of QgsWFSFeatureStore, shared with its feature sources.
+ * All members are protected by lock.
+ */
+class QgsWFSFeatureStoreData
+{
+  public:
+
+    struct Column
+    {
+      //! Int, LongLong, Double or String
+      QVariant::Type type = QVariant::String;
+      //! Integer values, bits of double values or arena offsets of strings
+      QVector< qint64 > values;
+      //! Sizes of strings
+      QVector< int > sizes;
+      QVector< bool > nulls;
+    };
+
+    struct Block
+    {
+      qint64 start = 0;
+      QByteArray data;
+    };
+
+    QgsWFSFeatureStoreData( const QgsFields &fields, const QString &spillFileName, qint64 memoryLimit );
+    ~QgsWFSFeatureStoreData();
+
+    //! Returns a pointer to the arena bytes at \a offset
+    const char *blob( qint64 offset ) const;
+
+    //! Appends \a size bytes to the arena and returns their offset
+    qint64 appendBlob( const char *data, int size );
+
+    //! Writes the blocks kept in memory to the spill file if they exceed the memory limit
+    void spillIfNeeded();
+
+    void storeValue( int columnIndex, int row, const QVariant &value );
+    QVariant value( int columnIndex, int row ) const;
+
+    //! Stores the geometry of \a row, which must not be in the spatial index
+    void storeGeometry( int row, const QgsGeometry &geometry );
+    QgsGeometry geometry( int row ) const;
+
+    QReadWriteLock lock;
+
+    QgsFields fields;
+    QVector< Column > columns;
+
+    QVector< qint64 > geometryOffsets;
+    //! Sizes of the WKB geometries, 0 for null geometries
+    QVector< int > geometrySizes;
+    QVector< QgsRectangle > boundingBoxes;
+    QVector< bool > deleted;
+
+    int rowCount = 0;
+    long featureCount = 0;
+    QgsRectangle extent;
+
+    QgsSpatialIndex spatialIndex;
+    QHash< int, QMultiHash< QString, QgsFeatureId > > valueIndexes;
+
+    QVector< Block > blocks;
+    qint64 memoryBytes = 0;
+    qint64 memoryLimit = -1;
+    qint64 spilledBytes = 0;
+    QFile spillFile;
+    uchar *spillMap = nullptr;
+};
+
+QgsWFSFeatureStoreData::QgsWFSFeatureStoreData( const QgsFields &fields, const QString &spillFileName, qint64 memoryLimit )
+  : fields( fields )
+  , memoryLimit( memoryLimit )
+  , spillFile( spillFileName )
+{
+  columns.resize( fields.count() );
+  for ( int i = 0; i < fields.count(); ++i )
+  {
+    switch ( fields.at( i ).type() )
+    {
+      case QVariant::Int:
+      case QVariant::LongLong:
+      case QVariant::Double:
+        columns[i].type = fields.at( i ).type();
+        break;
+      default:
+        columns[i].type = QVariant::String;
+        break;
+    }
+  }
+}
+
+QgsWFSFeatureStoreData::~QgsWFSFeatureStoreData()
+{
+  if ( spillMap )
+    spillFile.unmap( spillMap );
+  spillFile.close();
+}
+
+const char *QgsWFSFeatureStoreData::blob( qint64 offset ) const
+{
+  if ( offset < spilledBytes )
+    return reinterpret_cast< const char * >( spillMap ) + offset;
+
+  // last block starting at or before offset
+  QVector< Block >::const_iterator it = std::upper_bound( blocks.constBegin(), blocks.constEnd(), offset,
+                                        []( qint64 o, const Block & block ) { return o < block.start; } );
+  Q_ASSERT( it != blocks.constBegin() );
+  --it;
+  return it->data.constData() + ( offset - it->start );
+}
+
+qint64 QgsWFSFeatureStoreData::appendBlob( const char *data, int size )
+{
+  if ( blocks.isEmpty() || blocks.last().data.size() + size > blocks.last().data.capacity() )
+  {
+    Block block;
+    block.start = spilledBytes + memoryBytes;
+    // blocks grow up to ARENA_BLOCK_SIZE, so that small layers stay small
+    const int capacity = blocks.isEmpty() ? ARENA_INITIAL_BLOCK_SIZE : std::min( ARENA_BLOCK_SIZE, 2 * blocks.last().data.capacity() );
+    block.data.reserve( std::max( capacity, size ) );
+    blocks.append( block );
+  }
+  Block &block = blocks.last();
+  const qint64 offset = block.start + block.data.size();
+  block.data.append( data, size );
+  memoryBytes += size;
+  return offset;
+}
+
+void QgsWFSFeatureStoreData::spillIfNeeded()
+{
+  if ( memoryLimit < 0 || memoryBytes <= memoryLimit || memoryBytes == 0 )
+    return;
+
+  if ( !spillFile.isOpen() && !spillFile.open( QIODevice::ReadWrite | QIODevice::Truncate ) )
+  {
+    QgsMessageLog::logMessage( QObject::tr( "Cannot create %1. Features are kept in memory" ).arg( spillFile.fileName() ), QObject::tr( "WFS" ) );
+    memoryLimit = -1;
+    return;
+  }
+
+  // the file is mapped again as a whole once the blocks have been appended
+  if ( spillMap )
+  {
+    spillFile.unmap( spillMap );
+    spillMap = nullptr;
+  }
+
+  bool ok = spillFile.seek( spilledBytes );
+  for ( int i = 0; ok && i < blocks.size(); ++i )
+    ok = spillFile.write( blocks.at( i ).data ) == blocks.at( i ).data.size();
+  ok = ok && spillFile.flush();
+
+  uchar *map = ok ? spillFile.map( 0, spilledBytes + memoryBytes ) : nullptr;
+  if ( !map )
+  {
+    QgsMessageLog::logMessage( QObject::tr( "Cannot write to %1. Features are kept in memory" ).arg( spillFile.fileName() ), QObject::tr( "WFS" ) );
+    // the bytes spilled previously are still valid
+    if ( spilledBytes > 0 )
+      spillMap = spillFile.map( 0, spilledBytes );
+    memoryLimit = -1;
+    return;
+  }
+
+  spillMap = map;
+  spilledBytes += memoryBytes;
+  memoryBytes = 0;
+  blocks.clear();
+}
+
+void QgsWFSFeatureStoreData::storeValue( int columnIndex, int row, const QVariant &value )
+{
+  Column &column = columns[columnIndex];
+  qint64 stored = 0;
+  int size = 0;
+  bool isNull = value.isNull();
+  if ( !isNull )
+  {
+    bool ok = true;
+    switch ( column.type )
+    {
+      case QVariant::Int:
+      case QVariant::LongLong:
+        stored = value.toLongLong( &ok );
+        break;
+      case QVariant::Double:
+      {
+        const double d = value.toDouble( &ok );
+        std::memcpy( &stored, &d, sizeof( d ) );
+        break;
+      }
+      default:
+      {
+        const QByteArray utf8 = value.toString().toUtf8();
+        size = utf8.size();
+        if ( size > 0 )
+          stored = appendBlob( utf8.constData(), size );
+        break;
+      }
+    }
+    isNull = !ok;
+  }
+
+  const bool isString = column.type == QVariant::String;
+  if ( row == column.values.size() )
+  {
+    column.values.append( stored );
+    column.nulls.append( isNull );
+    if ( isString )
+      column.sizes.append( size );
+  }
+  else
+  {
+    column.values[row] = stored;
+    column.nulls[row] = isNull;
+    if ( isString )
+      column.sizes[row] = size;
+  }
+}
+
+QVariant QgsWFSFeatureStoreData::value( int columnIndex, int row ) const
+{
+  const Column &column = columns.at( columnIndex );
+  if ( column.nulls.at( row ) )
+    return QVariant( column.type );
+
+  const qint64 stored = column.values.at( row );
+  switch ( column.type )
+  {
+    case QVariant::Int:
+      return QVariant( static_cast< int >( stored ) );
+    case QVariant::LongLong:
+      return QVariant( stored );
+    case QVariant::Double:
+    {
+      double d;
+      std::memcpy( &d, &stored, sizeof( d ) );
+      return QVariant( d );
+    }
+    default:
+    {
+      const int size = column.sizes.at( row );
+      // keep empty strings distinct from NULL
+      if ( size == 0 )
+        return QVariant( QString( QLatin1String( "" ) ) );
+      return QVariant( QString::fromUtf8( blob( stored ), size ) );
+    }
+  }
+}
+
+void QgsWFSFeatureStoreData::storeGeometry( int row, const QgsGeometry &geometry )
+{
+  qint64 offset = 0;
+  int size = 0;
+  QgsRectangle bbox;
+  if ( !geometry.isNull() )
+  {
+    const QByteArray wkb = geometry.asWkb();
+    size = wkb.size();
+    offset = appendBlob( wkb.constData(), size );
+    bbox = geometry.boundingBox();
+    spatialIndex.addFeature( row + 1, bbox );
+    if ( extent.isNull() )
+      extent = bbox;
+    else
+      extent.combineExtentWith( bbox );
+  }
+
+  if ( row == geometryOffsets.size() )
+  {
+    geometryOffsets.append( offset );
+    geometrySizes.append( size );
+    boundingBoxes.append( bbox );
+  }
+  else
+  {
+    geometryOffsets[row] = offset;
+    geometrySizes[row] = size;
+    boundingBoxes[row] = bbox;
+  }
+}
+
+QgsGeometry QgsWFSFeatureStoreData::geometry( int row ) const
+{
+  QgsGeometry g;
+  const int size = geometrySizes.at( row );
+  if ( size > 0 )
+  {
+    // parsed straight from the arena
+    g.fromWkb( QByteArray::fromRawData( blob( geometryOffsets.at( row ) ), size ) );
+  }
+  return g;
+}
+
+
+class QgsWFSFeatureStoreSource : public QgsAbstractFeatureSource
+{
+  public:
+    QgsWFSFeatureStoreSource( const std::shared_ptr< QgsWFSFeatureStoreData > &data, int genCounterIdx, int maxGenCounter );
+
+    QgsFeatureIterator getFeatures( const QgsFeatureRequest &request ) override;
+
+  private:
+    std::shared_ptr< QgsWFSFeatureStoreData > mData;
+    int mGenCounterIdx;
+    int mMaxGenCounter;
+
+    friend class QgsWFSFeatureStoreIterator;
+};
+
+
+class QgsWFSFeatureStoreIterator : public QgsAbstractFeatureIteratorFromSource<QgsWFSFeatureStoreSource>
+{
+  public:
+    QgsWFSFeatureStoreIterator( QgsWFSFeatureStoreSource *source, bool ownSource, const QgsFeatureRequest &request );
+    ~QgsWFSFeatureStoreIterator() override;
+
+    bool rewind() override;
+    bool close() override;
+
+  protected:
+    bool fetchFeature( QgsFeature &feature ) override;
+
+  private:
+    //! Returns whether the stored row matches the request. Must be called with the read lock held
+    bool acceptRow( int row ) const;
+
+    QgsRectangle mFilterRect;
+    QgsGeometry mSelectRectGeom;
+    std::unique_ptr< QgsGeometryEngine > mSelectRectEngine;
+
+    //! Whether the features must be checked against the generation counter
+    bool mFilterGenCounter = false;
+
+    //! Rows to visit, if not all rows are visited
+    bool mUsingRowList = false;
+    QVector< int > mRows;
+
+    //! Position in mRows, or next row
+    int mPosition = 0;
+    //! Number of rows when the iteration started
+    int mRowCount = 0;
+};
+
+
+QgsWFSFeatureStoreSource::QgsWFSFeatureStoreSource( const std::shared_ptr< QgsWFSFeatureStoreData > &data, int genCounterIdx, int maxGenCounter )
+  : mData( data )
+  , mGenCounterIdx( genCounterIdx )
+  , mMaxGenCounter( maxGenCounter )
+{
+}
+
+QgsFeatureIterator QgsWFSFeatureStoreSource::getFeatures( const QgsFeatureRequest &request )
+{
+  return QgsFeatureIterator( new QgsWFSFeatureStoreIterator( this, false, request ) );
+}
+
+
+QgsWFSFeatureStoreIterator::QgsWFSFeatureStoreIterator( QgsWFSFeatureStoreSource *source, bool ownSource, const QgsFeatureRequest &request )
+  : QgsAbstractFeatureIteratorFromSource<QgsWFSFeatureStoreSource>( source, ownSource, request )
+{
+  mFilterRect = mRequest.filterRect();
+
+  if ( !mFilterRect.isNull() && mRequest.flags() & QgsFeatureRequest::ExactIntersect )
+  {
+    mSelectRectGeom = QgsGeometry::fromRect( mFilterRect );
+    mSelectRectEngine.reset( QgsGeometry::createGeometryEngine( mSelectRectGeom.constGet() ) );
+    mSelectRectEngine->prepareGeometry();
+  }
+
+  if ( mRequest.filterType() == QgsFeatureRequest::FilterFid )
+  {
+    mUsingRowList = true;
+    mRows.append( static_cast< int >( mRequest.filterFid() - 1 ) );
+  }
+  else if ( mRequest.filterType() == QgsFeatureRequest::FilterFids )
+  {
+    mUsingRowList = true;
+    const QgsFeatureIds fids = mRequest.filterFids();
+    mRows.reserve( fids.size() );
+    for ( QgsFeatureId fid : fids )
+      mRows.append( static_cast< int >( fid - 1 ) );
+    std::sort( mRows.begin(), mRows.end() );
+  }
+  else
+  {
+    mFilterGenCounter = mSource->mGenCounterIdx >= 0 && mSource->mMaxGenCounter >= 0;
+    if ( !mFilterRect.isNull() )
+    {
+      // return features in storage order, which is the download order
+      mUsingRowList = true;
+      const QList< QgsFeatureId > ids = mSource->mData->spatialIndex.intersects( mFilterRect );
+      mRows.reserve( ids.size() );
+      for ( QgsFeatureId fid : ids )
+        mRows.append( static_cast< int >( fid - 1 ) );
+      std::sort( mRows.begin(), mRows.end() );
+    }
+  }
+
+  rewind();
+}
+
+QgsWFSFeatureStoreIterator::~QgsWFSFeatureStoreIterator()
+{
+  close();
+}
+
+bool QgsWFSFeatureStoreIterator::rewind()
+{
+  if ( mClosed )
+    return false;
+
+  mPosition = 0;
+  QReadLocker locker( &mSource->mData->lock );
+  mRowCount = mSource->mData->rowCount;
+  return true;
+}
+
+bool QgsWFSFeatureStoreIterator::close()
+{
+  if ( mClosed )
+    return false;
+
+  iteratorClosed();
+
+  mClosed = true;
+  return true;
+}
+
+bool QgsWFSFeatureStoreIterator::acceptRow( int row ) const
+{
+  const QgsWFSFeatureStoreData *data = mSource->mData.get();
+  if ( row < 0 || row >= data->rowCount || data->deleted.at( row ) )
+    return false;
+
+  if ( mFilterGenCounter )
+  {
+    const QgsWFSFeatureStoreData::Column &column = data->columns.at( mSource->mGenCounterIdx );
+    if ( column.nulls.at( row ) || column.values.at( row ) > mSource->mMaxGenCounter )
+      return false;
+  }
+
+  if ( !mFilterRect.isNull() )
+  {
+    // rows from the spatial index are known to intersect, unless the geometry was changed since
+    if ( data->geometrySizes.at( row ) == 0 || !data->boundingBoxes.at( row ).intersects( mFilterRect ) )
+      return false;
+    if ( mSelectRectEngine && !mSelectRectEngine->intersects( data->geometry( row ).constGet() ) )
+      return false;
+  }
+
+  return true;
+}
+
+bool QgsWFSFeatureStoreIterator::fetchFeature( QgsFeature &feature )
+{
+  feature.setValid( false );
+
+  if ( mClosed )
+    return false;
+
+  const QgsWFSFeatureStoreData *data = mSource->mData.get();
+  QReadLocker locker( &mSource->mData->lock );
+
+  int row = -1;
+  while ( mUsingRowList ? mPosition < mRows.size() : mPosition < mRowCount )
+  {
+    const int candidate = mUsingRowList ? mRows.at( mPosition ) : mPosition;
+    ++mPosition;
+    if ( acceptRow( candidate ) )
+    {
+      row = candidate;
+      break;
+    }
+  }
+
+  if ( row < 0 )
+  {
+    locker.unlock();
+    close();
+    return false;
+  }
+
+  feature.setId( row + 1 );
+  feature.setFields( data->fields ); // allow name-based attribute lookups
+
+  QgsAttributes attributes( data->fields.count() );
+  if ( mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes )
+  {
+    const QgsAttributeList subset = mRequest.subsetOfAttributes();
+    for ( int idx : subset )
+    {
+      if ( idx >= 0 && idx < attributes.size() )
+        attributes[idx] = data->value( idx, row );
+    }
+  }
+  else
+  {
+    for ( int idx = 0; idx < attributes.size(); ++idx )
+      attributes[idx] = data->value( idx, row );
+  }
+  feature.setAttributes( attributes );
+
+  if ( mRequest.flags() & QgsFeatureRequest::NoGeometry )
+    feature.clearGeometry();
+  else
+    feature.setGeometry( data->geometry( row ) );
+
+  feature.setValid( true );
+  return true;
+}
+
+///@endcond
+
+
+QgsWFSFeatureStore::QgsWFSFeatureStore( const QgsFields &fields, QgsWkbTypes::Type wkbType, const QgsCoordinateReferenceSystem &crs,
+                                        const QString &spillFileName, qint64 memoryLimit )
+  : mData( std::make_shared< QgsWFSFeatureStoreData >( fields, spillFileName, memoryLimit ) )
+  , mWkbType( wkbType )
+  , mCrs( crs )
+  , mGenCounterIdx( fields.indexFromName( QgsWFSConstants::FIELD_GEN_COUNTER ) )
+{
+}
+
+QgsWFSFeatureStore::~QgsWFSFeatureStore() = default;
+
+QgsAbstractFeatureSource *QgsWFSFeatureStore::featureSource() const
+{
+  return new QgsWFSFeatureStoreSource( mData, mGenCounterIdx, -1 );
+}
+
+QgsFeatureIterator QgsWFSFeatureStore::getFeatures( const QgsFeatureRequest &request ) const
+{
+  return getFeatures( request, -1 );
+}
+
+QgsFeatureIterator QgsWFSFeatureStore::getFeatures( const QgsFeatureRequest &request, int maxGenCounter ) const
+{
+  return QgsFeatureIterator( new QgsWFSFeatureStoreIterator( new QgsWFSFeatureStoreSource( mData, mGenCounterIdx, maxGenCounter ), true, request ) );
+}
+
+QgsWkbTypes::Type QgsWFSFeatureStore::wkbType() const
+{
+  return mWkbType;
+}
+
+long QgsWFSFeatureStore::featureCount() const
+{
+  QReadLocker locker( &mData->lock );
+  return mData->featureCount;
+}
+
+QgsFields QgsWFSFeatureStore::fields() const
+{
+  return mData->fields;
+}
+
+bool QgsWFSFeatureStore::addFeatures( QgsFeatureList &flist, QgsFeatureSink::Flags )
+{
+  QWriteLocker locker( &mData->lock );
+
+  for ( QgsFeature &feature : flist )
+  {
+    const int row = mData->rowCount;
+    const QgsFeatureId fid = row + 1;
+    const QgsAttributes attributes = feature.attributes();
+    for ( int i = 0; i < mData->columns.size(); ++i )
+    {
+      const QVariant value = attributes.value( i );
+      mData->storeValue( i, row, value );
+      auto index = mData->valueIndexes.find( i );
+      if ( index != mData->valueIndexes.end() && !value.isNull() )
+        index->insert( value.toString(), fid );
+    }
+    mData->storeGeometry( row, feature.geometry() );
+    mData->deleted.append( false );
+    mData->rowCount++;
+    mData->featureCount++;
+
+    feature.setId( fid );
+  }
+
+  mData->spillIfNeeded();
+  return true;
+}
+
+bool QgsWFSFeatureStore::deleteFeatures( const QgsFeatureIds &ids )
+{
+  QWriteLocker locker( &mData->lock );
+
+  for ( QgsFeatureId fid : ids )
+  {
+    const int row = static_cast< int >( fid - 1 );
+    if ( row < 0 || row >= mData->rowCount || mData->deleted.at( row ) )
+      continue;
+
+    mData->deleted[row] = true;
+    mData->featureCount--;
+
+    if ( mData->geometrySizes.at( row ) > 0 )
+    {
+      QgsFeature f( fid );
+      f.setGeometry( QgsGeometry::fromRect( mData->boundingBoxes.at( row ) ) );
+      mData->spatialIndex.deleteFeature( f );
+    }
+
+    for ( auto index = mData->valueIndexes.begin(); index != mData->valueIndexes.end(); ++index )
+    {
+      const QVariant value = mData->value( index.key(), row );
+      if ( !value.isNull() )
+        index->remove( value.toString(), fid );
+    }
+  }
+  return true;
+}
+
+bool QgsWFSFeatureStore::changeAttributeValues( const QgsChangedAttributesMap &attr_map )
+{
+  QWriteLocker locker( &mData->lock );
+
+  for ( QgsChangedAttributesMap::const_iterator it = attr_map.constBegin(); it != attr_map.constEnd(); ++it )
+  {
+    const QgsFeatureId fid = it.key();
+    const int row = static_cast< int >( fid - 1 );
+    if ( row < 0 || row >= mData->rowCount || mData->deleted.at( row ) )
+      continue;
+
+    const QgsAttributeMap &attrs = it.value();
+    for ( QgsAttributeMap::const_iterator attrIt = attrs.constBegin(); attrIt != attrs.constEnd(); ++attrIt )
+    {
+      const int idx = attrIt.key();
+      if ( idx < 0 || idx >= mData->columns.size() )
+        continue;
+
+      auto index = mData->valueIndexes.find( idx );
+      if ( index != mData->valueIndexes.end() )
+      {
+        const QVariant oldValue = mData->value( idx, row );
+        if ( !oldValue.isNull() )
+          index->remove( oldValue.toString(), fid );
+        if ( !attrIt.value().isNull() )
+          index->insert( attrIt.value().toString(), fid );
+      }
+      mData->storeValue( idx, row, attrIt.value() );
+    }
+  }
+
+  mData->spillIfNeeded();
+  return true;
+}
+
+bool QgsWFSFeatureStore::changeGeometryValues( const QgsGeometryMap &geometry_map )
+{
+  QWriteLocker locker( &mData->lock );
+
+  for ( QgsGeometryMap::const_iterator it = geometry_map.constBegin(); it != geometry_map.constEnd(); ++it )
+  {
+    const QgsFeatureId fid = it.key();
+    const int row = static_cast< int >( fid - 1 );
+    if ( row < 0 || row >= mData->rowCount || mData->deleted.at( row ) )
+      continue;
+
+    if ( mData->geometrySizes.at( row ) > 0 )
+    {
+      QgsFeature f( fid );
+      f.setGeometry( QgsGeometry::fromRect( mData->boundingBoxes.at( row ) ) );
+      mData->spatialIndex.deleteFeature( f );
+    }
+    mData->storeGeometry( row, it.value() );
+  }
+
+  mData->spillIfNeeded();
+  return true;
+}
+
+QgsVectorDataProvider::Capabilities QgsWFSFeatureStore::capabilities() const
+{
+  return AddFeatures | DeleteFeatures | ChangeAttributeValues | ChangeGeometries | SelectAtId;
+}
+
+QString QgsWFSFeatureStore::name() const
+{
+  return QStringLiteral( "wfsfeaturestore" );
+}
+
+QString QgsWFSFeatureStore::description() const
+{
+  return QStringLiteral( "WFS in-process feature store" );
+}
+
+QgsRectangle QgsWFSFeatureStore::extent() const
+{
+  QReadLocker locker( &mData->lock );
+  return mData->extent;
+}
+
+bool QgsWFSFeatureStore::isValid() const
+{
+  return true;
+}
+
+QgsCoordinateReferenceSystem QgsWFSFeatureStore::crs() const
+{
+  return mCrs;
+}
+
+void QgsWFSFeatureStore::createValueIndex( int fieldIndex )
+{
+  if ( fieldIndex < 0 || fieldIndex >= mData->columns.size() )
+    return;
+
+  QWriteLocker locker( &mData->lock );
+  if ( mData->valueIndexes.contains( fieldIndex ) )
+    return;
+
+  QMultiHash< QString, QgsFeatureId > &index = mData->valueIndexes[fieldIndex];
+  for ( int row = 0; row < mData->rowCount; ++row )
+  {
+    if ( mData->deleted.at( row ) )
+      continue;
+    const QVariant value = mData->value( fieldIndex, row );
+    if ( !value.isNull() )
+      index.insert( value.toString(), row + 1 );
+  }
+}
+
+QSet<QString> QgsWFSFeatureStore::existingValues( int fieldIndex, const QStringList &values ) const
+{
+  QSet<QString> existing;
+  if ( fieldIndex < 0 || fieldIndex >= mData->columns.size() )
+    return existing;
+
+  QReadLocker locker( &mData->lock );
+  auto index = mData->valueIndexes.constFind( fieldIndex );
+  if ( index != mData->valueIndexes.constEnd() )
+  {
+    for ( const QString &value : values )
+    {
+      if ( index->contains( value ) )
+        existing.insert( value );
+    }
+    return existing;
+  }
+
+  const QSet<QString> wanted = values.toSet();
+  for ( int row = 0; row < mData->rowCount; ++row )
+  {
+    if ( mData->deleted.at( row ) )
+      continue;
+    const QString value = mData->value( fieldIndex, row ).toString();
+    if ( wanted.contains( value ) )
+      existing.insert( value );
+  }
+  return existing;
+}
@@ -0,0 +1,96 @@
+/***************************************************************************
+    qgswfsfeaturestore.h
+    ---------------------
+    begin                : October 2026
+    copyright            : (C) 2026 by QGIS contributors
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSWFSFEATURESTORE_H
+#define QGSWFSFEATURESTORE_H
+
+#include "qgsvectordataprovider.h"
+#include "qgscoordinatereferencesystem.h"
+
+#include <memory>
+
+class QgsWFSFeatureStoreData;
+
+/**
+ * In-process feature store, used by QgsWFSSharedData as an alternative to the
+ *  SpatiaLite cache.
+ *
+ *  Attributes are stored column by column: integer and double fields as
+ *  native values, other fields as UTF-8 strings. Geometries are kept as WKB
+ *  with their bounding box, which is indexed in a R-tree. Strings and
+ *  geometries are packed in an append-only arena, which is spilled to a
+ *  memory-mapped file once it exceeds the memory limit. Values which are
+ *  replaced keep their space in the arena.
+ *
+ *  Feature ids are assigned sequentially from 1 and are never reused.
+ *
+ *  The store can be read from several threads while features are added.
+ */
+class QgsWFSFeatureStore : public QgsVectorDataProvider
+{
+    Q_OBJECT
+  public:
+
+    /**
+     * Constructor.
+     * \param fields fields of the stored features
+     * \param wkbType geometry type of the stored features
+     * \param crs coordinate reference system of the stored geometries
+     * \param spillFileName file used to spill the arena
+     * \param memoryLimit size in bytes of the arena kept in memory. If negative, the arena is never spilled
+     */
+    QgsWFSFeatureStore( const QgsFields &fields, QgsWkbTypes::Type wkbType, const QgsCoordinateReferenceSystem &crs,
+                        const QString &spillFileName, qint64 memoryLimit );
+    ~QgsWFSFeatureStore() override;
+
+    QgsAbstractFeatureSource *featureSource() const override;
+    QgsFeatureIterator getFeatures( const QgsFeatureRequest &request ) const override;
+
+    /**
+     * Returns an iterator over the features whose generation counter field
+     *  is lower or equal to \a maxGenCounter. The generation counter is ignored
+     *  if negative or if features are requested by id.
+     */
+    QgsFeatureIterator getFeatures( const QgsFeatureRequest &request, int maxGenCounter ) const;
+
+    QgsWkbTypes::Type wkbType() const override;
+    long featureCount() const override;
+    QgsFields fields() const override;
+    bool addFeatures( QgsFeatureList &flist, QgsFeatureSink::Flags flags = nullptr ) override;
+    bool deleteFeatures( const QgsFeatureIds &ids ) override;
+    bool changeAttributeValues( const QgsChangedAttributesMap &attr_map ) override;
+    bool changeGeometryValues( const QgsGeometryMap &geometry_map ) override;
+    QgsVectorDataProvider::Capabilities capabilities() const override;
+
+    QString name() const override;
+    QString description() const override;
+    QgsRectangle extent() const override;
+    bool isValid() const override;
+    QgsCoordinateReferenceSystem crs() const override;
+
+    //! Indexes the values of the field \a fieldIndex, which are used as strings
+    void createValueIndex( int fieldIndex );
+
+    //! Returns the subset of \a values that are used by a stored feature for the field \a fieldIndex
+    QSet<QString> existingValues( int fieldIndex, const QStringList &values ) const;
+
+  private:
+    std::shared_ptr< QgsWFSFeatureStoreData > mData;
+    QgsWkbTypes::Type mWkbType = QgsWkbTypes::Unknown;
+    QgsCoordinateReferenceSystem mCrs;
+
+    //! Index of the generation counter field, or -1
+    int mGenCounterIdx = -1;
+};
+
+#endif // QGSWFSFEATURESTORE_H
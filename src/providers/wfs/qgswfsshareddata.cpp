@@ -16,6 +16,7 @@
 #include <cmath> // M_PI
 
 #include "qgswfsconstants.h"
+#include "qgswfsfeaturestore.h"
 #include "qgswfsshareddata.h"
 #include "qgswfsutils.h"
 
@@ -27,6 +28,7 @@
 #include "qgsvectorfilewriter.h"
 #include "qgsproviderregistry.h"
 #include "qgslogger.h"
+#include "qgssettings.h"
 #include "qgsspatialiteutils.h"
 
 #include <cpl_vsi.h>
@@ -213,9 +215,13 @@ bool QgsWFSSharedData::createCache()
 {
   Q_ASSERT( mCacheDbname.isEmpty() );
 
+  QgsSettings settings;
+  const bool memoryCache = settings.value( QStringLiteral( "wfs/cache_backend" ), "sqlite" ).toString() == QLatin1String( "memory" );
+
   static QAtomicInt sTmpCounter = 0;
   int tmpCounter = ++sTmpCounter;
-  mCacheDbname = QDir( QgsWFSUtils::acquireCacheDirectory() ).filePath( QStringLiteral( "wfs_cache_%1.sqlite" ).arg( tmpCounter ) );
+  mCacheDbname = QDir( QgsWFSUtils::acquireCacheDirectory() ).filePath(
+                   ( memoryCache ? QStringLiteral( "wfs_cache_%1.bin" ) : QStringLiteral( "wfs_cache_%1.sqlite" ) ).arg( tmpCounter ) );
   Q_ASSERT( !QFile::exists( mCacheDbname ) );
 
   QgsFields cacheFields;
@@ -234,10 +240,21 @@ bool QgsWFSSharedData::createCache()
   // Add some field for our internal use
   cacheFields.append( QgsField( QgsWFSConstants::FIELD_GEN_COUNTER, QVariant::Int, QStringLiteral( "int" ) ) );
   cacheFields.append( QgsField( QgsWFSConstants::FIELD_GMLID, QVariant::String, QStringLiteral( "string" ) ) );
-  cacheFields.append( QgsField( QgsWFSConstants::FIELD_HEXWKB_GEOM, QVariant::String, QStringLiteral( "string" ) ) );
   if ( mDistinctSelect )
     cacheFields.append( QgsField( QgsWFSConstants::FIELD_MD5, QVariant::String, QStringLiteral( "string" ) ) );
 
+  if ( memoryCache )
+  {
+    // The spill file is only created once the memory limit is exceeded
+    const qint64 memoryLimit = static_cast< qint64 >( settings.value( QStringLiteral( "wfs/cache_memory_limit" ), 256 ).toDouble() * 1024 * 1024 );
+    mCacheStore = new QgsWFSFeatureStore( cacheFields, mWKBType, mSourceCRS, mCacheDbname, memoryLimit );
+    mCacheStore->createValueIndex( cacheFields.indexFromName( mDistinctSelect ? QgsWFSConstants::FIELD_MD5 : QgsWFSConstants::FIELD_GMLID ) );
+    mCacheDataProvider = mCacheStore;
+    return true;
+  }
+
+  cacheFields.append( QgsField( QgsWFSConstants::FIELD_HEXWKB_GEOM, QVariant::String, QStringLiteral( "string" ) ) );
+
   bool ogrWaySuccessful = false;
   QString fidName( QStringLiteral( "__ogc_fid" ) );
   QString geometryFieldname( QStringLiteral( "__spatialite_geometry" ) );
@@ -570,6 +587,21 @@ int QgsWFSSharedData::getUpdatedCounter()
   return mGenCounter ++;
 }
 
+QgsFeatureIterator QgsWFSSharedData::getCachedFeatures( const QgsFeatureRequest &request, int genCounter )
+{
+  if ( mCacheStore )
+    return mCacheStore->getFeatures( request, genCounter );
+
+  QgsFeatureRequest requestCache( request );
+  if ( genCounter >= 0 &&
+       request.filterType() != QgsFeatureRequest::FilterFid &&
+       request.filterType() != QgsFeatureRequest::FilterFids )
+  {
+    requestCache.combineFilterExpression( QString( QgsWFSConstants::FIELD_GEN_COUNTER + " <= %1" ).arg( genCounter ) );
+  }
+  return mCacheDataProvider->getFeatures( requestCache );
+}
+
 QSet<QString> QgsWFSSharedData::getExistingCachedGmlIds( const QVector<QgsWFSFeatureGmlIdPair> &featureList )
 {
   QString expr;
@@ -579,6 +611,15 @@ QSet<QString> QgsWFSSharedData::getExistingCachedGmlIds( const QVector<QgsWFSFea
   QgsFields dataProviderFields = mCacheDataProvider->fields();
   const int gmlidIdx = dataProviderFields.indexFromName( QgsWFSConstants::FIELD_GMLID );
 
+  if ( mCacheStore )
+  {
+    QStringList gmlIds;
+    gmlIds.reserve( featureList.size() );
+    for ( const QgsWFSFeatureGmlIdPair &featPair : featureList )
+      gmlIds.append( featPair.second );
+    return mCacheStore->existingValues( gmlidIdx, gmlIds );
+  }
+
   // To avoid excessive memory consumption in expression building, do not
   // query more than 1000 ids at a time.
   for ( int i = 0; i < featureList.size(); i ++ )
@@ -630,6 +671,15 @@ QSet<QString> QgsWFSSharedData::getExistingCachedMD5( const QVector<QgsWFSFeatur
   QgsFields dataProviderFields = mCacheDataProvider->fields();
   const int md5Idx = dataProviderFields.indexFromName( QgsWFSConstants::FIELD_MD5 );
 
+  if ( mCacheStore )
+  {
+    QStringList md5s;
+    md5s.reserve( featureList.size() );
+    for ( const QgsWFSFeatureGmlIdPair &featPair : featureList )
+      md5s.append( QgsWFSUtils::getMD5( featPair.first ) );
+    return mCacheStore->existingValues( md5Idx, md5s );
+  }
+
   // To avoid excessive memory consumption in expression building, do not
   // query more than 1000 ids at a time.
   for ( int i = 0; i < featureList.size(); i ++ )
@@ -717,6 +767,9 @@ bool QgsWFSSharedData::changeGeometryValues( const QgsGeometryMap &geometry_map
   if ( !mCacheDataProvider )
     return false;
 
+  if ( mCacheStore )
+    return mCacheStore->changeGeometryValues( geometry_map );
+
   // We need to replace the geometry by its bounding box and issue a attribute
   // values change with the real geometry serialized as hexwkb.
 
@@ -808,8 +861,8 @@ void QgsWFSSharedData::serializeFeatures( QVector<QgsWFSFeatureGmlIdPair> &featu
   Q_ASSERT( gmlidIdx >= 0 );
   int genCounterIdx = dataProviderFields.indexFromName( QgsWFSConstants::FIELD_GEN_COUNTER );
   Q_ASSERT( genCounterIdx >= 0 );
+  // Not present in the in-process store, which keeps the geometries themselves
   int hexwkbGeomIdx = dataProviderFields.indexFromName( QgsWFSConstants::FIELD_HEXWKB_GEOM );
-  Q_ASSERT( hexwkbGeomIdx >= 0 );
   int md5Idx = ( mDistinctSelect ) ? dataProviderFields.indexFromName( QgsWFSConstants::FIELD_MD5 ) : -1;
 
   QSet<QString> existingGmlIds;
@@ -863,19 +916,27 @@ void QgsWFSSharedData::serializeFeatures( QVector<QgsWFSFeatureGmlIdPair> &featu
     QgsGeometry geometry = gmlFeature.geometry();
     if ( !mGeometryAttribute.isEmpty() && !geometry.isNull() )
     {
-      QByteArray array( geometry.asWkb() );
-
-      cachedFeature.setAttribute( hexwkbGeomIdx, QVariant( QString( array.toHex().data() ) ) );
-
       QgsRectangle bBox( geometry.boundingBox() );
       if ( localComputedExtent.isNull() )
         localComputedExtent = bBox;
       else
         localComputedExtent.combineExtentWith( bBox );
-      QgsGeometry polyBoundingBox = QgsGeometry::fromRect( bBox );
-      cachedFeature.setGeometry( polyBoundingBox );
+
+      if ( hexwkbGeomIdx >= 0 )
+      {
+        QByteArray array( geometry.asWkb() );
+
+        cachedFeature.setAttribute( hexwkbGeomIdx, QVariant( QString( array.toHex().data() ) ) );
+
+        QgsGeometry polyBoundingBox = QgsGeometry::fromRect( bBox );
+        cachedFeature.setGeometry( polyBoundingBox );
+      }
+      else
+      {
+        cachedFeature.setGeometry( geometry );
+      }
     }
-    else
+    else if ( hexwkbGeomIdx >= 0 )
     {
       cachedFeature.setAttribute( hexwkbGeomIdx, QVariant( QString() ) );
     }
@@ -1098,6 +1159,7 @@ void QgsWFSSharedData::invalidateCache()
   }
   delete mCacheDataProvider;
   mCacheDataProvider = nullptr;
+  mCacheStore = nullptr;
 
   if ( !mCacheDbname.isEmpty() )
   {
@@ -21,6 +21,8 @@
 #include "qgswfscapabilities.h"
 #include "qgsogcutils.h"
 
+class QgsWFSFeatureStore;
+
 /**
  * This class holds data, and logic, shared between QgsWFSProvider, QgsWFSFeatureIterator
  *  and QgsWFSFeatureDownloader. It manages the on-disk cache, as a SpatiaLite
@@ -44,6 +46,11 @@
  *
  *  It contains also methods used in WFS-T context to update the cache content,
  *  from the changes initiated by the user.
+ *
+ *  If the "wfs/cache_backend" setting is "memory", the cache is a QgsWFSFeatureStore
+ *  instead, which keeps the geometries themselves and has no __qgis_hexwkb_geom
+ *  field. The "wfs/cache_memory_limit" setting is then the size in MB of the
+ *  feature data kept in memory before it is spilled to a file.
  */
 class QgsWFSSharedData : public QObject
 {
@@ -152,6 +159,15 @@ class QgsWFSSharedData : public QObject
     //! The data provider of the on-disk cache
     QgsVectorDataProvider *mCacheDataProvider = nullptr;
 
+    //! The in-process feature store, if it is used as the cache. Same object as mCacheDataProvider
+    QgsWFSFeatureStore *mCacheStore = nullptr;
+
+    /**
+     * Returns the cached features matching \a request, whose generation counter
+     * is lower or equal to \a genCounter if it is not negative.
+     */
+    QgsFeatureIterator getCachedFeatures( const QgsFeatureRequest &request, int genCounter = -1 );
+
     //! Current BBOX used by the downloader
     QgsRectangle mRect;
 
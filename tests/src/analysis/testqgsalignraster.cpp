@@ -21,6 +21,7 @@
 #include "qgsrectangle.h"
 
 #include <QDir>
+#include <QMap>
 
 #include <gdal.h>
 
@@ -31,6 +32,26 @@ static QString _tempFile( const QString &name )
   return QStringLiteral( "%1/aligntest-%2.tif" ).arg( QDir::tempPath(), name );
 }
 
+class TestProgressHandler : public QgsAlignRaster::ProgressHandler
+{
+  public:
+    bool progress( double complete ) override
+    {
+      overallProgress = complete;
+      return !cancel;
+    }
+
+    bool rasterProgress( int index, double complete ) override
+    {
+      rasterCompleted[index] = complete;
+      return true;
+    }
+
+    double overallProgress = 0;
+    QMap< int, double > rasterCompleted;
+    bool cancel = false;
+};
+
 
 class TestAlignRaster : public QObject
 {
@@ -162,6 +183,77 @@ class TestAlignRaster : public QObject
     }
 
 
+    void testParallelWarps()
+    {
+      QString tmpFile1( _tempFile( QStringLiteral( "parallel-1" ) ) );
+      QString tmpFile2( _tempFile( QStringLiteral( "parallel-2" ) ) );
+
+      QgsAlignRaster align;
+      QgsAlignRaster::List rasters;
+      rasters << QgsAlignRaster::Item( SRC_FILE, tmpFile1 );
+      rasters << QgsAlignRaster::Item( SRC_FILE, tmpFile2 );
+      rasters[1].resampleMethod = QgsAlignRaster::RA_Bilinear;
+      align.setRasters( rasters );
+      align.setParametersFromRaster( SRC_FILE );
+      align.setCellSize( 0.001, 0.001 );
+      align.setMaximumParallelWarps( 2 );
+      align.setWarpMemoryLimit( 16 );
+      align.setCreateTiledOutputs( true );
+      align.setBuildOverviews( true );
+      TestProgressHandler handler;
+      align.setProgressHandler( &handler );
+      bool res = align.run();
+      align.setProgressHandler( nullptr );
+      QVERIFY( res );
+
+      QCOMPARE( handler.rasterCompleted.count(), 2 );
+      QGSCOMPARENEAR( handler.rasterCompleted.value( 0 ), 1., 0.01 );
+      QGSCOMPARENEAR( handler.rasterCompleted.value( 1 ), 1., 0.01 );
+      QGSCOMPARENEAR( handler.overallProgress, 1., 0.01 );
+
+      QgsAlignRaster::RasterInfo in( SRC_FILE );
+      QgsAlignRaster::RasterInfo out1( tmpFile1 );
+      QVERIFY( out1.isValid() );
+      QCOMPARE( out1.rasterSize(), QSize( 800, 800 ) );
+      QCOMPARE( out1.identify( 106.15, -6.35 ), in.identify( 106.15, -6.35 ) );
+      QCOMPARE( out1.identify( 106.75, -6.95 ), in.identify( 106.75, -6.95 ) );
+
+      QgsAlignRaster::RasterInfo out2( tmpFile2 );
+      QVERIFY( out2.isValid() );
+      QCOMPARE( out2.rasterSize(), QSize( 800, 800 ) );
+
+      // outputs are tiled, with overviews down to 256 pixels
+      gdal::dataset_unique_ptr ds( GDALOpen( tmpFile1.toLocal8Bit().constData(), GA_ReadOnly ) );
+      QVERIFY( ds );
+      GDALRasterBandH band = GDALGetRasterBand( ds.get(), 1 );
+      int blockXSize = 0;
+      int blockYSize = 0;
+      GDALGetBlockSize( band, &blockXSize, &blockYSize );
+      QCOMPARE( blockXSize, 256 );
+      QCOMPARE( blockYSize, 256 );
+      QCOMPARE( GDALGetOverviewCount( band ), 1 );
+      QCOMPARE( GDALGetRasterBandXSize( GDALGetOverview( band, 0 ) ), 400 );
+    }
+
+    void testCancel()
+    {
+      QgsAlignRaster align;
+      QgsAlignRaster::List rasters;
+      rasters << QgsAlignRaster::Item( SRC_FILE, _tempFile( QStringLiteral( "cancel" ) ) );
+      align.setRasters( rasters );
+      align.setParametersFromRaster( SRC_FILE );
+      align.setCellSize( 0.001, 0.001 );
+      QVERIFY( align.checkInputParameters() );
+      // the handler is called directly by GDAL when warping a single raster, so the warp is always canceled
+      TestProgressHandler handler;
+      handler.cancel = true;
+      align.setProgressHandler( &handler );
+      bool res = align.createAndWarp( rasters.at( 0 ) );
+      align.setProgressHandler( nullptr );
+      QVERIFY( !res );
+      QVERIFY( align.errorMessage().startsWith( QStringLiteral( "Canceled while warping" ) ) );
+    }
+
     void testBiggerCellSize()
     {
       QString tmpFile( _tempFile( QStringLiteral( "bigger-cell-size" ) ) );
@@ -0,0 +1,148 @@
+/***************************************************************************
+  testqgskde.cpp
+  --------------------------------------
+  Date                 : October 2026
+  Copyright            : (C) 2026 by QGIS contributors
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstest.h"
+#include "qgsapplication.h"
+#include "qgskde.h"
+#include "qgsogrutils.h"
+#include "qgsvectordataprovider.h"
+#include "qgsvectorlayer.h"
+
+#include <QDir>
+#include <QThreadPool>
+
+#include <random>
+#include <vector>
+
+class TestQgsKernelDensityEstimation : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testParallelTiles_data();
+    void testParallelTiles();
+
+  private:
+
+    //! Runs the estimation with at most \a threadCount workers and returns the output values
+    static std::vector< float > runEstimation( const QgsKernelDensityEstimation::Parameters &parameters, int threadCount, int &rows, int &columns );
+};
+
+void TestQgsKernelDensityEstimation::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+}
+
+void TestQgsKernelDensityEstimation::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+std::vector< float > TestQgsKernelDensityEstimation::runEstimation( const QgsKernelDensityEstimation::Parameters &parameters, int threadCount, int &rows, int &columns )
+{
+  const QString outputFile = QStringLiteral( "%1/kdetest-%2.tif" ).arg( QDir::tempPath() ).arg( threadCount );
+  QFile::remove( outputFile );
+
+  const int maxThreadCount = QThreadPool::globalInstance()->maxThreadCount();
+  QThreadPool::globalInstance()->setMaxThreadCount( threadCount );
+  QgsKernelDensityEstimation kde( parameters, outputFile, QStringLiteral( "GTiff" ) );
+  const QgsKernelDensityEstimation::Result result = kde.run();
+  QThreadPool::globalInstance()->setMaxThreadCount( maxThreadCount );
+
+  rows = 0;
+  columns = 0;
+  if ( result != QgsKernelDensityEstimation::Success )
+    return std::vector< float >();
+
+  gdal::dataset_unique_ptr dataset( GDALOpen( outputFile.toUtf8().constData(), GA_ReadOnly ) );
+  if ( !dataset )
+    return std::vector< float >();
+
+  columns = GDALGetRasterXSize( dataset.get() );
+  rows = GDALGetRasterYSize( dataset.get() );
+  std::vector< float > values( static_cast< std::size_t >( rows ) * columns );
+  if ( GDALRasterIO( GDALGetRasterBand( dataset.get(), 1 ), GF_Read, 0, 0, columns, rows, values.data(), columns, rows, GDT_Float32, 0, 0 ) != CE_None )
+    values.clear();
+  return values;
+}
+
+void TestQgsKernelDensityEstimation::testParallelTiles_data()
+{
+  QTest::addColumn<bool>( "variableRadius" );
+
+  QTest::newRow( "fixed radius" ) << false;
+  QTest::newRow( "radius field" ) << true;
+}
+
+void TestQgsKernelDensityEstimation::testParallelTiles()
+{
+  QFETCH( bool, variableRadius );
+
+  // more points than a single batch of pending points, spread over several rows of 256 pixel tiles
+  std::unique_ptr< QgsVectorLayer > layer = qgis::make_unique< QgsVectorLayer >( QStringLiteral( "Point?crs=epsg:3857&field=radius:double&field=weight:double" ), QStringLiteral( "points" ), QStringLiteral( "memory" ) );
+  std::mt19937 generator( 42 );
+  std::uniform_real_distribution< double > xDistribution( 0, 700 );
+  std::uniform_real_distribution< double > yDistribution( 0, 900 );
+  std::uniform_real_distribution< double > radiusDistribution( 2, 30 );
+  std::uniform_real_distribution< double > weightDistribution( 0.5, 3 );
+  QgsFeatureList features;
+  for ( int i = 0; i < 70000; ++i )
+  {
+    QgsFeature f( layer->fields() );
+    f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( xDistribution( generator ), yDistribution( generator ) ) ) );
+    f.setAttributes( QgsAttributes() << radiusDistribution( generator ) << weightDistribution( generator ) );
+    features << f;
+  }
+  QVERIFY( layer->dataProvider()->addFeatures( features ) );
+
+  QgsKernelDensityEstimation::Parameters parameters;
+  parameters.source = layer.get();
+  parameters.radius = 8;
+  parameters.radiusField = variableRadius ? QStringLiteral( "radius" ) : QString();
+  parameters.weightField = QStringLiteral( "weight" );
+  parameters.pixelSize = 1;
+  parameters.shape = QgsKernelDensityEstimation::KernelQuartic;
+  parameters.decayRatio = 0;
+  parameters.outputValues = QgsKernelDensityEstimation::OutputRaw;
+
+  int serialRows = 0;
+  int serialColumns = 0;
+  const std::vector< float > serial = runEstimation( parameters, 1, serialRows, serialColumns );
+  int parallelRows = 0;
+  int parallelColumns = 0;
+  const std::vector< float > parallel = runEstimation( parameters, 4, parallelRows, parallelColumns );
+
+  QVERIFY( !serial.empty() );
+  QCOMPARE( parallelRows, serialRows );
+  QCOMPARE( parallelColumns, serialColumns );
+  // the surface is split in several rows of tiles, so that several workers are used
+  QVERIFY( serialRows > 2 * 256 );
+
+  // each pixel receives the kernels of the points in the same order, whatever the number of workers
+  int mismatchCount = 0;
+  for ( std::size_t i = 0; i < serial.size(); ++i )
+  {
+    if ( serial[i] != parallel[i] )
+      mismatchCount++;
+  }
+  QCOMPARE( mismatchCount, 0 );
+}
+
+QGSTEST_MAIN( TestQgsKernelDensityEstimation )
+#include "testqgskde.moc"
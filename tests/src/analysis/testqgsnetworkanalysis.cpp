@@ -25,6 +25,9 @@ Email                : nyall dot dawson at gmail dot com
 #include "qgsgraphbuilder.h"
 #include "qgsgraph.h"
 #include "qgsgraphanalyzer.h"
+#include "qgscompactgraph.h"
+#include "qgscontractionhierarchy.h"
+#include <QTemporaryDir>
 
 class TestQgsNetworkAnalysis : public QObject
 {
@@ -43,9 +46,16 @@ class TestQgsNetworkAnalysis : public QObject
     void dijkkjkjkskkjsktra();
     void testRouteFail();
     void testRouteFail2();
+    void testCompactGraph();
+    void dijkstraCompact();
+    void contractionHierarchy();
+    void multiThreadedBuild();
+    void benchmarkBuild_data();
+    void benchmarkBuild();
 
   private:
     std::unique_ptr< QgsVectorLayer > buildNetwork();
+    std::unique_ptr< QgsVectorLayer > buildGridNetwork( int size );
 
 
 };
@@ -146,6 +156,30 @@ std::unique_ptr<QgsVectorLayer> TestQgsNetworkAnalysis::buildNetwork()
   return l;
 }
 
+std::unique_ptr<QgsVectorLayer> TestQgsNetworkAnalysis::buildGridNetwork( int size )
+{
+  std::unique_ptr< QgsVectorLayer > l = qgis::make_unique< QgsVectorLayer >( QStringLiteral( "LineString?crs=epsg:4326&field=cost:int" ), QStringLiteral( "x" ), QStringLiteral( "memory" ) );
+
+  // one feature per grid cell side, with slightly jittered vertices so that some are collapsed by the tolerance
+  QgsFeatureList flist;
+  for ( int i = 0; i <= size; ++i )
+  {
+    for ( int j = 0; j < size; ++j )
+    {
+      const double jitter = ( ( i * 7 + j * 13 ) % 5 ) * 0.001;
+      QgsFeature ff( 0 );
+      ff.setGeometry( QgsGeometry::fromPolylineXY( QgsPolylineXY() << QgsPointXY( j, i ) << QgsPointXY( j + 0.5, i + jitter ) << QgsPointXY( j + 1 + jitter, i ) ) );
+      ff.setAttributes( QgsAttributes() << ( i + j ) % 10 + 1 );
+      flist << ff;
+      ff.setGeometry( QgsGeometry::fromPolylineXY( QgsPolylineXY() << QgsPointXY( i, j ) << QgsPointXY( i + jitter, j + 1 ) ) );
+      ff.setAttributes( QgsAttributes() << ( i * j ) % 10 + 1 );
+      flist << ff;
+    }
+  }
+  l->dataProvider()->addFeatures( flist );
+
+  return l;
+}
 
 void TestQgsNetworkAnalysis::testBuild()
 {
@@ -575,6 +609,299 @@ void TestQgsNetworkAnalysis::testRouteFail2()
   QCOMPARE( resultCost.at( endVertexIdx ), 9.01 );
 }
 
+void TestQgsNetworkAnalysis::testCompactGraph()
+{
+  QgsGraph graph;
+  graph.addVertex( QgsPointXY( 1, 2 ) );
+  graph.addVertex( QgsPointXY( 3, 4 ) );
+  graph.addVertex( QgsPointXY( 7, 8 ) );
+  graph.addEdge( 1, 2, QVector< QVariant >() << 8 << 1.5 );
+  graph.addEdge( 0, 1, QVector< QVariant >() << 9 << 2.5 );
+  graph.addEdge( 1, 0, QVector< QVariant >() << 7 << 3.5 );
+
+  QgsCompactGraph compact( graph );
+  QCOMPARE( compact.vertexCount(), 3 );
+  QCOMPARE( compact.edgeCount(), 3 );
+  QCOMPARE( compact.strategyCount(), 2 );
+  for ( int i = 0; i < graph.edgeCount(); ++i )
+  {
+    QCOMPARE( compact.fromVertex( i ), graph.edge( i ).fromVertex() );
+    QCOMPARE( compact.toVertex( i ), graph.edge( i ).toVertex() );
+    QCOMPARE( compact.cost( i, 0 ), graph.edge( i ).cost( 0 ).toDouble() );
+    QCOMPARE( compact.cost( i, 1 ), graph.edge( i ).cost( 1 ).toDouble() );
+  }
+
+  QgsCompactGraph empty;
+  QCOMPARE( empty.vertexCount(), 0 );
+  QCOMPARE( empty.edgeCount(), 0 );
+}
+
+void TestQgsNetworkAnalysis::dijkstraCompact()
+{
+  std::unique_ptr<QgsVectorLayer> network = buildNetwork();
+  QgsFeature ff( 0 );
+  QgsFeatureList flist;
+  ff.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "LineString(10 10, 20 10 )" ) ) );
+  ff.setAttributes( QgsAttributes() << 2 );
+  flist << ff;
+  ff.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "LineString(10 20, 10 10 )" ) ) );
+  ff.setAttributes( QgsAttributes() << 3 );
+  flist << ff;
+  ff.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "LineString(20 -10, 20 10 )" ) ) );
+  ff.setAttributes( QgsAttributes() << 4 );
+  flist << ff;
+  network->dataProvider()->addFeatures( flist );
+
+  std::unique_ptr< QgsVectorLayerDirector > director = qgis::make_unique< QgsVectorLayerDirector > ( network.get(),
+      -1, QString(), QString(), QString(), QgsVectorLayerDirector::DirectionBoth );
+  std::unique_ptr< QgsNetworkStrategy > strategy = qgis::make_unique< TestNetworkStrategy >();
+  director->addStrategy( strategy.release() );
+  std::unique_ptr< QgsGraphBuilder > builder = qgis::make_unique< QgsGraphBuilder > ( network->sourceCrs(), true, 0 );
+
+  QVector<QgsPointXY > snapped;
+  director->makeGraph( builder.get(), QVector<QgsPointXY>(), snapped );
+  std::unique_ptr< QgsGraph > graph( builder->graph() );
+  QgsCompactGraph compact( *graph );
+
+  // full searches must match the QgsGraph based implementation from every start vertex
+  for ( int start = 0; start < graph->vertexCount(); ++start )
+  {
+    QVector<int> expectedTree;
+    QVector<double> expectedCost;
+    QgsGraphAnalyzer::dijkstra( graph.get(), start, 0, &expectedTree, &expectedCost );
+
+    QVector<int> resultTree;
+    QVector<double> resultCost;
+    QgsGraphAnalyzer::dijkstra( &compact, start, 0, &resultTree, &resultCost );
+    QCOMPARE( resultCost, expectedCost );
+    QCOMPARE( resultTree.size(), expectedTree.size() );
+    for ( int v = 0; v < resultTree.size(); ++v )
+    {
+      QCOMPARE( resultTree.at( v ) == -1, expectedTree.at( v ) == -1 );
+      if ( resultTree.at( v ) != -1 )
+        QCOMPARE( resultCost.at( graph->edge( resultTree.at( v ) ).fromVertex() ) + graph->edge( resultTree.at( v ) ).cost( 0 ).toDouble(), resultCost.at( v ) );
+    }
+  }
+
+  int startVertexIdx = graph->findVertex( QgsPointXY( 20, -10 ) );
+  int point_0_0_idx = graph->findVertex( QgsPointXY( 0, 0 ) );
+  int point_10_0_idx = graph->findVertex( QgsPointXY( 10, 0 ) );
+  int point_10_10_idx = graph->findVertex( QgsPointXY( 10, 10 ) );
+  int point_10_20_idx = graph->findVertex( QgsPointXY( 10, 20 ) );
+  int point_20_10_idx = graph->findVertex( QgsPointXY( 20, 10 ) );
+
+  // early exit on target
+  QVector<int> resultTree;
+  QVector<double> resultCost;
+  QgsGraphAnalyzer::dijkstra( &compact, startVertexIdx, 0, &resultTree, &resultCost, point_10_10_idx );
+  QCOMPARE( resultCost.at( point_10_10_idx ), 6.0 );
+  QCOMPARE( graph->edge( resultTree.at( point_10_10_idx ) ).fromVertex(), point_20_10_idx );
+  QCOMPARE( graph->edge( resultTree.at( point_20_10_idx ) ).fromVertex(), startVertexIdx );
+
+  // cost limit
+  QgsGraphAnalyzer::dijkstra( &compact, startVertexIdx, 0, &resultTree, &resultCost, -1, 7.0 );
+  QCOMPARE( resultCost.at( startVertexIdx ), 0.0 );
+  QCOMPARE( resultCost.at( point_20_10_idx ), 4.0 );
+  QCOMPARE( resultCost.at( point_10_10_idx ), 6.0 );
+  QCOMPARE( resultCost.at( point_10_0_idx ), 7.0 );
+  QCOMPARE( resultTree.at( point_0_0_idx ), -1 );
+  QCOMPARE( resultTree.at( point_10_20_idx ), -1 );
+  QVERIFY( std::isinf( resultCost.at( point_0_0_idx ) ) );
+
+  // invalid strategy, nothing reachable
+  QgsGraphAnalyzer::dijkstra( &compact, startVertexIdx, 5, &resultTree, &resultCost );
+  QCOMPARE( resultCost.at( startVertexIdx ), 0.0 );
+  QCOMPARE( resultTree.at( point_20_10_idx ), -1 );
+}
+
+void TestQgsNetworkAnalysis::contractionHierarchy()
+{
+  std::unique_ptr<QgsVectorLayer> network = buildNetwork();
+  QgsFeature ff( 0 );
+  QgsFeatureList flist;
+  ff.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "LineString(10 10, 20 10 )" ) ) );
+  ff.setAttributes( QgsAttributes() << 2 );
+  flist << ff;
+  ff.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "LineString(10 20, 10 10 )" ) ) );
+  ff.setAttributes( QgsAttributes() << 3 );
+  flist << ff;
+  ff.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "LineString(20 -10, 20 10 )" ) ) );
+  ff.setAttributes( QgsAttributes() << 4 );
+  flist << ff;
+  ff.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "LineString(0 0, 0 20, 10 20 )" ) ) );
+  ff.setAttributes( QgsAttributes() << 7 );
+  flist << ff;
+  network->dataProvider()->addFeatures( flist );
+
+  // forward only, so that costs are not symmetric
+  std::unique_ptr< QgsVectorLayerDirector > director = qgis::make_unique< QgsVectorLayerDirector > ( network.get(),
+      -1, QString(), QString(), QString(), QgsVectorLayerDirector::DirectionForward );
+  std::unique_ptr< QgsNetworkStrategy > strategy = qgis::make_unique< TestNetworkStrategy >();
+  director->addStrategy( strategy.release() );
+  std::unique_ptr< QgsGraphBuilder > builder = qgis::make_unique< QgsGraphBuilder > ( network->sourceCrs(), true, 0 );
+
+  QVector<QgsPointXY > snapped;
+  director->makeGraph( builder.get(), QVector<QgsPointXY>(), snapped );
+  std::unique_ptr< QgsGraph > graph( builder->graph() );
+  QgsCompactGraph compact( *graph );
+
+  QVERIFY( !QgsContractionHierarchy().isValid() );
+  QVERIFY( !QgsContractionHierarchy( compact, 1 ).isValid() );
+
+  QgsContractionHierarchy hierarchy( compact, 0 );
+  QVERIFY( hierarchy.isValid() );
+  QCOMPARE( hierarchy.vertexCount(), graph->vertexCount() );
+
+  auto compareWithDijkstra = [&graph]( const QgsContractionHierarchy & ch )
+  {
+    for ( int from = 0; from < graph->vertexCount(); ++from )
+    {
+      QVector<double> expectedCost;
+      QgsGraphAnalyzer::dijkstra( graph.get(), from, 0, nullptr, &expectedCost );
+      for ( int to = 0; to < graph->vertexCount(); ++to )
+      {
+        QCOMPARE( ch.shortestPathCost( from, to ), expectedCost.at( to ) );
+      }
+    }
+  };
+  compareWithDijkstra( hierarchy );
+
+  QVERIFY( std::isinf( hierarchy.shortestPathCost( -1, 0 ) ) );
+  QVERIFY( std::isinf( hierarchy.shortestPathCost( 0, graph->vertexCount() ) ) );
+
+  // persist and reload
+  QTemporaryDir dir;
+  const QString path = dir.filePath( QStringLiteral( "network.qch" ) );
+  QVERIFY( hierarchy.writeToFile( path ) );
+  QgsContractionHierarchy loaded;
+  QVERIFY( loaded.readFromFile( path ) );
+  QVERIFY( loaded.isValid() );
+  QCOMPARE( loaded.vertexCount(), hierarchy.vertexCount() );
+  QCOMPARE( loaded.shortcutCount(), hierarchy.shortcutCount() );
+  QCOMPARE( loaded.graphHash(), hierarchy.graphHash() );
+  compareWithDijkstra( loaded );
+
+  // the hash identifies the graph and criterion the hierarchy was built for
+  QVERIFY( !hierarchy.graphHash().isEmpty() );
+  QCOMPARE( hierarchy.graphHash(), QgsContractionHierarchy::hashGraph( compact, 0 ) );
+  QVERIFY( QgsContractionHierarchy::hashGraph( compact, 0 ) != QgsContractionHierarchy::hashGraph( compact, 1 ) );
+  QgsGraph otherGraph = *graph;
+  otherGraph.addVertex( QgsPointXY( 0, 0 ) );
+  QVERIFY( QgsContractionHierarchy::hashGraph( QgsCompactGraph( otherGraph ), 0 ) != hierarchy.graphHash() );
+
+  QVERIFY( !loaded.readFromFile( dir.filePath( QStringLiteral( "missing.qch" ) ) ) );
+
+  // corrupt files are rejected: negative vertex count, truncated arrays
+  QFile file( path );
+  QVERIFY( file.open( QIODevice::ReadOnly ) );
+  const QByteArray content = file.readAll();
+  file.close();
+  auto writeCorrupt = [&dir]( const QByteArray & data )
+  {
+    const QString corruptPath = dir.filePath( QStringLiteral( "corrupt.qch" ) );
+    QFile corrupt( corruptPath );
+    corrupt.open( QIODevice::WriteOnly | QIODevice::Truncate );
+    corrupt.write( data );
+    return corruptPath;
+  };
+  QByteArray negativeCount = content;
+  // magic and version come first, followed by the vertex count
+  negativeCount.replace( 8, 4, QByteArray( 4, static_cast< char >( 0xff ) ) );
+  QgsContractionHierarchy corrupt;
+  QVERIFY( !corrupt.readFromFile( writeCorrupt( negativeCount ) ) );
+  QVERIFY( !corrupt.isValid() );
+  QVERIFY( !corrupt.readFromFile( writeCorrupt( content.left( content.size() - 8 ) ) ) );
+  QVERIFY( !corrupt.readFromFile( writeCorrupt( content.left( 16 ) ) ) );
+  QVERIFY( !corrupt.isValid() );
+  QVERIFY( !QgsContractionHierarchy().writeToFile( dir.filePath( QStringLiteral( "invalid.qch" ) ) ) );
+}
+
+void TestQgsNetworkAnalysis::multiThreadedBuild()
+{
+  // enough features to be processed in several chunks
+  std::unique_ptr<QgsVectorLayer> network = buildGridNetwork( 60 );
+  QVERIFY( network->featureCount() > 5000 );
+
+  QVector< QgsPointXY > additionalPoints;
+  for ( int i = 0; i < 50; ++i )
+  {
+    additionalPoints << QgsPointXY( ( i * 37 ) % 60 + 0.3, ( i * 11 ) % 60 + 0.2 );
+  }
+  // duplicate point, which must snap to the same location
+  additionalPoints << additionalPoints.at( 3 );
+
+  auto build = [&network, &additionalPoints]( bool multiThreaded, QVector< QgsPointXY > &snapped )
+  {
+    QgsVectorLayerDirector director( network.get(), -1, QString(), QString(), QString(), QgsVectorLayerDirector::DirectionBoth );
+    director.addStrategy( new QgsNetworkDistanceStrategy() );
+    director.addStrategy( new TestNetworkStrategy() );
+    director.setMultiThreaded( multiThreaded );
+    QgsGraphBuilder builder( network->sourceCrs(), true, 0.002 );
+    director.makeGraph( &builder, additionalPoints, snapped );
+    return std::unique_ptr< QgsGraph >( builder.graph() );
+  };
+
+  QgsVectorLayerDirector director( network.get(), -1, QString(), QString(), QString(), QgsVectorLayerDirector::DirectionBoth );
+  QVERIFY( !director.isMultiThreaded() );
+  director.setMultiThreaded( true );
+  QVERIFY( director.isMultiThreaded() );
+
+  QVector< QgsPointXY > serialSnapped;
+  std::unique_ptr< QgsGraph > serial = build( false, serialSnapped );
+  QVector< QgsPointXY > parallelSnapped;
+  std::unique_ptr< QgsGraph > parallel = build( true, parallelSnapped );
+
+  // graphs must be identical, including vertex and edge order
+  QCOMPARE( parallelSnapped, serialSnapped );
+  QCOMPARE( parallel->vertexCount(), serial->vertexCount() );
+  QCOMPARE( parallel->edgeCount(), serial->edgeCount() );
+  for ( int i = 0; i < serial->vertexCount(); ++i )
+  {
+    QCOMPARE( parallel->vertex( i ).point(), serial->vertex( i ).point() );
+    QCOMPARE( parallel->vertex( i ).outgoingEdges(), serial->vertex( i ).outgoingEdges() );
+    QCOMPARE( parallel->vertex( i ).incomingEdges(), serial->vertex( i ).incomingEdges() );
+  }
+  for ( int i = 0; i < serial->edgeCount(); ++i )
+  {
+    QCOMPARE( parallel->edge( i ).fromVertex(), serial->edge( i ).fromVertex() );
+    QCOMPARE( parallel->edge( i ).toVertex(), serial->edge( i ).toVertex() );
+    QCOMPARE( parallel->edge( i ).strategies(), serial->edge( i ).strategies() );
+  }
+  QCOMPARE( parallelSnapped.at( 3 ), parallelSnapped.last() );
+}
+
+void TestQgsNetworkAnalysis::benchmarkBuild_data()
+{
+  QTest::addColumn< bool >( "multiThreaded" );
+
+  QTest::newRow( "serial" ) << false;
+  QTest::newRow( "multithreaded" ) << true;
+}
+
+void TestQgsNetworkAnalysis::benchmarkBuild()
+{
+  QFETCH( bool, multiThreaded );
+
+  // small enough to run with the unit tests, use a larger grid for actual measurements
+  std::unique_ptr<QgsVectorLayer> network = buildGridNetwork( 20 );
+  QVector< QgsPointXY > additionalPoints;
+  for ( int i = 0; i < 20; ++i )
+  {
+    additionalPoints << QgsPointXY( ( i * 7 ) % 20 + 0.3, ( i * 11 ) % 20 + 0.2 );
+  }
+
+  QgsVectorLayerDirector director( network.get(), -1, QString(), QString(), QString(), QgsVectorLayerDirector::DirectionBoth );
+  director.addStrategy( new QgsNetworkDistanceStrategy() );
+  director.setMultiThreaded( multiThreaded );
+
+  QBENCHMARK
+  {
+    QgsGraphBuilder builder( network->sourceCrs(), true, 0.002 );
+    QVector< QgsPointXY > snapped;
+    director.makeGraph( &builder, additionalPoints, snapped );
+    std::unique_ptr< QgsGraph > graph( builder.graph() );
+  }
+}
 
 
 QGSTEST_MAIN( TestQgsNetworkAnalysis )
@@ -16,6 +16,7 @@
 #include "qgstest.h"
 #include "qgsalignraster.h"
 #include "qgsaspectfilter.h"
+#include "qgsninecellfilter.h"
 #include "qgsslopefilter.h"
 #include "qgshillshadefilter.h"
 #include "qgsruggednessfilter.h"
@@ -28,10 +29,39 @@
 #endif
 
 #include <QDir>
+#include <QMutex>
+#include <QSet>
+#include <QThread>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 // If true regenerate raster reference images
 const bool REGENERATE_REFERENCES = false;
 
+/**
+ * Nine cell filter which copies the central cell and records the threads it is called from.
+ */
+class TestThreadRecordingFilter : public QgsNineCellFilter
+{
+  public:
+    using QgsNineCellFilter::QgsNineCellFilter;
+
+    float processNineCellWindow( float *, float *, float *, float *, float *x22, float *, float *, float *, float * ) override
+    {
+      QMutexLocker locker( &mMutex );
+      mThreads.insert( QThread::currentThread() );
+      return *x22;
+    }
+
+    QSet< QThread * > threads() const { return mThreads; }
+
+  private:
+    QMutex mMutex;
+    QSet< QThread * > mThreads;
+};
+
 class TestNineCellFilters : public QObject
 {
     Q_OBJECT
@@ -47,6 +77,9 @@ class TestNineCellFilters : public QObject
     void testAspect();
     void testRuggedness();
     void testTotalCurvature();
+    void testSlopeParallel();
+    void testHillshadeParallel();
+    void testSubclassSerial();
 #ifdef HAVE_OPENCL
     void testHillshadeCl();
     void testSlopeCl();
@@ -60,6 +93,11 @@ class TestNineCellFilters : public QObject
 
     template <class T> void _testAlg( const QString &name, bool useOpenCl = false );
 
+    template <class T> void _testParallel( const QString &name );
+
+    //! Writes a float raster, tall enough to be split in several bands of rows, with some nodata cells
+    static bool _writeParallelInput( const QString &fileName, int xSize, int ySize, float nodata, std::vector< float > &input );
+
     static QString referenceFile( const QString &name )
     {
       return QStringLiteral( "%1/analysis/%2.tif" ).arg( TEST_DATA_DIR, name );
@@ -215,6 +253,120 @@ void TestNineCellFilters::testTotalCurvature()
   _testAlg<QgsTotalCurvatureFilter>( QStringLiteral( "totalcurvature" ) );
 }
 
+bool TestNineCellFilters::_writeParallelInput( const QString &fileName, int xSize, int ySize, float nodata, std::vector< float > &input )
+{
+  input.resize( static_cast< std::size_t >( xSize ) * ySize );
+  for ( int y = 0; y < ySize; ++y )
+  {
+    for ( int x = 0; x < xSize; ++x )
+    {
+      input[ static_cast< std::size_t >( y ) * xSize + x ] = ( x * 7 + y * 13 ) % 97 == 0 ? nodata
+          : static_cast< float >( 100 + 50 * std::sin( x * 0.05 ) * std::cos( y * 0.03 ) + ( x * y ) % 11 );
+    }
+  }
+
+  gdal::dataset_unique_ptr dataset( GDALCreate( GDALGetDriverByName( "GTiff" ), fileName.toUtf8().constData(), xSize, ySize, 1, GDT_Float32, nullptr ) );
+  if ( !dataset )
+    return false;
+  double geoTransform[6] = { 1000, 10, 0, 2000, 0, -10 };
+  GDALSetGeoTransform( dataset.get(), geoTransform );
+  GDALRasterBandH band = GDALGetRasterBand( dataset.get(), 1 );
+  GDALSetRasterNoDataValue( band, nodata );
+  return GDALRasterIO( band, GF_Write, 0, 0, xSize, ySize, input.data(), xSize, ySize, GDT_Float32, 0, 0 ) == CE_None;
+}
+
+template <class T>
+void TestNineCellFilters::_testParallel( const QString &name )
+{
+#ifdef HAVE_OPENCL
+  QgsOpenClUtils::setEnabled( false );
+#endif
+
+  const int xSize = 301;
+  const int ySize = 1100;
+  const float nodata = -9999;
+  std::vector< float > input;
+  const QString inputFile( tempFile( name + "_parallel_input" ) );
+  QVERIFY( _writeParallelInput( inputFile, xSize, ySize, nodata, input ) );
+
+  const QString outputFile( tempFile( name + "_parallel" ) );
+  T ninecellFilter( inputFile, outputFile, "GTiff" );
+  QCOMPARE( ninecellFilter.processRaster(), 0 );
+
+  std::vector< float > output( input.size() );
+  {
+    gdal::dataset_unique_ptr dataset( GDALOpen( outputFile.toUtf8().constData(), GA_ReadOnly ) );
+    QVERIFY( dataset );
+    QCOMPARE( GDALRasterIO( GDALGetRasterBand( dataset.get(), 1 ), GF_Read, 0, 0, xSize, ySize, output.data(), xSize, ySize, GDT_Float32, 0, 0 ), CE_None );
+  }
+
+  // serial computation, one window at a time, with nodata around the raster
+  const int stride = xSize + 2;
+  std::vector< float > padded( static_cast< std::size_t >( stride ) * ( ySize + 2 ), nodata );
+  for ( int y = 0; y < ySize; ++y )
+    std::copy( input.begin() + static_cast< std::size_t >( y ) * xSize, input.begin() + static_cast< std::size_t >( y + 1 ) * xSize,
+               padded.begin() + static_cast< std::size_t >( y + 1 ) * stride + 1 );
+
+  int differences = 0;
+  for ( int y = 0; y < ySize; ++y )
+  {
+    float *line1 = padded.data() + static_cast< std::size_t >( y ) * stride;
+    float *line2 = line1 + stride;
+    float *line3 = line2 + stride;
+    for ( int x = 0; x < xSize; ++x )
+    {
+      const float expected = ninecellFilter.processNineCellWindow( &line1[x], &line1[x + 1], &line1[x + 2],
+                             &line2[x], &line2[x + 1], &line2[x + 2],
+                             &line3[x], &line3[x + 1], &line3[x + 2] );
+      const float value = output[ static_cast< std::size_t >( y ) * xSize + x ];
+      // allow for contracted floating point operations in the row loops
+      if ( std::fabs( value - expected ) > 1e-5 * std::max( 1.0f, std::fabs( expected ) ) )
+        differences++;
+    }
+  }
+  QCOMPARE( differences, 0 );
+
+  QFile::remove( inputFile );
+  QFile::remove( outputFile );
+}
+
+void TestNineCellFilters::testSlopeParallel()
+{
+  _testParallel<QgsSlopeFilter>( QStringLiteral( "slope" ) );
+}
+
+void TestNineCellFilters::testHillshadeParallel()
+{
+  _testParallel<QgsHillshadeFilter>( QStringLiteral( "hillshade" ) );
+}
+
+void TestNineCellFilters::testSubclassSerial()
+{
+  const int xSize = 301;
+  const int ySize = 1100;
+  const float nodata = -9999;
+  std::vector< float > input;
+  const QString inputFile( tempFile( QStringLiteral( "subclass_input" ) ) );
+  QVERIFY( _writeParallelInput( inputFile, xSize, ySize, nodata, input ) );
+
+  // filters which are not built-in, such as filters implemented in Python, are only called from the calling thread
+  const QString outputFile( tempFile( QStringLiteral( "subclass" ) ) );
+  TestThreadRecordingFilter filter( inputFile, outputFile, QStringLiteral( "GTiff" ) );
+  QCOMPARE( filter.processRaster(), 0 );
+  QCOMPARE( filter.threads(), QSet< QThread * >() << QThread::currentThread() );
+
+  std::vector< float > output( input.size() );
+  {
+    gdal::dataset_unique_ptr dataset( GDALOpen( outputFile.toUtf8().constData(), GA_ReadOnly ) );
+    QVERIFY( dataset );
+    QCOMPARE( GDALRasterIO( GDALGetRasterBand( dataset.get(), 1 ), GF_Read, 0, 0, xSize, ySize, output.data(), xSize, ySize, GDT_Float32, 0, 0 ), CE_None );
+  }
+  QVERIFY( output == input );
+
+  QFile::remove( inputFile );
+  QFile::remove( outputFile );
+}
+
 
 QGSTEST_MAIN( TestNineCellFilters )
 
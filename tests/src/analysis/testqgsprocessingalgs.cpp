@@ -30,6 +30,9 @@
 #include "qgscategorizedsymbolrenderer.h"
 #include "qgssinglesymbolrenderer.h"
 #include "qgsmultipolygon.h"
+#include "qgscontractionhierarchy.h"
+
+#include <QTemporaryDir>
 
 class TestQgsProcessingAlgs: public QObject
 {
@@ -65,6 +68,8 @@ class TestQgsProcessingAlgs: public QObject
     void densifyGeometries_data();
     void densifyGeometries();
 
+    void odCostMatrix();
+
   private:
 
     QString mPointLayerPath;
@@ -841,5 +846,165 @@ void TestQgsProcessingAlgs::densifyGeometries()
     QVERIFY2( result.geometry().equals( expectedGeometry ), QStringLiteral( "Result: %1, Expected: %2" ).arg( result.geometry().asWkt(), expectedGeometry.asWkt() ).toUtf8().constData() );
 }
 
+void TestQgsProcessingAlgs::odCostMatrix()
+{
+  std::unique_ptr< QgsProcessingAlgorithm > alg( QgsApplication::processingRegistry()->createAlgorithmById( QStringLiteral( "native:odcostmatrix" ) ) );
+  QVERIFY( alg != nullptr );
+
+  std::unique_ptr< QgsProcessingContext > context = qgis::make_unique< QgsProcessingContext >();
+  QgsProject p;
+  context->setProject( &p );
+  QgsProcessingFeedback feedback;
+
+  // a grid of roads, plus a road which is not connected to the grid
+  QgsVectorLayer *network = new QgsVectorLayer( QStringLiteral( "LineString?crs=EPSG:32633" ), QStringLiteral( "network" ), QStringLiteral( "memory" ) );
+  QgsFeatureList roads;
+  for ( int i = 0; i < 4; ++i )
+  {
+    QgsFeature f;
+    f.setGeometry( QgsGeometry::fromPolylineXY( QgsPolylineXY() << QgsPointXY( 500000, 5000000 + i * 100 ) << QgsPointXY( 500300, 5000000 + i * 100 ) ) );
+    roads << f;
+    f.setGeometry( QgsGeometry::fromPolylineXY( QgsPolylineXY() << QgsPointXY( 500000 + i * 100, 5000000 ) << QgsPointXY( 500000 + i * 100, 5000300 ) ) );
+    roads << f;
+  }
+  QgsFeature isolated;
+  isolated.setGeometry( QgsGeometry::fromPolylineXY( QgsPolylineXY() << QgsPointXY( 505000, 5005000 ) << QgsPointXY( 505100, 5005000 ) ) );
+  roads << isolated;
+  QVERIFY( network->dataProvider()->addFeatures( roads ) );
+  p.addMapLayer( network );
+
+  auto pointLayer = [&p]( const QString & name, const QList< QgsPointXY > &points )
+  {
+    QgsVectorLayer *layer = new QgsVectorLayer( QStringLiteral( "Point?crs=EPSG:32633" ), name, QStringLiteral( "memory" ) );
+    QgsFeatureList features;
+    for ( const QgsPointXY &point : points )
+    {
+      QgsFeature f;
+      f.setGeometry( QgsGeometry::fromPointXY( point ) );
+      features << f;
+    }
+    layer->dataProvider()->addFeatures( features );
+    p.addMapLayer( layer );
+    return layer;
+  };
+  const QList< QgsPointXY > startPoints = QList< QgsPointXY >() << QgsPointXY( 500000, 5000000 ) << QgsPointXY( 500250, 5000100 ) << QgsPointXY( 500300, 5000300 );
+  const QList< QgsPointXY > endPoints = QList< QgsPointXY >() << QgsPointXY( 500100, 5000000 ) << QgsPointXY( 500000, 5000300 ) << QgsPointXY( 500150, 5000200 ) << QgsPointXY( 505050, 5005000 );
+  QgsVectorLayer *starts = pointLayer( QStringLiteral( "starts" ), startPoints );
+  QgsVectorLayer *ends = pointLayer( QStringLiteral( "ends" ), endPoints );
+
+  QVariantMap parameters;
+  parameters.insert( QStringLiteral( "INPUT" ), network->id() );
+  parameters.insert( QStringLiteral( "STRATEGY" ), 0 );
+  parameters.insert( QStringLiteral( "START_POINTS" ), starts->id() );
+  parameters.insert( QStringLiteral( "END_POINTS" ), ends->id() );
+  parameters.insert( QStringLiteral( "OUTPUT" ), QStringLiteral( "memory:" ) );
+  bool ok = false;
+  QVariantMap results = alg->run( parameters, *context, &feedback, &ok );
+  QVERIFY( ok );
+
+  auto matrixCosts = [&context]( const QVariantMap & results )
+  {
+    QHash< QPair< QgsFeatureId, QgsFeatureId >, QVariant > costs;
+    std::unique_ptr< QgsVectorLayer > matrix( qobject_cast< QgsVectorLayer * >( context->takeResultLayer( results.value( QStringLiteral( "OUTPUT" ) ).toString() ) ) );
+    if ( !matrix )
+      return costs;
+
+    QgsFeature row;
+    QgsFeatureIterator it = matrix->getFeatures();
+    while ( it.nextFeature( row ) )
+    {
+      costs.insert( qMakePair( row.attribute( QStringLiteral( "start_id" ) ).toLongLong(), row.attribute( QStringLiteral( "end_id" ) ).toLongLong() ), row.attribute( QStringLiteral( "cost" ) ) );
+    }
+    return costs;
+  };
+  const QHash< QPair< QgsFeatureId, QgsFeatureId >, QVariant > costs = matrixCosts( results );
+  QCOMPARE( costs.size(), startPoints.size() * endPoints.size() );
+
+  // every pair must cost the same as the point to point shortest path
+  std::unique_ptr< QgsProcessingAlgorithm > shortestPath( QgsApplication::processingRegistry()->createAlgorithmById( QStringLiteral( "native:shortestpathpointtopoint" ) ) );
+  QgsFeatureIterator startIt = starts->getFeatures();
+  QgsFeature start;
+  while ( startIt.nextFeature( start ) )
+  {
+    QgsFeatureIterator endIt = ends->getFeatures();
+    QgsFeature end;
+    while ( endIt.nextFeature( end ) )
+    {
+      const QVariant cost = costs.value( qMakePair( start.id(), end.id() ) );
+
+      QVariantMap pathParameters;
+      pathParameters.insert( QStringLiteral( "INPUT" ), network->id() );
+      pathParameters.insert( QStringLiteral( "STRATEGY" ), 0 );
+      pathParameters.insert( QStringLiteral( "START_POINT" ), QStringLiteral( "%1,%2 [EPSG:32633]" ).arg( start.geometry().asPoint().x(), 0, 'f', 3 ).arg( start.geometry().asPoint().y(), 0, 'f', 3 ) );
+      pathParameters.insert( QStringLiteral( "END_POINT" ), QStringLiteral( "%1,%2 [EPSG:32633]" ).arg( end.geometry().asPoint().x(), 0, 'f', 3 ).arg( end.geometry().asPoint().y(), 0, 'f', 3 ) );
+      pathParameters.insert( QStringLiteral( "OUTPUT" ), QStringLiteral( "memory:" ) );
+      bool pathOk = false;
+      QgsProcessingFeedback pathFeedback;
+      const QVariantMap pathResults = shortestPath->run( pathParameters, *context, &pathFeedback, &pathOk );
+
+      // the end point on the isolated road cannot be reached
+      if ( end.geometry().asPoint().x() > 505000 )
+      {
+        QVERIFY( !pathOk );
+        QVERIFY( cost.isNull() );
+        continue;
+      }
+
+      QVERIFY( pathOk );
+      std::unique_ptr< QgsVectorLayer > path( qobject_cast< QgsVectorLayer * >( context->takeResultLayer( pathResults.value( QStringLiteral( "OUTPUT" ) ).toString() ) ) );
+      QVERIFY( path );
+      QgsFeature pathFeature;
+      QVERIFY( path->getFeatures().nextFeature( pathFeature ) );
+      QVERIFY( !cost.isNull() );
+      QGSCOMPARENEAR( cost.toDouble(), pathFeature.attribute( QStringLiteral( "cost" ) ).toDouble(), 1e-6 );
+    }
+  }
+
+  // the routing index is saved to a file, and loaded again by a run over the same network and points
+  class InfoFeedback : public QgsProcessingFeedback
+  {
+    public:
+      void pushInfo( const QString &info ) override { messages << info; }
+      QStringList messages;
+  };
+
+  QTemporaryDir indexDir;
+  const QString indexFile = indexDir.filePath( QStringLiteral( "index.qch" ) );
+  parameters.insert( QStringLiteral( "OUTPUT_INDEX" ), indexFile );
+  results = alg->run( parameters, *context, &feedback, &ok );
+  QVERIFY( ok );
+  QCOMPARE( results.value( QStringLiteral( "OUTPUT_INDEX" ) ).toString(), indexFile );
+  QVERIFY( QFile::exists( indexFile ) );
+  QCOMPARE( matrixCosts( results ), costs );
+
+  parameters.remove( QStringLiteral( "OUTPUT_INDEX" ) );
+  parameters.insert( QStringLiteral( "INPUT_INDEX" ), indexFile );
+  InfoFeedback loadFeedback;
+  results = alg->run( parameters, *context, &loadFeedback, &ok );
+  QVERIFY( ok );
+  QCOMPARE( loadFeedback.messages.filter( QStringLiteral( "Loaded routing index" ) ).size(), 1 );
+  QVERIFY( loadFeedback.messages.filter( QStringLiteral( "Building routing index" ) ).isEmpty() );
+  QCOMPARE( matrixCosts( results ), costs );
+
+  // an index built for other points does not match the network graph, and is rebuilt
+  QgsVectorLayer *otherEnds = pointLayer( QStringLiteral( "other ends" ), endPoints.mid( 0, 2 ) << QgsPointXY( 500200, 5000150 ) );
+  const QString otherIndexFile = indexDir.filePath( QStringLiteral( "other.qch" ) );
+  parameters.insert( QStringLiteral( "END_POINTS" ), otherEnds->id() );
+  parameters.insert( QStringLiteral( "OUTPUT_INDEX" ), otherIndexFile );
+  InfoFeedback rebuildFeedback;
+  results = alg->run( parameters, *context, &rebuildFeedback, &ok );
+  QVERIFY( ok );
+  QVERIFY( rebuildFeedback.messages.filter( QStringLiteral( "Loaded routing index" ) ).isEmpty() );
+  QCOMPARE( rebuildFeedback.messages.filter( QStringLiteral( "Building routing index" ) ).size(), 1 );
+  QCOMPARE( matrixCosts( results ).size(), startPoints.size() * 3 );
+  QVERIFY( QFile::exists( otherIndexFile ) );
+
+  QgsContractionHierarchy saved;
+  QVERIFY( saved.readFromFile( indexFile ) );
+  QgsContractionHierarchy rebuilt;
+  QVERIFY( rebuilt.readFromFile( otherIndexFile ) );
+  QVERIFY( saved.graphHash() != rebuilt.graphHash() );
+}
+
 QGSTEST_MAIN( TestQgsProcessingAlgs )
 #include "testqgsprocessingalgs.moc"
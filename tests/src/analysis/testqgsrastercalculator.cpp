@@ -16,6 +16,7 @@ Email                : nyall dot dawson at gmail dot com
 
 #include "qgsrastercalculator.h"
 #include "qgsrastercalcnode.h"
+#include "qgsrastercalcprogram.h"
 #include "qgsrasterdataprovider.h"
 #include "qgsrasterlayer.h"
 #include "qgsrastermatrix.h"
@@ -50,6 +51,7 @@ class TestQgsRasterCalculator : public QObject
 
     void rasterRefOp();
     void dualOpRasterRaster(); //test dual op on raster ref and raster ref
+    void compiledProgram(); //test compiled programs against the node tree
 
     void calcWithLayers();
     void calcWithReprojectedLayers();
@@ -423,6 +425,129 @@ void TestQgsRasterCalculator::dualOpRasterRaster()
   QCOMPARE( result.data()[5], -9999.0 );
 }
 
+void TestQgsRasterCalculator::compiledProgram()
+{
+  QgsRasterBlock m1( Qgis::Float32, 3, 2 );
+  m1.setNoDataValue( -1.0 );
+  m1.setValue( 0, 0, 1.0 );
+  m1.setValue( 0, 1, 4.0 );
+  m1.setValue( 0, 2, -1.0 ); //nodata
+  m1.setValue( 1, 0, 0.0 );
+  m1.setValue( 1, 1, -2.5 );
+  m1.setValue( 1, 2, 9.0 );
+
+  QgsRasterBlock m2( Qgis::Float32, 3, 2 );
+  m2.setNoDataValue( -2.0 ); //different no data value
+  m2.setValue( 0, 0, 3.0 );
+  m2.setValue( 0, 1, -2.0 ); //nodata
+  m2.setValue( 0, 2, 5.0 );
+  m2.setValue( 1, 0, 2.0 );
+  m2.setValue( 1, 1, 0.0 );
+  m2.setValue( 1, 2, 100.0 );
+
+  QMap<QString, QgsRasterBlock *> rasterData;
+  rasterData.insert( QStringLiteral( "raster1@1" ), &m1 );
+  rasterData.insert( QStringLiteral( "raster2@1" ), &m2 );
+
+  const double nodata = -FLT_MAX;
+  const QStringList expressions
+  {
+    QStringLiteral( "\"raster1@1\"" ),
+    QStringLiteral( "\"raster1@1\" + \"raster2@1\"" ),
+    QStringLiteral( "\"raster1@1\" * 2 - \"raster2@1\" / \"raster1@1\"" ),
+    QStringLiteral( "sqrt( \"raster1@1\" ) + log10( \"raster2@1\" ) - log( \"raster1@1\" )" ),
+    QStringLiteral( "( \"raster1@1\" > 2 ) AND ( \"raster2@1\" <= 3 ) OR \"raster1@1\" = 9" ),
+    QStringLiteral( "\"raster1@1\" ^ 0.5 + 2 * 3 - \"raster2@1\" ^ -1" ),
+    QStringLiteral( "-\"raster1@1\" + sin( 1 ) * cos( \"raster2@1\" )" ),
+    QStringLiteral( "( \"raster1@1\" + 1 ) * ( \"raster2@1\" + 2 ) * ( \"raster1@1\" + \"raster2@1\" )" ),
+    QStringLiteral( "2 + 3" ),
+  };
+
+  for ( const QString &exp : expressions )
+  {
+    QString error;
+    std::unique_ptr< QgsRasterCalcNode > calcNode( QgsRasterCalcNode::parseRasterCalcString( exp, error ) );
+    QVERIFY( calcNode );
+
+    QgsRasterMatrix expected;
+    expected.setNodataValue( nodata );
+    QVERIFY( calcNode->calculate( rasterData, expected ) );
+
+    std::unique_ptr< QgsRasterCalcProgram > program = QgsRasterCalcProgram::compile( calcNode.get(), nodata );
+    QVERIFY( program );
+
+    std::vector< std::vector< double > > inputValues;
+    std::vector< const double * > inputs;
+    for ( const QString &input : program->inputs() )
+    {
+      const QgsRasterBlock *block = rasterData.value( input );
+      QVERIFY( block );
+      std::vector< double > values;
+      for ( int i = 0; i < 6; ++i )
+      {
+        bool isNoData = false;
+        const double value = block->valueAndNoData( i, isNoData );
+        values.push_back( isNoData ? nodata : value );
+      }
+      inputValues.push_back( values );
+    }
+    for ( const std::vector< double > &values : inputValues )
+      inputs.push_back( values.data() );
+
+    std::vector< double > workspace = program->createWorkspace();
+    float result[6];
+    program->evaluate( inputs.data(), workspace, result, 0, 0, 6 );
+    for ( int i = 0; i < 6; ++i )
+    {
+      const double value = expected.isNumber() ? expected.number() : expected.data()[i];
+      QCOMPARE( result[i], static_cast< float >( value ) );
+    }
+  }
+
+  // constants are folded
+  QString error;
+  std::unique_ptr< QgsRasterCalcNode > calcNode( QgsRasterCalcNode::parseRasterCalcString( QStringLiteral( "\"raster1@1\" + 2 * 3 - sqrt( 4 )" ), error ) );
+  std::unique_ptr< QgsRasterCalcProgram > program = QgsRasterCalcProgram::compile( calcNode.get(), nodata );
+  QCOMPARE( program->instructionCount(), 2 );
+  QCOMPARE( program->inputs(), QStringList() << QStringLiteral( "raster1@1" ) );
+
+  // matrices are aligned with the rows of the raster
+  double *d = new double[6];
+  d[0] = 1.0;
+  d[1] = 2.0;
+  d[2] = -1.0; //nodata
+  d[3] = 4.0;
+  d[4] = 5.0;
+  d[5] = 6.0;
+  QgsRasterMatrix m( 3, 2, d, -1.0 );
+  QgsRasterCalcNode matrixNode( QgsRasterCalcNode::opMUL, new QgsRasterCalcNode( QStringLiteral( "raster2@1" ) ),
+                                new QgsRasterCalcNode( QgsRasterCalcNode::opPLUS, new QgsRasterCalcNode( &m ), new QgsRasterCalcNode( 1.0 ) ) );
+  QgsRasterMatrix expected;
+  expected.setNodataValue( nodata );
+  QVERIFY( matrixNode.calculate( rasterData, expected ) );
+
+  program = QgsRasterCalcProgram::compile( &matrixNode, nodata );
+  QVERIFY( program );
+  std::vector< double > workspace = program->createWorkspace();
+  for ( int row = 0; row < 2; ++row )
+  {
+    double values[3];
+    for ( int column = 0; column < 3; ++column )
+    {
+      bool isNoData = false;
+      const double value = m2.valueAndNoData( row, column, isNoData );
+      values[column] = isNoData ? nodata : value;
+    }
+    const double *inputs[] = { values };
+    float result[3];
+    program->evaluate( inputs, workspace, result, row, 0, 3 );
+    for ( int column = 0; column < 3; ++column )
+    {
+      QCOMPARE( result[column], static_cast< float >( expected.data()[row * 3 + column] ) );
+    }
+  }
+}
+
 void TestQgsRasterCalculator::calcWithLayers()
 {
   QgsRasterCalculatorEntry entry1;
@@ -23,6 +23,7 @@
 #include "qgszonalstatistics.h"
 #include "qgsproject.h"
 #include "qgsvectorlayerutils.h"
+#include "qgsrasteranalysisutils.h"
 
 /**
  * \ingroup UnitTests
@@ -42,6 +43,8 @@ class TestQgsZonalStatistics : public QObject
     void testReprojection();
     void testNoData();
     void testSmallPolygons();
+    void testSinglePass();
+    void testPolygonRasterizer();
 
   private:
     QgsVectorLayer *mVectorLayer = nullptr;
@@ -343,5 +346,104 @@ void TestQgsZonalStatistics::testSmallPolygons()
   QGSCOMPARENEAR( f.attribute( "nmean" ).toDouble(), 864.285638, 0.001 );
 }
 
+void TestQgsZonalStatistics::testSinglePass()
+{
+  QString myDataPath( TEST_DATA_DIR ); //defined in CmakeLists.txt
+  QString myTestDataPath = myDataPath + "/zonalstatistics/";
+
+  // single pass method must give the same results as the per feature method, including the
+  // fallback to precise intersections for polygons smaller than a pixel
+  std::unique_ptr< QgsRasterLayer > rasterLayer = qgis::make_unique< QgsRasterLayer >( myTestDataPath + "raster.tif", QStringLiteral( "raster" ), QStringLiteral( "gdal" ) );
+  const QStringList statistics = QStringList() << QStringLiteral( "count" ) << QStringLiteral( "sum" ) << QStringLiteral( "mean" )
+                                 << QStringLiteral( "median" ) << QStringLiteral( "stdev" ) << QStringLiteral( "min" )
+                                 << QStringLiteral( "max" ) << QStringLiteral( "range" ) << QStringLiteral( "minority" )
+                                 << QStringLiteral( "majority" ) << QStringLiteral( "variety" ) << QStringLiteral( "variance" );
+
+  for ( const QString &file : QStringList() << QStringLiteral( "polys2.shp" ) << QStringLiteral( "small_polys.shp" ) )
+  {
+    std::unique_ptr< QgsVectorLayer > vectorLayer = qgis::make_unique< QgsVectorLayer >( mTempPath + file, QStringLiteral( "poly" ), QStringLiteral( "ogr" ) );
+
+    QgsZonalStatistics perFeature( vectorLayer.get(), rasterLayer.get(), QStringLiteral( "p" ), 1, QgsZonalStatistics::All );
+    QCOMPARE( perFeature.method(), QgsZonalStatistics::PerFeature );
+    QCOMPARE( perFeature.calculateStatistics( nullptr ), 0 );
+
+    QgsZonalStatistics singlePass( vectorLayer.get(), rasterLayer.get(), QStringLiteral( "s" ), 1, QgsZonalStatistics::All );
+    singlePass.setMethod( QgsZonalStatistics::SinglePass );
+    QCOMPARE( singlePass.method(), QgsZonalStatistics::SinglePass );
+    QCOMPARE( singlePass.calculateStatistics( nullptr ), 0 );
+
+    QgsFeature f;
+    QgsFeatureIterator it = vectorLayer->getFeatures();
+    while ( it.nextFeature( f ) )
+    {
+      for ( const QString &statistic : statistics )
+      {
+        const QVariant expected = f.attribute( QStringLiteral( "p" ) + statistic );
+        const QVariant value = f.attribute( QStringLiteral( "s" ) + statistic );
+        QCOMPARE( value.isNull(), expected.isNull() );
+        QGSCOMPARENEAR( value.toDouble(), expected.toDouble(), 0.000001 );
+      }
+    }
+  }
+}
+
+void TestQgsZonalStatistics::testPolygonRasterizer()
+{
+  const QgsRectangle grid( 0, 0, 4, 4 );
+
+  // hole with the same orientation as the exterior ring
+  QgsPolygonRasterizer rasterizer( QgsGeometry::fromWkt( QStringLiteral( "Polygon((0.25 0.25, 3.75 0.25, 3.75 3.75, 0.25 3.75, 0.25 0.25),(1.25 1.25, 2.75 1.25, 2.75 2.75, 1.25 2.75, 1.25 1.25))" ) ), grid, 1, 1 );
+  QVERIFY( !rasterizer.isEmpty() );
+
+  unsigned char mask[16];
+  rasterizer.rasterizeCenters( 0, 0, 4, 4, mask );
+  const unsigned char expectedMask[16] = { 1, 1, 1, 1,
+                                           1, 0, 0, 1,
+                                           1, 0, 0, 1,
+                                           1, 1, 1, 1
+                                         };
+  for ( int i = 0; i < 16; ++i )
+    QCOMPARE( mask[i], expectedMask[i] );
+
+  double coverage[16];
+  rasterizer.rasterizeCoverage( 0, 0, 4, 4, coverage );
+  const double expectedCoverage[16] = { 0.5625, 0.75, 0.75, 0.5625,
+                                        0.75, 0.4375, 0.4375, 0.75,
+                                        0.75, 0.4375, 0.4375, 0.75,
+                                        0.5625, 0.75, 0.75, 0.5625
+                                      };
+  for ( int i = 0; i < 16; ++i )
+    QGSCOMPARENEAR( coverage[i], expectedCoverage[i], 1e-12 );
+
+  // block within the grid
+  rasterizer.rasterizeCoverage( 1, 1, 2, 2, coverage );
+  for ( int i = 0; i < 4; ++i )
+    QGSCOMPARENEAR( coverage[i], 0.4375, 1e-12 );
+
+  // edges crossing pixels diagonally
+  QgsPolygonRasterizer triangle( QgsGeometry::fromWkt( QStringLiteral( "Polygon((0 0, 4 0, 0 4, 0 0))" ) ), grid, 1, 1 );
+  triangle.rasterizeCoverage( 0, 0, 4, 4, coverage );
+  for ( int row = 0; row < 4; ++row )
+  {
+    for ( int col = 0; col < 4; ++col )
+    {
+      const int diagonal = 3 - row;
+      QGSCOMPARENEAR( coverage[row * 4 + col], col < diagonal ? 1.0 : ( col == diagonal ? 0.5 : 0.0 ), 1e-12 );
+    }
+  }
+
+  // polygon larger than the grid
+  QgsPolygonRasterizer large( QgsGeometry::fromWkt( QStringLiteral( "MultiPolygon(((-5 -5, 10 -5, 10 10, -5 10, -5 -5)))" ) ), grid, 1, 1 );
+  large.rasterizeCenters( 0, 0, 4, 4, mask );
+  large.rasterizeCoverage( 0, 0, 4, 4, coverage );
+  for ( int i = 0; i < 16; ++i )
+  {
+    QCOMPARE( mask[i], static_cast< unsigned char >( 1 ) );
+    QCOMPARE( coverage[i], 1.0 );
+  }
+
+  QVERIFY( QgsPolygonRasterizer( QgsGeometry::fromWkt( QStringLiteral( "LineString(0 0, 4 4)" ) ), grid, 1, 1 ).isEmpty() );
+}
+
 QGSTEST_MAIN( TestQgsZonalStatistics )
 #include "testqgszonalstatistics.moc"
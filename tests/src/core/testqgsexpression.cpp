@@ -33,6 +33,7 @@
 #include "qgsrasterlayer.h"
 #include "qgsproject.h"
 #include "qgsexpressionnodeimpl.h"
+#include "qgsexpressionprivate.h"
 #include "qgsvectorlayerutils.h"
 
 static void _parseAndEvalExpr( int arg )
@@ -3375,6 +3376,94 @@ class TestQgsExpression: public QObject
       QCOMPARE( zustaendigkeitskataster->dataProvider()->featureCount(), 4l );
     }
 
+    void compiledEvaluation_data()
+    {
+      QTest::addColumn<QString>( "string" );
+
+      QTest::newRow( "int arithmetic" ) << "\"int\" * 3 + 2 - \"lng\" % 7";
+      QTest::newRow( "double arithmetic" ) << "\"dbl\" / 2 + \"int\" * 1.5";
+      QTest::newRow( "division by zero" ) << "\"int\" / 0";
+      QTest::newRow( "mod by zero" ) << "\"int\" % 0";
+      QTest::newRow( "int division" ) << "\"dbl\" // 2";
+      QTest::newRow( "power" ) << "\"int\" ^ 2";
+      QTest::newRow( "comparison" ) << "\"int\" > 3 AND \"dbl\" <= 4.5";
+      QTest::newRow( "comparison or" ) << "\"int\" = 3 OR \"lng\" <> 4";
+      QTest::newRow( "is" ) << "\"dbl\" IS 4.5";
+      QTest::newRow( "is not" ) << "\"int\" IS NOT 5";
+      QTest::newRow( "null arithmetic" ) << "\"nul\" + 1";
+      QTest::newRow( "null logic" ) << "\"nul\" > 1 OR \"int\" > 1";
+      QTest::newRow( "null is" ) << "\"nul\" IS NULL";
+      QTest::newRow( "unary minus int" ) << "-\"int\"";
+      QTest::newRow( "unary minus double" ) << "-\"dbl\"";
+      QTest::newRow( "not" ) << "NOT \"int\"";
+      QTest::newRow( "string concat" ) << "\"str\" || '-' || \"int\"";
+      QTest::newRow( "string plus" ) << "\"str\" + 'x'";
+      QTest::newRow( "string compare" ) << "\"str\" = 'abc'";
+      QTest::newRow( "string number" ) << "'5' + \"int\"";
+      QTest::newRow( "like" ) << "\"str\" LIKE 'a%'";
+      QTest::newRow( "constant folding" ) << "\"int\" + (2 * 3 + 4)";
+      QTest::newRow( "function" ) << "abs(\"int\" - 10) + length(\"str\")";
+      QTest::newRow( "case" ) << "CASE WHEN \"int\" > 10 THEN 'big' WHEN \"int\" > 2 THEN \"str\" ELSE \"int\" END";
+      QTest::newRow( "case no else" ) << "CASE WHEN \"int\" > 10 THEN 1 END";
+      QTest::newRow( "case error" ) << "CASE WHEN \"str\" THEN 1 ELSE 2 END";
+      QTest::newRow( "error" ) << "\"str\" * 2";
+      QTest::newRow( "error nested" ) << "(\"str\" * 2) + 1";
+      QTest::newRow( "in" ) << "\"int\" IN (1, 2, 3) AND \"dbl\" > 1";
+      QTest::newRow( "missing column" ) << "\"int\" + \"missing\"";
+      QTest::newRow( "date" ) << "to_date('2018-01-02') - to_date('2018-01-01') + \"int\"";
+    }
+
+    void compiledEvaluation()
+    {
+      QFETCH( QString, string );
+
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "int" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "lng" ), QVariant::LongLong ) );
+      fields.append( QgsField( QStringLiteral( "dbl" ), QVariant::Double ) );
+      fields.append( QgsField( QStringLiteral( "str" ), QVariant::String ) );
+      fields.append( QgsField( QStringLiteral( "nul" ), QVariant::Int ) );
+
+      QgsFeature f( fields );
+      f.setAttributes( QgsAttributes() << QVariant( 3 ) << QVariant( 4LL ) << QVariant( 4.5 ) << QVariant( "abc" ) << QVariant( QVariant::Int ) );
+
+      QgsExpressionContext context;
+      context.setFields( fields );
+      context.setFeature( f );
+
+      // without a feature, column references evaluate to their name
+      QgsExpressionContext noFeatureContext;
+      noFeatureContext.setFields( fields );
+
+      // prepared with a field which the evaluated features do not have, so that a missing
+      // attribute is read by the program instead of failing the preparation
+      QgsFields prepareFields = fields;
+      prepareFields.append( QgsField( QStringLiteral( "missing" ), QVariant::Int ) );
+      QgsExpressionContext prepareContext;
+      prepareContext.setFields( prepareFields );
+
+      QgsExpression exp( string );
+      QVERIFY( !exp.hasParserError() );
+      QVERIFY( exp.prepare( &prepareContext ) );
+      QVERIFY( exp.d->mProgram );
+      QVERIFY( exp.d->mProgram->instructionCount() > 1 );
+
+      // the prepared expression runs as a compiled program, compare it to the node tree
+      QgsExpressionNode *root = const_cast< QgsExpressionNode * >( exp.rootNode() );
+      for ( const QgsExpressionContext *c : { &context, &noFeatureContext } )
+      {
+        exp.setEvalErrorString( QString() );
+        QVariant expected = root->eval( &exp, c );
+        QString expectedError = exp.evalErrorString();
+
+        QVariant result = exp.evaluate( c );
+        QCOMPARE( result.type(), expected.type() );
+        QCOMPARE( result.isNull(), expected.isNull() );
+        QCOMPARE( result, expected );
+        QCOMPARE( exp.evalErrorString(), expectedError );
+      }
+    }
+
 };
 
 QGSTEST_MAIN( TestQgsExpression )
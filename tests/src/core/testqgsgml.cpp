@@ -79,6 +79,10 @@ class TestQgsGML : public QObject
     void testThroughOGRGeometry_urn_EPSG_4326();
     void testAccents();
     void testSameTypeameAsGeomName();
+    void testParallelParsing_data();
+    void testParallelParsing();
+    void testCoordinateParsing_data();
+    void testCoordinateParsing();
 };
 
 const QString data1( "<myns:FeatureCollection "
@@ -1210,5 +1214,155 @@ void TestQgsGML::testSameTypeameAsGeomName()
   delete features[0].first;
 }
 
+void TestQgsGML::testParallelParsing_data()
+{
+  QTest::addColumn<bool>( "featureMembers" );
+
+  QTest::newRow( "featureMember" ) << false;
+  QTest::newRow( "featureMembers" ) << true;
+}
+
+void TestQgsGML::testParallelParsing()
+{
+  QFETCH( bool, featureMembers );
+
+  // large enough to be split in several chunks, with the srs only known from the geometries
+  QByteArray data( "<?xml version='1.0' encoding='UTF-8'?>"
+                   "<myns:FeatureCollection "
+                   "xmlns:myns='http://myns' "
+                   "xmlns:gml='http://www.opengis.net/gml'>"
+                   "<!-- <gml:featureMember> -->"
+                   "<gml:boundedBy><gml:null>unknown</gml:null></gml:boundedBy>" );
+  if ( featureMembers )
+    data += "<gml:featureMembers>";
+  const int featureCount = 50000;
+  for ( int i = 0; i < featureCount; i++ )
+  {
+    if ( !featureMembers )
+      data += "<gml:featureMember>";
+    data += QStringLiteral( "<myns:mytypename gml:id='mytypename.%1'>"
+                            "<myns:intfield>%1</myns:intfield>"
+                            "<myns:strfield><![CDATA[</gml:featureMember> > %1]]></myns:strfield>"
+                            "<myns:mygeom>"
+                            "<gml:LineString srsName='urn:ogc:def:crs:EPSG::4326'>"
+                            "<gml:posList>%2 1.5 %3 -2.25e-3</gml:posList>"
+                            "</gml:LineString>"
+                            "</myns:mygeom>"
+                            "</myns:mytypename>" ).arg( i ).arg( i * 0.1, 0, 'f', 1 ).arg( i ).toUtf8();
+    if ( !featureMembers )
+      data += "</gml:featureMember>\n";
+  }
+  if ( featureMembers )
+    data += "</gml:featureMembers>";
+  data += "</myns:FeatureCollection>";
+
+  QgsFields fields;
+  fields.append( QgsField( QStringLiteral( "intfield" ), QVariant::Int, QStringLiteral( "int" ) ) );
+  fields.append( QgsField( QStringLiteral( "strfield" ), QVariant::String, QStringLiteral( "string" ) ) );
+  QgsGmlStreamingParser gmlParser( QStringLiteral( "mytypename" ), QStringLiteral( "mygeom" ), fields );
+  gmlParser.setMaximumThreads( 4 );
+
+  // odd sized pieces, to split elements and markup between calls
+  QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> features;
+  const int pieceSize = 77777;
+  for ( int pos = 0; pos < data.size(); pos += pieceSize )
+  {
+    QString errorMsg;
+    QVERIFY( gmlParser.processData( data.mid( pos, pieceSize ), pos + pieceSize >= data.size(), errorMsg ) );
+    features += gmlParser.getAndStealReadyFeatures();
+  }
+  QCOMPARE( gmlParser.getEPSGCode(), 4326 );
+  QCOMPARE( gmlParser.srsName(), QString( "urn:ogc:def:crs:EPSG::4326" ) );
+  QCOMPARE( gmlParser.wkbType(), QgsWkbTypes::LineString );
+
+  QCOMPARE( features.size(), featureCount );
+  for ( int i = 0; i < featureCount; i++ )
+  {
+    QgsFeature *feature = features[i].first;
+    QCOMPARE( feature->id(), static_cast< QgsFeatureId >( i ) );
+    QCOMPARE( features[i].second, QStringLiteral( "mytypename.%1" ).arg( i ) );
+    QCOMPARE( feature->attribute( 0 ), QVariant( i ) );
+    QCOMPARE( feature->attribute( 1 ), QVariant( QStringLiteral( "</gml:featureMember> > %1" ).arg( i ) ) );
+    // axis order of EPSG:4326
+    QCOMPARE( feature->geometry().asPolyline(), QgsPolylineXY() << QgsPointXY( 1.5, QString::number( i * 0.1, 'f', 1 ).toDouble() ) << QgsPointXY( -2.25e-3, i ) );
+    delete feature;
+  }
+}
+
+void TestQgsGML::testCoordinateParsing_data()
+{
+  QTest::addColumn<QString>( "x" );
+  QTest::addColumn<QString>( "y" );
+
+  QTest::newRow( "integers" ) << "10" << "-20";
+  QTest::newRow( "decimals" ) << "4.35" << "-0.000123";
+  QTest::newRow( "zeros" ) << "0" << "-0.0";
+  QTest::newRow( "exponents" ) << "1.5e10" << "1.5E+22";
+  QTest::newRow( "negative exponents" ) << "123e-22" << "-1e-5";
+  QTest::newRow( "large exponents" ) << "1e23" << "2.2250738585072014e-308";
+  QTest::newRow( "15 digits" ) << "123456789012345" << "0.123456789012345";
+  QTest::newRow( "more than 15 digits" ) << "9007199254740993" << "0.1234567890123456789";
+  QTest::newRow( "signs" ) << "+1.5" << "-1.5";
+  QTest::newRow( "leading zeros" ) << "007" << "-00.5";
+  QTest::newRow( "missing digits" ) << ".5" << "5.";
+  QTest::newRow( "garbage x" ) << "1.5abc" << "2";
+  QTest::newRow( "garbage y" ) << "1" << "abc";
+  QTest::newRow( "empty exponent" ) << "1e" << "2";
+  QTest::newRow( "double sign" ) << "--1" << "2";
+  QTest::newRow( "two points" ) << "1.2.3" << "2";
+  QTest::newRow( "overflow" ) << "1e400" << "2";
+}
+
+void TestQgsGML::testCoordinateParsing()
+{
+  QFETCH( QString, x );
+  QFETCH( QString, y );
+
+  bool xOk = false;
+  bool yOk = false;
+  const double expectedX = x.toDouble( &xOk );
+  const double expectedY = y.toDouble( &yOk );
+
+  // invalid tuples are skipped
+  QgsPolylineXY expected;
+  expected << QgsPointXY( 0, 0 );
+  if ( xOk && yOk )
+    expected << QgsPointXY( expectedX, expectedY );
+  expected << QgsPointXY( 1, 1 );
+
+  const QStringList coordinates = QStringList() << QStringLiteral( "<gml:coordinates>0,0 %1,%2 1,1</gml:coordinates>" ).arg( x, y )
+                                  << QStringLiteral( "<gml:posList>0 0 %1 %2 1 1</gml:posList>" ).arg( x, y );
+  for ( const QString &coordinate : coordinates )
+  {
+    QgsFields fields;
+    QgsGmlStreamingParser gmlParser( QStringLiteral( "mytypename" ), QStringLiteral( "mygeom" ), fields );
+    QCOMPARE( gmlParser.processData( QStringLiteral( "<myns:FeatureCollection "
+                                     "xmlns:myns='http://myns' "
+                                     "xmlns:gml='http://www.opengis.net/gml'>"
+                                     "<gml:featureMember>"
+                                     "<myns:mytypename fid='mytypename.1'>"
+                                     "<myns:mygeom>"
+                                     "<gml:LineString srsName='EPSG:27700'>"
+                                     "%1"
+                                     "</gml:LineString>"
+                                     "</myns:mygeom>"
+                                     "</myns:mytypename>"
+                                     "</gml:featureMember>"
+                                     "</myns:FeatureCollection>" ).arg( coordinate ).toUtf8(), true ), true );
+    QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> features = gmlParser.getAndStealReadyFeatures();
+    QCOMPARE( features.size(), 1 );
+    const QgsPolylineXY line = features[0].first->geometry().asPolyline();
+    delete features[0].first;
+
+    QCOMPARE( line.size(), expected.size() );
+    for ( int i = 0; i < line.size(); ++i )
+    {
+      // exact comparison, QCOMPARE on doubles is fuzzy
+      QVERIFY2( line[i].x() == expected[i].x() && line[i].y() == expected[i].y(),
+                QStringLiteral( "%1: got %2, expected %3" ).arg( coordinate, line[i].toString( 17 ), expected[i].toString( 17 ) ).toUtf8().constData() );
+    }
+  }
+}
+
 QGSTEST_MAIN( TestQgsGML )
 #include "testqgsgml.moc"
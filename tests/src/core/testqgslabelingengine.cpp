@@ -19,6 +19,7 @@
 #include <qgslabelingengine.h>
 #include <qgsproject.h>
 #include <qgsmaprenderersequentialjob.h>
+#include <qgsmaprendererparalleljob.h>
 #include <qgsreadwritecontext.h>
 #include <qgsrulebasedlabeling.h>
 #include <qgsvectorlayer.h>
@@ -42,6 +43,7 @@ class TestQgsLabelingEngine : public QObject
     void cleanup();// will be called after every testfunction.
     void testEngineSettings();
     void testBasic();
+    void testParallelJob();
     void testDiagrams();
     void testRuleBased();
     void zOrder(); //test that labels are stacked correctly
@@ -54,6 +56,7 @@ class TestQgsLabelingEngine : public QObject
     void testParallelLabelSmallFeature();
     void testLabelBoundary();
     void testLabelBlockingRegion();
+    void testSolveConnectedComponents();
 
   private:
     QgsVectorLayer *vl = nullptr;
@@ -198,6 +201,52 @@ void TestQgsLabelingEngine::testBasic()
   QVERIFY( imageCheck( "labeling_basic", img2, 20 ) );
 }
 
+void TestQgsLabelingEngine::testParallelJob()
+{
+  QSize size( 640, 480 );
+  QgsMapSettings mapSettings;
+  mapSettings.setOutputSize( size );
+  mapSettings.setExtent( vl->extent() );
+  mapSettings.setLayers( QList<QgsMapLayer *>() << vl );
+  mapSettings.setOutputDpi( 96 );
+
+  QgsPalLayerSettings settings;
+  settings.fieldName = QStringLiteral( "Class" );
+  setDefaultLabelParams( settings );
+
+  vl->setLabeling( new QgsVectorLayerSimpleLabeling( settings ) );
+  vl->setLabelsEnabled( true );
+
+  // label candidates are generated as soon as the layer is rendered, result must match the sequential job
+  QgsMapRendererParallelJob job( mapSettings );
+  job.start();
+  job.waitForFinished();
+  QImage img = job.renderedImage();
+
+  vl->setLabeling( nullptr );
+
+  QVERIFY( imageCheck( "labeling_basic", img, 20 ) );
+
+  // the engine must produce the same layout when a layer is processed before run()
+  QgsMapRendererSequentialJob job2( mapSettings );
+  job2.start();
+  job2.waitForFinished();
+  QImage img2 = job2.renderedImage();
+
+  QPainter p( &img2 );
+  QgsRenderContext context = QgsRenderContext::fromMapSettings( mapSettings );
+  context.setPainter( &p );
+
+  QgsLabelingEngine engine;
+  engine.setMapSettings( mapSettings );
+  engine.addProvider( new QgsVectorLayerLabelProvider( vl, QString(), true, &settings ) );
+  engine.prepare( context );
+  engine.processLayer( vl->id(), context );
+  engine.run( context );
+  p.end();
+
+  QVERIFY( imageCheck( "labeling_basic", img2, 20 ) );
+}
 
 void TestQgsLabelingEngine::testDiagrams()
 {
@@ -959,5 +1008,69 @@ void TestQgsLabelingEngine::testLabelBlockingRegion()
 
 }
 
+void TestQgsLabelingEngine::testSolveConnectedComponents()
+{
+  // isolated points and a dense cluster of points are independent parts of the labeling problem
+  QgsPalLayerSettings settings;
+  setDefaultLabelParams( settings );
+  settings.fieldName = QStringLiteral( "'label'" );
+  settings.isExpression = true;
+  settings.placement = QgsPalLayerSettings::OverPoint;
+
+  std::unique_ptr< QgsVectorLayer> vl2( new QgsVectorLayer( QStringLiteral( "Point?crs=epsg:3857&field=id:integer" ), QStringLiteral( "vl" ), QStringLiteral( "memory" ) ) );
+  vl2->setRenderer( new QgsNullSymbolRenderer() );
+
+  QgsFeature f( vl2->fields(), 1 );
+  for ( int i = 0; i < 5; ++i )
+  {
+    f.setAttributes( QgsAttributes() << i );
+    f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( i * 2000, 0 ) ) );
+    vl2->dataProvider()->addFeature( f );
+  }
+  for ( int i = 0; i < 20; ++i )
+  {
+    f.setAttributes( QgsAttributes() << 100 + i );
+    f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( 4000 + ( i % 5 ) * 10, 5000 + ( i / 5 ) * 10 ) ) );
+    vl2->dataProvider()->addFeature( f );
+  }
+
+  vl2->setLabeling( new QgsVectorLayerSimpleLabeling( settings ) );
+  vl2->setLabelsEnabled( true );
+
+  QgsMapSettings mapSettings;
+  mapSettings.setDestinationCrs( vl2->crs() );
+  mapSettings.setOutputSize( QSize( 800, 600 ) );
+  mapSettings.setExtent( QgsRectangle( -1000, -1000, 9000, 6000 ) );
+  mapSettings.setLayers( QList<QgsMapLayer *>() << vl2.get() );
+  mapSettings.setOutputDpi( 96 );
+
+  QgsMapRendererParallelJob job( mapSettings );
+  job.start();
+  job.waitForFinished();
+  std::unique_ptr< QgsLabelingResults > results( job.takeLabelingResults() );
+
+  // all isolated points are labeled, only some of the clustered ones
+  for ( int i = 0; i < 5; ++i )
+  {
+    QCOMPARE( results->labelsWithinRect( QgsRectangle( i * 2000 - 500, -500, i * 2000 + 500, 500 ) ).count(), 1 );
+  }
+  const QList< QgsLabelPosition > clusterLabels = results->labelsWithinRect( QgsRectangle( 3000, 4000, 5000, 6000 ) );
+  QVERIFY( !clusterLabels.isEmpty() );
+  QVERIFY( clusterLabels.count() < 20 );
+
+  // components are solved concurrently, but the layout must not change between runs
+  QgsMapRendererParallelJob job2( mapSettings );
+  job2.start();
+  job2.waitForFinished();
+  std::unique_ptr< QgsLabelingResults > results2( job2.takeLabelingResults() );
+  const QList< QgsLabelPosition > clusterLabels2 = results2->labelsWithinRect( QgsRectangle( 3000, 4000, 5000, 6000 ) );
+  QCOMPARE( clusterLabels2.count(), clusterLabels.count() );
+  QSet< int > placedIds;
+  for ( const QgsLabelPosition &label : clusterLabels )
+    placedIds << label.featureId;
+  for ( const QgsLabelPosition &label : clusterLabels2 )
+    QVERIFY( placedIds.contains( label.featureId ) );
+}
+
 QGSTEST_MAIN( TestQgsLabelingEngine )
 #include "testqgslabelingengine.moc"
@@ -20,6 +20,8 @@
 #include <QTime>
 #include <QApplication>
 #include <QDesktopServices>
+#include <QTemporaryDir>
+#include <QThreadPool>
 
 //qgis includes...
 #include <qgsvectorlayer.h> //defines QgsFieldMap
@@ -32,6 +34,12 @@
 #include <qgsfield.h>
 #include <qgis.h> //defines GEOWkt
 #include "qgsmaprenderersequentialjob.h"
+#include "qgsmaprendererparalleljob.h"
+#include "qgsproperty.h"
+#include "qgssinglesymbolrenderer.h"
+#include "qgssymbol.h"
+#include "qgssymbollayer.h"
+#include "qgsvectordataprovider.h"
 #include <qgsmaplayer.h>
 #include <qgsreadwritecontext.h>
 #include <qgsvectorlayer.h>
@@ -76,6 +84,10 @@ class TestQgsMapRendererJob : public QObject
     void testFourAdjacentTiles_data();
     void testFourAdjacentTiles();
 
+    //! Tests that rendering a layer split into parallel tiles gives the same image as rendering it in one piece
+    void testTiledLayerRendering_data();
+    void testTiledLayerRendering();
+
   private:
     QString mEncoding;
     QgsVectorFileWriter::WriterError mError =  QgsVectorFileWriter::NoError ;
@@ -331,7 +343,152 @@ void TestQgsMapRendererJob::testFourAdjacentTiles()
 }
 
 
-QGSTEST_MAIN( TestQgsMapRendererJob )
-#include "testqgsmaprendererjob.moc"
+void TestQgsMapRendererJob::testTiledLayerRendering_data()
+{
+  QTest::addColumn<QString>( "geometryType" );
+  QTest::addColumn<bool>( "colored" );
+
+  QTest::newRow( "points" ) << QStringLiteral( "Point" ) << false;
+  QTest::newRow( "lines" ) << QStringLiteral( "LineString" ) << false;
+  QTest::newRow( "polygons" ) << QStringLiteral( "Polygon" ) << false;
+  // L-shaped polygons, whose bounding box center is outside of the polygon
+  QTest::newRow( "concave polygons" ) << QStringLiteral( "ConcavePolygon" ) << false;
+  // overlapping features with different colors, so that the order in which they are drawn matters
+  QTest::newRow( "colored points" ) << QStringLiteral( "Point" ) << true;
+  QTest::newRow( "colored lines" ) << QStringLiteral( "LineString" ) << true;
+  QTest::newRow( "colored polygons" ) << QStringLiteral( "Polygon" ) << true;
+}
+
+void TestQgsMapRendererJob::testTiledLayerRendering()
+{
+  QFETCH( QString, geometryType );
+  QFETCH( bool, colored );
+
+  // enough features to be considered worth splitting, with symbols and geometries crossing the tile boundaries
+  const QString layerType = geometryType == QLatin1String( "ConcavePolygon" ) ? QStringLiteral( "Polygon" ) : geometryType;
+  std::unique_ptr< QgsVectorLayer > memoryLayer = qgis::make_unique< QgsVectorLayer >( QStringLiteral( "%1?crs=epsg:4326" ).arg( layerType ), QStringLiteral( "tiled" ), QStringLiteral( "memory" ) );
+  QgsFeatureList features;
+  for ( int x = 0; x < 100; ++x )
+  {
+    for ( int y = 0; y < 60; ++y )
+    {
+      const double x0 = x + ( y % 3 ) * 0.25;
+      const double y0 = y + ( x % 4 ) * 0.2;
+      QgsFeature f;
+      if ( geometryType == QLatin1String( "Point" ) )
+      {
+        f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( x0, y0 ) ) );
+      }
+      else if ( geometryType == QLatin1String( "LineString" ) )
+      {
+        // long diagonal lines, most of them crossing at least one tile boundary
+        if ( ( x + y ) % 5 )
+          continue;
+        f.setGeometry( QgsGeometry::fromPolylineXY( QgsPolylineXY() << QgsPointXY( x0, y0 ) << QgsPointXY( x0 + 17, y0 + 9 ) << QgsPointXY( x0 + 31, y0 - 4 ) ) );
+      }
+      else if ( geometryType == QLatin1String( "ConcavePolygon" ) )
+      {
+        // thin L shapes spanning several tiles
+        if ( ( x + y ) % 5 )
+          continue;
+        f.setGeometry( QgsGeometry::fromPolygonXY( QgsPolygonXY() << ( QgsPolylineXY() << QgsPointXY( x0, y0 ) << QgsPointXY( x0 + 20, y0 )
+                       << QgsPointXY( x0 + 20, y0 + 0.6 ) << QgsPointXY( x0 + 0.6, y0 + 0.6 ) << QgsPointXY( x0 + 0.6, y0 + 12 )
+                       << QgsPointXY( x0, y0 + 12 ) << QgsPointXY( x0, y0 ) ) ) );
+      }
+      else
+      {
+        // rectangles spanning several map units, so that many of them cross the tile boundaries
+        if ( ( x + y ) % 5 )
+          continue;
+        f.setGeometry( QgsGeometry::fromRect( QgsRectangle( x0 - 3.5, y0 - 0.3, x0 + 3.5, y0 + 0.3 ) ) );
+      }
+      features << f;
+    }
+  }
+  QVERIFY( memoryLayer->dataProvider()->addFeatures( features ) );
+
+  // OGR only returns the features whose geometry intersects the requested extent
+  QTemporaryDir tempDir;
+  const QString fileName = tempDir.filePath( QStringLiteral( "tiled.gpkg" ) );
+  QCOMPARE( QgsVectorFileWriter::writeAsVectorFormat( memoryLayer.get(), fileName, QStringLiteral( "UTF-8" ), memoryLayer->crs(), QStringLiteral( "GPKG" ) ), QgsVectorFileWriter::NoError );
+  std::unique_ptr< QgsVectorLayer > layer = qgis::make_unique< QgsVectorLayer >( fileName, QStringLiteral( "tiled" ), QStringLiteral( "ogr" ) );
+  QVERIFY( layer->isValid() );
+
+  QgsStringMap props;
+  QgsSymbol *symbol = nullptr;
+  if ( geometryType == QLatin1String( "Point" ) )
+  {
+    props.insert( QStringLiteral( "name" ), QStringLiteral( "circle" ) );
+    props.insert( QStringLiteral( "color" ), QStringLiteral( "200,50,50,255" ) );
+    props.insert( QStringLiteral( "outline_style" ), QStringLiteral( "no" ) );
+    props.insert( QStringLiteral( "size" ), QStringLiteral( "3" ) );
+    symbol = QgsMarkerSymbol::createSimple( props );
+  }
+  else if ( geometryType == QLatin1String( "LineString" ) )
+  {
+    props.insert( QStringLiteral( "line_color" ), QStringLiteral( "200,50,50,255" ) );
+    props.insert( QStringLiteral( "line_width" ), QStringLiteral( "0.8" ) );
+    symbol = QgsLineSymbol::createSimple( props );
+  }
+  else
+  {
+    props.insert( QStringLiteral( "color" ), QStringLiteral( "200,50,50,255" ) );
+    props.insert( QStringLiteral( "outline_style" ), QStringLiteral( "no" ) );
+    symbol = QgsFillSymbol::createSimple( props );
+  }
+  if ( colored )
+  {
+    const QgsProperty color = QgsProperty::fromExpression( QStringLiteral( "color_rgba( ( $id * 67 ) % 256, ( $id * 131 ) % 256, ( $id * 29 ) % 256, 180 )" ) );
+    symbol->symbolLayer( 0 )->setDataDefinedProperty( geometryType == QLatin1String( "LineString" ) ? QgsSymbolLayer::PropertyStrokeColor : QgsSymbolLayer::PropertyFillColor, color );
+  }
+  layer->setRenderer( new QgsSingleSymbolRenderer( symbol ) );
+  QVERIFY( layer->featureCount() >= 1000 );
+
+  QgsMapSettings mapSettings;
+  mapSettings.setExtent( QgsRectangle( 0, 0, 100, 60 ) );
+  mapSettings.setOutputSize( QSize( 500, 300 ) );
+  mapSettings.setOutputDpi( 96 );
+  mapSettings.setLayers( QList<QgsMapLayer *>() << layer.get() );
+  mapSettings.setFlag( QgsMapSettings::Antialiasing, true );
+
+  // tiles are only used when several threads are available
+  const int maxThreadCount = QThreadPool::globalInstance()->maxThreadCount();
+  QThreadPool::globalInstance()->setMaxThreadCount( std::max( maxThreadCount, 4 ) );
+
+  QgsMapRendererParallelJob job( mapSettings );
+  job.start();
+  job.waitForFinished();
+  const QImage expected = job.renderedImage();
+
+  mapSettings.setFlag( QgsMapSettings::RenderTiledLayers, true );
+  QgsMapRendererParallelJob tiledJob( mapSettings );
+  tiledJob.start();
+  tiledJob.waitForFinished();
+  const QImage tiled = tiledJob.renderedImage();
+
+  QThreadPool::globalInstance()->setMaxThreadCount( maxThreadCount );
+
+  QCOMPARE( job.mTileCount, 0 );
+  QVERIFY( tiledJob.mTileCount > 1 );
+  QVERIFY( tiledJob.errors().isEmpty() );
+  QCOMPARE( tiled.size(), expected.size() );
+
+  // compositing antialiased edges from several tiles may round differently
+  int mismatchCount = 0;
+  for ( int y = 0; y < expected.height(); ++y )
+  {
+    for ( int x = 0; x < expected.width(); ++x )
+    {
+      const QRgb a = expected.pixel( x, y );
+      const QRgb b = tiled.pixel( x, y );
+      if ( std::abs( qRed( a ) - qRed( b ) ) > 2 || std::abs( qGreen( a ) - qGreen( b ) ) > 2
+           || std::abs( qBlue( a ) - qBlue( b ) ) > 2 || std::abs( qAlpha( a ) - qAlpha( b ) ) > 2 )
+        mismatchCount++;
+    }
+  }
+  QCOMPARE( mismatchCount, 0 );
+}
 
 
+QGSTEST_MAIN( TestQgsMapRendererJob )
+#include "testqgsmaprendererjob.moc"
@@ -17,6 +17,7 @@
 #include <QObject>
 #include <QString>
 #include <QTemporaryFile>
+#include <memory>
 
 #include "qgsrasterlayer.h"
 #include "qgsrasterdataprovider.h"
@@ -39,9 +40,27 @@ class TestQgsRasterBlock : public QObject
 
     void testBasic();
     void testWrite();
+    void testBulkOperations_data();
+    void testBulkOperations();
+    void testComplexBulkOperations();
+
+    void benchmarkReadRow_data() { addDataTypes(); }
+    void benchmarkReadRow();
+    void benchmarkConvert_data() { addDataTypes(); }
+    void benchmarkConvert();
+    void benchmarkScaleOffset_data() { addDataTypes(); }
+    void benchmarkScaleOffset();
+    void benchmarkNoDataValues_data() { addDataTypes(); }
+    void benchmarkNoDataValues();
+    void benchmarkStatistics_data() { addDataTypes(); }
+    void benchmarkStatistics();
 
   private:
 
+    void addDataTypes();
+    //! Creates a block filled with a pattern of values, with every 7th pixel no data
+    QgsRasterBlock *createBlock( Qgis::DataType dataType, int width, int height, bool useNoDataValue );
+
     QString mTestDataDir;
     QgsRasterLayer *mpRasterLayer = nullptr;
 };
@@ -242,6 +261,246 @@ void TestQgsRasterBlock::testWrite()
   delete block;
 }
 
+void TestQgsRasterBlock::addDataTypes()
+{
+  QTest::addColumn<int>( "dataType" );
+  QTest::addColumn<bool>( "useNoDataValue" );
+
+  const QList< Qgis::DataType > types { Qgis::Byte, Qgis::UInt16, Qgis::Int16, Qgis::UInt32, Qgis::Int32, Qgis::Float32, Qgis::Float64 };
+  for ( Qgis::DataType type : types )
+  {
+    const QByteArray name = QByteArray::number( static_cast< int >( type ) );
+    QTest::newRow( QByteArray( "type " + name + " value" ).constData() ) << static_cast< int >( type ) << true;
+    QTest::newRow( QByteArray( "type " + name + " bitmap" ).constData() ) << static_cast< int >( type ) << false;
+  }
+}
+
+QgsRasterBlock *TestQgsRasterBlock::createBlock( Qgis::DataType dataType, int width, int height, bool useNoDataValue )
+{
+  QgsRasterBlock *block = new QgsRasterBlock( dataType, width, height );
+  if ( useNoDataValue )
+    block->setNoDataValue( 100 );
+
+  for ( int row = 0; row < height; ++row )
+  {
+    for ( int column = 0; column < width; ++column )
+    {
+      const qgssize index = static_cast< qgssize >( row ) * width + column;
+      if ( index % 7 == 3 )
+        block->setIsNoData( row, column );
+      else
+        block->setValue( row, column, ( index * 13 ) % 90 );
+    }
+  }
+  return block;
+}
+
+void TestQgsRasterBlock::testBulkOperations_data()
+{
+  addDataTypes();
+}
+
+void TestQgsRasterBlock::testBulkOperations()
+{
+  QFETCH( int, dataType );
+  QFETCH( bool, useNoDataValue );
+  const Qgis::DataType type = static_cast< Qgis::DataType >( dataType );
+  const int width = 37;
+  const int height = 5;
+
+  std::unique_ptr< QgsRasterBlock > block( createBlock( type, width, height, useNoDataValue ) );
+  QCOMPARE( block->hasNoDataValue(), useNoDataValue );
+
+  // readRow() matches valueAndNoData()
+  std::vector< double > values( width );
+  std::vector< quint8 > isNoData( width );
+  double expectedMin = std::numeric_limits<double>::max();
+  double expectedMax = std::numeric_limits<double>::lowest();
+  double expectedSum = 0;
+  qgssize expectedCount = 0;
+  for ( int row = 0; row < height; ++row )
+  {
+    QVERIFY( block->readRow( row, values.data(), isNoData.data() ) );
+    for ( int column = 0; column < width; ++column )
+    {
+      bool noData = false;
+      const double value = block->valueAndNoData( row, column, noData );
+      QCOMPARE( static_cast< bool >( isNoData[column] ), noData );
+      QCOMPARE( static_cast< bool >( isNoData[column] ), ( static_cast< qgssize >( row ) * width + column ) % 7 == 3 );
+      if ( !noData )
+      {
+        QCOMPARE( values[column], value );
+        expectedMin = std::min( expectedMin, value );
+        expectedMax = std::max( expectedMax, value );
+        expectedSum += value;
+        expectedCount++;
+      }
+    }
+  }
+  QVERIFY( !block->readRow( height, values.data() ) );
+
+  // statistics
+  double min = 0;
+  double max = 0;
+  double sum = 0;
+  qgssize count = 0;
+  QVERIFY( block->computeStatistics( min, max, sum, count ) );
+  QCOMPARE( min, expectedMin );
+  QCOMPARE( max, expectedMax );
+  QCOMPARE( sum, expectedSum );
+  QCOMPARE( count, expectedCount );
+
+  // scale and offset are not applied to no data
+  std::unique_ptr< QgsRasterBlock > scaled( createBlock( type, width, height, useNoDataValue ) );
+  scaled->applyScaleOffset( 2, 1 );
+  for ( int row = 0; row < height; ++row )
+  {
+    for ( int column = 0; column < width; ++column )
+    {
+      bool noData = false;
+      const double value = scaled->valueAndNoData( row, column, noData );
+      QCOMPARE( noData, block->isNoData( row, column ) );
+      if ( !noData )
+        QCOMPARE( value, block->value( row, column ) * 2 + 1 );
+    }
+  }
+
+  // user no data ranges
+  std::unique_ptr< QgsRasterBlock > ranges( createBlock( type, width, height, useNoDataValue ) );
+  ranges->applyNoDataValues( QgsRasterRangeList() << QgsRasterRange( 10, 20 ) );
+  for ( int row = 0; row < height; ++row )
+  {
+    for ( int column = 0; column < width; ++column )
+    {
+      const bool expected = block->isNoData( row, column ) || ( block->value( row, column ) >= 10 && block->value( row, column ) <= 20 );
+      QCOMPARE( ranges->isNoData( row, column ), expected );
+    }
+  }
+
+  // type conversion
+  std::unique_ptr< QgsRasterBlock > converted( createBlock( type, width, height, useNoDataValue ) );
+  QVERIFY( converted->convert( Qgis::Float64 ) );
+  QCOMPARE( converted->dataType(), Qgis::Float64 );
+  QVERIFY( converted->convert( Qgis::Int16 ) );
+  QCOMPARE( converted->dataType(), Qgis::Int16 );
+  for ( int row = 0; row < height; ++row )
+  {
+    for ( int column = 0; column < width; ++column )
+    {
+      QCOMPARE( converted->isNoData( row, column ), block->isNoData( row, column ) );
+      if ( !block->isNoData( row, column ) )
+        QCOMPARE( converted->value( row, column ), block->value( row, column ) );
+    }
+  }
+
+  // whole block no data
+  block->setIsNoData();
+  QVERIFY( !block->computeStatistics( min, max, sum, count ) );
+  QCOMPARE( count, static_cast< qgssize >( 0 ) );
+}
+
+void TestQgsRasterBlock::testComplexBulkOperations()
+{
+  // complex values cannot be read by rows, so the bulk operations must leave the block untouched
+  const int width = 5;
+  const int height = 3;
+  QgsRasterBlock block( Qgis::CFloat32, width, height );
+  QVERIFY( block.isValid() );
+  QVector< float > values( width * height * 2 );
+  for ( int i = 0; i < values.size(); ++i )
+    values[i] = i + 1;
+  const QByteArray data( reinterpret_cast< const char * >( values.constData() ), values.size() * static_cast< int >( sizeof( float ) ) );
+  block.setData( data );
+
+  std::vector< double > row( width );
+  QVERIFY( !block.readRow( 0, row.data() ) );
+
+  block.applyNoDataValues( QgsRasterRangeList() << QgsRasterRange( -1000, 1000 ) );
+  for ( int i = 0; i < width * height; ++i )
+    QVERIFY( !block.isNoData( i ) );
+
+  block.applyScaleOffset( 2, 1 );
+  QCOMPARE( block.data(), data );
+
+  double min = 0;
+  double max = 0;
+  double sum = 0;
+  qgssize count = 0;
+  QVERIFY( !block.computeStatistics( min, max, sum, count ) );
+  QCOMPARE( count, static_cast< qgssize >( 0 ) );
+}
+
+void TestQgsRasterBlock::benchmarkReadRow()
+{
+  QFETCH( int, dataType );
+  QFETCH( bool, useNoDataValue );
+  std::unique_ptr< QgsRasterBlock > block( createBlock( static_cast< Qgis::DataType >( dataType ), 1024, 1024, useNoDataValue ) );
+  std::vector< double > values( block->width() );
+  std::vector< quint8 > isNoData( block->width() );
+
+  QBENCHMARK
+  {
+    for ( int row = 0; row < block->height(); ++row )
+      block->readRow( row, values.data(), isNoData.data() );
+  }
+}
+
+void TestQgsRasterBlock::benchmarkConvert()
+{
+  QFETCH( int, dataType );
+  QFETCH( bool, useNoDataValue );
+  const Qgis::DataType type = static_cast< Qgis::DataType >( dataType );
+  std::unique_ptr< QgsRasterBlock > block( createBlock( type, 1024, 1024, useNoDataValue ) );
+  const Qgis::DataType destType = type == Qgis::Float32 ? Qgis::Float64 : Qgis::Float32;
+
+  QBENCHMARK
+  {
+    block->convert( destType );
+    block->convert( type );
+  }
+}
+
+void TestQgsRasterBlock::benchmarkScaleOffset()
+{
+  QFETCH( int, dataType );
+  QFETCH( bool, useNoDataValue );
+  std::unique_ptr< QgsRasterBlock > block( createBlock( static_cast< Qgis::DataType >( dataType ), 1024, 1024, useNoDataValue ) );
+
+  QBENCHMARK
+  {
+    block->applyScaleOffset( 1, 1 );
+  }
+}
+
+void TestQgsRasterBlock::benchmarkNoDataValues()
+{
+  QFETCH( int, dataType );
+  QFETCH( bool, useNoDataValue );
+  std::unique_ptr< QgsRasterBlock > block( createBlock( static_cast< Qgis::DataType >( dataType ), 1024, 1024, useNoDataValue ) );
+  const QgsRasterRangeList ranges = QgsRasterRangeList() << QgsRasterRange( 10, 20 );
+
+  QBENCHMARK
+  {
+    block->applyNoDataValues( ranges );
+  }
+}
+
+void TestQgsRasterBlock::benchmarkStatistics()
+{
+  QFETCH( int, dataType );
+  QFETCH( bool, useNoDataValue );
+  std::unique_ptr< QgsRasterBlock > block( createBlock( static_cast< Qgis::DataType >( dataType ), 1024, 1024, useNoDataValue ) );
+  double min = 0;
+  double max = 0;
+  double sum = 0;
+  qgssize count = 0;
+
+  QBENCHMARK
+  {
+    block->computeStatistics( min, max, sum, count );
+  }
+}
+
 QGSTEST_MAIN( TestQgsRasterBlock )
 
 #include "testqgsrasterblock.moc"
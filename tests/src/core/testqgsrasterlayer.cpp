@@ -22,6 +22,10 @@
 #include <QPainter>
 #include <QTime>
 #include <QDesktopServices>
+#include <QMutex>
+#include <QSet>
+#include <QThread>
+#include <algorithm>
 
 #include "cpl_conv.h"
 #include "gdal.h"
@@ -39,6 +43,8 @@
 #include <qgscolorramp.h>
 #include <qgscptcityarchive.h>
 #include "qgscolorrampshader.h"
+#include "qgscontrastenhancement.h"
+#include "qgscontrastenhancementfunction.h"
 #include "qgsrasterdataprovider.h"
 #include "qgsrastershader.h"
 #include "qgsrastertransparency.h"
@@ -69,6 +75,9 @@ class TestQgsRasterLayer : public QObject
     void isValid();
     void isSpatial();
     void pseudoColor();
+    void pseudoColorShadingTolerance();
+    void pseudoColorCustomShader();
+    void grayCustomContrastEnhancement();
     void colorRamp1();
     void colorRamp2();
     void colorRamp3();
@@ -123,6 +132,46 @@ class TestSignalReceiver : public QObject
     }
 };
 
+//! Color ramp shader subclass, recording the threads it is called from
+class TestThreadRecordingShader : public QgsColorRampShader
+{
+  public:
+    bool shade( double value, int *returnRedValue, int *returnGreenValue, int *returnBlueValue, int *returnAlphaValue ) const override
+    {
+      mMutex.lock();
+      threads << QThread::currentThread();
+      mMutex.unlock();
+      return QgsColorRampShader::shade( value, returnRedValue, returnGreenValue, returnBlueValue, returnAlphaValue );
+    }
+
+    mutable QSet< QThread * > threads;
+
+  private:
+    mutable QMutex mMutex;
+};
+
+//! Contrast enhancement function, recording the threads it is called from
+class TestThreadRecordingEnhancement : public QgsContrastEnhancementFunction
+{
+  public:
+    TestThreadRecordingEnhancement( Qgis::DataType dataType, double minimum, double maximum, QSet< QThread * > &threads )
+      : QgsContrastEnhancementFunction( dataType, minimum, maximum )
+      , mThreads( threads )
+    {}
+
+    int enhance( double value ) override
+    {
+      mMutex.lock();
+      mThreads << QThread::currentThread();
+      mMutex.unlock();
+      return QgsContrastEnhancementFunction::enhance( value );
+    }
+
+  private:
+    QSet< QThread * > &mThreads;
+    QMutex mMutex;
+};
+
 //runs before all tests
 void TestQgsRasterLayer::initTestCase()
 {
@@ -244,6 +293,89 @@ void TestQgsRasterLayer::pseudoColor()
   QVERIFY( render( "raster_pseudo" ) );
 }
 
+void TestQgsRasterLayer::pseudoColorShadingTolerance()
+{
+  QString fileName = mTestDataDir + "landsat-f32-b1.tif";
+  QgsRasterLayer layer( fileName, QStringLiteral( "landsat" ) );
+  QVERIFY( layer.isValid() );
+
+  QList<QgsColorRampShader::ColorRampItem> colorRampItems;
+  colorRampItems << QgsColorRampShader::ColorRampItem( 100, QColor( 0, 0, 255 ) )
+                 << QgsColorRampShader::ColorRampItem( 130, QColor( 0, 255, 128, 128 ) )
+                 << QgsColorRampShader::ColorRampItem( 160, QColor( 255, 0, 0 ) );
+  QgsColorRampShader *colorRampShader = new QgsColorRampShader();
+  colorRampShader->setColorRampType( QgsColorRampShader::Interpolated );
+  colorRampShader->setColorRampItemList( colorRampItems );
+  QgsRasterShader *rasterShader = new QgsRasterShader();
+  rasterShader->setRasterShaderFunction( colorRampShader );
+  QgsSingleBandPseudoColorRenderer renderer( layer.dataProvider(), 1, rasterShader );
+  QCOMPARE( renderer.shadingTolerance(), 0.0 );
+
+  std::unique_ptr< QgsSingleBandPseudoColorRenderer > quantized( renderer.clone() );
+  quantized->setInput( layer.dataProvider() );
+  quantized->setShadingTolerance( 2 );
+  std::unique_ptr< QgsSingleBandPseudoColorRenderer > cloned( quantized->clone() );
+  QCOMPARE( cloned->shadingTolerance(), 2.0 );
+
+  std::unique_ptr< QgsRasterBlock > exactBlock( renderer.block( 1, layer.extent(), layer.width(), layer.height() ) );
+  std::unique_ptr< QgsRasterBlock > quantizedBlock( quantized->block( 1, layer.extent(), layer.width(), layer.height() ) );
+  QVERIFY( exactBlock->isValid() );
+  QVERIFY( quantizedBlock->isValid() );
+  int maxDifference = 0;
+  for ( int row = 0; row < layer.height(); ++row )
+  {
+    for ( int column = 0; column < layer.width(); ++column )
+    {
+      const QRgb exact = exactBlock->color( row, column );
+      const QRgb color = quantizedBlock->color( row, column );
+      maxDifference = std::max( { maxDifference, std::abs( qRed( exact ) - qRed( color ) ), std::abs( qGreen( exact ) - qGreen( color ) ),
+                                  std::abs( qBlue( exact ) - qBlue( color ) ), std::abs( qAlpha( exact ) - qAlpha( color ) )
+                                } );
+    }
+  }
+  // quantized values are at most half a table step away, which keeps premultiplied components
+  // within the tolerance. With this ramp, truncating the colors does not add to the difference.
+  QVERIFY( maxDifference <= 2 );
+}
+
+void TestQgsRasterLayer::pseudoColorCustomShader()
+{
+  QString fileName = mTestDataDir + "landsat-f32-b1.tif";
+  QgsRasterLayer layer( fileName, QStringLiteral( "landsat" ) );
+  QVERIFY( layer.isValid() );
+
+  // subclasses of the color ramp shader, e.g. implemented in Python, are only called from the rendering thread
+  TestThreadRecordingShader *shader = new TestThreadRecordingShader();
+  shader->setColorRampType( QgsColorRampShader::Interpolated );
+  shader->setColorRampItemList( QList<QgsColorRampShader::ColorRampItem>() << QgsColorRampShader::ColorRampItem( 100, QColor( 0, 0, 255 ) )
+                                << QgsColorRampShader::ColorRampItem( 160, QColor( 255, 0, 0 ) ) );
+  QgsRasterShader *rasterShader = new QgsRasterShader();
+  rasterShader->setRasterShaderFunction( shader );
+  QgsSingleBandPseudoColorRenderer renderer( layer.dataProvider(), 1, rasterShader );
+  std::unique_ptr< QgsRasterBlock > block( renderer.block( 1, layer.extent(), layer.width(), layer.height() ) );
+  QVERIFY( block->isValid() );
+  QCOMPARE( shader->threads, QSet< QThread * >() << QThread::currentThread() );
+}
+
+void TestQgsRasterLayer::grayCustomContrastEnhancement()
+{
+  QString fileName = mTestDataDir + "landsat-f32-b1.tif";
+  QgsRasterLayer layer( fileName, QStringLiteral( "landsat" ) );
+  QVERIFY( layer.isValid() );
+
+  // user defined contrast enhancement functions are only called from the rendering thread
+  QSet< QThread * > threads;
+  QgsContrastEnhancement *enhancement = new QgsContrastEnhancement( Qgis::Float32 );
+  enhancement->setMinimumValue( 100, false );
+  enhancement->setMaximumValue( 160, false );
+  enhancement->setContrastEnhancementFunction( new TestThreadRecordingEnhancement( Qgis::Float32, 100, 160, threads ) );
+  QgsSingleBandGrayRenderer renderer( layer.dataProvider(), 1 );
+  renderer.setContrastEnhancement( enhancement );
+  std::unique_ptr< QgsRasterBlock > block( renderer.block( 1, layer.extent(), layer.width(), layer.height() ) );
+  QVERIFY( block->isValid() );
+  QCOMPARE( threads, QSet< QThread * >() << QThread::currentThread() );
+}
+
 void TestQgsRasterLayer::populateColorRampShader( QgsColorRampShader *colorRampShader,
     QgsColorRamp *colorRamp,
     int numberOfEntries )
@@ -0,0 +1,219 @@
+/***************************************************************************
+     testqgsrasterprojector.cpp
+     --------------------------------------
+    Date                 : October 2026
+    Copyright            : (C) 2026 by QGIS contributors
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstest.h"
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+#include "qgsapplication.h"
+#include "qgscoordinatetransform.h"
+#include "qgsrasterblock.h"
+#include "qgsrasterprojector.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+/**
+ * Raster input returning a block filled with a byte pattern which depends on the
+ * position of each byte, for any data type.
+ */
+class TestPatternRasterInput : public QgsRasterInterface
+{
+  public:
+    explicit TestPatternRasterInput( Qgis::DataType dataType )
+      : mDataType( dataType )
+    {}
+
+    QgsRasterInterface *clone() const override { return new TestPatternRasterInput( mDataType ); }
+    Qgis::DataType dataType( int ) const override { return mDataType; }
+    int bandCount() const override { return 1; }
+
+    QgsRasterBlock *block( int, const QgsRectangle &, int width, int height, QgsRasterBlockFeedback * = nullptr ) override
+    {
+      QgsRasterBlock *block = new QgsRasterBlock( mDataType, width, height );
+      char *bits = block->bits();
+      const qgssize size = static_cast< qgssize >( width ) * height * QgsRasterBlock::typeSize( mDataType );
+      for ( qgssize i = 0; i < size; ++i )
+        bits[i] = static_cast< char >( ( i * 31 + i / 7 ) & 0xff );
+      return block;
+    }
+
+  private:
+    Qgis::DataType mDataType;
+};
+
+/**
+ * \ingroup UnitTests
+ * This is a unit test for the QgsRasterProjector class.
+ */
+class TestQgsRasterProjector : public QObject
+{
+    Q_OBJECT
+  public:
+    TestQgsRasterProjector() = default;
+
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void init() {} // will be called before each testfunction is executed.
+    void cleanup() {} // will be called after every testfunction.
+
+    void cachedGrid();
+    void parallelBlock_data();
+    void parallelBlock();
+    void approximateRowOrder();
+
+  private:
+
+    //! Returns the bytes and no data flags of a block, so that blocks can be compared
+    static QByteArray blockContent( QgsRasterBlock *block );
+
+    QgsCoordinateReferenceSystem mSrcCrs;
+    QgsCoordinateReferenceSystem mDestCrs;
+    QgsRectangle mExtent;
+};
+
+void TestQgsRasterProjector::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  mSrcCrs = QgsCoordinateReferenceSystem( QStringLiteral( "EPSG:4326" ) );
+  mDestCrs = QgsCoordinateReferenceSystem( QStringLiteral( "EPSG:3857" ) );
+  mExtent = QgsRectangle( -1000000, 4000000, 3000000, 8000000 );
+}
+
+void TestQgsRasterProjector::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+QByteArray TestQgsRasterProjector::blockContent( QgsRasterBlock *block )
+{
+  QByteArray content( block->bits(), static_cast< int >( QgsRasterBlock::typeSize( block->dataType() ) * block->width() * block->height() ) );
+  for ( int row = 0; row < block->height(); ++row )
+  {
+    for ( int col = 0; col < block->width(); ++col )
+      content.append( block->isNoData( row, col ) ? '1' : '0' );
+  }
+  return content;
+}
+
+void TestQgsRasterProjector::cachedGrid()
+{
+  TestPatternRasterInput input( Qgis::Float32 );
+
+  QgsRasterProjector::clearProjectorDataCache();
+  QCOMPARE( QgsRasterProjector::projectorDataCacheSize(), 0 );
+
+  QgsRasterProjector projector;
+  projector.setInput( &input );
+  projector.setCrs( mSrcCrs, mDestCrs );
+  std::unique_ptr< QgsRasterBlock > fresh( projector.block( 1, mExtent, 300, 257 ) );
+  QVERIFY( fresh->isValid() );
+  QCOMPARE( QgsRasterProjector::projectorDataCacheSize(), 1 );
+
+  // same request from the same and from another projector, both use the cached grid
+  std::unique_ptr< QgsRasterBlock > cached( projector.block( 1, mExtent, 300, 257 ) );
+  QCOMPARE( QgsRasterProjector::projectorDataCacheSize(), 1 );
+  QCOMPARE( blockContent( cached.get() ), blockContent( fresh.get() ) );
+
+  std::unique_ptr< QgsRasterProjector > clone( projector.clone() );
+  clone->setInput( &input );
+  std::unique_ptr< QgsRasterBlock > clonedCached( clone->block( 1, mExtent, 300, 257 ) );
+  QCOMPARE( QgsRasterProjector::projectorDataCacheSize(), 1 );
+  QCOMPARE( blockContent( clonedCached.get() ), blockContent( fresh.get() ) );
+
+  // another extent or precision needs another grid
+  delete projector.block( 1, QgsRectangle( -1000000, 4000000, 2000000, 8000000 ), 300, 257 );
+  QCOMPARE( QgsRasterProjector::projectorDataCacheSize(), 2 );
+  projector.setPrecision( QgsRasterProjector::Exact );
+  delete projector.block( 1, mExtent, 300, 257 );
+  QCOMPARE( QgsRasterProjector::projectorDataCacheSize(), 3 );
+
+  QgsRasterProjector::clearProjectorDataCache();
+}
+
+void TestQgsRasterProjector::parallelBlock_data()
+{
+  QTest::addColumn<int>( "dataType" );
+  QTest::addColumn<int>( "precision" );
+
+  const QList< Qgis::DataType > types = QList< Qgis::DataType >() << Qgis::Byte << Qgis::Int16 << Qgis::Float32
+                                        << Qgis::ARGB32 << Qgis::Float64 << Qgis::CFloat64;
+  for ( Qgis::DataType type : types )
+  {
+    const QString name = QStringLiteral( "%1 bytes, type %2" ).arg( QgsRasterBlock::typeSize( type ) ).arg( static_cast< int >( type ) );
+    QTest::newRow( ( name + QStringLiteral( " approximate" ) ).toLocal8Bit().constData() ) << static_cast< int >( type ) << static_cast< int >( QgsRasterProjector::Approximate );
+    QTest::newRow( ( name + QStringLiteral( " exact" ) ).toLocal8Bit().constData() ) << static_cast< int >( type ) << static_cast< int >( QgsRasterProjector::Exact );
+  }
+}
+
+void TestQgsRasterProjector::parallelBlock()
+{
+  QFETCH( int, dataType );
+  QFETCH( int, precision );
+
+  TestPatternRasterInput input( static_cast< Qgis::DataType >( dataType ) );
+  QgsRasterProjector projector;
+  projector.setInput( &input );
+  projector.setCrs( mSrcCrs, mDestCrs );
+  projector.setPrecision( static_cast< QgsRasterProjector::Precision >( precision ) );
+
+  // rows are split in one chunk per thread of the global pool
+  const int maxThreadCount = QThreadPool::globalInstance()->maxThreadCount();
+  QThreadPool::globalInstance()->setMaxThreadCount( 1 );
+  std::unique_ptr< QgsRasterBlock > serial( projector.block( 1, mExtent, 300, 257 ) );
+  QThreadPool::globalInstance()->setMaxThreadCount( 8 );
+  std::unique_ptr< QgsRasterBlock > parallel( projector.block( 1, mExtent, 300, 257 ) );
+  QThreadPool::globalInstance()->setMaxThreadCount( maxThreadCount );
+
+  QVERIFY( serial->isValid() );
+  QVERIFY( parallel->isValid() );
+  QCOMPARE( parallel->dataType(), static_cast< Qgis::DataType >( dataType ) );
+  QCOMPARE( blockContent( parallel.get() ), blockContent( serial.get() ) );
+}
+
+void TestQgsRasterProjector::approximateRowOrder()
+{
+  const int width = 300;
+  const int height = 257;
+  TestPatternRasterInput input( Qgis::Byte );
+  const QgsCoordinateTransform inverseCt( mDestCrs, mSrcCrs, QgsCoordinateTransformContext() );
+  ProjectorData pd( mExtent, width, height, &input, inverseCt, QgsRasterProjector::Approximate );
+  QVERIFY( pd.approximate() );
+
+  std::vector< qint64 > sequential( static_cast< size_t >( width ) * height );
+  ProjectorData::ApproximateHelper helper;
+  for ( int row = 0; row < height; ++row )
+    pd.srcIndexes( row, sequential.data() + static_cast< size_t >( row ) * width, helper, inverseCt );
+
+  std::vector< int > rows( height );
+  for ( int row = 0; row < height; ++row )
+    rows[row] = row;
+  std::mt19937 generator( 42 );
+  std::shuffle( rows.begin(), rows.end(), generator );
+
+  std::vector< qint64 > shuffled( static_cast< size_t >( width ) * height );
+  ProjectorData::ApproximateHelper shuffledHelper;
+  for ( int row : rows )
+    pd.srcIndexes( row, shuffled.data() + static_cast< size_t >( row ) * width, shuffledHelper, inverseCt );
+
+  QVERIFY( sequential == shuffled );
+}
+
+QGSTEST_MAIN( TestQgsRasterProjector )
+#include "testqgsrasterprojector.moc"
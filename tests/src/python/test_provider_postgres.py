@@ -32,6 +32,8 @@ from qgis.core import (
     QgsVectorLayerExporter,
     QgsFeatureRequest,
     QgsFeature,
+    QgsFeatureBatch,
+    QgsFeatureSink,
     QgsFieldConstraints,
     QgsDataProvider,
     NULL,
@@ -169,6 +171,78 @@ class TestPyQgsPostgresProvider(unittest.TestCase, ProviderTestCase):
         }
         self.assertEqual(values, expected)
 
+    def testFetchInBatches(self):
+        """ Values read over several fetches of the cursor, transferred in binary form """
+        query = ('(SELECT i AS id, i::int2 AS small, i::int8 * 1000000000 AS big, i::float8 / 4 AS dbl, i % 2 = 0 AS even, '
+                 'DATE \'1999-12-30\' + i AS day, TIMESTAMP \'1999-12-31 23:00:00\' + i * INTERVAL \'1 hour 1 second\' AS ts, '
+                 'TIME \'00:00:00\' + i * INTERVAL \'1 second\' AS tm FROM generate_series(1, 5000) AS i)')
+        vl = QgsVectorLayer('{} table="{}" key=\'id\' sql='.format(self.dbconn, query), "testbatches", "postgres")
+        self.assertTrue(vl.isValid())
+
+        def check(request):
+            count = 0
+            for f in vl.getFeatures(request):
+                i = f['id']
+                self.assertEqual(f['small'], i)
+                self.assertEqual(f['big'], i * 1000000000)
+                self.assertEqual(f['dbl'], i / 4)
+                self.assertEqual(f['even'], i % 2 == 0)
+                self.assertEqual(f['day'], QDate(1999, 12, 30).addDays(i))
+                days, secs = divmod(23 * 3600 + i * 3601, 86400)
+                self.assertEqual(f['ts'], QDateTime(QDate(1999, 12, 31).addDays(days), QTime(0, 0, 0).addSecs(secs)))
+                self.assertEqual(f['tm'], QTime(0, 0, 0).addSecs(i))
+                count += 1
+            self.assertEqual(count, 5000)
+
+        check(QgsFeatureRequest())
+        check(QgsFeatureRequest().setSubsetOfAttributes(['id', 'small', 'big', 'dbl', 'even', 'day', 'ts', 'tm'], vl.fields()))
+
+        # stop iterating while the next features are being fetched
+        it = vl.getFeatures()
+        f = QgsFeature()
+        self.assertTrue(it.nextFeature(f))
+        self.assertTrue(it.rewind())
+        self.assertTrue(it.nextFeature(f))
+        self.assertEqual(f['id'], 1)
+        it.close()
+
+    def testNextBatch(self):
+        """ Features read in batches straight from the cursor """
+        query = ('(SELECT i AS id, i::int2 AS small, CASE WHEN i % 3 = 0 THEN NULL ELSE i::float8 / 4 END AS dbl, '
+                 '\'v\' || i AS txt, DATE \'1999-12-30\' + i AS day, '
+                 'CASE WHEN i % 5 = 0 THEN NULL ELSE ST_SetSRID(ST_MakePoint(i, -i), 4326) END AS geom '
+                 'FROM generate_series(1, 3000) AS i)')
+        vl = QgsVectorLayer('{} srid=4326 type=POINT table="{}" (geom) key=\'id\' sql='.format(self.dbconn, query), "testbatches", "postgres")
+        self.assertTrue(vl.isValid())
+
+        def check(request, batch_size):
+            expected = [f for f in vl.getFeatures(request)]
+            batch = QgsFeatureBatch()
+            it = vl.getFeatures(request)
+            got = []
+            while it.nextBatch(batch, batch_size):
+                self.assertLessEqual(len(batch), batch_size)
+                got.extend([batch.feature(i) for i in range(len(batch))])
+            self.assertEqual(len(got), len(expected))
+            self.assertEqual([f.id() for f in got], [f.id() for f in expected])
+            self.assertEqual([f.attributes() for f in got], [f.attributes() for f in expected])
+            self.assertEqual([f.geometry().asWkt() for f in got], [f.geometry().asWkt() for f in expected])
+
+        for batch_size in (1, 100, 5000):
+            check(QgsFeatureRequest(), batch_size)
+            check(QgsFeatureRequest().setFlags(QgsFeatureRequest.NoGeometry), batch_size)
+            check(QgsFeatureRequest().setSubsetOfAttributes(['dbl', 'txt'], vl.fields()), batch_size)
+            check(QgsFeatureRequest().setLimit(250), batch_size)
+
+        # typed columns
+        batch = QgsFeatureBatch()
+        it = vl.getFeatures()
+        self.assertTrue(it.nextBatch(batch, 10))
+        self.assertEqual(len(batch), 10)
+        self.assertEqual(batch.columnType(vl.fields().indexOf('id')), QgsFeatureBatch.IntegerColumn)
+        self.assertEqual(batch.columnType(vl.fields().indexOf('dbl')), QgsFeatureBatch.DoubleColumn)
+        self.assertEqual(batch.columnType(vl.fields().indexOf('txt')), QgsFeatureBatch.StringColumn)
+
     def testQueryLayers(self):
         def test_query(dbconn, query, key):
             ql = QgsVectorLayer('%s srid=4326 table="%s" (geom) key=\'%s\' sql=' % (dbconn, query.replace('"', '\\"'), key), "testgeom", "postgres")
@@ -849,6 +923,75 @@ class TestPyQgsPostgresProvider(unittest.TestCase, ProviderTestCase):
         self.assertEqual(f['f2'], 123.456)
         self.assertEqual(f['f3'], '12345678.90123456789')
 
+    def testImportInBulk(self):
+        """ Features written without returned values are copied in bulk """
+        lyr = QgsVectorLayer('point?crs=epsg:4326&field=f1:int&field=f2:string(20)', "x", "memory")
+        self.assertTrue(lyr.isValid())
+        features = []
+        for i in range(2500):
+            f = QgsFeature(lyr.fields())
+            f['f1'] = i if i % 7 else NULL
+            f['f2'] = 'a\tb\\c\nd {}'.format(i) if i % 5 else NULL
+            if i % 11:
+                f.setGeometry(QgsGeometry.fromWkt('Point({} {})'.format(i, -i)))
+            features.append(f)
+        self.assertTrue(lyr.dataProvider().addFeatures(features)[0])
+
+        self.execSQLCommand('DROP TABLE IF EXISTS qgis_test.import_bulk')
+        uri = '%s table="qgis_test"."import_bulk" (g)' % self.dbconn
+        err = QgsVectorLayerExporter.exportLayer(lyr, uri, "postgres", lyr.crs())
+        self.assertEqual(err[0], QgsVectorLayerExporter.NoError,
+                         'unexpected import error {0}'.format(err))
+
+        olyr = QgsVectorLayer(uri, "y", "postgres")
+        self.assertTrue(olyr.isValid())
+        self.assertEqual(olyr.featureCount(), 2500)
+        ids = set()
+        for f in olyr.getFeatures():
+            ids.add(f['id'])
+            i = -int(f.geometry().asPoint().y()) if f.hasGeometry() else None
+            if f['f1'] != NULL:
+                i = f['f1']
+            if i is None:
+                continue
+            self.assertEqual(f['f1'], i if i % 7 else NULL)
+            self.assertEqual(f['f2'], 'a\tb\\c\nd {}'.format(i) if i % 5 else NULL)
+            self.assertEqual(f.hasGeometry(), i % 11 != 0)
+            if f.hasGeometry():
+                self.assertEqual(f.geometry().asWkt(), 'Point ({} {})'.format(i, -i))
+        self.assertEqual(len(ids), 2500)
+
+        # a conflicting primary key makes the whole batch fail, as with INSERT
+        f1 = QgsFeature(olyr.fields())
+        f1['id'] = 1000000
+        f2 = QgsFeature(olyr.fields())
+        f2['id'] = 1
+        self.assertFalse(olyr.dataProvider().addFeatures([f1, f2], QgsFeatureSink.FastInsert)[0])
+        self.assertEqual(olyr.dataProvider().featureCount(), 2500)
+
+    def testImportInBulkDefaultsAndLists(self):
+        """ Columns missing from the features get their server defaults, lists and maps keep their values """
+        self.execSQLCommand('DROP TABLE IF EXISTS qgis_test.import_bulk_defaults')
+        self.execSQLCommand('CREATE TABLE qgis_test.import_bulk_defaults (pk serial PRIMARY KEY, name text, value text[], kv hstore, fld_default int DEFAULT 42)')
+        vl = QgsVectorLayer('%s table="qgis_test"."import_bulk_defaults" sql=' % (self.dbconn), "bulk", "postgres")
+        self.assertTrue(vl.isValid())
+
+        features = []
+        for i in range(10):
+            f = QgsFeature()
+            # no value for the last column
+            f.setAttributes([NULL, 'name {}'.format(i), ['simple', '"doubleQuote"', "'quote'", 'back\\slash', str(i)],
+                             {'simple': '1', 'doubleQuote': '"y"', 'quote': "'q'", 'backslash': '\\', 'i': str(i)}])
+            features.append(f)
+        self.assertTrue(vl.dataProvider().addFeatures(features, QgsFeatureSink.FastInsert)[0])
+
+        self.assertEqual(vl.dataProvider().featureCount(), 10)
+        for f in vl.getFeatures():
+            i = int(f['name'].split(' ')[1])
+            self.assertEqual(f['fld_default'], 42)
+            self.assertEqual(f['value'], ['simple', '"doubleQuote"', "'quote'", 'back\\slash', str(i)])
+            self.assertEqual(f['kv'], {'simple': '1', 'doubleQuote': '"y"', 'quote': "'q'", 'backslash': '\\', 'i': str(i)})
+
     # See https://issues.qgis.org/issues/15226
     def testImportKey(self):
         uri = 'point?field=f1:int'
@@ -3901,5 +3901,33 @@ http://schemas.opengis.net/ows/1.1.0/owsAll.xsd">
         qgis_feat = next(vl.getFeatures(req))
 
 
+class TestPyQgsWFSProviderMemoryCache(TestPyQgsWFSProvider):
+    """Runs the WFS provider tests with the in-process feature cache"""
+
+    @classmethod
+    def setUpClass(cls):
+        """Run before all tests"""
+        super(TestPyQgsWFSProviderMemoryCache, cls).setUpClass()
+        QgsSettings().setValue('wfs/cache_backend', 'memory')
+
+    def testSpillToFile(self):
+        """Test reading features spilled to the memory-mapped file"""
+
+        QgsSettings().setValue('wfs/cache_memory_limit', 0)
+        try:
+            vl = QgsVectorLayer(self.vl.source(), 'test', 'WFS')
+            self.assertTrue(vl.isValid())
+
+            expected = {f['pk']: (f.attributes(), f.geometry().asWkt()) for f in self.vl.getFeatures()}
+            got = {f['pk']: (f.attributes(), f.geometry().asWkt()) for f in vl.getFeatures()}
+            self.assertEqual(got, expected)
+
+            request = QgsFeatureRequest().setFilterRect(QgsRectangle(-72, 66, -68, 79))
+            self.assertEqual(sorted([f['pk'] for f in vl.getFeatures(request)]),
+                             sorted([f['pk'] for f in self.vl.getFeatures(request)]))
+        finally:
+            QgsSettings().remove('wfs/cache_memory_limit')
+
+
 if __name__ == '__main__':
     unittest.main()
@@ -35,7 +35,7 @@ import collections
 
 rebuildTests = 'REBUILD_DELIMITED_TEXT_TESTS' in os.environ
 
-from qgis.PyQt.QtCore import QCoreApplication, QUrl, QObject
+from qgis.PyQt.QtCore import QCoreApplication, QUrl, QObject, QVariant
 
 from qgis.core import (
     QgsProviderRegistry,
@@ -828,6 +828,51 @@ class TestQgsDelimitedTextProviderOther(unittest.TestCase):
         components = registry.decodeUri('delimitedtext', uri)
         self.assertEqual(components['path'], filename)
 
+    def test_044_indexed_records(self):
+        # Seeking by feature id and filtering extents use the index of record offsets
+        # built when scanning files with more than one block of records
+        (filehandle, filename) = tempfile.mkstemp(suffix='.csv')
+        if os.name == "nt":
+            filename = filename.replace("\\", "/")
+        points = {}
+        with os.fdopen(filehandle, "w") as f:
+            f.write("id,name,x,y\r\n")
+            line = 1
+            for i in range(5000):
+                line += 1
+                if i % 500 == 0:
+                    f.write("\r\n")
+                    line += 1
+                name = '"name, {}"'.format(i) if i % 3 == 0 else 'name {}'.format(i)
+                f.write("{},{},{},{}\r\n".format(i, name, i % 100, i // 100))
+                points[line] = (i, i % 100, i // 100)
+
+        url = MyUrl.fromLocalFile(filename)
+        url.addQueryItem("type", "csv")
+        url.addQueryItem("xField", "x")
+        url.addQueryItem("yField", "y")
+        layer = QgsVectorLayer(url.toString(), 'test', 'delimitedtext')
+        self.assertTrue(layer.isValid())
+        self.assertEqual(layer.featureCount(), 5000)
+        self.assertEqual(layer.fields().field('id').type(), QVariant.Int)
+
+        for fid in (4510, 2, 5006, 1500, 1502, 1503, 3):
+            if fid in points:
+                f = layer.getFeature(fid)
+                self.assertTrue(f.isValid())
+                self.assertEqual(f['id'], points[fid][0])
+                self.assertEqual(f['name'], 'name, {}'.format(f['id']) if f['id'] % 3 == 0 else 'name {}'.format(f['id']))
+            else:
+                self.assertFalse(layer.getFeature(fid).isValid())
+
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(10, 20, 15, 25))
+        ids = sorted(f['id'] for f in layer.getFeatures(request))
+        expected = sorted(i for (i, x, y) in points.values() if 10 <= x <= 15 and 20 <= y <= 25)
+        self.assertEqual(ids, expected)
+
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(150, 20, 160, 25))
+        self.assertEqual(len(list(layer.getFeatures(request))), 0)
+
 
 if __name__ == '__main__':
     unittest.main()
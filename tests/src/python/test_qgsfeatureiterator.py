@@ -23,6 +23,7 @@ from qgis.core import (QgsVectorLayer,
                        NULL,
                        QgsProject,
                        QgsVectorLayerJoinInfo,
+                       QgsFeatureBatch,
                        QgsGeometry)
 from qgis.testing import start_app, unittest
 from qgis.PyQt.QtCore import QVariant
@@ -369,6 +370,79 @@ class TestQgsFeatureIterator(unittest.TestCase):
         self.assertEqual(res, ['a', 'b'])
         layer.rollBack()
 
+    def checkBatchesMatchFeatures(self, layer, request, batch_size):
+        expected = [f for f in layer.getFeatures(request)]
+        batch = QgsFeatureBatch()
+        it = layer.getFeatures(request)
+        got = []
+        while it.nextBatch(batch, batch_size):
+            self.assertLessEqual(len(batch), batch_size)
+            got.extend([batch.feature(i) for i in range(len(batch))])
+        self.assertEqual([f.id() for f in got], [f.id() for f in expected])
+        self.assertEqual([f.attributes() for f in got], [f.attributes() for f in expected])
+        self.assertEqual([f.geometry().asWkt() for f in got], [f.geometry().asWkt() for f in expected])
+
+    def test_nextBatch(self):
+        layer = QgsVectorLayer("Point?field=fldtxt:string&field=fldint:integer&field=flddbl:double&field=flddate:date",
+                               "addfeat", "memory")
+        features = []
+        for i in range(150):
+            f = QgsFeature()
+            f.setAttributes(['test{}'.format(i), i, i / 2.0 if i % 3 else NULL, NULL])
+            if i % 5:
+                f.setGeometry(QgsGeometry.fromWkt('Point ({} {})'.format(i, -i)))
+            features.append(f)
+        self.assertTrue(layer.dataProvider().addFeatures(features))
+
+        for batch_size in (1, 7, 64, 1000):
+            self.checkBatchesMatchFeatures(layer, QgsFeatureRequest(), batch_size)
+            self.checkBatchesMatchFeatures(layer, QgsFeatureRequest().setFlags(QgsFeatureRequest.NoGeometry), batch_size)
+            self.checkBatchesMatchFeatures(layer, QgsFeatureRequest().setLimit(100), batch_size)
+            self.checkBatchesMatchFeatures(layer, QgsFeatureRequest().setFilterExpression('fldint > 30'), batch_size)
+
+        # typed values and nulls
+        batch = QgsFeatureBatch()
+        it = layer.getFeatures()
+        self.assertTrue(it.nextBatch(batch, 3))
+        self.assertEqual(batch.columnType(0), QgsFeatureBatch.StringColumn)
+        self.assertEqual(batch.columnType(1), QgsFeatureBatch.IntegerColumn)
+        self.assertEqual(batch.columnType(2), QgsFeatureBatch.DoubleColumn)
+        self.assertEqual(batch.columnType(3), QgsFeatureBatch.VariantColumn)
+        self.assertTrue(batch.isNull(0, 2))
+        self.assertFalse(batch.isNull(1, 2))
+        self.assertEqual(batch.value(1, 2), 0.5)
+        self.assertEqual(batch.value(2, 1), 2)
+        self.assertEqual(batch.value(2, 0), 'test2')
+        self.assertFalse(batch.hasGeometry(0))
+        self.assertEqual(batch.geometry(1).asWkt(), 'Point (1 -1)')
+
+        # attributes of features without fields are kept
+        batch = QgsFeatureBatch()
+        f = QgsFeature()
+        f.setAttributes(['a', 2])
+        f.setGeometry(QgsGeometry.fromWkt('Point (1 2)'))
+        batch.appendFeature(f)
+        self.assertEqual(batch.fields().count(), 2)
+        self.assertEqual(batch.columnType(0), QgsFeatureBatch.VariantColumn)
+        self.assertEqual(batch.value(0, 0), 'a')
+        self.assertEqual(batch.value(0, 1), 2)
+        self.assertEqual(batch.geometry(0).asWkt(), 'Point (1 2)')
+
+        # edited layer goes through the generic path
+        layer.startEditing()
+        layer.changeAttributeValue(1, 1, 1000)
+        f = QgsFeature(layer.fields())
+        f.setAttributes(['added', 5, 1.5, NULL])
+        self.assertTrue(layer.addFeature(f))
+        self.checkBatchesMatchFeatures(layer, QgsFeatureRequest(), 10)
+        layer.rollBack()
+
+    def test_nextBatchOgr(self):
+        myShpFile = os.path.join(TEST_DATA_DIR, 'points.shp')
+        layer = QgsVectorLayer(myShpFile, 'Points', 'ogr')
+        self.checkBatchesMatchFeatures(layer, QgsFeatureRequest(), 5)
+        self.checkBatchesMatchFeatures(layer, QgsFeatureRequest().setSubsetOfAttributes([0, 2]), 4)
+
 
 if __name__ == '__main__':
     unittest.main()
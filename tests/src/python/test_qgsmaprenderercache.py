@@ -15,12 +15,13 @@ __revision__ = '$Format:%H$'
 import qgis  # NOQA
 
 from qgis.core import (QgsMapRendererCache,
+                       QgsMapSettings,
                        QgsRectangle,
                        QgsVectorLayer,
                        QgsProject)
 from qgis.testing import start_app, unittest
-from qgis.PyQt.QtCore import QCoreApplication
-from qgis.PyQt.QtGui import QImage
+from qgis.PyQt.QtCore import QCoreApplication, QDir, QRect, QSize, QTemporaryDir
+from qgis.PyQt.QtGui import QImage, QColor
 from time import sleep
 start_app()
 
@@ -266,6 +267,166 @@ class TestQgsMapRendererCache(unittest.TestCase):
         # cache should be cleared
         self.assertFalse(cache.hasCacheImage('l1'))
 
+    def testPannedCacheImage(self):
+        """ test reusing the previous images after a pan """
+        cache = QgsMapRendererCache()
+        layer1 = QgsVectorLayer("Point?field=fldtxt:string",
+                                "layer1", "memory")
+        # 100x100 pixels at 1 map unit per pixel
+        cache.init(QgsRectangle(0, 0, 100, 100), 1000)
+        im = QImage(100, 100, QImage.Format_ARGB32_Premultiplied)
+        im.fill(QColor(255, 0, 0))
+        im.setPixelColor(60, 40, QColor(0, 0, 255))
+        cache.setCacheImage('l1', im, [layer1])
+
+        # no pan yet
+        res, region = cache.pannedCacheImage('l1')
+        self.assertTrue(res.isNull())
+
+        # pan 30 pixels to the right and 20 pixels up
+        self.assertFalse(cache.init(QgsRectangle(30, 20, 130, 120), 1000))
+        self.assertFalse(cache.hasCacheImage('l1'))
+        res, region = cache.pannedCacheImage('l1')
+        self.assertFalse(res.isNull())
+        self.assertEqual(res.size(), im.size())
+        # previous pixel (60, 40) is now at (30, 60)
+        self.assertEqual(res.pixelColor(30, 60).name(), '#0000ff')
+        # exposed area is transparent and includes a margin into the previous image
+        self.assertEqual(res.pixelColor(90, 10).alpha(), 0)
+        self.assertTrue(region.contains(QRect(70, 0, 30, 100)))
+        self.assertTrue(region.contains(QRect(0, 0, 100, 20)))
+        self.assertFalse(region.intersects(QRect(0, 52, 38, 48)))
+        self.assertEqual(res.pixelColor(37, 99).name(), '#ff0000')
+        self.assertEqual(res.pixelColor(38, 99).alpha(), 0)
+        self.assertEqual(res.pixelColor(0, 51).alpha(), 0)
+
+        # previous images are invalidated by layer repaints
+        layer1.triggerRepaint()
+        res, region = cache.pannedCacheImage('l1')
+        self.assertTrue(res.isNull())
+
+        # no reuse when the scale changes
+        cache.setCacheImage('l1', im, [layer1])
+        cache.init(QgsRectangle(0, 0, 200, 200), 2000)
+        res, region = cache.pannedCacheImage('l1')
+        self.assertTrue(res.isNull())
+
+        # or when panning by a fraction of a pixel
+        cache.setCacheImage('l1', im, [layer1])
+        cache.init(QgsRectangle(0.5, 0, 200.5, 200), 2000)
+        res, region = cache.pannedCacheImage('l1')
+        self.assertTrue(res.isNull())
+
+    def testDiskCache(self):
+        """ test storing and retrieving images from the disk tier of the cache """
+        tmp_dir = QTemporaryDir()
+        cache = QgsMapRendererCache()
+        layer = QgsVectorLayer("Point?field=fldtxt:string",
+                               "layer1", "memory")
+        settings = QgsMapSettings()
+        settings.setOutputSize(QSize(100, 100))
+        settings.setExtent(QgsRectangle(0, 0, 10, 10))
+        key = cache.diskCacheKey(layer, settings)
+        self.assertTrue(key)
+
+        # no directory set, nothing is stored
+        im = QImage(100, 100, QImage.Format_ARGB32_Premultiplied)
+        im.fill(QColor(255, 0, 0))
+        cache.setDiskCacheImage(key, im, layer)
+        cache.waitForDiskCacheWrites()
+        self.assertTrue(cache.diskCacheImage(key, layer).isNull())
+
+        cache.setDiskCacheDirectory(tmp_dir.path())
+        self.assertEqual(cache.diskCacheDirectory(), tmp_dir.path())
+        cache.setDiskCacheImage(key, im, layer)
+        cache.waitForDiskCacheWrites()
+        res = cache.diskCacheImage(key, layer)
+        self.assertFalse(res.isNull())
+        self.assertEqual(res.size(), im.size())
+        self.assertEqual(res.pixelColor(50, 50).name(), '#ff0000')
+
+        # key depends on map settings
+        settings.setExtent(QgsRectangle(0, 0, 20, 20))
+        key2 = cache.diskCacheKey(layer, settings)
+        self.assertNotEqual(key, key2)
+        self.assertTrue(cache.diskCacheImage(key2, layer).isNull())
+
+        # images survive a new cache instance using the same directory
+        cache2 = QgsMapRendererCache()
+        cache2.setDiskCacheDirectory(tmp_dir.path())
+        self.assertFalse(cache2.diskCacheImage(key, layer).isNull())
+
+        # layer repaint invalidates images
+        layer.triggerRepaint()
+        self.assertTrue(cache.diskCacheImage(key, layer).isNull())
+        self.assertFalse(QDir(tmp_dir.path()).entryList(['*.png']))
+
+        # key is stable until the style or the data changes
+        settings.setExtent(QgsRectangle(0, 0, 10, 10))
+        self.assertEqual(cache.diskCacheKey(layer, settings), key)
+        cache.setDiskCacheImage(key, im, layer)
+        cache.waitForDiskCacheWrites()
+        self.assertFalse(cache.diskCacheImage(key, layer).isNull())
+
+        # data changes invalidate images, and images of a memory layer are keyed by its data generation
+        layer.dataChanged.emit()
+        self.assertTrue(cache.diskCacheImage(key, layer).isNull())
+        previous_key = key
+        key = cache.diskCacheKey(layer, settings)
+        self.assertNotEqual(key, previous_key)
+        cache.setDiskCacheImage(key, im, layer)
+        cache.waitForDiskCacheWrites()
+        self.assertFalse(cache.diskCacheImage(key, layer).isNull())
+
+        # style changes give another key
+        renderer = layer.renderer().clone()
+        renderer.symbol().setColor(QColor(0, 255, 0))
+        layer.setRenderer(renderer)
+        self.assertNotEqual(cache.diskCacheKey(layer, settings), key)
+
+        # editable layers are not cached
+        layer.startEditing()
+        self.assertFalse(cache.diskCacheKey(layer, settings))
+        layer.rollBack()
+
+    def testDiskCacheTrim(self):
+        """ test that least recently used images are removed when the cache is full """
+        tmp_dir = QTemporaryDir()
+        cache = QgsMapRendererCache()
+        cache.setDiskCacheDirectory(tmp_dir.path())
+        layer = QgsVectorLayer("Point?field=fldtxt:string",
+                               "layer1", "memory")
+        settings = QgsMapSettings()
+        settings.setOutputSize(QSize(100, 100))
+
+        im = QImage(100, 100, QImage.Format_ARGB32_Premultiplied)
+        im.fill(QColor(255, 0, 0))
+        keys = []
+        for i in range(3):
+            settings.setExtent(QgsRectangle(0, 0, 10 + i, 10 + i))
+            keys.append(cache.diskCacheKey(layer, settings))
+
+        cache.setDiskCacheImage(keys[0], im, layer)
+        cache.waitForDiskCacheWrites()
+        image_size = QDir(tmp_dir.path()).entryInfoList(['*.png'])[0].size()
+
+        # room for two images only
+        cache.setDiskCacheDirectory(tmp_dir.path(), image_size * 2 + image_size // 2)
+        cache.setDiskCacheImage(keys[1], im, layer)
+        cache.waitForDiskCacheWrites()
+        # use the first image, so that the second one becomes the least recently used
+        self.assertFalse(cache.diskCacheImage(keys[0], layer).isNull())
+        cache.setDiskCacheImage(keys[2], im, layer)
+        cache.waitForDiskCacheWrites()
+
+        self.assertEqual(len(QDir(tmp_dir.path()).entryList(['*.png'])), 2)
+        self.assertFalse(cache.diskCacheImage(keys[0], layer).isNull())
+        self.assertTrue(cache.diskCacheImage(keys[1], layer).isNull())
+        self.assertFalse(cache.diskCacheImage(keys[2], layer).isNull())
+
+        cache.clearDiskCache()
+        self.assertFalse(QDir(tmp_dir.path()).entryList(['*.png']))
+
 
 if __name__ == '__main__':
     unittest.main()